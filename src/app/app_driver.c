@@ -4,6 +4,10 @@
 #include "../core/chord_types.h"
 #include "../core/ring.h"
 #include "../util/util.h"
+#include "../util/trace.h"
+
+/* default trace dump path when built with `make trace` */
+#define TRACE_FILE_DEFAULT "chord.trace"
 
 /**
  * @TODO:
@@ -40,6 +44,7 @@ void do_ring_print();
 void do_stabilise_node();
 void do_fix_fingers();
 void do_node_add_random(int num);
+void do_trace_dump();
 
 int main(int argc, char *argv[]) {
   (void)argc;  /* Unused parameter */
@@ -47,6 +52,10 @@ int main(int argc, char *argv[]) {
   
   do_main_menu();
 
+#if CHORD_TRACE
+  do_trace_dump();
+#endif
+
   return EXIT_SUCCESS;
 }
 
@@ -256,6 +265,13 @@ void do_node_print() {
 }
 
 void do_node_leave() {
+  Node *node = do_node_get("Select node: ");
+  
+  if (node != NULL) {
+    node_leave(node);
+    
+    printf("\nNode %s left, its documents handed to its successor.\n", node->id);
+  }
 }
 
 void do_node_fail() {
@@ -267,6 +283,7 @@ void do_document_add() {
   char doc_filename[FILENAME_MAX_LENGTH];
   Document *doc;
   char doc_data[TEMP_STRING_LENGTH];
+  uint32_t outer_lookup;
   
   node = do_node_get("Select node context: ");
   
@@ -283,23 +300,47 @@ void do_document_add() {
   strcpy(doc->data, doc_data);
   doc->key = chord_hash(doc_filename);
   
+  outer_lookup = TRACE_SCOPE_BEGIN(TRACE_EV_CLI_BEGIN, node->key, doc->key);
   node_document_add(node, doc);
+  TRACE_SCOPE_END(outer_lookup, TRACE_EV_CLI_END, node->key, doc->key);
 }
 
 void do_document_query() {
   Node *ctx_node;
   char *prompt = "Enter document filename: ";
   char doc_filename[FILENAME_MAX_LENGTH];
+  uint32_t outer_lookup;
   
   ctx_node = do_node_get("Select node to perform search from: ");
   
   getString(doc_filename, FILENAME_MAX_LENGTH, prompt);
   
+  outer_lookup = TRACE_SCOPE_BEGIN(TRACE_EV_CLI_BEGIN, ctx_node->key, chord_hash(doc_filename));
   node_document_query(ctx_node, doc_filename);
+  TRACE_SCOPE_END(outer_lookup, TRACE_EV_CLI_END, ctx_node->key, chord_hash(doc_filename));
   
  
 }
 
+/**
+ * Write the lookup trace buffers to $CHORD_TRACE_FILE (or chord.trace)
+ * for decoding with build/chord_trace.
+ */
+void do_trace_dump() {
+  char *path = getenv("CHORD_TRACE_FILE");
+  
+  if (path == NULL) {
+    path = TRACE_FILE_DEFAULT;
+  }
+  
+  if (trace_dump(path) != 0) {
+    fprintf(stderr, "Failed to write trace to %s\n", path);
+  }
+  else {
+    printf("Trace written to %s\n", path);
+  }
+}
+
 void do_ring_print() {
   ring_print(FALSE, FALSE);
 }
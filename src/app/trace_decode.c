@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../util/trace.h"
+
+/**
+ * Offline decoder for lookup trace dumps.
+ *
+ * Usage: chord_trace <dump> [lookup_id]
+ *
+ * Prints one route timeline per lookup: every record sharing a lookup
+ * ID, in time order, with offsets relative to the first record.
+ */
+
+static int compare_by_lookup(const void *a, const void *b) {
+  const trace_record_t *ra = (const trace_record_t*)a;
+  const trace_record_t *rb = (const trace_record_t*)b;
+
+  if (ra->lookup_id != rb->lookup_id) {
+    return ra->lookup_id < rb->lookup_id ? -1 : 1;
+  }
+  if (ra->timestamp != rb->timestamp) {
+    return ra->timestamp < rb->timestamp ? -1 : 1;
+  }
+  return 0;
+}
+
+static void print_timeline(const trace_record_t *records, size_t count, double ns_per_tick) {
+  size_t i;
+  int hops = 0;
+  double total_us;
+
+  for (i = 0; i < count; i++) {
+    if (records[i].event == TRACE_EV_LOOKUP_HOP) {
+      hops++;
+    }
+  }
+  total_us = (double)(records[count - 1].timestamp - records[0].timestamp) * ns_per_tick / 1000.0;
+
+  printf("lookup %u: %d hops, %.3f us\n", records[0].lookup_id, hops, total_us);
+  for (i = 0; i < count; i++) {
+    double offset_us = (double)(records[i].timestamp - records[0].timestamp) * ns_per_tick / 1000.0;
+    printf("  +%10.3f us  t%-3u %-13s node %-6d arg %d\n",
+           offset_us, records[i].thread, trace_event_name(records[i].event),
+           records[i].node_key, records[i].arg);
+  }
+  printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+  trace_dump_t dump;
+  unsigned long only_id = 0;
+  size_t start, end;
+
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "Usage: %s <dump> [lookup_id]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (argc == 3) {
+    only_id = strtoul(argv[2], NULL, 10);
+  }
+
+  if (trace_dump_load(argv[1], &dump) != 0) {
+    fprintf(stderr, "Failed to read trace dump %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  printf("%zu records, %.4f ns/tick\n\n", dump.count, dump.ns_per_tick);
+
+  if (dump.count > 0) {
+    qsort(dump.records, dump.count, sizeof(trace_record_t), compare_by_lookup);
+  }
+
+  for (start = 0; start < dump.count; start = end) {
+    end = start + 1;
+    while (end < dump.count && dump.records[end].lookup_id == dump.records[start].lookup_id) {
+      end++;
+    }
+
+    /* records outside any lookup have no route to show */
+    if (dump.records[start].lookup_id == 0) {
+      continue;
+    }
+    if (only_id != 0 && dump.records[start].lookup_id != only_id) {
+      continue;
+    }
+    print_timeline(&dump.records[start], end - start, dump.ns_per_tick);
+  }
+
+  trace_dump_free(&dump);
+  return EXIT_SUCCESS;
+}
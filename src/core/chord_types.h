@@ -6,6 +6,7 @@
 
 /* defines */
 #define KEY_BITS 8
+#define FINGERS_MAX ((1 << KEY_BITS) - 1)   /* a finger table of base 2^KEY_BITS */
 #define TRUE 1
 #define FALSE 0
 #define RETURN_TO_MENU -1
@@ -26,6 +27,10 @@
  for replication */
 #define SUCCESSOR_LIST_SIZE 3
 
+/* node_balance() moves a node next to one holding more than this many
+ times its documents (1/epsilon in Karger and Ruhl) */
+#define BALANCE_RATIO 4
+
 #ifndef DEBUG_ON
 #define DEBUG_ON 0
 #endif
@@ -63,8 +68,62 @@ typedef struct Finger {
 typedef struct FingerTable {
   struct Finger **fingers;
   int length;
+  int next;               /* finger FINGER_FIX_NEXT refreshes next */
 } FingerTable;
 
+/* How node_fix_fingers_policy() maintains a finger table */
+typedef enum FingerPolicy {
+  FINGER_FIX_ALL,         /* look every finger up again */
+  FINGER_FIX_NEXT,        /* one finger per call, round robin (the paper's next) */
+  FINGER_FIX_SHARED,      /* look up only past the previous finger's node */
+  FINGER_FIX_CHANGED      /* ask each finger's node for its predecessor, look up dead ones */
+} FingerPolicy;
+
+/* What node_closest_preceding_node() chooses from */
+typedef enum RoutingView {
+  ROUTE_FINGERS,          /* the finger table only (per the paper) */
+  ROUTE_UNIFIED           /* fingers, successor list and predecessor, live nodes only */
+} RoutingView;
+
+/* Periodic tasks node_maintain() runs, each on its own period */
+#define MAINTAIN_STABILISE 0
+#define MAINTAIN_FIX_FINGERS 1
+#define MAINTAIN_CHECK_PREDECESSOR 2
+#define MAINTAIN_TASKS 3
+
+/* When a node's maintenance tasks next run, in ticks. Periods adapt
+ between min_period and max_period (equal bounds: fixed periods) */
+typedef struct Schedule {
+  int period[MAINTAIN_TASKS];
+  int due[MAINTAIN_TASKS];
+  int min_period;
+  int max_period;
+  int tick;               /* last tick node_maintain() ran */
+} Schedule;
+
+/* Membership changes a table keeps to pass on */
+#define MEMBER_DELTAS 32
+
+/* A join (or leave) heard of, and which ways it was passed on */
+typedef struct MemberDelta {
+  int key;
+  struct Node *node;
+  int joined;
+  int sent_forward;       /* to the successor */
+  int sent_back;          /* to the predecessor */
+} MemberDelta;
+
+/* Every member of the ring sorted by key, for one-hop lookups: the
+ keys apart from the nodes, so a search reads only the keys */
+typedef struct Membership {
+  int *keys;
+  struct Node **nodes;
+  int count;
+  int capacity;
+  MemberDelta deltas[MEMBER_DELTAS];
+  int num_deltas;
+} Membership;
+
 /* Node */
 typedef struct Node {
   char *id;
@@ -78,6 +137,14 @@ typedef struct Node {
   
   /* per E.3 for replication */
   struct Node *successors[SUCCESSOR_LIST_SIZE];
+  
+  struct Schedule schedule;
+  
+  /* one-hop routing table, NULL unless node_members_enable() */
+  struct Membership *members;
+  
+  /* physical host of a virtual node, NULL for a node of its own */
+  struct Host *host;
 } Node;
 
 /* Document */
@@ -87,12 +154,25 @@ typedef struct Document {
   char data[TEMP_STRING_LENGTH];
 } Document;
 
+/* A physical host running virtual nodes: they keep documents in its
+ one store and route with each other's fingers */
+typedef struct Host {
+  char *id;
+  struct Node **vnodes;
+  int num_vnodes;
+  struct Document **documents;
+  int num_documents;
+} Host;
+
 /* Chord Ring */
 typedef struct Ring {
   Node *first_node;
   Node *last_node;
   unsigned size;
-  Node *nodes[500];
+  unsigned capacity;
+  Node **nodes;           /* every node created, grown as needed */
+  RoutingView routing;
+  int finger_base;        /* b: finger tables made from now on hold (b-1)·log_b fingers */
 } Ring;
 
 #endif
@@ -13,31 +13,47 @@ Finger* finger_init(Node *node, int start) {
   return finger;
 }
 
+/**
+ * Per the ring's finger base b, b - 1 fingers for each power of b that
+ * fits the key space, at distances i * b^k for i in 1..b-1 (b = 2 is
+ * the paper's table of KEY_BITS fingers)
+ */
 FingerTable* finger_table_init(Node *node) {
   int i;
+  int span;
   Finger *finger = NULL;
   FingerTable *finger_table = NULL;
   int start;
+  int base = MAX(2, MIN(ring_get()->finger_base, ring_key_max()));
   
   /* allocate finger table memory */
   if ((finger_table = malloc(sizeof(FingerTable))) == NULL) {
     BAIL("Failed to allocate memory for FingerTable");
   }
   
-  finger_table->length = KEY_BITS;
+  finger_table->length = 0;
+  finger_table->next = 0;
+  for (span = 1; span < ring_key_max(); span *= base) {
+    for (i = 1; i < base && i * span < ring_key_max(); i++) {
+      finger_table->length++;
+    }
+  }
   
   /* allocate fingers in the table */
   if ((finger_table->fingers = malloc(sizeof(Finger) * (size_t)finger_table->length)) == NULL) {
     BAIL("Failed to allocate memory for Finger");
   }
   
-  for (i = 0; i < finger_table->length; i++) {
-    start = node->key + (int)pow(2, i);
-    if (start > ring_key_max()) {
-      start -= ring_key_max();
+  finger_table->length = 0;
+  for (span = 1; span < ring_key_max(); span *= base) {
+    for (i = 1; i < base && i * span < ring_key_max(); i++) {
+      start = node->key + i * span;
+      if (start > ring_key_max()) {
+        start -= ring_key_max();
+      }
+      finger = finger_init(node, start);
+      finger_table->fingers[finger_table->length++] = finger;
     }
-    finger = finger_init(node, start);
-    finger_table->fingers[i] = finger;
   }
   
   return finger_table;
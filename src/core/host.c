@@ -0,0 +1,152 @@
+#include "host.h"
+
+Host* host_init(char *id) {
+  Host *host = NULL;
+  
+  if ((host = malloc(sizeof(Host))) == NULL) {
+    BAIL("Failed to allocate memory for Host");
+  }
+  
+  host->id = id;
+  host->vnodes = NULL;
+  host->num_vnodes = 0;
+  host->documents = NULL;
+  host->num_documents = 0;
+  
+  return host;
+}
+
+/**
+ * Make node one of host's virtual nodes
+ */
+void host_add(Host *host, Node *node) {
+  if ((host->vnodes = realloc(host->vnodes, sizeof(Node*) * (size_t)(host->num_vnodes + 1))) == NULL) {
+    BAIL("Failed to allocate memory for host virtual nodes");
+  }
+  
+  host->vnodes[host->num_vnodes] = node;
+  host->num_vnodes++;
+  node->host = host;
+}
+
+/**
+ * TRUE if a virtual node of host already holds key
+ */
+int host_key_taken(const Host *host, int key) {
+  int i;
+  
+  for (i = 0; i < host->num_vnodes; i++) {
+    if (host->vnodes[i]->key == key) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/**
+ * A host running num_vnodes virtual nodes, named "<n>.<id>" and each on
+ * a key of its own. The index leads: chord_hash() weighs the last
+ * characters least, so "<id>.<n>" would put them on adjacent keys
+ */
+Host* host_spawn(char *id, int num_vnodes) {
+  Host *host = host_init(id);
+  char *vnode_id;
+  size_t length = strlen(id) + 12;
+  int n;
+  
+  for (n = 0; host->num_vnodes < num_vnodes && n < ring_key_max() * 4; n++) {
+    if ((vnode_id = malloc(length)) == NULL) {
+      BAIL("Failed to allocate memory for virtual node id");
+    }
+    snprintf(vnode_id, length, "%d.%s", n, id);
+    
+    if (host_key_taken(host, chord_hash(vnode_id))) {
+      free(vnode_id);
+      continue;
+    }
+    host_add(host, node_init(vnode_id));
+  }
+  
+  return host;
+}
+
+/**
+ * node_join() every virtual node through existing_node, or through the
+ * first of them, which creates the ring, if existing_node is NULL
+ */
+void host_join(Host *host, Node *existing_node) {
+  int i = 0;
+  
+  if (existing_node == NULL) {
+    node_create(host->vnodes[0]);
+    existing_node = host->vnodes[0];
+    i = 1;
+  }
+  for (; i < host->num_vnodes; i++) {
+    node_join(existing_node, host->vnodes[i]);
+  }
+}
+
+/**
+ * Keys the host's virtual nodes are responsible for, each from its
+ * predecessor's key (excluded) to its own
+ */
+int host_keys(const Host *host) {
+  int i;
+  int keys = 0;
+  Node *vnode;
+  
+  for (i = 0; i < host->num_vnodes; i++) {
+    vnode = host->vnodes[i];
+    if (vnode->state == NODE_STATE_DEAD) {
+      continue;
+    }
+    keys += vnode->predecessor == NULL || vnode->predecessor == vnode
+      ? ring_key_max() : key_distance(vnode->predecessor->key, vnode->key);
+  }
+  
+  return MIN(keys, ring_key_max());
+}
+
+void host_print(const Host *host) {
+  printf("%-11s %6d %5d %7d\n", host->id, host->num_vnodes, host_keys(host), host->num_documents);
+}
+
+/**
+ * Load per host: keys and documents held, and the spread of each as
+ * the largest and smallest against the mean
+ */
+void host_print_load(Host **hosts, int num_hosts) {
+  int i;
+  int keys, most_keys = 0, least_keys = ring_key_max(), total_keys = 0;
+  int most_documents = 0, least_documents = 0, total_documents = 0;
+  double mean_keys, mean_documents;
+  
+  if (num_hosts == 0) {
+    printf("No hosts.\n");
+    return;
+  }
+  
+  printf("%-11s %6s %5s %7s\n", "Host", "VNodes", "Keys", "# Docs");
+  printf("----------- ------ ----- -------\n");
+  for (i = 0; i < num_hosts; i++) {
+    host_print(hosts[i]);
+    keys = host_keys(hosts[i]);
+    most_keys = MAX(most_keys, keys);
+    least_keys = MIN(least_keys, keys);
+    total_keys += keys;
+    most_documents = MAX(most_documents, hosts[i]->num_documents);
+    least_documents = i == 0 ? hosts[i]->num_documents : MIN(least_documents, hosts[i]->num_documents);
+    total_documents += hosts[i]->num_documents;
+  }
+  printf("----------- ------ ----- -------\n");
+  
+  mean_keys = (double)total_keys / num_hosts;
+  mean_documents = (double)total_documents / num_hosts;
+  printf("Keys:      max/mean %.2f, min/mean %.2f\n",
+         most_keys / mean_keys, least_keys / mean_keys);
+  if (total_documents > 0) {
+    printf("Documents: max/mean %.2f, min/mean %.2f\n",
+           most_documents / mean_documents, least_documents / mean_documents);
+  }
+}
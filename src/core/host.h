@@ -0,0 +1,18 @@
+#ifndef _HOST_H
+#define _HOST_H
+
+#include <string.h>
+#include "chord_types.h"
+#include "key.h"
+#include "node.h"
+
+Host* host_init(char *id);
+void host_add(Host *host, Node *node);
+int host_key_taken(const Host *host, int key);
+Host* host_spawn(char *id, int num_vnodes);
+void host_join(Host *host, Node *existing_node);
+int host_keys(const Host *host);
+void host_print(const Host *host);
+void host_print_load(Host **hosts, int num_hosts);
+
+#endif
@@ -38,6 +38,14 @@ int key_in_range(int check, int bound1, int bound2, int half) {
   }
 }
 
+/**
+ * Distance going clockwise round the ring from one key to another
+ * (0 for the same key)
+ */
+int key_distance(int from, int to) {
+  return ((to - from) % ring_key_max() + ring_key_max()) % ring_key_max();
+}
+
 int key_init(Node *node, int idx) {
   (void)node;  /* Unused parameter - TODO: implement or remove */
   /* @TODO: what is this supposed to do? */
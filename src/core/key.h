@@ -5,6 +5,7 @@
 #include "ring.h"
 
 int key_in_range(int check, int bound1, int bound2, int half);
+int key_distance(int from, int to);
 int key_init(Node *node, int idx);
 
 #endif
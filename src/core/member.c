@@ -0,0 +1,192 @@
+#include "member.h"
+
+Membership* membership_init() {
+  Membership *members = NULL;
+  
+  if ((members = malloc(sizeof(Membership))) == NULL) {
+    BAIL("Failed to allocate memory for Membership");
+  }
+  
+  members->keys = NULL;
+  members->nodes = NULL;
+  members->count = 0;
+  members->capacity = 0;
+  members->num_deltas = 0;
+  
+  return members;
+}
+
+void membership_free(Membership *members) {
+  free(members->keys);
+  free(members->nodes);
+  free(members);
+}
+
+static void membership_grow(Membership *members, int capacity) {
+  if (capacity <= members->capacity) {
+    return;
+  }
+  if ((members->keys = realloc(members->keys, sizeof(int) * (size_t)capacity)) == NULL
+      || (members->nodes = realloc(members->nodes, sizeof(Node*) * (size_t)capacity)) == NULL) {
+    BAIL("Failed to grow the membership table");
+  }
+  members->capacity = capacity;
+}
+
+/* index of the first member at or after key, count if there is none */
+static int membership_find(const Membership *members, int key) {
+  int low = 0;
+  int high = members->count;
+  int mid;
+  
+  while (low < high) {
+    mid = low + (high - low) / 2;
+    if (members->keys[mid] < key) {
+      low = mid + 1;
+    }
+    else {
+      high = mid;
+    }
+  }
+  
+  return low;
+}
+
+void membership_copy(Membership *to, const Membership *from) {
+  membership_grow(to, from->count);
+  memcpy(to->keys, from->keys, sizeof(int) * (size_t)from->count);
+  memcpy(to->nodes, from->nodes, sizeof(Node*) * (size_t)from->count);
+  to->count = from->count;
+}
+
+/**
+ * Put node in the table, in place of any member on its key. TRUE if
+ * that changed the table
+ */
+int membership_add(Membership *members, Node *node) {
+  int i = membership_find(members, node->key);
+  
+  if (i < members->count && members->keys[i] == node->key) {
+    if (members->nodes[i] == node) {
+      return FALSE;
+    }
+    members->nodes[i] = node;
+    return TRUE;
+  }
+  
+  if (members->count == members->capacity) {
+    membership_grow(members, members->capacity ? members->capacity * 2 : 16);
+  }
+  memmove(&members->keys[i + 1], &members->keys[i], sizeof(int) * (size_t)(members->count - i));
+  memmove(&members->nodes[i + 1], &members->nodes[i], sizeof(Node*) * (size_t)(members->count - i));
+  members->keys[i] = node->key;
+  members->nodes[i] = node;
+  members->count++;
+  
+  return TRUE;
+}
+
+/**
+ * Take node out of the table (not another member on its key). TRUE if
+ * it was there
+ */
+int membership_remove(Membership *members, Node *node) {
+  int i = membership_find(members, node->key);
+  
+  if (i == members->count || members->nodes[i] != node) {
+    return FALSE;
+  }
+  memmove(&members->keys[i], &members->keys[i + 1], sizeof(int) * (size_t)(members->count - i - 1));
+  memmove(&members->nodes[i], &members->nodes[i + 1], sizeof(Node*) * (size_t)(members->count - i - 1));
+  members->count--;
+  
+  return TRUE;
+}
+
+/* keep a change to pass on; entries passed both ways go first, then the oldest */
+static void membership_record(Membership *members, Node *node, int joined,
+                              int sent_forward, int sent_back) {
+  MemberDelta *delta;
+  int i, kept = 0;
+  
+  if (members->num_deltas == MEMBER_DELTAS) {
+    for (i = 0; i < members->num_deltas; i++) {
+      if (!members->deltas[i].sent_forward || !members->deltas[i].sent_back) {
+        members->deltas[kept++] = members->deltas[i];
+      }
+    }
+    if (kept == MEMBER_DELTAS) {
+      memmove(&members->deltas[0], &members->deltas[1], sizeof(MemberDelta) * (MEMBER_DELTAS - 1));
+      kept--;
+    }
+    members->num_deltas = kept;
+  }
+  
+  delta = &members->deltas[members->num_deltas++];
+  delta->key = node->key;
+  delta->node = node;
+  delta->joined = joined;
+  delta->sent_forward = sent_forward;
+  delta->sent_back = sent_back;
+}
+
+/**
+ * A join or leave seen by this node itself: applied, and kept to pass
+ * on both ways round the ring. TRUE if it changed the table
+ */
+int membership_learn(Membership *members, Node *node, int joined) {
+  int changed = joined ? membership_add(members, node) : membership_remove(members, node);
+  
+  if (changed) {
+    membership_record(members, node, joined, FALSE, FALSE);
+  }
+  return changed;
+}
+
+/**
+ * The member at or after key, going round the ring (NULL if empty)
+ */
+Node* membership_successor(const Membership *members, int key) {
+  int i;
+  
+  if (members->count == 0) {
+    return NULL;
+  }
+  i = membership_find(members, key % ring_key_max());
+  return members->nodes[i < members->count ? i : 0];
+}
+
+/**
+ * Piggyback from's changes not yet passed this way on a stabilise:
+ * forward when from is members' predecessor, back when its successor.
+ * Changes new to members are applied and kept to pass on further the
+ * same way. Returns the changes passed
+ */
+int membership_exchange(Membership *members, Membership *from, int forward) {
+  int i;
+  int passed = 0;
+  int changed;
+  MemberDelta *delta;
+  
+  for (i = 0; i < from->num_deltas; i++) {
+    delta = &from->deltas[i];
+    if (forward ? delta->sent_forward : delta->sent_back) {
+      continue;
+    }
+    if (forward) {
+      delta->sent_forward = TRUE;
+    }
+    else {
+      delta->sent_back = TRUE;
+    }
+    passed++;
+    
+    changed = delta->joined ? membership_add(members, delta->node)
+      : membership_remove(members, delta->node);
+    if (changed) {
+      membership_record(members, delta->node, delta->joined, !forward, forward);
+    }
+  }
+  
+  return passed;
+}
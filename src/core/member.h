@@ -0,0 +1,17 @@
+#ifndef _MEMBER_H
+#define _MEMBER_H
+
+#include <string.h>
+#include "chord_types.h"
+#include "key.h"
+
+Membership* membership_init();
+void membership_free(Membership *members);
+void membership_copy(Membership *to, const Membership *from);
+int membership_add(Membership *members, Node *node);
+int membership_remove(Membership *members, Node *node);
+int membership_learn(Membership *members, Node *node, int joined);
+Node* membership_successor(const Membership *members, int key);
+int membership_exchange(Membership *members, Membership *from, int forward);
+
+#endif
@@ -1,8 +1,11 @@
 #include "node.h"
 
+static void node_schedule_wake(Node *node, int task, int failed);
+
 Node* node_init(char *id) {
   Node *node = NULL;
   Ring *ring = ring_get();
+  int i;
   
   if ((node = malloc(sizeof(Node))) == NULL) {
     BAIL("Failed to allocate memory for Node");
@@ -12,8 +15,28 @@ Node* node_init(char *id) {
   node->key = chord_hash(id);
   node->finger_table = finger_table_init(node);
   node->state = NODE_STATE_RUNNING;
+  node->successor = NULL;
+  node->predecessor = NULL;
+  node->documents = NULL;
   node->num_documents = 0;
+  for (i = 0; i < SUCCESSOR_LIST_SIZE; i++) {
+    node->successors[i] = NULL;
+  }
+  node->schedule.tick = 0;
+  node_schedule(node, 1, 1);
+  node->members = NULL;
+  node->host = NULL;
   
+  if (ring->size == ring->capacity) {
+    unsigned capacity = ring->capacity ? ring->capacity * 2 : 64;
+    Node **nodes = realloc(ring->nodes, sizeof(Node*) * capacity);
+
+    if (nodes == NULL) {
+      BAIL("Failed to grow the ring's node array");
+    }
+    ring->nodes = nodes;
+    ring->capacity = capacity;
+  }
   ring->nodes[ring->size] = node;
   ring->size++;
   
@@ -21,16 +44,24 @@ Node* node_init(char *id) {
 }
 
 Node* node_find_successor(Node *node, int key) {
-  return node_find_successor_impl(node, node, key, 0);
+  Node *successor;
+  uint32_t outer_lookup = TRACE_SCOPE_BEGIN(TRACE_EV_LOOKUP_BEGIN, node->key, key);
+  
+  successor = node_find_successor_impl(node, node, key, 0);
+  
+  TRACE_SCOPE_END(outer_lookup, TRACE_EV_LOOKUP_END, successor->key, key);
+  return successor;
 }
 
 Node* node_find_successor_impl(Node *orig_node, Node *node, int key, int depth) {
   Node *closest_preceding_node = NULL;
 
   depth++;
+  TRACE(TRACE_EV_LOOKUP_HOP, node->key, depth);
   
   if (depth > KEY_BITS * 2) {
-    return node_find_successor(orig_node->successor, key);
+    /* restart from the origin's successor within the same traced lookup */
+    return node_find_successor_impl(orig_node->successor, orig_node->successor, key, 0);
   }
   
   if (key_in_range(key, node->key, node->successor->key, TRUE)
@@ -46,19 +77,185 @@ Node* node_find_successor_impl(Node *orig_node, Node *node, int key, int depth)
   }
 }
 
+/* candidate if it is live, in (node, key) and closer to key than closest */
+static Node* node_closer(Node *node, Node *closest, Node *candidate, int key) {
+  if (candidate == NULL || candidate->state == NODE_STATE_DEAD
+      || !key_in_range(candidate->key, node->key, key, FALSE)) {
+    return closest;
+  }
+  if (closest == node || key_distance(candidate->key, key) < key_distance(closest->key, key)) {
+    return candidate;
+  }
+  return closest;
+}
+
 Node* node_closest_preceding_node(Node *node, int key) {
-  int i;
+  int i, j;
   Finger *finger = NULL;
+  Node *closest = node;
+  Node *vnode;
   
-  for (i = KEY_BITS - 1; i >= 0; i--) {
-    finger = node->finger_table->fingers[i];
-    
-    if (key_in_range(finger->start, node->key, key, FALSE)) {
-      return finger->node;
+  if (ring_get()->routing == ROUTE_FINGERS) {
+    for (i = node->finger_table->length - 1; i >= 0; i--) {
+      finger = node->finger_table->fingers[i];
+      
+      /* the finger's node, not its start: a start before key can still
+         resolve to a node past it, and routing would then loop */
+      if (key_in_range(finger->node->key, node->key, key, FALSE)) {
+        return finger->node;
+      }
     }
+    return node;
   }
   
-  return node;
+  /* every node this one knows of: the successor list and predecessor
+     are kept fresh by stabilise, and cover for stale or dead fingers */
+  for (i = 0; i < node->finger_table->length; i++) {
+    closest = node_closer(node, closest, node->finger_table->fingers[i]->node, key);
+  }
+  closest = node_closer(node, closest, node->successor, key);
+  for (i = 0; i < SUCCESSOR_LIST_SIZE; i++) {
+    closest = node_closer(node, closest, node->successors[i], key);
+  }
+  closest = node_closer(node, closest, node->predecessor, key);
+  
+  /* a virtual node also knows its host's other virtual nodes and their
+     fingers: reading them costs no message */
+  if (node->host != NULL) {
+    for (i = 0; i < node->host->num_vnodes; i++) {
+      vnode = node->host->vnodes[i];
+      if (vnode == node || vnode->state == NODE_STATE_DEAD) {
+        continue;
+      }
+      closest = node_closer(node, closest, vnode, key);
+      for (j = 0; j < vnode->finger_table->length; j++) {
+        closest = node_closer(node, closest, vnode->finger_table->fingers[j]->node, key);
+      }
+    }
+  }
+  
+  return closest;
+}
+
+/**
+ * One routing step of node_find_successor_impl() at node, for callers
+ * that move a lookup between nodes themselves: the key's successor if
+ * done is set, otherwise the node to continue at
+ */
+Node* node_next_hop(Node *node, int key, int *done) {
+  Node *closest_preceding_node = NULL;
+  
+  if (key_in_range(key, node->key, node->successor->key, TRUE)
+      || node == node->successor) {
+    *done = TRUE;
+    return node->successor;
+  }
+  
+  *done = FALSE;
+  closest_preceding_node = node_closest_preceding_node(node, key);
+  return closest_preceding_node == node ? node->successor : closest_preceding_node;
+}
+
+/**
+ * node_find_successor() taken one node_next_hop() at a time, as it
+ * would run across the network: adds the nodes asked after the first
+ * (the remote hops) to *hops. A step to a virtual node on the same
+ * host is not a hop
+ */
+Node* node_lookup(Node *node, int key, int *hops) {
+  Node *current = node;
+  Node *next;
+  int done;
+  int steps;
+  int max_steps = (int)ring_get()->size + KEY_BITS;
+  
+  for (steps = 0; steps < max_steps; steps++) {
+    next = node_next_hop(current, key, &done);
+    if (done) {
+      return next;
+    }
+    if (current->host == NULL || next->host != current->host) {
+      (*hops)++;
+    }
+    current = next;
+  }
+  
+  /* went round the ring without settling: fall back to the restart */
+  return node_find_successor(node, key);
+}
+
+/**
+ * One-hop lookup (Gupta et al.): node's membership table names key's
+ * successor, which is asked directly and answers if key falls between
+ * its predecessor (if live) and itself. A dead member is dropped and
+ * the next one asked; a member a newer node now precedes is corrected
+ * from what the ask saw, and the lookup falls back to node_lookup().
+ * Adds the nodes asked to *hops
+ */
+Node* node_lookup_one_hop(Node *node, int key, int *hops) {
+  Node *member;
+  Node *predecessor;
+  int asked;
+  
+  if (node->members == NULL) {
+    return node_lookup(node, key, hops);
+  }
+  if (node == node->successor || key_in_range(key, node->key, node->successor->key, TRUE)) {
+    return node->successor;
+  }
+  
+  for (asked = 0; asked < SUCCESSOR_LIST_SIZE; asked++) {
+    member = membership_successor(node->members, key);
+    if (member == NULL) {
+      break;
+    }
+    if (member != node) {
+      (*hops)++;
+    }
+    if (member->state == NODE_STATE_DEAD) {
+      membership_learn(node->members, member, FALSE);
+      continue;
+    }
+    predecessor = member->predecessor;
+    if (predecessor == NULL || predecessor->state == NODE_STATE_DEAD
+        || key_in_range(key, predecessor->key, member->key, TRUE)) {
+      return member;
+    }
+    membership_learn(node->members, predecessor, TRUE);
+    break;
+  }
+  
+  return node_lookup(node, key, hops);
+}
+
+/**
+ * Give node a membership table for node_lookup_one_hop(): a copy of
+ * its successor's if it has one, else one built by walking the
+ * successors round the ring. node's own join is passed on with its
+ * next stabilises. Returns the messages used
+ */
+int node_members_enable(Node *node) {
+  Node *current;
+  int messages = 0;
+  int max_steps = (int)ring_get()->size;
+  
+  node->members = membership_init();
+  if (node->successor != node && node->successor->members != NULL) {
+    membership_copy(node->members, node->successor->members);
+    membership_remove(node->members, node);
+    messages++;
+  }
+  else {
+    current = node->successor;
+    while (current != node && current->state != NODE_STATE_DEAD && messages < max_steps) {
+      membership_add(node->members, current);
+      current = current->successor;
+      messages++;
+    }
+  }
+  membership_learn(node->members, node, TRUE);
+  
+  return messages;
 }
 
 void node_create(Node *node) {
@@ -73,13 +270,163 @@ void node_create(Node *node) {
 void node_join(Node *existing_node, Node *new_node) {
   new_node->predecessor = NULL;
   new_node->successor = node_find_successor(existing_node, new_node->key);
+  node_documents_handoff(new_node);
+}
+
+/**
+ * Seed node's fingers from source's table, as if fetched in one
+ * transfer: a start up to node's successor takes it, any other the
+ * first copied node at or after the start
+ */
+static void node_fingers_seed(Node *node, Node *source) {
+  int i, j;
+  Node *candidate;
+  Finger *finger = NULL;
+  FingerTable *copied = source->finger_table;
+  
+  for (i = 0; i < node->finger_table->length; i++) {
+    finger = node->finger_table->fingers[i];
+    finger->node = node->successor;
+    if (key_in_range(finger->start, node->key, node->successor->key, TRUE)) {
+      continue;
+    }
+    for (j = 0; j < copied->length; j++) {
+      candidate = copied->fingers[j]->node;
+      if (key_distance(finger->start, candidate->key)
+          < key_distance(finger->start, finger->node->key)) {
+        finger->node = candidate;
+      }
+    }
+  }
+}
+
+/**
+ * node_join() seeding new_node's fingers from its successor's table
+ * (per IV.E of the paper) instead of looking each one up. Fingers the
+ * copy gets wrong are left to later fix_fingers rounds. Returns the
+ * messages used: the lookup sent to existing_node, its hops and the
+ * transfer
+ */
+int node_join_copy(Node *existing_node, Node *new_node) {
+  int messages = 1;
+  
+  new_node->predecessor = NULL;
+  new_node->successor = node_lookup(existing_node, new_node->key, &messages);
+  node_documents_handoff(new_node);
+  
+  node_fingers_seed(new_node, new_node->successor);
+  messages++;
+  
+  return messages;
+}
+
+/* joiners grouped by successor, each group in key order */
+static int node_join_order(const void *a, const void *b) {
+  const Node *x = *(Node * const *)a;
+  const Node *y = *(Node * const *)b;
+  
+  if (x->successor != y->successor) {
+    return x->successor->key != y->successor->key
+      ? x->successor->key - y->successor->key
+      : (x->successor < y->successor ? -1 : 1);
+  }
+  return key_distance(y->key, y->successor->key) - key_distance(x->key, x->successor->key);
+}
+
+/**
+ * Admit count nodes joining at once. Each is looked up from
+ * existing_node as node_join() would, then the joiners sharing a
+ * successor are spliced in together: the successor links them in key
+ * order between its predecessor and itself, tells the predecessor,
+ * hands each its documents and seeds their fingers from its table. Then every joiner and
+ * spliced predecessor stabilises once. A run whose successor and
+ * predecessor disagree is left for stabilisation to place. Returns
+ * the messages used (lookups and their hops, one transfer per joiner,
+ * one splice per run, one STABILIZE per node stabilised). joining is
+ * reordered
+ */
+int node_join_batch(Node *existing_node, Node **joining, int count) {
+  int i, first, last;
+  int messages = 0;
+  Node *successor;
+  Node *predecessor;
+  
+  for (i = 0; i < count; i++) {
+    joining[i]->predecessor = NULL;
+    messages++;
+    joining[i]->successor = node_lookup(existing_node, joining[i]->key, &messages);
+  }
+  qsort(joining, (size_t)count, sizeof(Node*), node_join_order);
+  
+  for (first = 0; first < count; first = last + 1) {
+    successor = joining[first]->successor;
+    last = first;
+    while (last + 1 < count && joining[last + 1]->successor == successor) {
+      last++;
+    }
+    
+    predecessor = successor->successor == successor ? successor : successor->predecessor;
+    if (predecessor != NULL
+        && (predecessor->successor != successor
+            || (predecessor != successor
+                && !key_in_range(joining[first]->key, predecessor->key, successor->key, FALSE)))) {
+      predecessor = NULL;
+    }
+    
+    for (i = first; i <= last; i++) {
+      joining[i]->predecessor = i == first ? predecessor : joining[i - 1];
+      
+      /* first to last, each joiner takes only its own range of the
+         successor's documents */
+      joining[i]->successor = successor;
+      if (predecessor != NULL) {
+        successor->predecessor = joining[i]->predecessor;
+      }
+      node_documents_handoff(joining[i]);
+      
+      joining[i]->successor = i == last ? successor : joining[i + 1];
+      node_fingers_seed(joining[i], successor);
+      messages++;
+    }
+    if (predecessor != NULL) {
+      successor->predecessor = joining[last];
+      predecessor->successor = joining[first];
+      messages++;
+      node_stabilise(predecessor);
+      messages++;
+    }
+  }
+  
+  for (i = 0; i < count; i++) {
+    node_stabilise(joining[i]);
+    messages++;
+  }
+  
+  return messages;
 }
 
 void node_stabilise(Node *node) {
-  Node *successor = node->successor;
-  Node *x = node->successor->predecessor;
+  Node *successor;
+  Node *x;
   int i = 0;
   
+  /* per E.3 a failed successor gives way to the first live one listed */
+  if (node->successor->state == NODE_STATE_DEAD) {
+    if (node->members != NULL) {
+      membership_learn(node->members, node->successor, FALSE);
+    }
+    node->successor = node;
+    for (i = 0; i < SUCCESSOR_LIST_SIZE; i++) {
+      if (node->successors[i] != NULL && node->successors[i]->state != NODE_STATE_DEAD) {
+        node->successor = node->successors[i];
+        break;
+      }
+    }
+    i = 0;
+  }
+  successor = node->successor;
+  x = node->successor->predecessor;
+  
   /* per E.3 maintain successor list */
   while (successor != NULL && i < SUCCESSOR_LIST_SIZE) {
     node->successors[i] = successor;
@@ -87,13 +434,68 @@ void node_stabilise(Node *node) {
     i++;
   }
   
-  if (x != NULL) {
+  if (x != NULL && x->state != NODE_STATE_DEAD) {
     if (node == node->successor
         || key_in_range(x->key, node->key, node->successor->key, FALSE)) {
       node->successor = x;
+      if (node->members != NULL) {
+        membership_learn(node->members, x, TRUE);
+      }
     }
   }
   node_notify(node->successor, node);
+  
+  /* membership changes ride on the stabilise, both ways */
+  if (node->members != NULL && node->successor->members != NULL && node->successor != node) {
+    membership_exchange(node->successor->members, node->members, TRUE);
+    membership_exchange(node->members, node->successor->members, FALSE);
+  }
+}
+
+/**
+ * The successor's half of a stabilise round done in one exchange:
+ * node answers check_node with its predecessor as it was before
+ * check_node's notify, then takes the notify, and sets successors
+ * (count entries) to its own successor list
+ */
+Node* node_stabilise_answer(Node *node, Node *check_node, Node **successors, int *count) {
+  Node *predecessor = node->predecessor;
+  int i = 0;
+  
+  if (node->successors[0] == NULL) {
+    /* not stabilised yet: all it knows is its successor */
+    successors[i++] = node->successor;
+  }
+  while (i < SUCCESSOR_LIST_SIZE && node->successors[i] != NULL) {
+    successors[i] = node->successors[i];
+    i++;
+  }
+  *count = i;
+  
+  node_notify(node, check_node);
+  return predecessor;
+}
+
+/**
+ * The asking node's half: the same updates as node_stabilise() made
+ * from node_stabilise_answer()'s reply. The list becomes the successor
+ * followed by its own list (per E.3). The notify went to the old
+ * successor, so a newly adopted one has not heard from node yet
+ */
+void node_stabilise_adopt(Node *node, Node *predecessor, Node **successors, int count) {
+  int i;
+  
+  node->successors[0] = node->successor;
+  for (i = 1; i < SUCCESSOR_LIST_SIZE; i++) {
+    node->successors[i] = i - 1 < count ? successors[i - 1] : NULL;
+  }
+  
+  if (predecessor != NULL) {
+    if (node == node->successor
+        || key_in_range(predecessor->key, node->key, node->successor->key, FALSE)) {
+      node->successor = predecessor;
+    }
+  }
 }
 
 void node_notify(Node *notify_node, Node *check_node) {
@@ -101,50 +503,234 @@ void node_notify(Node *notify_node, Node *check_node) {
        || key_in_range(check_node->key, notify_node->predecessor->key, notify_node->key, FALSE))) {
     
     /* check_node thinks it might be notify_node's predecessor */
+    if (notify_node->predecessor != check_node) {
+      node_schedule_wake(notify_node, MAINTAIN_STABILISE, FALSE);
+      if (notify_node->members != NULL) {
+        membership_learn(notify_node->members, check_node, TRUE);
+      }
+    }
     notify_node->predecessor = check_node;
   }
 }
 
 void node_fix_fingers(Node *node) {
-  int i;
-  Finger *finger = NULL;
-  Node *nodes[KEY_BITS];
+  node_fix_fingers_policy(node, FINGER_FIX_ALL);
+}
+
+/**
+ * Finger's node as FINGER_FIX_CHANGED keeps it: while the node's
+ * predecessor still falls in [start, node) it has joined in front and
+ * becomes the finger. One message per predecessor asked; a finger on
+ * node itself, on a dead node or before start (an answer from a ring
+ * still forming) is looked up instead
+ */
+static Node* node_finger_recheck(Node *node, Finger *finger, int *messages) {
+  Node *current = finger->node;
+  Node *predecessor;
+  int before_start = (finger->start + ring_key_max() - 1) % ring_key_max();
+  int probes;
   
-  /* reset */
-  for (i = 0; i < KEY_BITS; i++) {
-    finger = node->finger_table->fingers[i];
-    finger->node = node->successor;
+  if (current == node || current->state == NODE_STATE_DEAD
+      || key_in_range(current->key, node->key, before_start, TRUE)) {
+    return node_lookup(node, finger->start, messages);
   }
   
-  for (i = 0; i < KEY_BITS; i++) {
-    finger = node->finger_table->fingers[i];
-    nodes[i] = node_find_successor(node, finger->start);
-    /*
-    finger = node->finger_table->fingers[i];
-    finger->node = node_find_successor(node, finger->start);
-    */
+  for (probes = 0; probes < KEY_BITS * 2; probes++) {
+    predecessor = current->predecessor;
+    (*messages)++;
+    if (predecessor == NULL || predecessor->state == NODE_STATE_DEAD
+        || !key_in_range(predecessor->key, before_start, current->key, FALSE)) {
+      return current;
+    }
+    current = predecessor;
   }
   
-  for (i = 0; i < KEY_BITS; i++) {
-    finger = node->finger_table->fingers[i];
-    finger->node = nodes[i];
-  }
+  return node_lookup(node, finger->start, messages);
+}
+
+/**
+ * Refresh node's finger table by policy and return the messages it
+ * cost: lookup hops (node_lookup()) and predecessor probes. A start in
+ * (node, successor] resolves locally for every policy but ALL
+ */
+int node_fix_fingers_policy(Node *node, FingerPolicy policy) {
+  int i;
+  int messages = 0;
+  Finger *finger = NULL;
+  FingerTable *table = node->finger_table;
+  Node *nodes[FINGERS_MAX];
+  Node *previous = NULL;
   
-  /*for (i = 0; i < KEY_BITS; i++) {*/
-  /*
-  for (i = KEY_BITS - 1; i >= 0; i--) {
-    finger = node->finger_table->fingers[i];
-    finger->node = node_find_successor(node, finger->start);
+  switch (policy) {
+  case FINGER_FIX_NEXT:
+    finger = table->fingers[table->next];
+    finger->node = node_lookup(node, finger->start, &messages);
+    table->next = (table->next + 1) % table->length;
+    break;
+    
+  case FINGER_FIX_SHARED:
+  case FINGER_FIX_CHANGED:
+    for (i = 0; i < table->length; i++) {
+      finger = table->fingers[i];
+      if (key_in_range(finger->start, node->key, node->successor->key, TRUE)) {
+        finger->node = node->successor;
+      }
+      else if (policy == FINGER_FIX_CHANGED) {
+        finger->node = node_finger_recheck(node, finger, &messages);
+      }
+      else if (previous != NULL && previous != node
+               && key_in_range(finger->start, node->key, previous->key, TRUE)) {
+        /* the previous finger's node also follows this start */
+        finger->node = previous;
+      }
+      else {
+        finger->node = node_lookup(node, finger->start, &messages);
+      }
+      previous = finger->node;
+    }
+    break;
+    
+  case FINGER_FIX_ALL:
+  default:
+    /* reset */
+    for (i = 0; i < table->length; i++) {
+      finger = table->fingers[i];
+      finger->node = node->successor;
+    }
+    
+    for (i = 0; i < table->length; i++) {
+      finger = table->fingers[i];
+      nodes[i] = node_lookup(node, finger->start, &messages);
+    }
+    
+    for (i = 0; i < table->length; i++) {
+      finger = table->fingers[i];
+      finger->node = nodes[i];
+    }
+    break;
   }
-  */
+  
+  return messages;
 }
 
 void node_check_predecessor(Node *node) {
-  if (node->predecessor->state == NODE_STATE_DEAD) {
+  if (node->predecessor != NULL && node->predecessor->state == NODE_STATE_DEAD) {
+    if (node->members != NULL) {
+      membership_learn(node->members, node->predecessor, FALSE);
+    }
     node->predecessor = NULL;
   }
 }
 
+/**
+ * Bound node's maintenance periods; every task starts at min_period
+ * and runs on the next node_maintain()
+ */
+void node_schedule(Node *node, int min_period, int max_period) {
+  Schedule *schedule = &node->schedule;
+  int task;
+  
+  schedule->min_period = min_period;
+  schedule->max_period = max_period;
+  for (task = 0; task < MAINTAIN_TASKS; task++) {
+    schedule->period[task] = min_period;
+    schedule->due[task] = schedule->tick;
+  }
+}
+
+/**
+ * Set task's next run after it ran: a task that saw a change halves
+ * its period down to min_period, a quiet one doubles it up to
+ * max_period
+ */
+static void node_schedule_next(Node *node, int task, int changed) {
+  Schedule *schedule = &node->schedule;
+  
+  schedule->period[task] = changed ? MAX(schedule->period[task] / 2, schedule->min_period)
+    : MIN(schedule->period[task] * 2, schedule->max_period);
+  schedule->due[task] = schedule->tick + schedule->period[task];
+}
+
+/**
+ * Churn seen between runs: task halves its period (e.g. a new
+ * predecessor), or drops to min_period if a neighbour failed, and runs
+ * within the new period
+ */
+static void node_schedule_wake(Node *node, int task, int failed) {
+  Schedule *schedule = &node->schedule;
+  
+  schedule->period[task] = failed ? schedule->min_period
+    : MAX(schedule->period[task] / 2, schedule->min_period);
+  schedule->due[task] = MIN(schedule->due[task], schedule->tick + schedule->period[task]);
+}
+
+/**
+ * Run node's maintenance tasks due at tick and return the messages
+ * they sent: one STABILIZE, the fix_fingers messages and a ping to the
+ * predecessor. A changed successor wakes fix_fingers too; a failed
+ * successor or predecessor wakes every task, stabilise and the
+ * predecessor check (one message each) at min_period
+ */
+int node_maintain(Node *node, int tick, FingerPolicy policy) {
+  Schedule *schedule = &node->schedule;
+  Node *before[FINGERS_MAX + SUCCESSOR_LIST_SIZE];
+  int messages = 0;
+  int failed = FALSE;
+  int changed;
+  int i;
+  
+  schedule->tick = tick;
+  
+  if (tick >= schedule->due[MAINTAIN_STABILISE]) {
+    failed = node->successor->state == NODE_STATE_DEAD;
+    before[0] = node->successor;
+    for (i = 0; i < SUCCESSOR_LIST_SIZE; i++) {
+      before[i + 1] = node->successors[i];
+    }
+    node_stabilise(node);
+    messages++;
+    changed = before[0] != node->successor;
+    for (i = 0; i < SUCCESSOR_LIST_SIZE; i++) {
+      changed |= before[i + 1] != node->successors[i];
+    }
+    node_schedule_next(node, MAINTAIN_STABILISE, changed || failed);
+    if (before[0] != node->successor) {
+      node_schedule_wake(node, MAINTAIN_FIX_FINGERS, FALSE);
+    }
+  }
+  
+  if (tick >= schedule->due[MAINTAIN_FIX_FINGERS]) {
+    for (i = 0; i < node->finger_table->length; i++) {
+      before[i] = node->finger_table->fingers[i]->node;
+    }
+    messages += node_fix_fingers_policy(node, policy);
+    changed = FALSE;
+    for (i = 0; i < node->finger_table->length; i++) {
+      changed |= before[i] != node->finger_table->fingers[i]->node;
+    }
+    node_schedule_next(node, MAINTAIN_FIX_FINGERS, changed);
+  }
+  
+  if (tick >= schedule->due[MAINTAIN_CHECK_PREDECESSOR]) {
+    changed = FALSE;
+    if (node->predecessor != NULL) {
+      changed = node->predecessor->state == NODE_STATE_DEAD;
+      messages++;
+    }
+    node_check_predecessor(node);
+    failed |= changed;
+    node_schedule_next(node, MAINTAIN_CHECK_PREDECESSOR, changed);
+  }
+  
+  if (failed) {
+    for (i = 0; i < MAINTAIN_TASKS; i++) {
+      node_schedule_wake(node, i, i != MAINTAIN_FIX_FINGERS);
+    }
+  }
+  
+  return messages;
+}
+
 /**
  * Node wants to add a document to the chord ring.
  * Search for the node responsible for this key and
@@ -158,17 +744,211 @@ void node_document_add(Node *node, Document *doc) {
 }
 
 /**
- * Store a document at this node
+ * Store a document at this node, in its host's store for a virtual
+ * node (num_documents still counts the node's own)
  */
 void node_document_store(Node *node, Document *doc) {
+  node_document_keep(node, doc);
+  
+  if (node->host != NULL) {
+    printf("Document \"%s\" with key %d added to node %s:%d on host %s\n", doc->filename, doc->key, node->id, node->key, node->host->id);
+  }
+  else {
+    printf("Document \"%s\" with key %d added to node %s:%d\n", doc->filename, doc->key, node->id, node->key);
+  }
+}
+
+/**
+ * node_document_store() without the announcement, for handoffs
+ */
+void node_document_keep(Node *node, Document *doc) {
+  Host *host = node->host;
+  
+  if (host != NULL) {
+    if ((host->documents = realloc(host->documents, (sizeof(struct Document*) * (size_t)(host->num_documents + 1)))) == NULL) {
+      BAIL("Failed to allocate memory for host documents");
+    }
+    host->documents[host->num_documents] = doc;
+    host->num_documents++;
+    node->num_documents++;
+    return;
+  }
+  
   if ((node->documents = realloc(node->documents, (sizeof(struct Document*) * (size_t)(node->num_documents + 1)))) == NULL) {
     BAIL("Failed to allocate memory for node documents");
   }
   
   node->documents[node->num_documents] = doc;
   node->num_documents++;
+}
+
+/**
+ * Move the documents with keys in (low, high] from from's store to
+ * to's, or every document in from's own store if all is set. Returns
+ * the documents moved
+ */
+static int node_documents_move(Node *from, Node *to, int low, int high, int all) {
+  Document **documents = from->host != NULL ? from->host->documents : from->documents;
+  int *num_documents = from->host != NULL ? &from->host->num_documents : &from->num_documents;
+  Document *doc;
+  int i;
+  int moved = 0;
+  
+  /* from the end: a store shared with to grows past i, never before it */
+  for (i = *num_documents - 1; i >= 0; i--) {
+    doc = documents[i];
+    if (!(all && from->host == NULL) && !key_in_range(doc->key, low, high, TRUE)) {
+      continue;
+    }
+    documents[i] = documents[*num_documents - 1];
+    (*num_documents)--;
+    if (from->host != NULL) {
+      from->num_documents--;
+    }
+    node_document_keep(to, doc);
+    documents = from->host != NULL ? from->host->documents : from->documents;
+    moved++;
+  }
+  
+  return moved;
+}
+
+/**
+ * A joined node takes from its successor the documents that are now
+ * its own: those between the successor's old predecessor and node, or
+ * if that is not known, all but the successor's. Returns the documents
+ * moved
+ */
+int node_documents_handoff(Node *node) {
+  Node *successor = node->successor;
+  Node *predecessor = successor->predecessor;
+  
+  if (successor == node) {
+    return 0;
+  }
+  if (predecessor != NULL && predecessor != node && predecessor != successor
+      && predecessor->state != NODE_STATE_DEAD
+      && key_in_range(node->key, predecessor->key, successor->key, FALSE)) {
+    return node_documents_move(successor, node, predecessor->key, node->key, FALSE);
+  }
+  if (successor->host != NULL) {
+    /* a shared store holds other ranges too: only a known range moves */
+    return 0;
+  }
+  return node_documents_move(successor, node, successor->key, node->key, FALSE);
+}
+
+/**
+ * Voluntary departure (per IV.F of the paper): node hands its
+ * documents to its successor and links its predecessor and successor
+ * together, then stops
+ */
+void node_leave(Node *node) {
+  Ring *ring = ring_get();
+  Node *successor = node->successor;
+  Node *predecessor = node->predecessor;
+  
+  /* a node joined just before the successor is the one to hand to */
+  while (successor != node && successor->predecessor != NULL
+         && successor->predecessor->state != NODE_STATE_DEAD
+         && key_in_range(successor->predecessor->key, node->key, successor->key, FALSE)) {
+    successor = successor->predecessor;
+  }
+  
+  if (successor != node) {
+    if (predecessor != NULL && predecessor != node) {
+      node_documents_move(node, successor, predecessor->key, node->key, TRUE);
+      if (predecessor->successor == node) {
+        predecessor->successor = successor;
+      }
+    }
+    else {
+      node_documents_move(node, successor, node->key, node->key, TRUE);
+    }
+    if (successor->predecessor == node) {
+      successor->predecessor = predecessor != node ? predecessor : NULL;
+    }
+  }
+  if (ring->first_node == node) {
+    ring->first_node = successor != node ? successor : NULL;
+  }
+  if (ring->last_node == node) {
+    ring->last_node = predecessor != NULL && predecessor != node ? predecessor : NULL;
+  }
+  
+  node->state = NODE_STATE_DEAD;
+  node->successor = node;
+  node->predecessor = NULL;
+}
+
+/* farthest from sample first */
+static int node_balance_order(const void *a, const void *b) {
+  return *(const int *)b - *(const int *)a;
+}
+
+/**
+ * One probe of Karger-Ruhl item balancing: if sample holds more than
+ * BALANCE_RATIO times node's documents, node leaves (its documents
+ * going to its successor) and joins again at the key that splits
+ * sample's documents in two, taking the first half. Both must have
+ * joined and know their predecessors and node's successor must know
+ * node, so the ranges handed over are known. Virtual nodes and nodes with a
+ * membership table keep their keys. Only node->key moves: node->id
+ * keeps its name, so chord_hash(node->id) no longer equals node->key
+ * after a move. TRUE if node moved
+ */
+int node_balance(Node *node, Node *sample) {
+  Node *predecessor = sample->predecessor;
+  int *distances;
+  int i, split, key;
+  
+  if (node == sample || node->host != NULL || node->members != NULL || sample->host != NULL
+      || node->state == NODE_STATE_DEAD || sample->state == NODE_STATE_DEAD
+      || node->successor == NULL || sample->successor == NULL
+      || node->successor == node || node->successor->predecessor != node
+      || node->predecessor == NULL || predecessor == NULL || sample->num_documents < 2
+      || sample->num_documents <= BALANCE_RATIO * node->num_documents) {
+    return FALSE;
+  }
+  
+  if ((distances = malloc(sizeof(int) * (size_t)sample->num_documents)) == NULL) {
+    BAIL("Failed to allocate memory for balance split");
+  }
+  for (i = 0; i < sample->num_documents; i++) {
+    distances[i] = key_distance(sample->documents[i]->key, sample->key);
+  }
+  qsort(distances, (size_t)sample->num_documents, sizeof(int), node_balance_order);
+  
+  /* the median, but never sample's own key */
+  split = (sample->num_documents - 1) / 2;
+  while (split > 0 && distances[split] == 0) {
+    split--;
+  }
+  key = (sample->key - distances[split] + ring_key_max()) % ring_key_max();
+  free(distances);
+  
+  if (key == sample->key || !key_in_range(key, predecessor->key, sample->key, FALSE)) {
+    return FALSE;
+  }
+  
+  node_leave(node);
+  
+  /* fingers keep their distances from the new key */
+  for (i = 0; i < node->finger_table->length; i++) {
+    node->finger_table->fingers[i]->start =
+      (key + key_distance(node->key, node->finger_table->fingers[i]->start)) % ring_key_max();
+    node->finger_table->fingers[i]->node = node;
+  }
+  node->key = key;
+  node->state = NODE_STATE_RUNNING;
+  
+  /* node_join() without the lookup: sample is key's successor */
+  node->predecessor = NULL;
+  node->successor = sample;
+  node_documents_handoff(node);
+  node_stabilise(node);
   
-  printf("Document \"%s\" with key %d added to node %s:%d\n", doc->filename, doc->key, node->id, node->key);
+  return TRUE;
 }
 
 void node_document_query(Node *ctx_node, char *filename) {
@@ -201,10 +981,12 @@ void node_document_print(Node *node, Document *doc) {
 
 Document* node_document_exists(Node *node, char *filename) {
   int i;
+  Document **documents = node->host != NULL ? node->host->documents : node->documents;
+  int num_documents = node->host != NULL ? node->host->num_documents : node->num_documents;
   
-  for (i = 0; i < node->num_documents; i++) {
-    if (strcmp(filename, node->documents[i]->filename) == 0) {
-      return node->documents[i];
+  for (i = 0; i < num_documents; i++) {
+    if (strcmp(filename, documents[i]->filename) == 0) {
+      return documents[i];
     }
   }
   
@@ -223,16 +1005,18 @@ void node_print(Node *node) {
 void node_print_documents(Node *node) {
   int i;
   Document *doc;
+  Document **documents = node->host != NULL ? node->host->documents : node->documents;
+  int num_documents = node->host != NULL ? node->host->num_documents : node->num_documents;
   
-  if (node->num_documents == 0) {
+  if (num_documents == 0) {
     printf("\nNo documents at this node.\n");
   }
   else {
     printf("\n");
     printf("%-3s %-4s %-16s\n", "i", "Key", "Filename");
     printf("--- ---- ----------------\n");
-    for (i = 0; i < node->num_documents; i++) {
-      doc = node->documents[i];
+    for (i = 0; i < num_documents; i++) {
+      doc = documents[i];
       printf("%-3d %-4d %s\n", i, doc->key, doc->filename);
     }
     printf("--- ---- ----------------\n");
@@ -247,7 +1031,7 @@ void node_print_finger_table(Node *node) {
   printf("%-3s %-6s %-16s\n", "i", "Start", "Succ (ID:Key)");
   printf("--- ------ ----------------\n");
   
-  for (i = 0; i < KEY_BITS; i++) {
+  for (i = 0; i < node->finger_table->length; i++) {
     finger = node->finger_table->fingers[i];
     printf("%-3d %-6d %10s : %-4d\n", i, finger->start, finger->node->id, finger->node->key);
   }
@@ -4,22 +4,39 @@
 #include "chord_types.h"
 #include "hash.h"
 #include "finger.h"
+#include "member.h"
+#include "trace.h"
 
 Node* node_init(char *id);
 Node* node_find_successor(Node *node, int key);
 Node* node_find_successor_impl(Node *orig_node, Node *node, int key, int depth);
 Node* node_closest_preceding_node(Node *node, int key);
+Node* node_next_hop(Node *node, int key, int *done);
+Node* node_lookup(Node *node, int key, int *hops);
+Node* node_lookup_one_hop(Node *node, int key, int *hops);
+int node_members_enable(Node *node);
 void node_create(Node *node);
 void node_join(Node *existing_node, Node *new_node);
+int node_join_copy(Node *existing_node, Node *new_node);
+int node_join_batch(Node *existing_node, Node **joining, int count);
 void node_stabilise(Node *node);
 void node_notify(Node *notify_node, Node *check_node);
+Node* node_stabilise_answer(Node *node, Node *check_node, Node **successors, int *count);
+void node_stabilise_adopt(Node *node, Node *predecessor, Node **successors, int count);
 void node_fix_fingers(Node *node);
+int node_fix_fingers_policy(Node *node, FingerPolicy policy);
 void node_check_predecessor(Node *node);
+void node_schedule(Node *node, int min_period, int max_period);
+int node_maintain(Node *node, int tick, FingerPolicy policy);
 void node_print(Node *node);
 void node_print_documents(Node *node);
 void node_print_finger_table(Node *node);
 void node_document_add(Node *node, Document *doc);
 void node_document_store(Node *node, Document *doc);
+void node_document_keep(Node *node, Document *doc);
+int node_documents_handoff(Node *node);
+void node_leave(Node *node);
+int node_balance(Node *node, Node *sample);
 void node_document_query(Node *node, char *filename);
 Document* node_document_exists(Node *node, char *filename);
 void node_document_print(Node *node, Document *doc);
@@ -218,8 +218,64 @@ void ring_print_all(int index, int with_fingers) {
       node_print_finger_table(current);
     }
   }
+  ring_print_load();
 }
 
+/**
+ * Documents per live node: the most any holds and the mean
+ */
+void ring_document_load(int *most, double *mean) {
+  Ring *r = ring_get();
+  int live = 0;
+  int total = 0;
+  
+  *most = 0;
+  for (unsigned int i = 0; i < r->size; i++) {
+    if (r->nodes[i]->state == NODE_STATE_DEAD) {
+      continue;
+    }
+    live++;
+    total += r->nodes[i]->num_documents;
+    *most = MAX(*most, r->nodes[i]->num_documents);
+  }
+  *mean = live > 0 ? (double)total / live : 0.0;
+}
+
+void ring_print_load() {
+  int most;
+  double mean;
+  
+  ring_document_load(&most, &mean);
+  printf("Documents per node: max %d, mean %.2f", most, mean);
+  if (mean > 0.0) {
+    printf(", max/mean %.2f", most / mean);
+  }
+  printf("\n");
+}
+
+/**
+ * One round of item balancing: every live node probes one other live
+ * node picked at random (node_balance()). Returns the nodes moved
+ */
+int ring_balance() {
+  Ring *r = ring_get();
+  Node *node;
+  Node *sample;
+  int moved = 0;
+  
+  if (r->size < 2) {
+    return 0;
+  }
+  for (unsigned int i = 0; i < r->size; i++) {
+    node = r->nodes[i];
+    sample = r->nodes[(unsigned int)rand() % r->size];
+    if (node->state != NODE_STATE_DEAD && sample->state != NODE_STATE_DEAD) {
+      moved += node_balance(node, sample);
+    }
+  }
+  
+  return moved;
+}
 
 Ring *ring_get() {
   if (g_ring == NULL) {
@@ -230,7 +286,11 @@ Ring *ring_get() {
     }
     
     g_ring->size = 0;
+    g_ring->capacity = 0;
+    g_ring->nodes = NULL;
     g_ring->first_node = NULL;
+    g_ring->routing = ROUTE_UNIFIED;
+    g_ring->finger_base = 2;
   }
   
   return g_ring;
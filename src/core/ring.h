@@ -16,5 +16,8 @@ void ring_print_all(int index, int with_fingers);
 Ring* ring_get();
 void ring_add(Node *node);
 void ring_stabilise_all();
+void ring_document_load(int *most, double *mean);
+void ring_print_load();
+int ring_balance();
 
 #endif
@@ -0,0 +1,65 @@
+#include "net_buf.h"
+#include <stdlib.h>
+#include <stdatomic.h>
+
+/*
+ * Pooled frame buffer implementation
+ *
+ * Buffers are only returned to the heap by net_buf_pool_release(); a
+ * pool otherwise grows to the peak number of frames a thread had in
+ * flight.
+ */
+
+static _Thread_local net_buf_t *t_free_list = NULL;
+static _Atomic size_t g_heap_allocs = 0;
+
+net_buf_t* net_buf_alloc(void) {
+    net_buf_t *buf = t_free_list;
+
+    if (buf) {
+        t_free_list = buf->next;
+    }
+    else {
+        buf = (net_buf_t*)malloc(sizeof(net_buf_t));
+        if (!buf) {
+            return NULL;
+        }
+        atomic_fetch_add_explicit(&g_heap_allocs, 1, memory_order_relaxed);
+    }
+
+    buf->next = NULL;
+    buf->len = 0;
+    return buf;
+}
+
+void net_buf_free(net_buf_t *buf) {
+    if (!buf) {
+        return;
+    }
+    buf->next = t_free_list;
+    t_free_list = buf;
+}
+
+int net_buf_pool_reserve(size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        net_buf_t *buf = (net_buf_t*)malloc(sizeof(net_buf_t));
+        if (!buf) {
+            return -1;
+        }
+        atomic_fetch_add_explicit(&g_heap_allocs, 1, memory_order_relaxed);
+        net_buf_free(buf);
+    }
+    return 0;
+}
+
+void net_buf_pool_release(void) {
+    while (t_free_list) {
+        net_buf_t *buf = t_free_list;
+        t_free_list = buf->next;
+        free(buf);
+    }
+}
+
+size_t net_buf_pool_heap_allocs(void) {
+    return atomic_load_explicit(&g_heap_allocs, memory_order_relaxed);
+}
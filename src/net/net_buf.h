@@ -0,0 +1,52 @@
+#ifndef NET_BUF_H
+#define NET_BUF_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "net_protocol.h"
+
+/*
+ * Pooled Frame Buffers
+ *
+ * Fixed-size buffers holding one encoded frame. Requests are encoded
+ * straight into a buffer that the transport sends, and responses are
+ * received into a buffer and decoded as views over its bytes.
+ *
+ * Each thread keeps its own free list, so alloc/free are a pointer pop
+ * and push with no locking. The heap is only touched when a thread's
+ * list is empty; after warm-up (or net_buf_pool_reserve()) a steady
+ * stream of RPCs performs no allocation at all.
+ *
+ * Ownership: a buffer belongs to whoever allocated it until passed to
+ * net_buf_free(). It may be freed on a different thread, in which case
+ * it joins that thread's free list.
+ */
+
+/* Capacity of one buffer (largest frame) */
+#define NET_BUF_SIZE NET_PROTOCOL_MAX_FRAME
+
+typedef struct net_buf {
+    struct net_buf *next;           /* Free list link */
+    size_t len;                     /* Valid bytes in data */
+    uint8_t data[NET_BUF_SIZE];
+} net_buf_t;
+
+/* Take a buffer from the calling thread's pool (len reset to 0).
+ * Returns NULL only if the heap is exhausted. */
+net_buf_t* net_buf_alloc(void);
+
+/* Return a buffer to the calling thread's pool (NULL is ignored) */
+void net_buf_free(net_buf_t *buf);
+
+/* Pre-populate the calling thread's pool with count buffers
+ * (returns 0 on success, -1 if allocation failed) */
+int net_buf_pool_reserve(size_t count);
+
+/* Hand the calling thread's pooled buffers back to the heap (for a
+ * thread about to exit; buffers still allocated are not affected) */
+void net_buf_pool_release(void);
+
+/* Buffers ever taken from the heap, across all threads */
+size_t net_buf_pool_heap_allocs(void);
+
+#endif /* NET_BUF_H */
@@ -0,0 +1,781 @@
+#define _GNU_SOURCE
+
+#include "net_host.h"
+#include "net_transport.h"
+#include "host.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+
+/*
+ * Node host implementation
+ *
+ * Hosted nodes are kept in a chained hash table keyed by node id. Each
+ * entry is one allocation holding the node's URL, and the node's id is
+ * the tail of that URL, so a node costs its Node and finger table plus
+ * one small block. The local peer handed out for a node is created on
+ * first use and kept with it.
+ *
+ * Requests are served into a frame view whose node strings point at
+ * the hosted entries (or the Node ids), so an async local call is a
+ * queued job and a callback; encoding only happens for the sync frame
+ * API and for other processes.
+ */
+
+#define HOST_BUCKETS_INITIAL 64
+#define HOST_SEND_TIMEOUT_MS 1000
+
+typedef struct host_entry {
+    struct host_entry *next;        /* Bucket chain */
+    Node *node;
+    net_peer_t *peer;               /* Local peer, NULL until acquired */
+    uint32_t url_len;
+    char url[];                     /* "<base>/<id>"; node->id points at <id> */
+} host_entry_t;
+
+typedef struct {
+    net_peer_t base;
+    net_host_t *host;
+    host_entry_t *entry;
+} host_local_t;
+
+typedef struct host_job {
+    struct host_job *next;
+    host_entry_t *entry;
+    uint32_t request_id;
+    net_msg_type_t type;
+    int key;
+    int has_node;
+    net_node_addr_t node;
+    net_peer_callback_t callback;
+    void *context;
+} host_job_t;
+
+typedef struct host_conn {
+    struct host_conn *prev;
+    struct host_conn *next;
+    net_host_t *host;
+    net_transport_t *transport;
+    net_watch_t watch;
+} host_conn_t;
+
+struct net_host {
+    net_loop_t *loop;
+    net_pool_t *pool;
+    char url[NET_PROTOCOL_MAX_URL];
+    size_t url_len;
+    net_transport_listener_t *listener;
+    host_conn_t *conns;
+
+    host_entry_t **buckets;
+    size_t bucket_count;            /* Power of two */
+    size_t count;
+
+    net_hook_t hook;
+    host_job_t *queue_head;         /* Async local calls, oldest first */
+    host_job_t *queue_tail;
+    host_job_t *free_jobs;
+
+    uint64_t local_calls;
+    uint64_t remote_acquires;
+    uint64_t served;
+};
+
+static const net_peer_iface_t host_local_iface;
+
+/*
+ * Index
+ */
+
+static uint32_t host_hash(const char *id, size_t len) {
+    uint32_t hash = 2166136261u;    /* FNV-1a */
+
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)id[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static const char* entry_id(const net_host_t *host, const host_entry_t *entry) {
+    return entry->url + host->url_len + 1;
+}
+
+static host_entry_t* host_lookup(const net_host_t *host, const char *id, size_t len) {
+    host_entry_t *entry = host->buckets[host_hash(id, len) & (host->bucket_count - 1)];
+
+    for (; entry; entry = entry->next) {
+        if (entry->url_len == host->url_len + 1 + len &&
+            memcmp(entry_id(host, entry), id, len) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* Entry for a URL of this host (url need not be NUL-terminated) */
+static host_entry_t* host_lookup_url(const net_host_t *host, const char *url, size_t len) {
+    if (len <= host->url_len + 1 || memcmp(url, host->url, host->url_len) != 0 ||
+        url[host->url_len] != '/') {
+        return NULL;
+    }
+    return host_lookup(host, url + host->url_len + 1, len - host->url_len - 1);
+}
+
+static int host_grow(net_host_t *host) {
+    size_t count = host->bucket_count * 2;
+    host_entry_t **buckets = (host_entry_t**)calloc(count, sizeof(host_entry_t*));
+
+    if (!buckets) {
+        return -1;
+    }
+    for (size_t i = 0; i < host->bucket_count; i++) {
+        host_entry_t *entry = host->buckets[i];
+
+        while (entry) {
+            host_entry_t *next = entry->next;
+            const char *id = entry_id(host, entry);
+            size_t slot = host_hash(id, strlen(id)) & (count - 1);
+
+            entry->next = buckets[slot];
+            buckets[slot] = entry;
+            entry = next;
+        }
+    }
+    free(host->buckets);
+    host->buckets = buckets;
+    host->bucket_count = count;
+    return 0;
+}
+
+/* Heap held for one hosted node, as node_init and finger_table_init
+ * allocate it */
+static size_t entry_bytes(const host_entry_t *entry) {
+    const Node *node = entry->node;
+    size_t fingers = (size_t)node->finger_table->length;
+    size_t bytes = sizeof(host_entry_t) + entry->url_len + 1;
+
+    bytes += sizeof(Node) + sizeof(FingerTable) + 2 * fingers * sizeof(Finger);
+    bytes += (size_t)node->num_documents * (sizeof(Document*) + sizeof(Document));
+    if (entry->peer) {
+        bytes += sizeof(host_local_t);
+    }
+    return bytes;
+}
+
+/*
+ * Serving
+ */
+
+static void host_node_view(const net_host_t *host, net_node_view_t *view, const Node *node) {
+    host_entry_t *entry = host_lookup(host, node->id, strlen(node->id));
+
+    view->id = node->id;
+    view->id_len = (uint32_t)strlen(node->id);
+    view->key = node->key;
+    if (entry && entry->node == node) {
+        view->url = entry->url;
+        view->url_len = entry->url_len;
+    } else {
+        view->url = host->url;
+        view->url_len = (uint32_t)host->url_len;
+    }
+}
+
+_Static_assert(SUCCESSOR_LIST_SIZE <= NET_PROTOCOL_MAX_SUCCESSORS,
+               "a successor list must fit a STABILIZE_RESPONSE");
+
+/* Answer request at node into response. Returns a net_error_t code. */
+static int host_serve(const net_host_t *host, Node *node, const net_frame_view_t *request,
+                      net_frame_view_t *response) {
+    const Node *answer = NULL;
+    host_entry_t *from;
+
+    memset(response, 0, sizeof(*response));
+    response->header.version = NET_PROTOCOL_VERSION;
+    response->header.msg_type = (uint8_t)(request->header.msg_type + 1);
+    response->header.request_id = request->header.request_id;
+
+    switch (request->header.msg_type) {
+        case NET_MSG_FIND_SUCCESSOR:
+            answer = node_find_successor(node, request->key);
+            break;
+        case NET_MSG_CLOSEST_PRECEDING:
+            answer = node_closest_preceding_node(node, request->key);
+            break;
+        case NET_MSG_GET_PREDECESSOR:
+            answer = node->predecessor;
+            break;
+        case NET_MSG_GET_SUCCESSOR:
+            answer = node->successor;
+            break;
+        case NET_MSG_NEXT_HOP:
+            answer = node_next_hop(node, request->key, &response->done);
+            break;
+        case NET_MSG_PING:
+            response->alive = node->state == NODE_STATE_RUNNING;
+            response->state = node->state;
+            return NET_ERR_OK;
+        case NET_MSG_NOTIFY:
+            from = request->has_node
+                ? host_lookup_url(host, request->node.url, request->node.url_len) : NULL;
+            if (!from) {
+                return NET_ERR_NODE_NOT_FOUND;
+            }
+            node_notify(node, from->node);
+            response->success = 1;
+            return NET_ERR_OK;
+        case NET_MSG_STABILIZE: {
+            Node *successors[SUCCESSOR_LIST_SIZE];
+            int count;
+
+            from = request->has_node
+                ? host_lookup_url(host, request->node.url, request->node.url_len) : NULL;
+            if (!from) {
+                return NET_ERR_NODE_NOT_FOUND;
+            }
+            answer = node_stabilise_answer(node, from->node, successors, &count);
+            response->count = (uint32_t)count;
+            for (int i = 0; i < count; i++) {
+                host_node_view(host, &response->successors[i], successors[i]);
+            }
+            break;
+        }
+        default:
+            return NET_ERR_INVALID_MESSAGE;
+    }
+
+    response->has_node = answer != NULL;
+    if (answer) {
+        host_node_view(host, &response->node, answer);
+    }
+    return NET_ERR_OK;
+}
+
+/* Encode request's answer at node (or the error) into frame. Returns
+ * its length, or -1. */
+static int host_reply(net_host_t *host, Node *node, const net_frame_view_t *request,
+                      void *frame, size_t size) {
+    net_frame_view_t view;
+    net_message_t msg;
+    int err = node ? host_serve(host, node, request, &view) : NET_ERR_NODE_NOT_FOUND;
+
+    if (err != NET_ERR_OK) {
+        net_protocol_create_error(&msg, request->header.request_id, (net_error_t)err,
+                                  node ? "request refused" : "no such node");
+        return net_protocol_serialize(&msg, frame, size);
+    }
+
+    net_protocol_init_message(&msg, (net_msg_type_t)view.header.msg_type, view.header.request_id);
+    switch (view.header.msg_type) {
+        case NET_MSG_FIND_SUCCESSOR_RESPONSE:
+            net_protocol_copy_node_view(&msg.payload.find_successor_resp.node, &view.node);
+            break;
+        case NET_MSG_CLOSEST_PRECEDING_RESPONSE:
+            net_protocol_copy_node_view(&msg.payload.closest_preceding_resp.node, &view.node);
+            break;
+        case NET_MSG_GET_PREDECESSOR_RESPONSE:
+        case NET_MSG_GET_SUCCESSOR_RESPONSE:
+            msg.payload.get_node_resp.has_node = view.has_node;
+            if (view.has_node) {
+                net_protocol_copy_node_view(&msg.payload.get_node_resp.node, &view.node);
+            }
+            break;
+        case NET_MSG_NEXT_HOP_RESPONSE:
+            msg.payload.next_hop_resp.done = view.done;
+            net_protocol_copy_node_view(&msg.payload.next_hop_resp.node, &view.node);
+            break;
+        case NET_MSG_PING_RESPONSE:
+            msg.payload.ping_resp.alive = view.alive;
+            msg.payload.ping_resp.state = view.state;
+            break;
+        case NET_MSG_NOTIFY_RESPONSE:
+            msg.payload.notify_resp.success = view.success;
+            break;
+        case NET_MSG_STABILIZE_RESPONSE:
+            msg.payload.stabilize_resp.has_node = view.has_node;
+            if (view.has_node) {
+                net_protocol_copy_node_view(&msg.payload.stabilize_resp.node, &view.node);
+            }
+            msg.payload.stabilize_resp.count = view.count;
+            for (uint32_t i = 0; i < view.count; i++) {
+                net_protocol_copy_node_view(&msg.payload.stabilize_resp.successors[i],
+                                            &view.successors[i]);
+            }
+            break;
+        default:
+            break;
+    }
+    return net_protocol_serialize(&msg, frame, size);
+}
+
+/*
+ * Local peers
+ */
+
+static host_local_t* local_of(net_peer_t *peer) {
+    return (host_local_t*)peer->impl_data;
+}
+
+static int local_connect(net_peer_t *peer, const char *url) {
+    snprintf(peer->remote_url, sizeof(peer->remote_url), "%s", url);
+    peer->connected = 1;
+    return NET_ERR_OK;
+}
+
+static int local_send_frame(net_peer_t *peer, const net_buf_t *request, net_buf_t *response,
+                            int timeout_ms) {
+    host_local_t *local = local_of(peer);
+    net_frame_view_t view;
+    int len;
+    int err = net_protocol_decode_view(&view, request->data, request->len);
+
+    (void)timeout_ms;
+    if (err != NET_ERR_OK) {
+        return err;
+    }
+    local->host->local_calls++;
+    len = host_reply(local->host, local->entry->node, &view, response->data, sizeof(response->data));
+    if (len < 0) {
+        return NET_ERR_INTERNAL;
+    }
+    response->len = (size_t)len;
+    return NET_ERR_OK;
+}
+
+static int local_send_request(net_peer_t *peer, const net_message_t *request,
+                              net_message_t *response, int timeout_ms) {
+    net_buf_t *req = net_buf_alloc();
+    net_buf_t *resp = net_buf_alloc();
+    int len;
+    int err = NET_ERR_INTERNAL;
+
+    if (req && resp && (len = net_protocol_serialize(request, req->data, sizeof(req->data))) > 0) {
+        req->len = (size_t)len;
+        err = local_send_frame(peer, req, resp, timeout_ms);
+        if (err == NET_ERR_OK) {
+            err = net_protocol_deserialize(response, resp->data, resp->len);
+        }
+    }
+    net_buf_free(req);
+    net_buf_free(resp);
+    return err;
+}
+
+static int local_call_async(net_peer_t *peer, uint32_t request_id, net_msg_type_t type, int key,
+                            const net_node_addr_t *node, net_peer_callback_t callback,
+                            void *context, int timeout_ms) {
+    host_local_t *local = local_of(peer);
+    net_host_t *host = local->host;
+    host_job_t *job = host->free_jobs;
+
+    (void)timeout_ms;
+    if (job) {
+        host->free_jobs = job->next;
+    } else if ((job = (host_job_t*)malloc(sizeof(host_job_t))) == NULL) {
+        return NET_ERR_INTERNAL;
+    }
+
+    job->next = NULL;
+    job->entry = local->entry;
+    job->request_id = request_id;
+    job->type = type;
+    job->key = key;
+    job->has_node = node != NULL;
+    if (node) {
+        job->node = *node;
+    }
+    job->callback = callback;
+    job->context = context;
+
+    if (host->queue_tail) {
+        host->queue_tail->next = job;
+    } else {
+        host->queue_head = job;
+    }
+    host->queue_tail = job;
+    host->local_calls++;
+    return NET_ERR_OK;
+}
+
+static void local_close(net_peer_t *peer) {
+    peer->connected = 0;
+}
+
+static void local_destroy(net_peer_t *peer) {
+    /* Local peers live as long as their node; see net_host_release */
+    (void)peer;
+}
+
+static const net_peer_iface_t host_local_iface = {
+    .connect = local_connect,
+    .send_request = local_send_request,
+    .send_frame = local_send_frame,
+    .call_async = local_call_async,
+    .close = local_close,
+    .destroy = local_destroy
+};
+
+/* Loop hook: complete every queued async call, including those queued
+ * by the callbacks it runs */
+static void host_drain(void *context) {
+    net_host_t *host = (net_host_t*)context;
+    host_job_t *job;
+
+    while ((job = host->queue_head) != NULL) {
+        net_frame_view_t request;
+        net_frame_view_t response;
+        net_peer_callback_t callback = job->callback;
+        void *callback_context = job->context;
+        int err;
+
+        host->queue_head = job->next;
+        if (!host->queue_head) {
+            host->queue_tail = NULL;
+        }
+
+        memset(&request, 0, sizeof(request));
+        request.header.version = NET_PROTOCOL_VERSION;
+        request.header.msg_type = (uint8_t)job->type;
+        request.header.request_id = job->request_id;
+        request.key = job->key;
+        if (job->has_node) {
+            request.has_node = 1;
+            request.node.id = job->node.id;
+            request.node.id_len = (uint32_t)strlen(job->node.id);
+            request.node.key = job->node.key;
+            request.node.url = job->node.url;
+            request.node.url_len = (uint32_t)strlen(job->node.url);
+        }
+        err = host_serve(host, job->entry->node, &request, &response);
+
+        /* Recycle first so the callback can start the next call */
+        job->next = host->free_jobs;
+        host->free_jobs = job;
+        callback(callback_context, err == NET_ERR_OK ? &response : NULL, err);
+    }
+}
+
+/*
+ * Connections from other processes
+ */
+
+static void conn_close(host_conn_t *conn) {
+    net_host_t *host = conn->host;
+
+    net_loop_unwatch(host->loop, &conn->watch);
+    net_transport_destroy(conn->transport);
+    if (conn->prev) {
+        conn->prev->next = conn->next;
+    } else {
+        host->conns = conn->next;
+    }
+    if (conn->next) {
+        conn->next->prev = conn->prev;
+    }
+    free(conn);
+}
+
+/* Reply to one received frame; returns -1 if the connection failed */
+static int conn_serve(host_conn_t *conn, const uint8_t *data, size_t len) {
+    net_host_t *host = conn->host;
+    uint8_t inner[NET_PROTOCOL_MAX_FRAME];
+    uint8_t reply[NET_PROTOCOL_MAX_FRAME];
+    net_frame_view_t view;
+    net_message_t error;
+    host_entry_t *entry = NULL;
+    uint32_t inner_len;
+    int n;
+    int err;
+
+    memset(&view, 0, sizeof(view));
+    err = net_protocol_decode_view(&view, data, len);
+
+    if (err == NET_ERR_OK && view.header.msg_type != NET_MSG_ADDRESSED) {
+        err = NET_ERR_INVALID_MESSAGE;
+    }
+    if (err == NET_ERR_OK) {
+        /* A JSON view points into scratch the inner decode reuses */
+        entry = host_lookup(host, view.to, view.to_len);
+        inner_len = view.frame_len;
+        memcpy(inner, view.frame, inner_len);
+        err = net_protocol_decode_view(&view, inner, inner_len);
+    }
+
+    if (err != NET_ERR_OK) {
+        net_protocol_create_error(&error, view.header.request_id, (net_error_t)err, "not addressed");
+        n = net_protocol_serialize(&error, reply, sizeof(reply));
+    } else {
+        n = host_reply(host, entry ? entry->node : NULL, &view, reply, sizeof(reply));
+        host->served++;
+    }
+    if (n > 0 && net_transport_send(conn->transport, reply, (size_t)n, HOST_SEND_TIMEOUT_MS) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static void conn_on_ready(void *context, uint32_t events) {
+    host_conn_t *conn = (host_conn_t*)context;
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+
+    (void)events;
+    for (;;) {
+        int n = net_transport_recv(conn->transport, frame, sizeof(frame), 0);
+
+        if (n < 0) {
+            if (errno == EMSGSIZE) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                conn_close(conn);
+            }
+            return;
+        }
+        if (conn_serve(conn, frame, (size_t)n) != 0) {
+            conn_close(conn);
+            return;
+        }
+    }
+}
+
+static void host_on_accept(net_transport_t *client, void *context) {
+    net_host_t *host = (net_host_t*)context;
+    host_conn_t *conn = (host_conn_t*)calloc(1, sizeof(host_conn_t));
+    int fd = net_transport_fd(client);
+
+    if (!conn || fd < 0 ||
+        net_loop_watch(host->loop, &conn->watch, fd, EPOLLIN, conn_on_ready, conn) != 0) {
+        free(conn);
+        net_transport_destroy(client);
+        return;
+    }
+    conn->host = host;
+    conn->transport = client;
+    conn->next = host->conns;
+    if (host->conns) {
+        host->conns->prev = conn;
+    }
+    host->conns = conn;
+}
+
+/*
+ * Host API
+ */
+
+net_host_t* net_host_create(net_loop_t *loop, const char *base_url, net_pool_t *pool) {
+    net_host_t *host;
+
+    if (!loop || !base_url || !*base_url || strlen(base_url) >= NET_PROTOCOL_MAX_URL - 2) {
+        errno = EINVAL;
+        return NULL;
+    }
+    host = (net_host_t*)calloc(1, sizeof(net_host_t));
+    if (!host) {
+        return NULL;
+    }
+    host->buckets = (host_entry_t**)calloc(HOST_BUCKETS_INITIAL, sizeof(host_entry_t*));
+    if (!host->buckets) {
+        free(host);
+        return NULL;
+    }
+    host->bucket_count = HOST_BUCKETS_INITIAL;
+    host->loop = loop;
+    host->pool = pool;
+    snprintf(host->url, sizeof(host->url), "%s", base_url);
+    host->url_len = strlen(host->url);
+    net_loop_add_hook(loop, &host->hook, host_drain, host);
+    return host;
+}
+
+void net_host_destroy(net_host_t *host) {
+    if (!host) {
+        return;
+    }
+    net_loop_remove_hook(host->loop, &host->hook);
+    while (host->conns) {
+        conn_close(host->conns);
+    }
+    net_transport_listener_destroy(host->listener);
+
+    while (host->queue_head) {
+        host_job_t *job = host->queue_head;
+        host->queue_head = job->next;
+        free(job);
+    }
+    while (host->free_jobs) {
+        host_job_t *job = host->free_jobs;
+        host->free_jobs = job->next;
+        free(job);
+    }
+    for (size_t i = 0; i < host->bucket_count; i++) {
+        host_entry_t *entry = host->buckets[i];
+
+        while (entry) {
+            host_entry_t *next = entry->next;
+            if (entry->peer) {
+                free(local_of(entry->peer));
+            }
+            free(entry);
+            entry = next;
+        }
+    }
+    free(host->buckets);
+    free(host);
+}
+
+int net_host_listen(net_host_t *host) {
+    net_transport_type_t type;
+
+    if (!host || host->listener || host->count > 0) {
+        errno = host && host->count > 0 ? EBUSY : EINVAL;
+        return -1;
+    }
+    if (net_transport_url_type(host->url, &type) != 0) {
+        return -1;
+    }
+
+    host->listener = net_transport_listener_create(type);
+    if (!host->listener ||
+        net_transport_listener_listen(host->listener, host->url) != 0 ||
+        net_transport_listener_attach(host->listener, host->loop, host_on_accept, host) != 0) {
+        int err = errno;
+        net_transport_listener_destroy(host->listener);
+        host->listener = NULL;
+        errno = err;
+        return -1;
+    }
+    snprintf(host->url, sizeof(host->url), "%s", net_transport_listener_url(host->listener));
+    host->url_len = strlen(host->url);
+    return 0;
+}
+
+const char* net_host_url(const net_host_t *host) {
+    return host->url;
+}
+
+Node* net_host_spawn(net_host_t *host, const char *id) {
+    size_t id_len = id ? strlen(id) : 0;
+    size_t url_len = host->url_len + 1 + id_len;
+    size_t slot;
+    host_entry_t *entry;
+
+    if (id_len == 0 || id_len >= NET_PROTOCOL_MAX_NODE_ID || url_len >= NET_PROTOCOL_MAX_URL ||
+        strchr(id, '/')) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (host_lookup(host, id, id_len)) {
+        errno = EEXIST;
+        return NULL;
+    }
+    if (host->count >= host->bucket_count && host_grow(host) != 0) {
+        return NULL;
+    }
+    entry = (host_entry_t*)malloc(sizeof(host_entry_t) + url_len + 1);
+    if (!entry) {
+        return NULL;
+    }
+
+    memcpy(entry->url, host->url, host->url_len);
+    entry->url[host->url_len] = '/';
+    memcpy(entry->url + host->url_len + 1, id, id_len + 1);
+    entry->url_len = (uint32_t)url_len;
+    entry->peer = NULL;
+    entry->node = node_init(entry->url + host->url_len + 1);
+
+    slot = host_hash(id, id_len) & (host->bucket_count - 1);
+    entry->next = host->buckets[slot];
+    host->buckets[slot] = entry;
+    host->count++;
+    return entry->node;
+}
+
+Host* net_host_spawn_virtual(net_host_t *host, const char *id, int num_vnodes) {
+    char vnode_id[NET_PROTOCOL_MAX_NODE_ID];
+    char *host_id;
+    Host *vhost;
+    Node *node;
+
+    if (!id || num_vnodes < 1 || strlen(id) + 12 > sizeof(vnode_id)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(host_id = strdup(id))) {
+        return NULL;
+    }
+    vhost = host_init(host_id);
+
+    for (int n = 0; vhost->num_vnodes < num_vnodes && n < ring_key_max() * 4; n++) {
+        snprintf(vnode_id, sizeof(vnode_id), "%d.%s", n, id);
+        if (host_key_taken(vhost, chord_hash(vnode_id))) {
+            continue;
+        }
+        if (!(node = net_host_spawn(host, vnode_id))) {
+            free(vhost->vnodes);
+            free(vhost);
+            free(host_id);
+            return NULL;
+        }
+        host_add(vhost, node);
+    }
+    return vhost;
+}
+
+Node* net_host_find(const net_host_t *host, const char *url) {
+    host_entry_t *entry = url ? host_lookup_url(host, url, strlen(url)) : NULL;
+    return entry ? entry->node : NULL;
+}
+
+const char* net_host_node_url(const net_host_t *host, const Node *node) {
+    host_entry_t *entry = host_lookup(host, node->id, strlen(node->id));
+    return entry && entry->node == node ? entry->url : NULL;
+}
+
+net_peer_t* net_host_acquire(net_host_t *host, const char *url) {
+    host_entry_t *entry = host_lookup_url(host, url, strlen(url));
+
+    if (!entry) {
+        if (!host->pool) {
+            errno = EHOSTUNREACH;
+            return NULL;
+        }
+        host->remote_acquires++;
+        return net_pool_acquire(host->pool, url);
+    }
+    if (!entry->peer) {
+        host_local_t *local = (host_local_t*)calloc(1, sizeof(host_local_t));
+
+        if (!local) {
+            return NULL;
+        }
+        local->base.iface = &host_local_iface;
+        local->base.impl_data = local;
+        local->host = host;
+        local->entry = entry;
+        entry->peer = &local->base;
+        local_connect(entry->peer, entry->url);
+    }
+    return entry->peer;
+}
+
+void net_host_release(net_host_t *host, net_peer_t *peer) {
+    if (peer && peer->iface != &host_local_iface && host->pool) {
+        net_pool_release(host->pool, peer);
+    }
+}
+
+void net_host_get_stats(const net_host_t *host, net_host_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->nodes = host->count;
+    stats->table_bytes = host->bucket_count * sizeof(host_entry_t*);
+    for (size_t i = 0; i < host->bucket_count; i++) {
+        for (const host_entry_t *entry = host->buckets[i]; entry; entry = entry->next) {
+            stats->node_bytes += entry_bytes(entry);
+        }
+    }
+    stats->local_calls = host->local_calls;
+    stats->remote_acquires = host->remote_acquires;
+    stats->served = host->served;
+}
@@ -0,0 +1,98 @@
+#ifndef NET_HOST_H
+#define NET_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "net_loop.h"
+#include "net_peer.h"
+#include "net_pool.h"
+#include "node.h"
+
+/*
+ * Node Host
+ *
+ * One process hosting many logical Chord nodes (thousands, for dense
+ * test clusters) on a single event loop. Every hosted node has its own
+ * Node state and its own URL, the host's base URL plus "/<node id>":
+ *
+ *   tcp://10.0.0.7:5000/17-node
+ *
+ * Calls are routed by URL through net_host_acquire():
+ * - A hosted node's URL gives its local peer. Calls on it never leave
+ *   memory: sync calls are served on the spot, async calls are queued
+ *   and completed by a loop hook at the start of the next
+ *   net_loop_run_once(). Response node strings point at the hosted
+ *   nodes themselves, so nothing is encoded or copied.
+ * - Any other URL goes to the host's net_pool, i.e. a real net_peer.
+ *
+ * Other processes reach a hosted node through the host's listener
+ * (net_host_listen) with the request wrapped in an ADDRESSED envelope
+ * naming the node id; the answer is the inner request's response, or an
+ * ERROR frame for an unknown node. Connections are served on the loop.
+ *
+ * Requests are served against the Node directly, as the node service
+ * does: FIND_SUCCESSOR, CLOSEST_PRECEDING, GET_PREDECESSOR,
+ * GET_SUCCESSOR, PING, NEXT_HOP, NOTIFY and STABILIZE (the last two
+ * name a node that must be hosted here, otherwise
+ * NET_ERR_NODE_NOT_FOUND). Nodes are answered with
+ * their hosted URL, or the base URL for nodes the host does not hold.
+ *
+ * The host only holds nodes: forming the ring (node_create, node_join,
+ * stabilisation) is up to the caller.
+ *
+ * Thread safety: a host and its local peers belong to its loop's
+ * thread; nothing here locks.
+ */
+
+typedef struct net_host net_host_t;
+
+typedef struct {
+    size_t nodes;               /* Hosted nodes */
+    size_t node_bytes;          /* Heap held for them: Node, fingers, URL, local peer */
+    size_t table_bytes;         /* Index buckets */
+    uint64_t local_calls;       /* Calls short-circuited in memory */
+    uint64_t remote_acquires;   /* Peers handed out by the pool */
+    uint64_t served;            /* Addressed requests from other processes */
+} net_host_stats_t;
+
+/* Create a host for base_url (tcp://, ipc:// or any name for a host
+ * that never listens) driven by loop. pool supplies peers for URLs not
+ * hosted here and may be NULL. NULL on failure. */
+net_host_t* net_host_create(net_loop_t *loop, const char *base_url, net_pool_t *pool);
+
+/* Free the host, its nodes' host state and its local peers (the Node
+ * structures stay in the ring). Pending async calls are dropped. */
+void net_host_destroy(net_host_t *host);
+
+/* Listen on the base URL, which then names the port actually bound.
+ * Only before the first node is spawned. Returns 0 or -1 (errno). */
+int net_host_listen(net_host_t *host);
+
+/* Base URL */
+const char* net_host_url(const net_host_t *host);
+
+/* Create and host a node (node_init) named id. NULL with errno EEXIST
+ * if id is taken, EINVAL if it is empty, too long or contains '/'. */
+Node* net_host_spawn(net_host_t *host, const char *id);
+
+/* Host a physical host's num_vnodes virtual nodes, named "<n>.<id>" on
+ * distinct keys, behind this host's one listener and pool (see host.h).
+ * The caller owns the returned Host. NULL with errno as for
+ * net_host_spawn (nodes spawned before the failure stay hosted). */
+Host* net_host_spawn_virtual(net_host_t *host, const char *id, int num_vnodes);
+
+/* Hosted node for url, or NULL */
+Node* net_host_find(const net_host_t *host, const char *url);
+
+/* URL of a hosted node (NULL if node is not hosted here) */
+const char* net_host_node_url(const net_host_t *host, const Node *node);
+
+/* Peer for url: local for hosted nodes, pooled otherwise (NULL if the
+ * pool is missing or cannot dial). Hand it back with net_host_release. */
+net_peer_t* net_host_acquire(net_host_t *host, const char *url);
+void net_host_release(net_host_t *host, net_peer_t *peer);
+
+/* Snapshot of the counters */
+void net_host_get_stats(const net_host_t *host, net_host_stats_t *stats);
+
+#endif /* NET_HOST_H */
@@ -0,0 +1,289 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "net_loop.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+/*
+ * Event loop implementation
+ *
+ * Timers hash into wheel[ceil(expires / TICK) % SLOTS]. Advancing the
+ * wheel visits each slot between the last processed tick and now,
+ * moves due timers onto an expired list and then fires them one by
+ * one, so callbacks may freely start or stop any timer (including
+ * ones that are due in the same pass).
+ */
+
+#define LOOP_MAX_EVENTS 64
+#define LOOP_SLOT_EXPIRED NET_LOOP_WHEEL_SLOTS
+
+struct net_loop {
+    int epoll_fd;
+    uint64_t now_ms;
+    uint64_t tick;                              /* Last processed tick */
+    size_t timer_count;
+    net_timer_t *wheel[NET_LOOP_WHEEL_SLOTS];
+    net_timer_t *expired;
+    net_hook_t *hooks;
+};
+
+static uint64_t loop_clock_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+net_loop_t* net_loop_create(void) {
+    net_loop_t *loop = (net_loop_t*)calloc(1, sizeof(net_loop_t));
+    if (!loop) {
+        return NULL;
+    }
+
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0) {
+        free(loop);
+        return NULL;
+    }
+
+    loop->now_ms = loop_clock_ms();
+    loop->tick = loop->now_ms / NET_LOOP_TICK_MS;
+    return loop;
+}
+
+void net_loop_destroy(net_loop_t *loop) {
+    if (!loop) {
+        return;
+    }
+    close(loop->epoll_fd);
+    free(loop);
+}
+
+uint64_t net_loop_now_ms(const net_loop_t *loop) {
+    return loop->now_ms;
+}
+
+size_t net_loop_timer_count(const net_loop_t *loop) {
+    return loop->timer_count;
+}
+
+/*
+ * Watches
+ */
+
+int net_loop_watch(net_loop_t *loop, net_watch_t *watch, int fd, uint32_t events,
+                   net_watch_callback_t callback, void *context) {
+    struct epoll_event ev;
+    int op = EPOLL_CTL_ADD;
+
+    if (watch->callback && watch->fd == fd) {
+        op = EPOLL_CTL_MOD;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = watch;
+    if (epoll_ctl(loop->epoll_fd, op, fd, &ev) != 0) {
+        return -1;
+    }
+
+    watch->fd = fd;
+    watch->callback = callback;
+    watch->context = context;
+    return 0;
+}
+
+void net_loop_unwatch(net_loop_t *loop, net_watch_t *watch) {
+    if (!watch->callback) {
+        return;
+    }
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, watch->fd, NULL);
+    watch->callback = NULL;
+}
+
+/*
+ * Timer wheel
+ */
+
+static net_timer_t** timer_list(net_loop_t *loop, unsigned slot) {
+    return slot == LOOP_SLOT_EXPIRED ? &loop->expired : &loop->wheel[slot];
+}
+
+static void timer_link(net_loop_t *loop, net_timer_t *timer, unsigned slot) {
+    net_timer_t **head = timer_list(loop, slot);
+
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = *head;
+    if (*head) {
+        (*head)->prev = timer;
+    }
+    *head = timer;
+}
+
+static void timer_unlink(net_loop_t *loop, net_timer_t *timer) {
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    }
+    else {
+        *timer_list(loop, timer->slot) = timer->next;
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+    timer->prev = timer->next = NULL;
+}
+
+void net_timer_init(net_timer_t *timer, net_timer_callback_t callback, void *context) {
+    memset(timer, 0, sizeof(net_timer_t));
+    timer->callback = callback;
+    timer->context = context;
+}
+
+void net_loop_timer_start(net_loop_t *loop, net_timer_t *timer, int timeout_ms) {
+    uint64_t tick;
+
+    net_loop_timer_stop(loop, timer);
+
+    timer->expires_ms = loop->now_ms + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0);
+    /* round up: when the wheel reaches this tick the deadline has passed */
+    tick = (timer->expires_ms + NET_LOOP_TICK_MS - 1) / NET_LOOP_TICK_MS;
+    if (tick <= loop->tick) {
+        tick = loop->tick + 1;  /* already-processed tick: fire on the next one */
+    }
+
+    timer_link(loop, timer, (unsigned)(tick % NET_LOOP_WHEEL_SLOTS));
+    timer->active = 1;
+    loop->timer_count++;
+}
+
+void net_loop_timer_stop(net_loop_t *loop, net_timer_t *timer) {
+    if (!timer->active) {
+        return;
+    }
+    timer_unlink(loop, timer);
+    timer->active = 0;
+    loop->timer_count--;
+}
+
+/*
+ * Hooks
+ */
+
+void net_loop_add_hook(net_loop_t *loop, net_hook_t *hook, net_hook_callback_t callback, void *context) {
+    if (hook->active) {
+        return;
+    }
+    hook->callback = callback;
+    hook->context = context;
+    hook->prev = NULL;
+    hook->next = loop->hooks;
+    if (loop->hooks) {
+        loop->hooks->prev = hook;
+    }
+    loop->hooks = hook;
+    hook->active = 1;
+}
+
+void net_loop_remove_hook(net_loop_t *loop, net_hook_t *hook) {
+    if (!hook->active) {
+        return;
+    }
+    if (hook->prev) {
+        hook->prev->next = hook->next;
+    }
+    else {
+        loop->hooks = hook->next;
+    }
+    if (hook->next) {
+        hook->next->prev = hook->prev;
+    }
+    hook->prev = hook->next = NULL;
+    hook->active = 0;
+}
+
+static void loop_run_hooks(net_loop_t *loop) {
+    net_hook_t *hook = loop->hooks;
+
+    while (hook) {
+        net_hook_t *next = hook->next;  /* The callback may remove its hook */
+        hook->callback(hook->context);
+        hook = next;
+    }
+}
+
+static int loop_expire_timers(net_loop_t *loop) {
+    uint64_t target = loop->now_ms / NET_LOOP_TICK_MS;
+    uint64_t steps;
+    int fired = 0;
+
+    if (target <= loop->tick) {
+        return 0;
+    }
+
+    steps = target - loop->tick;
+    if (steps > NET_LOOP_WHEEL_SLOTS) {
+        steps = NET_LOOP_WHEEL_SLOTS;
+    }
+
+    for (uint64_t i = 1; i <= steps; i++) {
+        unsigned slot = (unsigned)((loop->tick + i) % NET_LOOP_WHEEL_SLOTS);
+        net_timer_t *timer = loop->wheel[slot];
+
+        while (timer) {
+            net_timer_t *next = timer->next;
+            if (timer->expires_ms <= loop->now_ms) {
+                timer_unlink(loop, timer);
+                timer_link(loop, timer, LOOP_SLOT_EXPIRED);
+            }
+            timer = next;
+        }
+    }
+    loop->tick = target;
+
+    while (loop->expired) {
+        net_timer_t *timer = loop->expired;
+        net_loop_timer_stop(loop, timer);
+        timer->callback(timer, timer->context);
+        fired++;
+    }
+
+    return fired;
+}
+
+int net_loop_run_once(net_loop_t *loop, int max_wait_ms) {
+    struct epoll_event events[LOOP_MAX_EVENTS];
+    int wait_ms = max_wait_ms;
+    int count;
+    int dispatched = 0;
+
+    loop_run_hooks(loop);
+
+    /* With timers armed, wake at least once per tick */
+    if (loop->timer_count > 0 && (wait_ms < 0 || wait_ms > NET_LOOP_TICK_MS)) {
+        wait_ms = NET_LOOP_TICK_MS;
+    }
+
+    count = epoll_wait(loop->epoll_fd, events, LOOP_MAX_EVENTS, wait_ms);
+    if (count < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+        count = 0;
+    }
+
+    loop->now_ms = loop_clock_ms();
+
+    for (int i = 0; i < count; i++) {
+        net_watch_t *watch = (net_watch_t*)events[i].data.ptr;
+        if (watch->callback) {
+            watch->callback(watch->context, events[i].events);
+            dispatched++;
+        }
+    }
+
+    return dispatched + loop_expire_timers(loop);
+}
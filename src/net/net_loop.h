@@ -0,0 +1,122 @@
+#ifndef NET_LOOP_H
+#define NET_LOOP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Event Loop
+ *
+ * Single-threaded epoll loop with a hashed timer wheel. Drives the
+ * async RPC engine: transports register their sockets as watches and
+ * every in-flight call arms a timer for its deadline.
+ *
+ * Watches and timers are intrusive: the caller embeds them in its own
+ * objects, so arming or cancelling one never allocates. Starting,
+ * stopping and expiring a timer are all O(1); a timer fires on the
+ * first tick at or after its deadline, so resolution is
+ * NET_LOOP_TICK_MS.
+ *
+ * Thread safety: a loop and everything registered with it belong to
+ * the thread that calls net_loop_run_once().
+ */
+
+/* Timer resolution and wheel size (one revolution ~4 s; longer
+ * timers simply stay in their slot for extra revolutions) */
+#define NET_LOOP_TICK_MS 4
+#define NET_LOOP_WHEEL_SLOTS 1024
+
+typedef struct net_loop net_loop_t;
+
+/*
+ * File descriptor watches
+ */
+
+typedef void (*net_watch_callback_t)(void *context, uint32_t events);
+
+typedef struct {
+    int fd;
+    net_watch_callback_t callback;
+    void *context;
+} net_watch_t;
+
+/* Watch fd for epoll events (watch must start zeroed); calling again
+ * with the same watch changes the event mask. Returns 0 or -1. */
+int net_loop_watch(net_loop_t *loop, net_watch_t *watch, int fd, uint32_t events,
+                   net_watch_callback_t callback, void *context);
+
+/* Stop watching (must be called before closing the fd) */
+void net_loop_unwatch(net_loop_t *loop, net_watch_t *watch);
+
+/*
+ * Timers
+ */
+
+typedef struct net_timer net_timer_t;
+typedef void (*net_timer_callback_t)(net_timer_t *timer, void *context);
+
+struct net_timer {
+    net_timer_t *prev;
+    net_timer_t *next;
+    uint64_t expires_ms;
+    unsigned slot;                  /* Wheel slot, or the expired list */
+    int active;
+    net_timer_callback_t callback;
+    void *context;
+};
+
+/* Initialise a timer (not armed) */
+void net_timer_init(net_timer_t *timer, net_timer_callback_t callback, void *context);
+
+/* Arm (or re-arm) timer to fire after timeout_ms */
+void net_loop_timer_start(net_loop_t *loop, net_timer_t *timer, int timeout_ms);
+
+/* Disarm timer (no-op if not armed) */
+void net_loop_timer_stop(net_loop_t *loop, net_timer_t *timer);
+
+/*
+ * Flush hooks
+ */
+
+typedef struct net_hook net_hook_t;
+typedef void (*net_hook_callback_t)(void *context);
+
+struct net_hook {
+    net_hook_t *prev;
+    net_hook_t *next;
+    int active;
+    net_hook_callback_t callback;
+    void *context;
+};
+
+/* Run callback at the start of every net_loop_run_once(), before the
+ * loop waits: where output batched by earlier callbacks is pushed out
+ * in one syscall. The hook must start zeroed; adding it twice is a
+ * no-op. */
+void net_loop_add_hook(net_loop_t *loop, net_hook_t *hook, net_hook_callback_t callback, void *context);
+
+/* Remove hook (no-op if not added) */
+void net_loop_remove_hook(net_loop_t *loop, net_hook_t *hook);
+
+/*
+ * Loop API
+ */
+
+/* Create loop (NULL on failure) */
+net_loop_t* net_loop_create(void);
+
+/* Destroy loop (watches and timers are simply forgotten) */
+void net_loop_destroy(net_loop_t *loop);
+
+/* Run hooks, wait up to max_wait_ms for I/O (-1 = until something
+ * happens), dispatch ready watches and expired timers.
+ * Returns the number of callbacks run, or -1 on error. */
+int net_loop_run_once(net_loop_t *loop, int max_wait_ms);
+
+/* Loop time in ms (monotonic, refreshed by net_loop_run_once()) */
+uint64_t net_loop_now_ms(const net_loop_t *loop);
+
+/* Number of armed timers */
+size_t net_loop_timer_count(const net_loop_t *loop);
+
+#endif /* NET_LOOP_H */
@@ -0,0 +1,933 @@
+#define _GNU_SOURCE
+
+#include "net_node_service.h"
+#include "net_pool.h"
+#include "net_rpc.h"
+#include "net_transport.h"
+#include "ring.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/*
+ * Node service implementation
+ *
+ * Each handler reads or updates the Node structures directly; the
+ * server's reader/writer lock is what makes that safe across workers.
+ *
+ * Messages to other servers leave through a net_pool of links, one
+ * connection per remote server, each a net_peer whose net_rpc engine
+ * multiplexes every call in flight on it. Links, engines and the pool
+ * are only touched by the service's own loop thread: a caller queues a
+ * job, wakes the loop through an eventfd and sleeps until the job's
+ * call completes. Completed jobs hand their lease back from a loop
+ * hook, outside the link's own callbacks, since a release may destroy
+ * the link. New links are dialled on the loop thread.
+ *
+ * A recursive lookup's origin waits on a pending entry that the
+ * LOOKUP_RESULT handler fills in.
+ */
+
+#define SERVICE_CONNECT_TIMEOUT_MS 1000
+
+_Static_assert(SUCCESSOR_LIST_SIZE <= NET_PROTOCOL_MAX_SUCCESSORS,
+               "a successor list must fit a STABILIZE_RESPONSE");
+
+typedef struct {
+    net_peer_t base;
+    net_node_service_t *service;
+    net_transport_t *transport;         /* NULL until connected, or after a failure */
+    net_rpc_t *rpc;
+    net_watch_t watch;
+} service_link_t;
+
+/* What a caller keeps of a response */
+typedef struct {
+    int has_node;
+    net_node_addr_t node;
+    int done;                           /* NEXT_HOP_RESPONSE */
+    uint32_t count;                     /* STABILIZE_RESPONSE */
+    int successors[NET_PROTOCOL_MAX_SUCCESSORS];    /* keys */
+} service_reply_t;
+
+typedef struct service_job {
+    struct service_job *next;
+    const char *url;
+    net_msg_type_t type;                /* Request, or 0 to send frame one way */
+    int key;
+    const net_node_addr_t *node;
+    const void *frame;
+    size_t len;
+    int timeout_ms;
+    service_reply_t *reply;
+    net_peer_t *peer;                   /* Leased while the call runs */
+    int err;
+    int done;
+} service_job_t;
+
+typedef struct service_pending {
+    uint32_t id;
+    int done;
+    int hops;
+    net_node_addr_t result;
+    struct service_pending *next;
+} service_pending_t;
+
+struct net_node_service {
+    net_server_t *server;
+    Node *node;
+    net_node_resolver_t resolver;
+    void *resolver_context;
+    unsigned link_delay_us;
+    _Atomic uint32_t next_id;           /* Recursive lookup ids */
+
+    net_loop_t *loop;
+    net_pool_t *pool;
+    pthread_t thread;
+    _Atomic int stopping;
+    int wake_fd;                        /* eventfd */
+    net_watch_t wake_watch;
+    net_hook_t hook;
+
+    pthread_mutex_t jobs_lock;
+    pthread_cond_t jobs_cond;           /* Signalled when a job is done */
+    service_job_t *queued_head;         /* Waiting for the loop, oldest first */
+    service_job_t *queued_tail;
+    service_job_t *completed;           /* Loop thread only */
+
+    pthread_mutex_t pending_lock;
+    pthread_cond_t pending_cond;        /* CLOCK_MONOTONIC */
+    service_pending_t *pending;
+};
+
+static const char* service_node_url(const net_node_service_t *service, const Node *node) {
+    const char *url = service->resolver ? service->resolver(service->resolver_context, node) : NULL;
+    return url ? url : net_server_url(service->server);
+}
+
+static void service_copy_node(const net_node_service_t *service, net_node_addr_t *dest,
+                              const Node *node) {
+    net_protocol_copy_node_addr(dest, node->id, node->key, service_node_url(service, node));
+}
+
+/*
+ * Links
+ */
+
+static void service_delay(const net_node_service_t *service, const char *url) {
+    struct timespec ts;
+
+    if (service->link_delay_us == 0 || strcmp(url, net_server_url(service->server)) == 0) {
+        return;
+    }
+    ts.tv_sec = service->link_delay_us / 1000000;
+    ts.tv_nsec = (long)(service->link_delay_us % 1000000) * 1000;
+    nanosleep(&ts, NULL);
+}
+
+static void link_close(service_link_t *link) {
+    if (link->transport) {
+        net_loop_unwatch(link->service->loop, &link->watch);
+        net_transport_destroy(link->transport);
+        link->transport = NULL;
+    }
+    link->base.connected = 0;
+}
+
+static void link_on_ready(void *context, uint32_t events) {
+    service_link_t *link = (service_link_t*)context;
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+
+    (void)events;
+    for (;;) {
+        int n = net_transport_recv(link->transport, frame, sizeof(frame), 0);
+
+        if (n < 0) {
+            if (errno == EMSGSIZE) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                link_close(link);
+                net_rpc_fail_all(link->rpc, NET_ERR_CONNECTION_CLOSED);
+            }
+            return;
+        }
+        /* Frames no call waits for are responses that came too late */
+        net_rpc_receive(link->rpc, frame, (size_t)n);
+    }
+}
+
+static int link_send(void *context, const net_buf_t *frame) {
+    service_link_t *link = (service_link_t*)context;
+
+    if (!link->transport) {
+        return NET_ERR_CONNECTION_CLOSED;
+    }
+    if (net_transport_send(link->transport, frame->data, frame->len, NET_SERVER_SEND_TIMEOUT_MS) != 0) {
+        /* The calls still in flight on it time out */
+        link_close(link);
+        return NET_ERR_CONNECTION_CLOSED;
+    }
+    return NET_ERR_OK;
+}
+
+static int link_connect(net_peer_t *peer, const char *url) {
+    service_link_t *link = (service_link_t*)peer->impl_data;
+    net_transport_type_t type;
+
+    link_close(link);
+    if (net_transport_url_type(url, &type) != 0) {
+        return NET_ERR_NODE_NOT_FOUND;
+    }
+    link->transport = net_transport_create(type);
+    if (!link->transport ||
+        net_transport_connect(link->transport, url, SERVICE_CONNECT_TIMEOUT_MS) != 0 ||
+        net_loop_watch(link->service->loop, &link->watch, net_transport_fd(link->transport),
+                       EPOLLIN, link_on_ready, link) != 0) {
+        net_transport_destroy(link->transport);
+        link->transport = NULL;
+        return NET_ERR_CONNECTION_CLOSED;
+    }
+    snprintf(peer->remote_url, sizeof(peer->remote_url), "%s", url);
+    peer->connected = 1;
+    return NET_ERR_OK;
+}
+
+static int link_call_async(net_peer_t *peer, uint32_t request_id, net_msg_type_t type, int key,
+                           const net_node_addr_t *node, net_peer_callback_t callback,
+                           void *context, int timeout_ms) {
+    service_link_t *link = (service_link_t*)peer->impl_data;
+
+    if (!peer->connected) {
+        return NET_ERR_CONNECTION_CLOSED;
+    }
+    return net_rpc_call(link->rpc, request_id, type, key, node, callback, context, timeout_ms);
+}
+
+static void link_destroy(net_peer_t *peer) {
+    service_link_t *link = (service_link_t*)peer->impl_data;
+
+    link_close(link);
+    net_rpc_destroy(link->rpc);
+    free(link);
+}
+
+static const net_peer_iface_t service_link_iface = {
+    .connect = link_connect,
+    .send_request = NULL,
+    .send_frame = NULL,
+    .call_async = link_call_async,
+    .close = NULL,
+    .destroy = link_destroy
+};
+
+/* Pool factory (loop thread) */
+static net_peer_t* link_create(void *context, const char *url) {
+    net_node_service_t *service = (net_node_service_t*)context;
+    service_link_t *link = (service_link_t*)calloc(1, sizeof(service_link_t));
+
+    (void)url;
+    if (!link) {
+        return NULL;
+    }
+    link->base.iface = &service_link_iface;
+    link->base.impl_data = link;
+    link->service = service;
+    link->rpc = net_rpc_create(service->loop, link_send, link);
+    if (!link->rpc) {
+        free(link);
+        return NULL;
+    }
+    return &link->base;
+}
+
+/*
+ * Jobs
+ */
+
+/* Hand job back to the hook (loop thread) */
+static void job_complete(service_job_t *job, int err) {
+    net_node_service_t *service = ((service_link_t*)job->peer->impl_data)->service;
+
+    job->err = err;
+    job->next = service->completed;
+    service->completed = job;
+}
+
+static void job_on_reply(void *context, const net_frame_view_t *response, int error) {
+    service_job_t *job = (service_job_t*)context;
+    service_reply_t *reply = job->reply;
+
+    /* A view only sets the fields its message type carries */
+    if (error == NET_ERR_OK) {
+        memset(reply, 0, sizeof(*reply));
+        switch (response->header.msg_type) {
+            case NET_MSG_NEXT_HOP_RESPONSE:
+                reply->done = response->done;
+                reply->has_node = 1;
+                net_protocol_copy_node_view(&reply->node, &response->node);
+                break;
+            case NET_MSG_STABILIZE_RESPONSE:
+                reply->count = response->count;
+                for (uint32_t i = 0; i < response->count; i++) {
+                    reply->successors[i] = response->successors[i].key;
+                }
+                /* fall through */
+            case NET_MSG_GET_PREDECESSOR_RESPONSE:
+            case NET_MSG_GET_SUCCESSOR_RESPONSE:
+                reply->has_node = response->has_node;
+                if (response->has_node) {
+                    net_protocol_copy_node_view(&reply->node, &response->node);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    job_complete(job, error);
+}
+
+/* Start job on the loop thread; a job that cannot start is done at once */
+static void job_start(net_node_service_t *service, service_job_t *job) {
+    net_peer_t *peer = net_pool_acquire(service->pool, job->url);
+    service_link_t *link;
+    net_buf_t *buf;
+    int err;
+
+    if (!peer) {
+        pthread_mutex_lock(&service->jobs_lock);
+        job->err = NET_ERR_CONNECTION_CLOSED;
+        job->done = 1;
+        pthread_cond_broadcast(&service->jobs_cond);
+        pthread_mutex_unlock(&service->jobs_lock);
+        return;
+    }
+    job->peer = peer;
+    link = (service_link_t*)peer->impl_data;
+    if (job->type == 0) {
+        if ((buf = net_buf_alloc()) == NULL) {
+            job_complete(job, NET_ERR_INTERNAL);
+            return;
+        }
+        memcpy(buf->data, job->frame, job->len);
+        buf->len = job->len;
+        job_complete(job, link_send(link, buf));
+        net_buf_free(buf);
+        return;
+    }
+    err = peer->iface->call_async(peer, net_peer_next_request_id(peer), job->type, job->key,
+                                  job->node, job_on_reply, job, job->timeout_ms);
+    if (err != NET_ERR_OK) {
+        job_complete(job, err);
+    }
+}
+
+static void service_on_wake(void *context, uint32_t events) {
+    net_node_service_t *service = (net_node_service_t*)context;
+    service_job_t *job;
+    uint64_t count;
+
+    (void)events;
+    if (read(service->wake_fd, &count, sizeof(count)) < 0) {
+        /* Nothing pending: another wake-up already drained it */
+    }
+    pthread_mutex_lock(&service->jobs_lock);
+    job = service->queued_head;
+    service->queued_head = NULL;
+    service->queued_tail = NULL;
+    pthread_mutex_unlock(&service->jobs_lock);
+
+    while (job) {
+        service_job_t *next = job->next;
+        job_start(service, job);
+        job = next;
+    }
+}
+
+/* Loop hook: settle completed jobs and wake their callers */
+static void service_settle(void *context) {
+    net_node_service_t *service = (net_node_service_t*)context;
+    service_job_t *job = service->completed;
+
+    if (!job) {
+        return;
+    }
+    service->completed = NULL;
+    pthread_mutex_lock(&service->jobs_lock);
+    while (job) {
+        service_job_t *next = job->next;
+
+        net_pool_report(service->pool, job->peer, job->err);
+        net_pool_release(service->pool, job->peer);
+        job->done = 1;
+        job = next;
+    }
+    pthread_cond_broadcast(&service->jobs_cond);
+    pthread_mutex_unlock(&service->jobs_lock);
+}
+
+static void* service_loop_main(void *arg) {
+    net_node_service_t *service = (net_node_service_t*)arg;
+
+    while (!atomic_load(&service->stopping)) {
+        net_loop_run_once(service->loop, -1);
+    }
+    net_buf_pool_release();
+    return NULL;
+}
+
+/* Queue job for the loop thread and wait until it is done. Returns a
+ * net_error_t code. */
+static int service_run(net_node_service_t *service, service_job_t *job) {
+    uint64_t one = 1;
+
+    job->next = NULL;
+    job->peer = NULL;
+    job->done = 0;
+    pthread_mutex_lock(&service->jobs_lock);
+    if (service->queued_tail) {
+        service->queued_tail->next = job;
+    } else {
+        service->queued_head = job;
+    }
+    service->queued_tail = job;
+    pthread_mutex_unlock(&service->jobs_lock);
+
+    if (write(service->wake_fd, &one, sizeof(one)) < 0) {
+        /* Counter saturated: a wake-up is already pending */
+    }
+
+    pthread_mutex_lock(&service->jobs_lock);
+    while (!job->done) {
+        pthread_cond_wait(&service->jobs_cond, &service->jobs_lock);
+    }
+    pthread_mutex_unlock(&service->jobs_lock);
+    return job->err;
+}
+
+/* Send a one-way frame to url. Returns a net_error_t code. */
+static int service_send(net_node_service_t *service, const char *url, const void *frame, size_t len) {
+    service_job_t job;
+
+    memset(&job, 0, sizeof(job));
+    job.url = url;
+    job.frame = frame;
+    job.len = len;
+    service_delay(service, url);
+    return service_run(service, &job);
+}
+
+/* Call url with a request of type (key and node as net_rpc_call) and
+ * keep the answer in reply. Returns a net_error_t code. */
+static int service_call(net_node_service_t *service, const char *url, net_msg_type_t type, int key,
+                        const net_node_addr_t *node, int timeout_ms, service_reply_t *reply) {
+    service_job_t job;
+    int err;
+
+    memset(&job, 0, sizeof(job));
+    job.url = url;
+    job.type = type;
+    job.key = key;
+    job.node = node;
+    job.timeout_ms = timeout_ms;
+    job.reply = reply;
+    service_delay(service, url);
+    err = service_run(service, &job);
+    service_delay(service, url);
+    return err;
+}
+
+static int service_find_successor(void *context, const net_frame_view_t *request,
+                                  net_message_t *response) {
+    net_node_service_t *service = (net_node_service_t*)context;
+    Node *successor = node_find_successor(service->node, request->key);
+
+    service_copy_node(service, &response->payload.find_successor_resp.node, successor);
+    return NET_ERR_OK;
+}
+
+static int service_closest_preceding(void *context, const net_frame_view_t *request,
+                                     net_message_t *response) {
+    net_node_service_t *service = (net_node_service_t*)context;
+    Node *closest = node_closest_preceding_node(service->node, request->key);
+
+    service_copy_node(service, &response->payload.closest_preceding_resp.node, closest);
+    return NET_ERR_OK;
+}
+
+static int service_get_node(const net_node_service_t *service, const Node *node,
+                            net_message_t *response) {
+    response->payload.get_node_resp.has_node = node != NULL;
+    if (node) {
+        service_copy_node(service, &response->payload.get_node_resp.node, node);
+    }
+    return NET_ERR_OK;
+}
+
+static int service_get_predecessor(void *context, const net_frame_view_t *request,
+                                   net_message_t *response) {
+    net_node_service_t *service = (net_node_service_t*)context;
+
+    (void)request;
+    return service_get_node(service, service->node->predecessor, response);
+}
+
+static int service_get_successor(void *context, const net_frame_view_t *request,
+                                 net_message_t *response) {
+    net_node_service_t *service = (net_node_service_t*)context;
+
+    (void)request;
+    return service_get_node(service, service->node->successor, response);
+}
+
+static int service_ping(void *context, const net_frame_view_t *request, net_message_t *response) {
+    net_node_service_t *service = (net_node_service_t*)context;
+
+    (void)request;
+    response->payload.ping_resp.alive = service->node->state == NODE_STATE_RUNNING;
+    response->payload.ping_resp.state = service->node->state;
+    return NET_ERR_OK;
+}
+
+static int service_next_hop(void *context, const net_frame_view_t *request, net_message_t *response) {
+    net_node_service_t *service = (net_node_service_t*)context;
+    int done;
+    const Node *next = node_next_hop(service->node, request->key, &done);
+
+    response->payload.next_hop_resp.done = done;
+    service_copy_node(service, &response->payload.next_hop_resp.node, next);
+    return NET_ERR_OK;
+}
+
+static int service_forward_lookup(void *context, const net_frame_view_t *request,
+                                  net_message_t *response) {
+    net_node_service_t *service = (net_node_service_t*)context;
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+    net_node_addr_t origin;
+    net_node_addr_t next;
+    const Node *node;
+    int done;
+    int len;
+
+    (void)response;
+    net_protocol_copy_node_view(&origin, &request->node);
+    node = node_next_hop(service->node, request->key, &done);
+    service_copy_node(service, &next, node);
+
+    if (done) {
+        /* The owner answers the origin directly */
+        len = net_protocol_encode_lookup(frame, sizeof(frame), NET_MSG_LOOKUP_RESULT,
+                                         request->header.request_id, request->key,
+                                         request->hops, &next);
+        if (len > 0) {
+            service_send(service, origin.url, frame, (size_t)len);
+        }
+    } else if (request->hops < NET_LOOKUP_MAX_HOPS) {
+        len = net_protocol_encode_lookup(frame, sizeof(frame), NET_MSG_FORWARD_LOOKUP,
+                                         request->header.request_id, request->key,
+                                         request->hops + 1, &origin);
+        if (len > 0) {
+            service_send(service, next.url, frame, (size_t)len);
+        }
+    }
+    /* else dropped: the origin times out */
+    return NET_SERVER_NO_REPLY;
+}
+
+static int service_lookup_result(void *context, const net_frame_view_t *request,
+                                 net_message_t *response) {
+    net_node_service_t *service = (net_node_service_t*)context;
+    service_pending_t *pending;
+
+    (void)response;
+    pthread_mutex_lock(&service->pending_lock);
+    for (pending = service->pending; pending; pending = pending->next) {
+        if (pending->id == request->header.request_id && !pending->done) {
+            net_protocol_copy_node_view(&pending->result, &request->node);
+            pending->hops = request->hops;
+            pending->done = 1;
+            pthread_cond_broadcast(&service->pending_cond);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&service->pending_lock);
+    return NET_SERVER_NO_REPLY;
+}
+
+/* Node of this process's ring with key, or NULL */
+static Node* service_ring_node(int key) {
+    Ring *ring = ring_get();
+
+    for (unsigned i = 0; i < ring->size; i++) {
+        if (ring->nodes[i]->key == key) {
+            return ring->nodes[i];
+        }
+    }
+    return NULL;
+}
+
+static int service_notify(void *context, const net_frame_view_t *request, net_message_t *response) {
+    net_node_service_t *service = (net_node_service_t*)context;
+    Node *from = service_ring_node(request->node.key);
+
+    if (!from) {
+        return NET_ERR_NODE_NOT_FOUND;
+    }
+    node_notify(service->node, from);
+    response->payload.notify_resp.success = 1;
+    return NET_ERR_OK;
+}
+
+static int service_stabilize(void *context, const net_frame_view_t *request,
+                             net_message_t *response) {
+    net_node_service_t *service = (net_node_service_t*)context;
+    net_stabilize_resp_t *resp = &response->payload.stabilize_resp;
+    Node *from = service_ring_node(request->node.key);
+    Node *successors[SUCCESSOR_LIST_SIZE];
+    Node *predecessor;
+    int count;
+
+    if (!from) {
+        return NET_ERR_NODE_NOT_FOUND;
+    }
+    predecessor = node_stabilise_answer(service->node, from, successors, &count);
+    resp->has_node = predecessor != NULL;
+    if (predecessor) {
+        service_copy_node(service, &resp->node, predecessor);
+    }
+    resp->count = (uint32_t)count;
+    for (int i = 0; i < count; i++) {
+        service_copy_node(service, &resp->successors[i], successors[i]);
+    }
+    return NET_ERR_OK;
+}
+
+net_node_service_t* net_node_service_create(net_server_t *server, Node *node) {
+    net_node_service_t *service;
+    net_pool_config_t pool_config;
+    pthread_condattr_t attr;
+
+    if (!server || !node) {
+        return NULL;
+    }
+    service = (net_node_service_t*)calloc(1, sizeof(net_node_service_t));
+    if (!service) {
+        return NULL;
+    }
+    service->server = server;
+    service->node = node;
+    service->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    service->loop = net_loop_create();
+    net_pool_config_default(&pool_config);
+    service->pool = net_pool_create(&pool_config, link_create, service);
+    if (service->wake_fd < 0 || !service->loop || !service->pool ||
+        net_loop_watch(service->loop, &service->wake_watch, service->wake_fd, EPOLLIN,
+                       service_on_wake, service) != 0) {
+        goto fail;
+    }
+    net_loop_add_hook(service->loop, &service->hook, service_settle, service);
+
+    pthread_mutex_init(&service->jobs_lock, NULL);
+    pthread_cond_init(&service->jobs_cond, NULL);
+    pthread_mutex_init(&service->pending_lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&service->pending_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&service->thread, NULL, service_loop_main, service) != 0) {
+        pthread_cond_destroy(&service->pending_cond);
+        pthread_mutex_destroy(&service->pending_lock);
+        pthread_cond_destroy(&service->jobs_cond);
+        pthread_mutex_destroy(&service->jobs_lock);
+        goto fail;
+    }
+
+    net_server_handle(server, NET_MSG_FIND_SUCCESSOR, NET_SERVER_READ, service_find_successor, service);
+    net_server_handle(server, NET_MSG_CLOSEST_PRECEDING, NET_SERVER_READ, service_closest_preceding, service);
+    net_server_handle(server, NET_MSG_GET_PREDECESSOR, NET_SERVER_READ, service_get_predecessor, service);
+    net_server_handle(server, NET_MSG_GET_SUCCESSOR, NET_SERVER_READ, service_get_successor, service);
+    net_server_handle(server, NET_MSG_PING, NET_SERVER_READ, service_ping, service);
+    net_server_handle(server, NET_MSG_NOTIFY, NET_SERVER_WRITE, service_notify, service);
+    net_server_handle(server, NET_MSG_STABILIZE, NET_SERVER_WRITE, service_stabilize, service);
+    net_server_handle(server, NET_MSG_NEXT_HOP, NET_SERVER_READ, service_next_hop, service);
+    net_server_handle(server, NET_MSG_FORWARD_LOOKUP, NET_SERVER_READ, service_forward_lookup, service);
+    net_server_handle(server, NET_MSG_LOOKUP_RESULT, NET_SERVER_READ, service_lookup_result, service);
+    return service;
+
+fail:
+    net_pool_destroy(service->pool);
+    net_loop_destroy(service->loop);
+    if (service->wake_fd >= 0) {
+        close(service->wake_fd);
+    }
+    free(service);
+    return NULL;
+}
+
+void net_node_service_destroy(net_node_service_t *service) {
+    uint64_t one = 1;
+
+    if (!service) {
+        return;
+    }
+    atomic_store(&service->stopping, 1);
+    if (write(service->wake_fd, &one, sizeof(one)) < 0) {
+        /* Counter saturated: a wake-up is already pending */
+    }
+    pthread_join(service->thread, NULL);
+
+    /* Links unwatch themselves from the loop as they go */
+    net_pool_destroy(service->pool);
+    net_loop_remove_hook(service->loop, &service->hook);
+    net_loop_unwatch(service->loop, &service->wake_watch);
+    close(service->wake_fd);
+    net_loop_destroy(service->loop);
+
+    pthread_cond_destroy(&service->pending_cond);
+    pthread_mutex_destroy(&service->pending_lock);
+    pthread_cond_destroy(&service->jobs_cond);
+    pthread_mutex_destroy(&service->jobs_lock);
+    free(service);
+}
+
+void net_node_service_set_resolver(net_node_service_t *service, net_node_resolver_t resolver,
+                                   void *context) {
+    service->resolver = resolver;
+    service->resolver_context = context;
+}
+
+void net_node_service_set_link_delay(net_node_service_t *service, unsigned delay_us) {
+    service->link_delay_us = delay_us;
+}
+
+static int lookup_iterative(net_node_service_t *service, int key, net_node_addr_t next,
+                            int timeout_ms, net_node_addr_t *result, int *hops) {
+    service_reply_t reply;
+
+    for (int hop = 1; hop <= NET_LOOKUP_MAX_HOPS; hop++) {
+        int err = service_call(service, next.url, NET_MSG_NEXT_HOP, key, NULL, timeout_ms, &reply);
+
+        if (err != NET_ERR_OK) {
+            return err;
+        }
+        next = reply.node;
+        if (reply.done) {
+            *result = next;
+            *hops = hop;
+            return NET_ERR_OK;
+        }
+    }
+    return NET_ERR_NODE_NOT_FOUND;
+}
+
+static int lookup_recursive(net_node_service_t *service, int key, const net_node_addr_t *next,
+                            int timeout_ms, net_node_addr_t *result, int *hops) {
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+    service_pending_t pending;
+    service_pending_t **link;
+    net_node_addr_t origin;
+    struct timespec deadline;
+    int err;
+    int len;
+
+    memset(&pending, 0, sizeof(pending));
+    pending.id = atomic_fetch_add_explicit(&service->next_id, 1, memory_order_relaxed);
+    net_protocol_copy_node_addr(&origin, service->node->id, service->node->key,
+                                net_server_url(service->server));
+    len = net_protocol_encode_lookup(frame, sizeof(frame), NET_MSG_FORWARD_LOOKUP, pending.id,
+                                     key, 1, &origin);
+    if (len < 0) {
+        return NET_ERR_INTERNAL;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&service->pending_lock);
+    pending.next = service->pending;
+    service->pending = &pending;
+    pthread_mutex_unlock(&service->pending_lock);
+
+    err = service_send(service, next->url, frame, (size_t)len);
+
+    pthread_mutex_lock(&service->pending_lock);
+    while (err == NET_ERR_OK && !pending.done) {
+        if (pthread_cond_timedwait(&service->pending_cond, &service->pending_lock, &deadline) == ETIMEDOUT) {
+            err = pending.done ? NET_ERR_OK : NET_ERR_TIMEOUT;
+            break;
+        }
+    }
+    for (link = &service->pending; *link; link = &(*link)->next) {
+        if (*link == &pending) {
+            *link = pending.next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&service->pending_lock);
+
+    if (err == NET_ERR_OK) {
+        *result = pending.result;
+        *hops = pending.hops;
+    }
+    return err;
+}
+
+/* node_stabilise() as one STABILIZE exchange with the successor, and
+ * one more with the successor it adopts, if any */
+static int stabilise_combined(net_node_service_t *service, const net_node_addr_t *self,
+                              net_node_addr_t successor, int timeout_ms, int *trips) {
+    service_reply_t reply;
+    Node *successors[SUCCESSOR_LIST_SIZE];
+
+    for (int round = 0; round < 2; round++) {
+        Node *predecessor = NULL;
+        Node *before;
+        int moved;
+        int count = 0;
+        int err = service_call(service, successor.url, NET_MSG_STABILIZE, 0, self, timeout_ms, &reply);
+
+        (*trips)++;
+        if (err != NET_ERR_OK) {
+            return err;
+        }
+        if (reply.has_node) {
+            predecessor = service_ring_node(reply.node.key);
+        }
+        for (uint32_t i = 0; i < reply.count && count < SUCCESSOR_LIST_SIZE; i++) {
+            if ((successors[count] = service_ring_node(reply.successors[i])) == NULL) {
+                break;
+            }
+            count++;
+        }
+
+        net_server_lock(service->server, NET_SERVER_WRITE);
+        before = service->node->successor;
+        node_stabilise_adopt(service->node, predecessor, successors, count);
+        service_copy_node(service, &successor, service->node->successor);
+        moved = service->node->successor != before;
+        net_server_unlock(service->server);
+        if (!moved) {
+            break;
+        }
+    }
+    return NET_ERR_OK;
+}
+
+/* node_stabilise() step by step: GET_PREDECESSOR, GET_SUCCESSOR down
+ * the list, then NOTIFY */
+static int stabilise_separate(net_node_service_t *service, const net_node_addr_t *self,
+                              const net_node_addr_t *successor, int timeout_ms, int *trips) {
+    service_reply_t reply;
+    net_node_addr_t next = *successor;
+    Node *successors[SUCCESSOR_LIST_SIZE];
+    Node *predecessor = NULL;
+    int count = 0;
+    int err;
+
+    err = service_call(service, successor->url, NET_MSG_GET_PREDECESSOR, 0, NULL, timeout_ms, &reply);
+    (*trips)++;
+    if (err != NET_ERR_OK) {
+        return err;
+    }
+    if (reply.has_node) {
+        predecessor = service_ring_node(reply.node.key);
+    }
+    while (count < SUCCESSOR_LIST_SIZE - 1) {
+        err = service_call(service, next.url, NET_MSG_GET_SUCCESSOR, 0, NULL, timeout_ms, &reply);
+        (*trips)++;
+        if (err != NET_ERR_OK) {
+            return err;
+        }
+        if (!reply.has_node || (successors[count] = service_ring_node(reply.node.key)) == NULL) {
+            break;
+        }
+        next = reply.node;
+        count++;
+    }
+
+    net_server_lock(service->server, NET_SERVER_WRITE);
+    node_stabilise_adopt(service->node, predecessor, successors, count);
+    service_copy_node(service, &next, service->node->successor);
+    net_server_unlock(service->server);
+
+    err = service_call(service, next.url, NET_MSG_NOTIFY, 0, self, timeout_ms, &reply);
+    (*trips)++;
+    return err;
+}
+
+int net_node_service_stabilise(net_node_service_t *service, net_stabilise_mode_t mode,
+                               int timeout_ms, int *trips) {
+    net_node_addr_t self;
+    net_node_addr_t successor;
+    int alone;
+    int unused;
+
+    if (!service) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+    if (!trips) {
+        trips = &unused;
+    }
+    *trips = 0;
+
+    net_server_lock(service->server, NET_SERVER_READ);
+    alone = service->node->successor == service->node;
+    service_copy_node(service, &self, service->node);
+    service_copy_node(service, &successor, service->node->successor);
+    net_server_unlock(service->server);
+
+    if (alone) {
+        /* Only a local predecessor to adopt */
+        net_server_lock(service->server, NET_SERVER_WRITE);
+        node_stabilise(service->node);
+        net_server_unlock(service->server);
+        return NET_ERR_OK;
+    }
+    if (mode == NET_STABILISE_SEPARATE) {
+        return stabilise_separate(service, &self, &successor, timeout_ms, trips);
+    }
+    return stabilise_combined(service, &self, successor, timeout_ms, trips);
+}
+
+int net_node_service_lookup(net_node_service_t *service, int key, net_lookup_mode_t mode,
+                            int timeout_ms, net_node_addr_t *result, int *hops) {
+    net_node_addr_t next;
+    const Node *node;
+    int done;
+    int unused;
+
+    if (!service || !result || key < 0) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+    if (!hops) {
+        hops = &unused;
+    }
+
+    /* The first step is local */
+    net_server_lock(service->server, NET_SERVER_READ);
+    node = node_next_hop(service->node, key, &done);
+    service_copy_node(service, &next, node);
+    net_server_unlock(service->server);
+
+    if (done) {
+        *result = next;
+        *hops = 0;
+        return NET_ERR_OK;
+    }
+    if (mode == NET_LOOKUP_RECURSIVE) {
+        return lookup_recursive(service, key, &next, timeout_ms, result, hops);
+    }
+    return lookup_iterative(service, key, next, timeout_ms, result, hops);
+}
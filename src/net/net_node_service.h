@@ -0,0 +1,99 @@
+#ifndef NET_NODE_SERVICE_H
+#define NET_NODE_SERVICE_H
+
+#include "net_server.h"
+#include "node.h"
+
+/*
+ * Node Service
+ *
+ * Serves one local Chord node's operations through a net_server:
+ * - FIND_SUCCESSOR      node_find_successor()           reader
+ * - CLOSEST_PRECEDING   node_closest_preceding_node()   reader
+ * - GET_PREDECESSOR     node->predecessor               reader
+ * - GET_SUCCESSOR       node->successor                 reader
+ * - PING                node->state                     reader
+ * - NOTIFY              node_notify()                   writer
+ * - STABILIZE           node_stabilise_answer()         writer
+ * - NEXT_HOP            one routing step                reader
+ * - FORWARD_LOOKUP      one routing step, passed on     reader
+ * - LOOKUP_RESULT       completes a local lookup        reader
+ *
+ * Lookups therefore run on every worker at once while NOTIFY waits for
+ * them to drain and runs alone. Any other code that changes the ring
+ * while the server runs must hold the same exclusion, e.g. by running
+ * from a NET_SERVER_WRITE handler.
+ *
+ * Nodes are answered with the server's URL unless a resolver names
+ * another, which is needed when the ring's nodes sit behind different
+ * servers. NOTIFY and STABILIZE name their node by key; it must be a
+ * node of this process's ring, otherwise the answer is
+ * NET_ERR_NODE_NOT_FOUND.
+ *
+ * net_node_service_stabilise() runs node_stabilise() against the
+ * node's successor on its server, in either mode:
+ * - Separate: GET_PREDECESSOR, a GET_SUCCESSOR per further list entry,
+ *   then NOTIFY. SUCCESSOR_LIST_SIZE + 1 round trips.
+ * - Combined: one STABILIZE, whose answer carries the predecessor and
+ *   the successor's list; the notify goes with the request. When that
+ *   predecessor becomes the new successor, a second STABILIZE notifies
+ *   it and fetches its list. A settled ring costs one round trip.
+ *
+ * net_node_service_lookup() runs node_find_successor() across servers,
+ * one routing step per node, in either mode:
+ * - Iterative: the origin sends NEXT_HOP to each node in turn and gets
+ *   back the node to ask next, or the key's successor. 2 trips per hop.
+ * - Recursive: FORWARD_LOOKUP is passed from node to node and the
+ *   owner's predecessor sends LOOKUP_RESULT straight to the origin.
+ *   hops + 1 one-way trips; neither message is answered, so a lost
+ *   message shows up as a timeout at the origin.
+ */
+
+/* Most remote nodes one lookup visits (as node_find_successor_impl) */
+#define NET_LOOKUP_MAX_HOPS (KEY_BITS * 2)
+
+typedef enum {
+    NET_LOOKUP_ITERATIVE,           /* Origin asks every hop itself */
+    NET_LOOKUP_RECURSIVE            /* Each hop forwards, owner replies to origin */
+} net_lookup_mode_t;
+
+typedef enum {
+    NET_STABILISE_COMBINED,         /* One STABILIZE round trip */
+    NET_STABILISE_SEPARATE          /* One round trip per read, then NOTIFY */
+} net_stabilise_mode_t;
+
+typedef struct net_node_service net_node_service_t;
+
+/* URL of the server serving node, or NULL for this service's own */
+typedef const char* (*net_node_resolver_t)(void *context, const Node *node);
+
+/* Register node's handlers on server (after net_server_listen, before
+ * net_server_start). NULL on failure. */
+net_node_service_t* net_node_service_create(net_server_t *server, Node *node);
+
+/* Free the service (stop the server first) */
+void net_node_service_destroy(net_node_service_t *service);
+
+/* Name the server of every node the service answers with or sends to
+ * (before net_server_start) */
+void net_node_service_set_resolver(net_node_service_t *service, net_node_resolver_t resolver,
+                                   void *context);
+
+/* Hold every message the service sends to another server for delay_us,
+ * to simulate link latency (0, the default, sends at once) */
+void net_node_service_set_link_delay(net_node_service_t *service, unsigned delay_us);
+
+/* Find key's successor starting at the service's node. Sets result and
+ * the number of remote nodes visited (hops may be NULL). Returns a
+ * net_error_t code: NET_ERR_TIMEOUT if no answer came in timeout_ms. */
+int net_node_service_lookup(net_node_service_t *service, int key, net_lookup_mode_t mode,
+                            int timeout_ms, net_node_addr_t *result, int *hops);
+
+/* One stabilization period of the service's node. Sets the round trips
+ * it took (trips may be NULL; 0 for a node alone in its ring). Returns
+ * a net_error_t code; on error the node is left as it was, except that
+ * in separate mode a failed NOTIFY comes after the update. */
+int net_node_service_stabilise(net_node_service_t *service, net_stabilise_mode_t mode,
+                               int timeout_ms, int *trips);
+
+#endif /* NET_NODE_SERVICE_H */
@@ -17,6 +17,10 @@ net_peer_t* net_peer_create(const net_peer_iface_t *iface) {
     return peer;
 }
 
+uint32_t net_peer_next_request_id(net_peer_t *peer) {
+    return atomic_fetch_add_explicit(&peer->next_request_id, 1, memory_order_relaxed) + 1;
+}
+
 int net_peer_connect(net_peer_t *peer, const char *url) {
     if (!peer || !peer->iface || !peer->iface->connect) {
         return NET_ERR_INTERNAL;
@@ -32,12 +36,41 @@ int net_peer_send_request(net_peer_t *peer, const net_message_t *request,
     return peer->iface->send_request(peer, request, response, timeout_ms);
 }
 
+int net_peer_send_frame(net_peer_t *peer, const net_buf_t *request,
+                        net_buf_t *response, int timeout_ms) {
+    if (!peer || !peer->iface || !peer->iface->send_frame) {
+        return NET_ERR_INTERNAL;
+    }
+    return peer->iface->send_frame(peer, request, response, timeout_ms);
+}
+
 int net_peer_send_request_async(net_peer_t *peer, const net_message_t *request,
                                 net_peer_callback_t callback, void *context, int timeout_ms) {
-    if (!peer || !peer->iface || !peer->iface->send_request_async) {
+    int key = 0;
+    const net_node_addr_t *node = NULL;
+    
+    if (!peer || !peer->iface || !peer->iface->call_async || !request) {
         return NET_ERR_INTERNAL;
     }
-    return peer->iface->send_request_async(peer, request, callback, context, timeout_ms);
+    
+    switch (request->header.msg_type) {
+        case NET_MSG_FIND_SUCCESSOR:
+            key = request->payload.find_successor_req.key;
+            break;
+        case NET_MSG_CLOSEST_PRECEDING:
+            key = request->payload.closest_preceding_req.key;
+            break;
+        case NET_MSG_NOTIFY:
+        case NET_MSG_STABILIZE:
+            node = &request->payload.notify_req.node;
+            break;
+        default:
+            break;
+    }
+    
+    return peer->iface->call_async(peer, net_peer_next_request_id(peer),
+                                   (net_msg_type_t)request->header.msg_type, key, node,
+                                   callback, context, timeout_ms);
 }
 
 void net_peer_close(net_peer_t *peer) {
@@ -56,140 +89,357 @@ void net_peer_destroy(net_peer_t *peer) {
  * High-level Chord RPC helpers
  */
 
-int net_peer_find_successor(net_peer_t *peer, int key, net_node_addr_t *result, int timeout_ms) {
-    net_message_t request, response;
-    
-    memset(&request, 0, sizeof(net_message_t));
-    request.header.version = NET_PROTOCOL_VERSION;
-    request.header.msg_type = NET_MSG_FIND_SUCCESSOR;
-    request.header.request_id = (uint32_t)rand();  /* Simple request ID */
-    request.payload.find_successor_req.key = key;
-    
-    int err = net_peer_send_request(peer, &request, &response, timeout_ms);
+/*
+ * Encode a request into a pooled buffer, send it and decode the reply
+ * as a view over *response_buf. The caller reads the view and then
+ * releases *response_buf with net_buf_free() (also on error).
+ */
+static int peer_call(net_peer_t *peer, net_msg_type_t type, int key, const net_node_addr_t *node,
+                     net_msg_type_t expected, net_frame_view_t *view,
+                     net_buf_t **response_buf, int timeout_ms) {
+    uint32_t request_id;
+    net_buf_t *request;
+    net_buf_t *response;
+    int err;
+
+    if (!peer) {
+        *response_buf = NULL;
+        return NET_ERR_INTERNAL;
+    }
+
+    request_id = net_peer_next_request_id(peer);
+    request = net_buf_alloc();
+    response = net_buf_alloc();
+    *response_buf = response;
+    if (!request || !response) {
+        net_buf_free(request);
+        return NET_ERR_INTERNAL;
+    }
+
+    int len = net_protocol_encode_request(request->data, sizeof(request->data), type, request_id, key, node);
+    if (len < 0) {
+        net_buf_free(request);
+        return NET_ERR_INTERNAL;
+    }
+    request->len = (size_t)len;
+
+    err = net_peer_send_frame(peer, request, response, timeout_ms);
+    net_buf_free(request);
     if (err != NET_ERR_OK) {
         return err;
     }
-    
-    if (response.header.msg_type != NET_MSG_FIND_SUCCESSOR_RESPONSE) {
+
+    err = net_protocol_decode_view(view, response->data, response->len);
+    if (err != NET_ERR_OK) {
+        return err;
+    }
+    if (view->header.msg_type == NET_MSG_ERROR) {
+        return view->error_code != NET_ERR_OK ? (int)view->error_code : NET_ERR_INTERNAL;
+    }
+    if (view->header.msg_type != expected || view->header.request_id != request_id) {
         return NET_ERR_INVALID_MESSAGE;
     }
-    
-    memcpy(result, &response.payload.find_successor_resp.node, sizeof(net_node_addr_t));
+
     return NET_ERR_OK;
 }
 
-int net_peer_get_predecessor(net_peer_t *peer, net_node_addr_t *result, int *has_predecessor, int timeout_ms) {
-    net_message_t request, response;
-    
-    memset(&request, 0, sizeof(net_message_t));
-    request.header.version = NET_PROTOCOL_VERSION;
-    request.header.msg_type = NET_MSG_GET_PREDECESSOR;
-    request.header.request_id = (uint32_t)rand();
+int net_peer_find_successor(net_peer_t *peer, int key, net_node_addr_t *result, int timeout_ms) {
+    net_frame_view_t view;
+    net_buf_t *response;
     
-    int err = net_peer_send_request(peer, &request, &response, timeout_ms);
-    if (err != NET_ERR_OK) {
-        return err;
+    int err = peer_call(peer, NET_MSG_FIND_SUCCESSOR, key, NULL,
+                        NET_MSG_FIND_SUCCESSOR_RESPONSE, &view, &response, timeout_ms);
+    if (err == NET_ERR_OK) {
+        net_protocol_copy_node_view(result, &view.node);
     }
     
-    if (response.header.msg_type != NET_MSG_GET_PREDECESSOR_RESPONSE) {
-        return NET_ERR_INVALID_MESSAGE;
-    }
+    net_buf_free(response);
+    return err;
+}
+
+int net_peer_get_predecessor(net_peer_t *peer, net_node_addr_t *result, int *has_predecessor, int timeout_ms) {
+    net_frame_view_t view;
+    net_buf_t *response;
     
-    *has_predecessor = response.payload.get_node_resp.has_node;
-    if (*has_predecessor) {
-        memcpy(result, &response.payload.get_node_resp.node, sizeof(net_node_addr_t));
+    int err = peer_call(peer, NET_MSG_GET_PREDECESSOR, 0, NULL,
+                        NET_MSG_GET_PREDECESSOR_RESPONSE, &view, &response, timeout_ms);
+    if (err == NET_ERR_OK) {
+        *has_predecessor = view.has_node;
+        if (view.has_node) {
+            net_protocol_copy_node_view(result, &view.node);
+        }
     }
     
-    return NET_ERR_OK;
+    net_buf_free(response);
+    return err;
 }
 
 int net_peer_get_successor(net_peer_t *peer, net_node_addr_t *result, int timeout_ms) {
-    net_message_t request, response;
+    net_frame_view_t view;
+    net_buf_t *response;
     
-    memset(&request, 0, sizeof(net_message_t));
-    request.header.version = NET_PROTOCOL_VERSION;
-    request.header.msg_type = NET_MSG_GET_SUCCESSOR;
-    request.header.request_id = (uint32_t)rand();
-    
-    int err = net_peer_send_request(peer, &request, &response, timeout_ms);
-    if (err != NET_ERR_OK) {
-        return err;
+    int err = peer_call(peer, NET_MSG_GET_SUCCESSOR, 0, NULL,
+                        NET_MSG_GET_SUCCESSOR_RESPONSE, &view, &response, timeout_ms);
+    if (err == NET_ERR_OK) {
+        if (view.has_node) {
+            net_protocol_copy_node_view(result, &view.node);
+        }
+        else {
+            err = NET_ERR_NODE_NOT_FOUND;
+        }
     }
     
-    if (response.header.msg_type != NET_MSG_GET_SUCCESSOR_RESPONSE) {
-        return NET_ERR_INVALID_MESSAGE;
+    net_buf_free(response);
+    return err;
+}
+
+int net_peer_notify(net_peer_t *peer, const net_node_addr_t *node, int timeout_ms) {
+    net_frame_view_t view;
+    net_buf_t *response;
+    
+    int err = peer_call(peer, NET_MSG_NOTIFY, 0, node,
+                        NET_MSG_NOTIFY_RESPONSE, &view, &response, timeout_ms);
+    if (err == NET_ERR_OK && !view.success) {
+        err = NET_ERR_INTERNAL;
     }
     
-    if (!response.payload.get_node_resp.has_node) {
-        return NET_ERR_NODE_NOT_FOUND;
+    net_buf_free(response);
+    return err;
+}
+
+int net_peer_closest_preceding(net_peer_t *peer, int key, net_node_addr_t *result, int timeout_ms) {
+    net_frame_view_t view;
+    net_buf_t *response;
+    
+    int err = peer_call(peer, NET_MSG_CLOSEST_PRECEDING, key, NULL,
+                        NET_MSG_CLOSEST_PRECEDING_RESPONSE, &view, &response, timeout_ms);
+    if (err == NET_ERR_OK) {
+        net_protocol_copy_node_view(result, &view.node);
     }
     
-    memcpy(result, &response.payload.get_node_resp.node, sizeof(net_node_addr_t));
-    return NET_ERR_OK;
+    net_buf_free(response);
+    return err;
 }
 
-int net_peer_notify(net_peer_t *peer, const net_node_addr_t *node, int timeout_ms) {
-    net_message_t request, response;
+int net_peer_ping(net_peer_t *peer, int *alive, int *state, int timeout_ms) {
+    net_frame_view_t view;
+    net_buf_t *response;
     
-    memset(&request, 0, sizeof(net_message_t));
-    request.header.version = NET_PROTOCOL_VERSION;
-    request.header.msg_type = NET_MSG_NOTIFY;
-    request.header.request_id = (uint32_t)rand();
-    memcpy(&request.payload.notify_req.node, node, sizeof(net_node_addr_t));
+    int err = peer_call(peer, NET_MSG_PING, 0, NULL,
+                        NET_MSG_PING_RESPONSE, &view, &response, timeout_ms);
+    if (err == NET_ERR_OK) {
+        *alive = view.alive;
+        *state = view.state;
+    }
     
-    int err = net_peer_send_request(peer, &request, &response, timeout_ms);
-    if (err != NET_ERR_OK) {
-        return err;
+    net_buf_free(response);
+    return err;
+}
+
+/* Copy a STABILIZE_RESPONSE view out */
+static void peer_copy_stabilize(net_stabilize_resp_t *result, const net_frame_view_t *view) {
+    result->has_node = view->has_node;
+    if (view->has_node) {
+        net_protocol_copy_node_view(&result->node, &view->node);
     }
+    result->count = view->count;
+    for (uint32_t i = 0; i < view->count; i++) {
+        net_protocol_copy_node_view(&result->successors[i], &view->successors[i]);
+    }
+}
+
+int net_peer_stabilize(net_peer_t *peer, const net_node_addr_t *node, net_stabilize_resp_t *result,
+                       int timeout_ms) {
+    net_frame_view_t view;
+    net_buf_t *response;
     
-    if (response.header.msg_type != NET_MSG_NOTIFY_RESPONSE) {
-        return NET_ERR_INVALID_MESSAGE;
+    int err = peer_call(peer, NET_MSG_STABILIZE, 0, node,
+                        NET_MSG_STABILIZE_RESPONSE, &view, &response, timeout_ms);
+    if (err == NET_ERR_OK) {
+        peer_copy_stabilize(result, &view);
     }
     
-    return response.payload.notify_resp.success ? NET_ERR_OK : NET_ERR_INTERNAL;
+    net_buf_free(response);
+    return err;
 }
 
-int net_peer_closest_preceding(net_peer_t *peer, int key, net_node_addr_t *result, int timeout_ms) {
-    net_message_t request, response;
-    
-    memset(&request, 0, sizeof(net_message_t));
-    request.header.version = NET_PROTOCOL_VERSION;
-    request.header.msg_type = NET_MSG_CLOSEST_PRECEDING;
-    request.header.request_id = (uint32_t)rand();
-    request.payload.closest_preceding_req.key = key;
+/*
+ * Async Chord RPC helpers
+ *
+ * Each call carries a small adapter from the raw frame callback to the
+ * typed one. Adapters are recycled through a per-thread free list;
+ * calls start and complete on the loop thread, so in steady state the
+ * list never runs dry.
+ */
+
+typedef struct peer_async {
+    struct peer_async *next;        /* Free list link */
+    net_msg_type_t type;
+    net_peer_node_callback_t on_node;
+    net_peer_status_callback_t on_status;
+    net_peer_ping_callback_t on_ping;
+    net_peer_stabilize_callback_t on_stabilize;
+    void *context;
+} peer_async_t;
+
+static _Thread_local peer_async_t *t_free_async = NULL;
+
+static peer_async_t* peer_async_alloc(void) {
+    peer_async_t *op = t_free_async;
     
-    int err = net_peer_send_request(peer, &request, &response, timeout_ms);
-    if (err != NET_ERR_OK) {
-        return err;
+    if (op) {
+        t_free_async = op->next;
     }
-    
-    if (response.header.msg_type != NET_MSG_CLOSEST_PRECEDING_RESPONSE) {
-        return NET_ERR_INVALID_MESSAGE;
+    else {
+        op = (peer_async_t*)malloc(sizeof(peer_async_t));
+        if (!op) {
+            return NULL;
+        }
     }
     
-    memcpy(result, &response.payload.closest_preceding_resp.node, sizeof(net_node_addr_t));
-    return NET_ERR_OK;
+    memset(op, 0, sizeof(peer_async_t));
+    return op;
 }
 
-int net_peer_ping(net_peer_t *peer, int *alive, int *state, int timeout_ms) {
-    net_message_t request, response;
+static void peer_async_free(peer_async_t *op) {
+    op->next = t_free_async;
+    t_free_async = op;
+}
+
+static void peer_async_complete(void *context, const net_frame_view_t *response, int error) {
+    peer_async_t op = *(peer_async_t*)context;
+    net_node_addr_t node;
+    
+    /* Recycle first so the callback can start the next call */
+    peer_async_free((peer_async_t*)context);
     
-    memset(&request, 0, sizeof(net_message_t));
-    request.header.version = NET_PROTOCOL_VERSION;
-    request.header.msg_type = NET_MSG_PING;
-    request.header.request_id = (uint32_t)rand();
+    switch (op.type) {
+        case NET_MSG_NOTIFY:
+            if (error == NET_ERR_OK && !response->success) {
+                error = NET_ERR_INTERNAL;
+            }
+            op.on_status(op.context, error);
+            break;
+            
+        case NET_MSG_PING:
+            if (error != NET_ERR_OK) {
+                op.on_ping(op.context, error, 0, 0);
+            }
+            else {
+                op.on_ping(op.context, error, response->alive, response->state);
+            }
+            break;
+            
+        case NET_MSG_STABILIZE:
+            if (error != NET_ERR_OK) {
+                op.on_stabilize(op.context, error, NULL);
+            }
+            else {
+                net_stabilize_resp_t result;
+                
+                peer_copy_stabilize(&result, response);
+                op.on_stabilize(op.context, error, &result);
+            }
+            break;
+            
+        default:
+            if (error == NET_ERR_OK && response->has_node) {
+                net_protocol_copy_node_view(&node, &response->node);
+                op.on_node(op.context, error, &node);
+            }
+            else if (error == NET_ERR_OK && op.type == NET_MSG_GET_SUCCESSOR) {
+                op.on_node(op.context, NET_ERR_NODE_NOT_FOUND, NULL);
+            }
+            else {
+                op.on_node(op.context, error, NULL);
+            }
+            break;
+    }
+}
+
+static int peer_async_start(net_peer_t *peer, peer_async_t *op, int key,
+                            const net_node_addr_t *node, int timeout_ms) {
+    if (!peer || !peer->iface || !peer->iface->call_async) {
+        peer_async_free(op);
+        return NET_ERR_INTERNAL;
+    }
     
-    int err = net_peer_send_request(peer, &request, &response, timeout_ms);
+    int err = peer->iface->call_async(peer, net_peer_next_request_id(peer), op->type, key, node,
+                                      peer_async_complete, op, timeout_ms);
     if (err != NET_ERR_OK) {
-        return err;
+        peer_async_free(op);
+    }
+    return err;
+}
+
+static int peer_async_node(net_peer_t *peer, net_msg_type_t type, int key,
+                           net_peer_node_callback_t callback, void *context, int timeout_ms) {
+    peer_async_t *op = callback ? peer_async_alloc() : NULL;
+    if (!op) {
+        return NET_ERR_INTERNAL;
     }
     
-    if (response.header.msg_type != NET_MSG_PING_RESPONSE) {
-        return NET_ERR_INVALID_MESSAGE;
+    op->type = type;
+    op->on_node = callback;
+    op->context = context;
+    return peer_async_start(peer, op, key, NULL, timeout_ms);
+}
+
+int net_peer_find_successor_async(net_peer_t *peer, int key,
+                                  net_peer_node_callback_t callback, void *context, int timeout_ms) {
+    return peer_async_node(peer, NET_MSG_FIND_SUCCESSOR, key, callback, context, timeout_ms);
+}
+
+int net_peer_get_predecessor_async(net_peer_t *peer,
+                                   net_peer_node_callback_t callback, void *context, int timeout_ms) {
+    return peer_async_node(peer, NET_MSG_GET_PREDECESSOR, 0, callback, context, timeout_ms);
+}
+
+int net_peer_get_successor_async(net_peer_t *peer,
+                                 net_peer_node_callback_t callback, void *context, int timeout_ms) {
+    return peer_async_node(peer, NET_MSG_GET_SUCCESSOR, 0, callback, context, timeout_ms);
+}
+
+int net_peer_closest_preceding_async(net_peer_t *peer, int key,
+                                     net_peer_node_callback_t callback, void *context, int timeout_ms) {
+    return peer_async_node(peer, NET_MSG_CLOSEST_PRECEDING, key, callback, context, timeout_ms);
+}
+
+int net_peer_notify_async(net_peer_t *peer, const net_node_addr_t *node,
+                          net_peer_status_callback_t callback, void *context, int timeout_ms) {
+    peer_async_t *op = callback ? peer_async_alloc() : NULL;
+    if (!op) {
+        return NET_ERR_INTERNAL;
+    }
+    
+    op->type = NET_MSG_NOTIFY;
+    op->on_status = callback;
+    op->context = context;
+    return peer_async_start(peer, op, 0, node, timeout_ms);
+}
+
+int net_peer_ping_async(net_peer_t *peer,
+                        net_peer_ping_callback_t callback, void *context, int timeout_ms) {
+    peer_async_t *op = callback ? peer_async_alloc() : NULL;
+    if (!op) {
+        return NET_ERR_INTERNAL;
     }
     
-    *alive = response.payload.ping_resp.alive;
-    *state = response.payload.ping_resp.state;
+    op->type = NET_MSG_PING;
+    op->on_ping = callback;
+    op->context = context;
+    return peer_async_start(peer, op, 0, NULL, timeout_ms);
+}
+
+int net_peer_stabilize_async(net_peer_t *peer, const net_node_addr_t *node,
+                             net_peer_stabilize_callback_t callback, void *context, int timeout_ms) {
+    peer_async_t *op = callback ? peer_async_alloc() : NULL;
+    if (!op) {
+        return NET_ERR_INTERNAL;
+    }
     
-    return NET_ERR_OK;
+    op->type = NET_MSG_STABILIZE;
+    op->on_stabilize = callback;
+    op->context = context;
+    return peer_async_start(peer, op, 0, node, timeout_ms);
 }
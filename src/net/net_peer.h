@@ -1,7 +1,10 @@
 #ifndef NET_PEER_H
 #define NET_PEER_H
 
+#include <stdatomic.h>
 #include "net_protocol.h"
+#include "net_buf.h"
+#include "net_rpc.h"
 
 /*
  * Network Peer Layer
@@ -11,7 +14,7 @@
  * 
  * Design principles:
  * - Abstract interface that can be faked for testing
- * - Async operations with callbacks
+ * - Async operations with callbacks (net_rpc.h engine on a net_loop)
  * - Timeout handling
  * - Connection pooling/reuse
  */
@@ -20,8 +23,8 @@
 typedef struct net_peer net_peer_t;
 typedef struct net_peer_iface net_peer_iface_t;
 
-/* Callback for async operations */
-typedef void (*net_peer_callback_t)(void *context, const net_message_t *response, int error);
+/* Callback for async operations (response is NULL on error) */
+typedef net_rpc_callback_t net_peer_callback_t;
 
 /*
  * Peer interface (vtable pattern for testability)
@@ -37,9 +40,16 @@ struct net_peer_iface {
     int (*send_request)(net_peer_t *peer, const net_message_t *request, 
                         net_message_t *response, int timeout_ms);
     
-    /* Send request asynchronously (future enhancement) */
-    int (*send_request_async)(net_peer_t *peer, const net_message_t *request,
-                              net_peer_callback_t callback, void *context, int timeout_ms);
+    /* Send an encoded request frame and receive the response frame
+     * into a caller-provided buffer (used by the RPC helpers) */
+    int (*send_frame)(net_peer_t *peer, const net_buf_t *request,
+                      net_buf_t *response, int timeout_ms);
+    
+    /* Start an async call completed on the peer's loop thread
+     * (see net_rpc_call) */
+    int (*call_async)(net_peer_t *peer, uint32_t request_id, net_msg_type_t type, int key,
+                      const net_node_addr_t *node, net_peer_callback_t callback,
+                      void *context, int timeout_ms);
     
     /* Close connection */
     void (*close)(net_peer_t *peer);
@@ -56,6 +66,7 @@ struct net_peer {
     void *impl_data;                 /* Implementation-specific data */
     char remote_url[NET_PROTOCOL_MAX_URL];
     int connected;
+    _Atomic uint32_t next_request_id; /* Last request ID issued */
 };
 
 /*
@@ -65,6 +76,11 @@ struct net_peer {
 /* Create a peer (implementation-specific) */
 net_peer_t* net_peer_create(const net_peer_iface_t *iface);
 
+/* Next request ID for this peer. IDs increase monotonically from 1 and
+ * are unique among the peer's in-flight calls from any thread, which
+ * lets one connection multiplex many concurrent calls. */
+uint32_t net_peer_next_request_id(net_peer_t *peer);
+
 /* Connect to remote peer */
 int net_peer_connect(net_peer_t *peer, const char *url);
 
@@ -72,7 +88,12 @@ int net_peer_connect(net_peer_t *peer, const char *url);
 int net_peer_send_request(net_peer_t *peer, const net_message_t *request,
                           net_message_t *response, int timeout_ms);
 
-/* Send asynchronous request */
+/* Send an encoded frame and receive the response frame */
+int net_peer_send_frame(net_peer_t *peer, const net_buf_t *request,
+                        net_buf_t *response, int timeout_ms);
+
+/* Send asynchronous request (its request_id is replaced by the next
+ * one from net_peer_next_request_id()) */
 int net_peer_send_request_async(net_peer_t *peer, const net_message_t *request,
                                 net_peer_callback_t callback, void *context, int timeout_ms);
 
@@ -85,7 +106,11 @@ void net_peer_destroy(net_peer_t *peer);
 /*
  * High-level Chord RPC helpers
  * 
- * These wrap the low-level send_request with Chord-specific logic.
+ * These wrap the low-level send_frame with Chord-specific logic.
+ * Requests are encoded into pooled buffers and responses read as
+ * views, so a round-trip performs no heap allocation once the
+ * calling thread's buffer pool is warm, and only the result fields
+ * are copied out.
  */
 
 /* Find successor for a key */
@@ -106,4 +131,41 @@ int net_peer_closest_preceding(net_peer_t *peer, int key, net_node_addr_t *resul
 /* Ping peer */
 int net_peer_ping(net_peer_t *peer, int *alive, int *state, int timeout_ms);
 
+/* One stabilization round in one trip: notify the peer of node and get
+ * its predecessor (as before the notify) and successor list */
+int net_peer_stabilize(net_peer_t *peer, const net_node_addr_t *node, net_stabilize_resp_t *result,
+                       int timeout_ms);
+
+/*
+ * Async Chord RPC helpers
+ *
+ * Same operations without blocking: each returns NET_ERR_OK once the
+ * request is in flight and later invokes its callback exactly once on
+ * the peer's loop thread. On any other return the callback is not
+ * invoked. Result pointers are only valid during the callback.
+ */
+
+/* node is NULL on error, and for get_predecessor when there is none */
+typedef void (*net_peer_node_callback_t)(void *context, int error, const net_node_addr_t *node);
+typedef void (*net_peer_status_callback_t)(void *context, int error);
+typedef void (*net_peer_ping_callback_t)(void *context, int error, int alive, int state);
+/* result is NULL on error */
+typedef void (*net_peer_stabilize_callback_t)(void *context, int error,
+                                              const net_stabilize_resp_t *result);
+
+int net_peer_find_successor_async(net_peer_t *peer, int key,
+                                  net_peer_node_callback_t callback, void *context, int timeout_ms);
+int net_peer_get_predecessor_async(net_peer_t *peer,
+                                   net_peer_node_callback_t callback, void *context, int timeout_ms);
+int net_peer_get_successor_async(net_peer_t *peer,
+                                 net_peer_node_callback_t callback, void *context, int timeout_ms);
+int net_peer_notify_async(net_peer_t *peer, const net_node_addr_t *node,
+                          net_peer_status_callback_t callback, void *context, int timeout_ms);
+int net_peer_closest_preceding_async(net_peer_t *peer, int key,
+                                     net_peer_node_callback_t callback, void *context, int timeout_ms);
+int net_peer_ping_async(net_peer_t *peer,
+                        net_peer_ping_callback_t callback, void *context, int timeout_ms);
+int net_peer_stabilize_async(net_peer_t *peer, const net_node_addr_t *node,
+                             net_peer_stabilize_callback_t callback, void *context, int timeout_ms);
+
 #endif /* NET_PEER_H */
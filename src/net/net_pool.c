@@ -0,0 +1,406 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "net_pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+/*
+ * Connection pool implementation
+ *
+ * Entries live in a URL hash table; idle ones are also on an LRU list
+ * (most recently released at the head), so both idle expiry and LRU
+ * eviction only ever look at the tail. Dialling happens outside the
+ * lock: the entry is published first with `connecting` set and other
+ * callers for the same URL wait for the outcome instead of dialling
+ * twice. Retired entries that are still leased wait on a side list
+ * until their last release.
+ */
+
+typedef struct pool_entry {
+    struct pool_entry *hash_next;   /* Bucket chain, or retired list */
+    struct pool_entry *lru_prev;    /* Idle list (leases == 0) */
+    struct pool_entry *lru_next;
+    net_peer_t *peer;
+    uint64_t last_used_ms;
+    int leases;
+    int failures;
+    int connecting;
+    int idle;                       /* On the LRU list */
+    char url[NET_PROTOCOL_MAX_URL];
+} pool_entry_t;
+
+struct net_pool {
+    net_pool_config_t config;
+    net_pool_factory_t factory;
+    void *factory_context;
+
+    pthread_mutex_t lock;
+    pthread_cond_t connected;       /* Signalled when a dial finishes */
+
+    pool_entry_t **buckets;
+    size_t bucket_mask;
+    size_t size;
+    pool_entry_t *lru_head;
+    pool_entry_t *lru_tail;
+    pool_entry_t *retired;
+
+    net_pool_stats_t stats;
+};
+
+static uint64_t pool_clock_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+void net_pool_config_default(net_pool_config_t *config) {
+    config->max_peers = 64;
+    config->idle_timeout_ms = 60000;
+    config->max_failures = 3;
+    config->clock = NULL;
+}
+
+net_pool_t* net_pool_create(const net_pool_config_t *config,
+                            net_pool_factory_t factory, void *context) {
+    net_pool_t *pool;
+    size_t buckets = 16;
+
+    if (!config || !factory || config->max_peers == 0) {
+        return NULL;
+    }
+
+    pool = (net_pool_t*)calloc(1, sizeof(net_pool_t));
+    if (!pool) {
+        return NULL;
+    }
+
+    while (buckets < config->max_peers * 2) {
+        buckets *= 2;
+    }
+    pool->buckets = (pool_entry_t**)calloc(buckets, sizeof(pool_entry_t*));
+    if (!pool->buckets) {
+        free(pool);
+        return NULL;
+    }
+
+    pool->config = *config;
+    if (!pool->config.clock) {
+        pool->config.clock = pool_clock_ms;
+    }
+    pool->bucket_mask = buckets - 1;
+    pool->factory = factory;
+    pool->factory_context = context;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->connected, NULL);
+    return pool;
+}
+
+static void pool_entry_free(pool_entry_t *entry) {
+    if (entry->peer) {
+        net_peer_close(entry->peer);
+        net_peer_destroy(entry->peer);
+    }
+    free(entry);
+}
+
+void net_pool_destroy(net_pool_t *pool) {
+    if (!pool) {
+        return;
+    }
+
+    for (size_t i = 0; i <= pool->bucket_mask; i++) {
+        while (pool->buckets[i]) {
+            pool_entry_t *entry = pool->buckets[i];
+            pool->buckets[i] = entry->hash_next;
+            pool_entry_free(entry);
+        }
+    }
+    while (pool->retired) {
+        pool_entry_t *entry = pool->retired;
+        pool->retired = entry->hash_next;
+        pool_entry_free(entry);
+    }
+
+    pthread_cond_destroy(&pool->connected);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->buckets);
+    free(pool);
+}
+
+/*
+ * Table and LRU list (lock held)
+ */
+
+static size_t pool_hash(const char *url) {
+    uint32_t hash = 2166136261u;  /* FNV-1a */
+    for (const unsigned char *p = (const unsigned char*)url; *p; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash;
+}
+
+static pool_entry_t* pool_find(net_pool_t *pool, const char *url) {
+    pool_entry_t *entry = pool->buckets[pool_hash(url) & pool->bucket_mask];
+    while (entry && strcmp(entry->url, url) != 0) {
+        entry = entry->hash_next;
+    }
+    return entry;
+}
+
+static void pool_lru_push(net_pool_t *pool, pool_entry_t *entry) {
+    entry->idle = 1;
+    entry->lru_prev = NULL;
+    entry->lru_next = pool->lru_head;
+    if (pool->lru_head) {
+        pool->lru_head->lru_prev = entry;
+    }
+    else {
+        pool->lru_tail = entry;
+    }
+    pool->lru_head = entry;
+}
+
+static void pool_lru_remove(net_pool_t *pool, pool_entry_t *entry) {
+    if (!entry->idle) {
+        return;
+    }
+    entry->idle = 0;
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    }
+    else {
+        pool->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    }
+    else {
+        pool->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+/* Unpublish entry; free it now if idle, else when its last lease ends */
+static void pool_retire(net_pool_t *pool, pool_entry_t *entry) {
+    pool_entry_t **link = &pool->buckets[pool_hash(entry->url) & pool->bucket_mask];
+
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+    pool->size--;
+
+    if (entry->leases == 0) {
+        pool_lru_remove(pool, entry);
+        pool_entry_free(entry);
+    }
+    else {
+        entry->hash_next = pool->retired;
+        pool->retired = entry;
+    }
+}
+
+static void pool_expire_locked(net_pool_t *pool) {
+    uint64_t now;
+
+    if (pool->config.idle_timeout_ms <= 0) {
+        return;
+    }
+
+    now = pool->config.clock();
+    while (pool->lru_tail &&
+           pool->lru_tail->last_used_ms + (uint64_t)pool->config.idle_timeout_ms <= now) {
+        pool_retire(pool, pool->lru_tail);
+        pool->stats.idle_evictions++;
+    }
+}
+
+/*
+ * Public API
+ */
+
+/* Dial entry->peer outside the lock (entry->connecting is set) */
+static int pool_dial(net_pool_t *pool, pool_entry_t *entry) {
+    int err;
+
+    pthread_mutex_unlock(&pool->lock);
+    if (!entry->peer) {
+        entry->peer = pool->factory(pool->factory_context, entry->url);
+    }
+    err = entry->peer ? net_peer_connect(entry->peer, entry->url) : NET_ERR_INTERNAL;
+    pthread_mutex_lock(&pool->lock);
+
+    entry->connecting = 0;
+    pthread_cond_broadcast(&pool->connected);
+    return err;
+}
+
+net_peer_t* net_pool_acquire(net_pool_t *pool, const char *url) {
+    pool_entry_t *entry;
+    net_peer_t *peer = NULL;
+
+    if (!pool || !url) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool_expire_locked(pool);
+
+    /* Wait out any dial in progress for this URL */
+    while ((entry = pool_find(pool, url)) && entry->connecting) {
+        pthread_cond_wait(&pool->connected, &pool->lock);
+    }
+
+    if (entry) {
+        entry->leases++;
+        pool_lru_remove(pool, entry);
+        if (entry->peer->connected) {
+            pool->stats.hits++;
+            peer = entry->peer;
+        }
+        else {
+            entry->connecting = 1;
+            if (pool_dial(pool, entry) == NET_ERR_OK) {
+                pool->stats.reconnects++;
+                peer = entry->peer;
+            }
+            else {
+                entry->leases--;
+                pool_retire(pool, entry);
+            }
+        }
+    }
+    else {
+        if (pool->size >= pool->config.max_peers && pool->lru_tail) {
+            pool_retire(pool, pool->lru_tail);
+            pool->stats.lru_evictions++;
+        }
+
+        entry = (pool_entry_t*)calloc(1, sizeof(pool_entry_t));
+        if (entry) {
+            size_t bucket = pool_hash(url) & pool->bucket_mask;
+            strncpy(entry->url, url, NET_PROTOCOL_MAX_URL - 1);
+            entry->leases = 1;
+            entry->connecting = 1;
+            entry->hash_next = pool->buckets[bucket];
+            pool->buckets[bucket] = entry;
+            pool->size++;
+
+            if (pool_dial(pool, entry) == NET_ERR_OK) {
+                pool->stats.connects++;
+                peer = entry->peer;
+            }
+            else {
+                entry->leases--;
+                pool_retire(pool, entry);
+            }
+        }
+    }
+
+    if (peer) {
+        entry->last_used_ms = pool->config.clock();
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return peer;
+}
+
+/* Find the entry owning peer, published or retired (lock held) */
+static pool_entry_t* pool_find_peer(net_pool_t *pool, net_peer_t *peer, int *retired) {
+    pool_entry_t *entry = pool_find(pool, peer->remote_url);
+
+    *retired = 0;
+    if (entry && entry->peer == peer) {
+        return entry;
+    }
+    for (entry = pool->retired; entry; entry = entry->hash_next) {
+        if (entry->peer == peer) {
+            *retired = 1;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+void net_pool_release(net_pool_t *pool, net_peer_t *peer) {
+    pool_entry_t *entry;
+    int retired;
+
+    if (!pool || !peer) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    entry = pool_find_peer(pool, peer, &retired);
+    if (entry && --entry->leases == 0) {
+        if (retired) {
+            pool_entry_t **link = &pool->retired;
+            while (*link != entry) {
+                link = &(*link)->hash_next;
+            }
+            *link = entry->hash_next;
+            pool_entry_free(entry);
+        }
+        else {
+            entry->last_used_ms = pool->config.clock();
+            pool_lru_push(pool, entry);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void net_pool_report(net_pool_t *pool, net_peer_t *peer, int error) {
+    pool_entry_t *entry;
+    int retired;
+
+    if (!pool || !peer) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    entry = pool_find_peer(pool, peer, &retired);
+    if (entry && !retired) {
+        if (error == NET_ERR_TIMEOUT || error == NET_ERR_CONNECTION_CLOSED) {
+            if (++entry->failures >= pool->config.max_failures) {
+                pool_retire(pool, entry);
+                pool->stats.health_evictions++;
+            }
+        }
+        else {
+            entry->failures = 0;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int net_pool_prewarm(net_pool_t *pool, const char *url) {
+    net_peer_t *peer = net_pool_acquire(pool, url);
+
+    if (!peer) {
+        return NET_ERR_CONNECTION_CLOSED;
+    }
+    net_pool_release(pool, peer);
+    return NET_ERR_OK;
+}
+
+void net_pool_expire(net_pool_t *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool_expire_locked(pool);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+size_t net_pool_size(net_pool_t *pool) {
+    size_t size;
+
+    pthread_mutex_lock(&pool->lock);
+    size = pool->size;
+    pthread_mutex_unlock(&pool->lock);
+    return size;
+}
+
+void net_pool_get_stats(net_pool_t *pool, net_pool_stats_t *stats) {
+    pthread_mutex_lock(&pool->lock);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->lock);
+}
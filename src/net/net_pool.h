@@ -0,0 +1,90 @@
+#ifndef NET_POOL_H
+#define NET_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "net_peer.h"
+
+/*
+ * Peer Connection Pool
+ *
+ * Maps a remote URL (net_node_addr_t.url) to one connected peer handle
+ * shared by every caller, so finger table entries, successor lists and
+ * lookup hops that name the same node reuse one connection.
+ *
+ * Callers lease a handle with net_pool_acquire() and hand it back with
+ * net_pool_release(). A handle with no leases is idle and may be:
+ * - closed after idle_timeout_ms without use (idle expiry)
+ * - closed when the pool is at max_peers and a new URL needs a slot,
+ *   least recently used first (LRU eviction; if every handle is leased
+ *   the pool briefly exceeds the cap rather than fail the caller)
+ * Independently, callers report RPC outcomes with net_pool_report();
+ * max_failures consecutive failures retire the handle (health eviction)
+ * so the next acquire dials afresh.
+ *
+ * A pooled handle whose connection dropped is reconnected in place on
+ * its next acquire (warm reconnect), keeping its request ID sequence
+ * and async state; net_pool_prewarm() connects ahead of first use.
+ *
+ * Thread safety: all functions may be called from any thread.
+ */
+
+typedef struct net_pool net_pool_t;
+
+/* Create an unconnected peer for url (NULL on failure) */
+typedef net_peer_t* (*net_pool_factory_t)(void *context, const char *url);
+
+/* Monotonic clock in ms (tests inject their own) */
+typedef uint64_t (*net_pool_clock_t)(void);
+
+typedef struct {
+    size_t max_peers;           /* LRU cap on pooled handles */
+    int idle_timeout_ms;        /* Close handles idle this long (0 = never) */
+    int max_failures;           /* Consecutive failures before eviction */
+    net_pool_clock_t clock;     /* NULL = CLOCK_MONOTONIC */
+} net_pool_config_t;
+
+typedef struct {
+    uint64_t hits;              /* Acquires served by a live handle */
+    uint64_t connects;          /* New handles dialled */
+    uint64_t reconnects;        /* Warm reconnects of a dropped handle */
+    uint64_t idle_evictions;
+    uint64_t lru_evictions;
+    uint64_t health_evictions;
+} net_pool_stats_t;
+
+/* Default configuration (64 peers, 60 s idle, 3 failures) */
+void net_pool_config_default(net_pool_config_t *config);
+
+/* Create pool; factory builds peers for new URLs (NULL on failure) */
+net_pool_t* net_pool_create(const net_pool_config_t *config,
+                            net_pool_factory_t factory, void *context);
+
+/* Destroy pool and every handle (no leases may be outstanding) */
+void net_pool_destroy(net_pool_t *pool);
+
+/* Lease a connected handle for url (NULL if it cannot be connected) */
+net_peer_t* net_pool_acquire(net_pool_t *pool, const char *url);
+
+/* Return a lease */
+void net_pool_release(net_pool_t *pool, net_peer_t *peer);
+
+/* Record an RPC outcome on a leased handle (NET_ERR_OK resets the
+ * failure count; NET_ERR_TIMEOUT and NET_ERR_CONNECTION_CLOSED count
+ * towards max_failures, other errors are the remote's answer) */
+void net_pool_report(net_pool_t *pool, net_peer_t *peer, int error);
+
+/* Connect to url now so a later acquire finds it ready
+ * (returns NET_ERR_OK or the connect error) */
+int net_pool_prewarm(net_pool_t *pool, const char *url);
+
+/* Close idle handles past idle_timeout_ms (also done on acquire) */
+void net_pool_expire(net_pool_t *pool);
+
+/* Number of pooled handles (leased or idle) */
+size_t net_pool_size(net_pool_t *pool);
+
+/* Copy of the pool counters */
+void net_pool_get_stats(net_pool_t *pool, net_pool_stats_t *stats);
+
+#endif /* NET_POOL_H */
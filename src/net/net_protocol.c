@@ -0,0 +1,1727 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "net_protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+/*
+ * Wire format implementation
+ *
+ * Both codecs encode exactly the fields each message type uses, so a
+ * frame is proportional to its content rather than to the size of the
+ * net_message_t union. Decoding only touches the payload member for the
+ * decoded type.
+ */
+
+/* Worst-case sizes: ids and URLs at their longest, ints at their
+ * widest, no JSON escapes in ids or URLs */
+#define WORST_NODE_BINARY (1 + (NET_PROTOCOL_MAX_NODE_ID - 1) + 5 + 2 + (NET_PROTOCOL_MAX_URL - 1))
+#define WORST_HEADER_BINARY (2 + 5 + 3)
+#define WORST_STABILIZE_BINARY \
+    (WORST_HEADER_BINARY + 1 + WORST_NODE_BINARY + 1 + NET_PROTOCOL_MAX_SUCCESSORS * WORST_NODE_BINARY)
+#define WORST_NODE_JSON \
+    (sizeof("{\"id\":\"\",\"key\":-2147483648,\"url\":\"\"}") - 1 \
+     + (NET_PROTOCOL_MAX_NODE_ID - 1) + (NET_PROTOCOL_MAX_URL - 1))
+#define WORST_STABILIZE_JSON \
+    (sizeof("{\"v\":1,\"type\":\"STABILIZE_RESPONSE\",\"id\":4294967295,\"payload\":" \
+            "{\"has_node\":1,\"node\":,\"successors\":[]}}") - 1 \
+     + WORST_NODE_JSON + NET_PROTOCOL_MAX_SUCCESSORS * (WORST_NODE_JSON + 1) - 1)
+
+_Static_assert(WORST_HEADER_BINARY + 1 + (NET_PROTOCOL_MAX_NODE_ID - 1) + 2 + WORST_STABILIZE_BINARY
+               <= NET_PROTOCOL_MAX_FRAME,
+               "a binary STABILIZE_RESPONSE must fit a frame inside an ADDRESSED envelope");
+_Static_assert(sizeof("{\"v\":1,\"type\":\"ADDRESSED\",\"id\":4294967295,\"payload\":{\"to\":\"\",\"frame\":}}") - 1
+               + (NET_PROTOCOL_MAX_NODE_ID - 1) + WORST_STABILIZE_JSON <= NET_PROTOCOL_MAX_FRAME,
+               "a JSON STABILIZE_RESPONSE must fit a frame inside an ADDRESSED envelope");
+
+static _Atomic int g_protocol_format = NET_PROTOCOL_FORMAT_BINARY;
+
+static const char *const g_msg_type_names[] = {
+    [NET_MSG_FIND_SUCCESSOR] = "FIND_SUCCESSOR",
+    [NET_MSG_FIND_SUCCESSOR_RESPONSE] = "FIND_SUCCESSOR_RESPONSE",
+    [NET_MSG_GET_PREDECESSOR] = "GET_PREDECESSOR",
+    [NET_MSG_GET_PREDECESSOR_RESPONSE] = "GET_PREDECESSOR_RESPONSE",
+    [NET_MSG_GET_SUCCESSOR] = "GET_SUCCESSOR",
+    [NET_MSG_GET_SUCCESSOR_RESPONSE] = "GET_SUCCESSOR_RESPONSE",
+    [NET_MSG_NOTIFY] = "NOTIFY",
+    [NET_MSG_NOTIFY_RESPONSE] = "NOTIFY_RESPONSE",
+    [NET_MSG_CLOSEST_PRECEDING] = "CLOSEST_PRECEDING",
+    [NET_MSG_CLOSEST_PRECEDING_RESPONSE] = "CLOSEST_PRECEDING_RESPONSE",
+    [NET_MSG_PING] = "PING",
+    [NET_MSG_PING_RESPONSE] = "PING_RESPONSE",
+    [NET_MSG_NEXT_HOP] = "NEXT_HOP",
+    [NET_MSG_NEXT_HOP_RESPONSE] = "NEXT_HOP_RESPONSE",
+    [NET_MSG_FORWARD_LOOKUP] = "FORWARD_LOOKUP",
+    [NET_MSG_LOOKUP_RESULT] = "LOOKUP_RESULT",
+    [NET_MSG_ADDRESSED] = "ADDRESSED",
+    [NET_MSG_BATCH] = "BATCH",
+    [NET_MSG_BATCH_RESPONSE] = "BATCH_RESPONSE",
+    [NET_MSG_STABILIZE] = "STABILIZE",
+    [NET_MSG_STABILIZE_RESPONSE] = "STABILIZE_RESPONSE",
+    [NET_MSG_ERROR] = "ERROR"
+};
+
+#define MSG_TYPE_NAME_COUNT (sizeof(g_msg_type_names) / sizeof(g_msg_type_names[0]))
+
+const char* net_protocol_msg_type_name(int msg_type) {
+    if (msg_type < 0 || (size_t)msg_type >= MSG_TYPE_NAME_COUNT || !g_msg_type_names[msg_type]) {
+        return "UNKNOWN";
+    }
+    return g_msg_type_names[msg_type];
+}
+
+static int msg_type_from_name(const char *name) {
+    for (size_t i = 0; i < MSG_TYPE_NAME_COUNT; i++) {
+        if (g_msg_type_names[i] && strcmp(g_msg_type_names[i], name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void net_protocol_set_format(net_protocol_format_t format) {
+    atomic_store(&g_protocol_format, (int)format);
+}
+
+net_protocol_format_t net_protocol_get_format(void) {
+    return (net_protocol_format_t)atomic_load(&g_protocol_format);
+}
+
+/*
+ * Binary codec
+ */
+
+typedef struct {
+    uint8_t *data;      /* NULL for a sizing pass */
+    size_t cap;
+    size_t len;
+    int overflow;
+} wire_writer_t;
+
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+    int error;
+} wire_reader_t;
+
+static void wire_put_bytes(wire_writer_t *w, const void *src, size_t n) {
+    if (w->data) {
+        if (w->overflow || n > w->cap - w->len) {
+            w->overflow = 1;
+            return;
+        }
+        memcpy(w->data + w->len, src, n);
+    }
+    w->len += n;
+}
+
+static void wire_put_u8(wire_writer_t *w, uint8_t value) {
+    wire_put_bytes(w, &value, 1);
+}
+
+static void wire_put_varint(wire_writer_t *w, uint32_t value) {
+    uint8_t tmp[5];
+    size_t n = 0;
+
+    while (value >= 0x80) {
+        tmp[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    tmp[n++] = (uint8_t)value;
+    wire_put_bytes(w, tmp, n);
+}
+
+static void wire_put_int(wire_writer_t *w, int value) {
+    /* zigzag keeps small negative values short */
+    wire_put_varint(w, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+static void wire_put_str(wire_writer_t *w, const char *str, size_t max) {
+    size_t n = strnlen(str, max);
+    wire_put_varint(w, (uint32_t)n);
+    wire_put_bytes(w, str, n);
+}
+
+static void wire_put_node(wire_writer_t *w, const net_node_addr_t *node) {
+    wire_put_str(w, node->id, NET_PROTOCOL_MAX_NODE_ID - 1);
+    wire_put_int(w, node->key);
+    wire_put_str(w, node->url, NET_PROTOCOL_MAX_URL - 1);
+}
+
+static uint8_t wire_get_u8(wire_reader_t *r) {
+    if (r->pos >= r->len) {
+        r->error = 1;
+        return 0;
+    }
+    return r->data[r->pos++];
+}
+
+static uint32_t wire_get_varint(wire_reader_t *r) {
+    uint32_t value = 0;
+
+    for (unsigned shift = 0; shift <= 28; shift += 7) {
+        uint8_t byte = wire_get_u8(r);
+        if (r->error) {
+            return 0;
+        }
+        if (shift == 28 && byte > 0x0f) {
+            break;  /* more than 32 bits */
+        }
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+
+    r->error = 1;
+    return 0;
+}
+
+static int wire_get_int(wire_reader_t *r) {
+    uint32_t zigzag = wire_get_varint(r);
+    return (int)((zigzag >> 1) ^ (0u - (zigzag & 1u)));
+}
+
+static void wire_get_str(wire_reader_t *r, char *dest, size_t cap) {
+    uint32_t n = wire_get_varint(r);
+
+    if (r->error || n >= cap || n > r->len - r->pos) {
+        r->error = 1;
+        dest[0] = '\0';
+        return;
+    }
+    memcpy(dest, r->data + r->pos, n);
+    dest[n] = '\0';
+    r->pos += n;
+}
+
+static void wire_get_node(wire_reader_t *r, net_node_addr_t *node) {
+    wire_get_str(r, node->id, sizeof(node->id));
+    node->key = wire_get_int(r);
+    wire_get_str(r, node->url, sizeof(node->url));
+}
+
+/* 1 if records holds exactly count non-empty length-prefixed frames */
+static int batch_records_valid(const uint8_t *records, size_t len, uint32_t count) {
+    wire_reader_t r = { records, len, 0, 0 };
+    uint32_t seen = 0;
+
+    if (count == 0 || count > NET_PROTOCOL_MAX_BATCH || len > NET_PROTOCOL_BATCH_CAPACITY) {
+        return 0;
+    }
+    while (r.pos < r.len) {
+        uint32_t n = wire_get_varint(&r);
+
+        if (r.error || n == 0 || n > r.len - r.pos) {
+            return 0;
+        }
+        r.pos += n;
+        seen++;
+    }
+    return seen == count;
+}
+
+static int binary_put_payload(wire_writer_t *w, const net_message_t *msg) {
+    switch (msg->header.msg_type) {
+        case NET_MSG_FIND_SUCCESSOR:
+            wire_put_int(w, msg->payload.find_successor_req.key);
+            break;
+        case NET_MSG_FIND_SUCCESSOR_RESPONSE:
+            wire_put_node(w, &msg->payload.find_successor_resp.node);
+            break;
+        case NET_MSG_GET_PREDECESSOR:
+        case NET_MSG_GET_SUCCESSOR:
+        case NET_MSG_PING:
+            break;
+        case NET_MSG_GET_PREDECESSOR_RESPONSE:
+        case NET_MSG_GET_SUCCESSOR_RESPONSE:
+            wire_put_varint(w, msg->payload.get_node_resp.has_node ? 1 : 0);
+            if (msg->payload.get_node_resp.has_node) {
+                wire_put_node(w, &msg->payload.get_node_resp.node);
+            }
+            break;
+        case NET_MSG_NOTIFY:
+        case NET_MSG_STABILIZE:
+            wire_put_node(w, &msg->payload.notify_req.node);
+            break;
+        case NET_MSG_NOTIFY_RESPONSE:
+            wire_put_varint(w, msg->payload.notify_resp.success ? 1 : 0);
+            break;
+        case NET_MSG_STABILIZE_RESPONSE:
+            if (msg->payload.stabilize_resp.count > NET_PROTOCOL_MAX_SUCCESSORS) {
+                return -1;
+            }
+            wire_put_varint(w, msg->payload.stabilize_resp.has_node ? 1 : 0);
+            if (msg->payload.stabilize_resp.has_node) {
+                wire_put_node(w, &msg->payload.stabilize_resp.node);
+            }
+            wire_put_varint(w, msg->payload.stabilize_resp.count);
+            for (uint32_t i = 0; i < msg->payload.stabilize_resp.count; i++) {
+                wire_put_node(w, &msg->payload.stabilize_resp.successors[i]);
+            }
+            break;
+        case NET_MSG_CLOSEST_PRECEDING:
+            wire_put_int(w, msg->payload.closest_preceding_req.key);
+            break;
+        case NET_MSG_CLOSEST_PRECEDING_RESPONSE:
+            wire_put_node(w, &msg->payload.closest_preceding_resp.node);
+            break;
+        case NET_MSG_PING_RESPONSE:
+            wire_put_int(w, msg->payload.ping_resp.alive);
+            wire_put_int(w, msg->payload.ping_resp.state);
+            break;
+        case NET_MSG_NEXT_HOP:
+            wire_put_int(w, msg->payload.find_successor_req.key);
+            break;
+        case NET_MSG_NEXT_HOP_RESPONSE:
+            wire_put_varint(w, msg->payload.next_hop_resp.done ? 1 : 0);
+            wire_put_node(w, &msg->payload.next_hop_resp.node);
+            break;
+        case NET_MSG_FORWARD_LOOKUP:
+        case NET_MSG_LOOKUP_RESULT:
+            wire_put_int(w, msg->payload.lookup.key);
+            wire_put_int(w, msg->payload.lookup.hops);
+            wire_put_node(w, &msg->payload.lookup.node);
+            break;
+        case NET_MSG_ADDRESSED:
+            if (msg->payload.addressed.frame_len > sizeof(msg->payload.addressed.frame)) {
+                return -1;
+            }
+            wire_put_str(w, msg->payload.addressed.node_id, NET_PROTOCOL_MAX_NODE_ID - 1);
+            wire_put_varint(w, msg->payload.addressed.frame_len);
+            wire_put_bytes(w, msg->payload.addressed.frame, msg->payload.addressed.frame_len);
+            break;
+        case NET_MSG_BATCH:
+        case NET_MSG_BATCH_RESPONSE:
+            if (!batch_records_valid(msg->payload.batch.data, msg->payload.batch.len,
+                                     msg->payload.batch.count)) {
+                return -1;
+            }
+            wire_put_varint(w, msg->payload.batch.count);
+            wire_put_bytes(w, msg->payload.batch.data, msg->payload.batch.len);
+            break;
+        case NET_MSG_ERROR:
+            wire_put_varint(w, (uint32_t)msg->payload.error.error_code);
+            wire_put_str(w, msg->payload.error.error_msg, sizeof(msg->payload.error.error_msg) - 1);
+            break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+static int binary_get_payload(wire_reader_t *r, net_message_t *msg) {
+    switch (msg->header.msg_type) {
+        case NET_MSG_FIND_SUCCESSOR:
+            msg->payload.find_successor_req.key = wire_get_int(r);
+            break;
+        case NET_MSG_FIND_SUCCESSOR_RESPONSE:
+            wire_get_node(r, &msg->payload.find_successor_resp.node);
+            break;
+        case NET_MSG_GET_PREDECESSOR:
+        case NET_MSG_GET_SUCCESSOR:
+        case NET_MSG_PING:
+            break;
+        case NET_MSG_GET_PREDECESSOR_RESPONSE:
+        case NET_MSG_GET_SUCCESSOR_RESPONSE:
+            msg->payload.get_node_resp.has_node = wire_get_varint(r) ? 1 : 0;
+            if (msg->payload.get_node_resp.has_node) {
+                wire_get_node(r, &msg->payload.get_node_resp.node);
+            }
+            else {
+                memset(&msg->payload.get_node_resp.node, 0, sizeof(net_node_addr_t));
+            }
+            break;
+        case NET_MSG_NOTIFY:
+        case NET_MSG_STABILIZE:
+            wire_get_node(r, &msg->payload.notify_req.node);
+            break;
+        case NET_MSG_NOTIFY_RESPONSE:
+            msg->payload.notify_resp.success = wire_get_varint(r) ? 1 : 0;
+            break;
+        case NET_MSG_STABILIZE_RESPONSE:
+            msg->payload.stabilize_resp.has_node = wire_get_varint(r) ? 1 : 0;
+            if (msg->payload.stabilize_resp.has_node) {
+                wire_get_node(r, &msg->payload.stabilize_resp.node);
+            }
+            msg->payload.stabilize_resp.count = (uint32_t)wire_get_varint(r);
+            if (msg->payload.stabilize_resp.count > NET_PROTOCOL_MAX_SUCCESSORS) {
+                return NET_ERR_INVALID_MESSAGE;
+            }
+            for (uint32_t i = 0; i < msg->payload.stabilize_resp.count; i++) {
+                wire_get_node(r, &msg->payload.stabilize_resp.successors[i]);
+            }
+            break;
+        case NET_MSG_CLOSEST_PRECEDING:
+            msg->payload.closest_preceding_req.key = wire_get_int(r);
+            break;
+        case NET_MSG_CLOSEST_PRECEDING_RESPONSE:
+            wire_get_node(r, &msg->payload.closest_preceding_resp.node);
+            break;
+        case NET_MSG_PING_RESPONSE:
+            msg->payload.ping_resp.alive = wire_get_int(r);
+            msg->payload.ping_resp.state = wire_get_int(r);
+            break;
+        case NET_MSG_NEXT_HOP:
+            msg->payload.find_successor_req.key = wire_get_int(r);
+            break;
+        case NET_MSG_NEXT_HOP_RESPONSE:
+            msg->payload.next_hop_resp.done = wire_get_varint(r) ? 1 : 0;
+            wire_get_node(r, &msg->payload.next_hop_resp.node);
+            break;
+        case NET_MSG_FORWARD_LOOKUP:
+        case NET_MSG_LOOKUP_RESULT:
+            msg->payload.lookup.key = wire_get_int(r);
+            msg->payload.lookup.hops = wire_get_int(r);
+            wire_get_node(r, &msg->payload.lookup.node);
+            break;
+        case NET_MSG_ADDRESSED:
+            wire_get_str(r, msg->payload.addressed.node_id, sizeof(msg->payload.addressed.node_id));
+            msg->payload.addressed.frame_len = wire_get_varint(r);
+            if (r->error || msg->payload.addressed.frame_len > sizeof(msg->payload.addressed.frame)
+                || msg->payload.addressed.frame_len > r->len - r->pos) {
+                return NET_ERR_INVALID_MESSAGE;
+            }
+            memcpy(msg->payload.addressed.frame, r->data + r->pos, msg->payload.addressed.frame_len);
+            r->pos += msg->payload.addressed.frame_len;
+            break;
+        case NET_MSG_BATCH:
+        case NET_MSG_BATCH_RESPONSE:
+            msg->payload.batch.count = wire_get_varint(r);
+            if (r->error || !batch_records_valid(r->data + r->pos, r->len - r->pos,
+                                                 msg->payload.batch.count)) {
+                return NET_ERR_INVALID_MESSAGE;
+            }
+            msg->payload.batch.len = (uint32_t)(r->len - r->pos);
+            memcpy(msg->payload.batch.data, r->data + r->pos, msg->payload.batch.len);
+            r->pos = r->len;
+            break;
+        case NET_MSG_ERROR:
+            msg->payload.error.error_code = (net_error_t)wire_get_varint(r);
+            wire_get_str(r, msg->payload.error.error_msg, sizeof(msg->payload.error.error_msg));
+            break;
+        default:
+            return NET_ERR_INVALID_MESSAGE;
+    }
+
+    if (r->error || r->pos != r->len) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+    return NET_ERR_OK;
+}
+
+static int serialize_binary(const net_message_t *msg, void *buffer, size_t buffer_size) {
+    wire_writer_t sizing = { NULL, 0, 0, 0 };
+    wire_writer_t w = { (uint8_t*)buffer, buffer_size, 0, 0 };
+
+    if (binary_put_payload(&sizing, msg) != 0 || sizing.len > NET_PROTOCOL_MAX_PAYLOAD) {
+        return -1;
+    }
+
+    wire_put_u8(&w, msg->header.version);
+    wire_put_u8(&w, msg->header.msg_type);
+    wire_put_varint(&w, msg->header.request_id);
+    wire_put_varint(&w, (uint32_t)sizing.len);
+    binary_put_payload(&w, msg);
+
+    return w.overflow ? -1 : (int)w.len;
+}
+
+static int binary_get_header(wire_reader_t *r, net_msg_header_t *header) {
+    uint8_t version = wire_get_u8(r);
+    uint8_t msg_type = wire_get_u8(r);
+    uint32_t request_id = wire_get_varint(r);
+    uint32_t payload_len = wire_get_varint(r);
+
+    if (r->error) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+    if (version != NET_PROTOCOL_VERSION) {
+        return NET_ERR_VERSION_MISMATCH;
+    }
+    if (payload_len > NET_PROTOCOL_MAX_PAYLOAD || payload_len != r->len - r->pos) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+
+    header->version = version;
+    header->msg_type = msg_type;
+    header->payload_len = (uint16_t)payload_len;
+    header->request_id = request_id;
+    return NET_ERR_OK;
+}
+
+static int deserialize_binary(net_message_t *msg, const uint8_t *data, size_t size) {
+    wire_reader_t r = { data, size, 0, 0 };
+    int err = binary_get_header(&r, &msg->header);
+
+    if (err != NET_ERR_OK) {
+        return err;
+    }
+
+    wire_reader_t payload = { data + r.pos, msg->header.payload_len, 0, 0 };
+    return binary_get_payload(&payload, msg);
+}
+
+/*
+ * JSON codec (debug format)
+ */
+
+typedef struct {
+    char *data;
+    size_t cap;
+    size_t len;
+    int overflow;
+} json_writer_t;
+
+static void json_put_raw(json_writer_t *w, const char *text, size_t n) {
+    if (w->overflow || n > w->cap - w->len) {
+        w->overflow = 1;
+        return;
+    }
+    memcpy(w->data + w->len, text, n);
+    w->len += n;
+}
+
+static void json_put(json_writer_t *w, const char *text) {
+    json_put_raw(w, text, strlen(text));
+}
+
+static void json_put_int(json_writer_t *w, const char *name, long long value) {
+    char tmp[64];
+    int n = snprintf(tmp, sizeof(tmp), "\"%s\":%lld", name, value);
+    json_put_raw(w, tmp, (size_t)n);
+}
+
+static void json_put_str(json_writer_t *w, const char *name, const char *str, size_t max) {
+    size_t n = strnlen(str, max);
+
+    json_put(w, "\"");
+    json_put(w, name);
+    json_put(w, "\":\"");
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)str[i];
+        if (c == '"' || c == '\\') {
+            char esc[2] = { '\\', (char)c };
+            json_put_raw(w, esc, 2);
+        }
+        else if (c < 0x20) {
+            char esc[8];
+            int len = snprintf(esc, sizeof(esc), "\\u%04x", c);
+            json_put_raw(w, esc, (size_t)len);
+        }
+        else {
+            json_put_raw(w, (const char*)&str[i], 1);
+        }
+    }
+    json_put(w, "\"");
+}
+
+static void json_put_node_object(json_writer_t *w, const net_node_addr_t *node) {
+    json_put(w, "{");
+    json_put_str(w, "id", node->id, NET_PROTOCOL_MAX_NODE_ID - 1);
+    json_put(w, ",");
+    json_put_int(w, "key", node->key);
+    json_put(w, ",");
+    json_put_str(w, "url", node->url, NET_PROTOCOL_MAX_URL - 1);
+    json_put(w, "}");
+}
+
+static void json_put_node(json_writer_t *w, const net_node_addr_t *node) {
+    json_put(w, "\"node\":");
+    json_put_node_object(w, node);
+}
+
+static int json_put_payload(json_writer_t *w, const net_message_t *msg) {
+    json_put(w, "{");
+    switch (msg->header.msg_type) {
+        case NET_MSG_FIND_SUCCESSOR:
+            json_put_int(w, "key", msg->payload.find_successor_req.key);
+            break;
+        case NET_MSG_FIND_SUCCESSOR_RESPONSE:
+            json_put_node(w, &msg->payload.find_successor_resp.node);
+            break;
+        case NET_MSG_GET_PREDECESSOR:
+        case NET_MSG_GET_SUCCESSOR:
+        case NET_MSG_PING:
+            break;
+        case NET_MSG_GET_PREDECESSOR_RESPONSE:
+        case NET_MSG_GET_SUCCESSOR_RESPONSE:
+            json_put_int(w, "has_node", msg->payload.get_node_resp.has_node ? 1 : 0);
+            if (msg->payload.get_node_resp.has_node) {
+                json_put(w, ",");
+                json_put_node(w, &msg->payload.get_node_resp.node);
+            }
+            break;
+        case NET_MSG_NOTIFY:
+        case NET_MSG_STABILIZE:
+            json_put_node(w, &msg->payload.notify_req.node);
+            break;
+        case NET_MSG_NOTIFY_RESPONSE:
+            json_put_int(w, "success", msg->payload.notify_resp.success ? 1 : 0);
+            break;
+        case NET_MSG_STABILIZE_RESPONSE:
+            if (msg->payload.stabilize_resp.count > NET_PROTOCOL_MAX_SUCCESSORS) {
+                return -1;
+            }
+            json_put_int(w, "has_node", msg->payload.stabilize_resp.has_node ? 1 : 0);
+            if (msg->payload.stabilize_resp.has_node) {
+                json_put(w, ",");
+                json_put_node(w, &msg->payload.stabilize_resp.node);
+            }
+            json_put(w, ",\"successors\":[");
+            for (uint32_t i = 0; i < msg->payload.stabilize_resp.count; i++) {
+                if (i > 0) {
+                    json_put(w, ",");
+                }
+                json_put_node_object(w, &msg->payload.stabilize_resp.successors[i]);
+            }
+            json_put(w, "]");
+            break;
+        case NET_MSG_CLOSEST_PRECEDING:
+            json_put_int(w, "key", msg->payload.closest_preceding_req.key);
+            break;
+        case NET_MSG_CLOSEST_PRECEDING_RESPONSE:
+            json_put_node(w, &msg->payload.closest_preceding_resp.node);
+            break;
+        case NET_MSG_PING_RESPONSE:
+            json_put_int(w, "alive", msg->payload.ping_resp.alive);
+            json_put(w, ",");
+            json_put_int(w, "state", msg->payload.ping_resp.state);
+            break;
+        case NET_MSG_NEXT_HOP:
+            json_put_int(w, "key", msg->payload.find_successor_req.key);
+            break;
+        case NET_MSG_NEXT_HOP_RESPONSE:
+            json_put_int(w, "done", msg->payload.next_hop_resp.done ? 1 : 0);
+            json_put(w, ",");
+            json_put_node(w, &msg->payload.next_hop_resp.node);
+            break;
+        case NET_MSG_FORWARD_LOOKUP:
+        case NET_MSG_LOOKUP_RESULT:
+            json_put_int(w, "key", msg->payload.lookup.key);
+            json_put(w, ",");
+            json_put_int(w, "hops", msg->payload.lookup.hops);
+            json_put(w, ",");
+            json_put_node(w, &msg->payload.lookup.node);
+            break;
+        case NET_MSG_ADDRESSED:
+            /* the inner frame is embedded as is, so it must be JSON too */
+            if (msg->payload.addressed.frame_len == 0 || msg->payload.addressed.frame[0] != '{'
+                || msg->payload.addressed.frame_len > sizeof(msg->payload.addressed.frame)) {
+                return -1;
+            }
+            json_put_str(w, "to", msg->payload.addressed.node_id, NET_PROTOCOL_MAX_NODE_ID - 1);
+            json_put(w, ",\"frame\":");
+            json_put_raw(w, (const char*)msg->payload.addressed.frame, msg->payload.addressed.frame_len);
+            break;
+        case NET_MSG_BATCH:
+        case NET_MSG_BATCH_RESPONSE: {
+            /* records are embedded as is, so they must be JSON too */
+            const uint8_t *frame;
+            size_t frame_len;
+            size_t offset = 0;
+
+            if (!batch_records_valid(msg->payload.batch.data, msg->payload.batch.len,
+                                     msg->payload.batch.count)) {
+                return -1;
+            }
+            json_put(w, "\"frames\":[");
+            while (net_protocol_batch_next(msg->payload.batch.data, msg->payload.batch.len, &offset,
+                                           &frame, &frame_len)) {
+                if (frame[0] != '{') {
+                    return -1;
+                }
+                json_put_raw(w, (const char*)frame, frame_len);
+                if (offset < msg->payload.batch.len) {
+                    json_put(w, ",");
+                }
+            }
+            json_put(w, "]");
+            break;
+        }
+        case NET_MSG_ERROR:
+            json_put_int(w, "code", msg->payload.error.error_code);
+            json_put(w, ",");
+            json_put_str(w, "message", msg->payload.error.error_msg,
+                         sizeof(msg->payload.error.error_msg) - 1);
+            break;
+        default:
+            return -1;
+    }
+    json_put(w, "}");
+    return 0;
+}
+
+static int serialize_json(const net_message_t *msg, void *buffer, size_t buffer_size) {
+    json_writer_t w = { (char*)buffer, buffer_size, 0, 0 };
+
+    json_put(&w, "{");
+    json_put_int(&w, "v", msg->header.version);
+    json_put(&w, ",\"type\":\"");
+    json_put(&w, net_protocol_msg_type_name(msg->header.msg_type));
+    json_put(&w, "\",");
+    json_put_int(&w, "id", msg->header.request_id);
+    json_put(&w, ",\"payload\":");
+    if (json_put_payload(&w, msg) != 0) {
+        return -1;
+    }
+    json_put(&w, "}");
+
+    return w.overflow ? -1 : (int)w.len;
+}
+
+typedef struct {
+    const char *p;
+    const char *end;
+    int error;
+} json_reader_t;
+
+/* Every payload field the JSON format can carry */
+typedef struct {
+    int has_key, has_node, has_has_node, has_success, has_alive, has_state, has_code, has_message;
+    int has_done, has_hops, has_to, has_frame, has_frames, has_successors;
+    long long key, has_node_value, success, alive, state, code, done, hops;
+    net_node_addr_t node;
+    char message[256];
+    char to[NET_PROTOCOL_MAX_NODE_ID];
+    const char *frame;          /* raw span of the embedded frame */
+    size_t frame_len;
+    const char *frames;         /* raw span of the batch's record array */
+    size_t frames_len;
+    const char *successors;     /* raw span of the successor list */
+    size_t successors_len;
+} json_fields_t;
+
+static void json_skip_ws(json_reader_t *r) {
+    while (r->p < r->end && (*r->p == ' ' || *r->p == '\t' || *r->p == '\n' || *r->p == '\r')) {
+        r->p++;
+    }
+}
+
+static int json_accept(json_reader_t *r, char c) {
+    json_skip_ws(r);
+    if (r->p < r->end && *r->p == c) {
+        r->p++;
+        return 1;
+    }
+    return 0;
+}
+
+static void json_expect(json_reader_t *r, char c) {
+    if (!json_accept(r, c)) {
+        r->error = 1;
+    }
+}
+
+static int json_hex(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* Parse a string into dest (NULL to skip); only \u00XX escapes are supported */
+static void json_get_str(json_reader_t *r, char *dest, size_t cap) {
+    size_t n = 0;
+
+    json_expect(r, '"');
+    while (!r->error) {
+        char c;
+
+        if (r->p >= r->end) {
+            r->error = 1;
+            break;
+        }
+        c = *r->p++;
+        if (c == '"') {
+            break;
+        }
+        if (c == '\\') {
+            if (r->p >= r->end) {
+                r->error = 1;
+                break;
+            }
+            c = *r->p++;
+            switch (c) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'u': {
+                    int hi, lo;
+                    if (r->end - r->p < 4 || r->p[0] != '0' || r->p[1] != '0'
+                        || (hi = json_hex(r->p[2])) < 0 || (lo = json_hex(r->p[3])) < 0) {
+                        r->error = 1;
+                        return;
+                    }
+                    c = (char)(hi * 16 + lo);
+                    r->p += 4;
+                    break;
+                }
+                default:
+                    break;  /* \" \\ \/ */
+            }
+        }
+        if (dest) {
+            if (n + 1 >= cap) {
+                r->error = 1;
+                break;
+            }
+            dest[n++] = c;
+        }
+    }
+    if (dest && cap > 0) {
+        dest[n < cap ? n : cap - 1] = '\0';
+    }
+}
+
+static long long json_get_int(json_reader_t *r) {
+    long long value = 0;
+    int negative = 0;
+    int digits = 0;
+
+    json_skip_ws(r);
+    if (r->p < r->end && *r->p == '-') {
+        negative = 1;
+        r->p++;
+    }
+    while (r->p < r->end && *r->p >= '0' && *r->p <= '9' && digits < 18) {
+        value = value * 10 + (*r->p - '0');
+        r->p++;
+        digits++;
+    }
+    if (digits == 0) {
+        r->error = 1;
+    }
+    return negative ? -value : value;
+}
+
+static void json_skip_value(json_reader_t *r, int depth) {
+    json_skip_ws(r);
+    if (depth > 8 || r->p >= r->end) {
+        r->error = 1;
+        return;
+    }
+    if (*r->p == '"') {
+        json_get_str(r, NULL, 0);
+    }
+    else if (*r->p == '{' || *r->p == '[') {
+        char close = *r->p == '{' ? '}' : ']';
+        r->p++;
+        if (json_accept(r, close)) {
+            return;
+        }
+        do {
+            if (close == '}') {
+                json_get_str(r, NULL, 0);
+                json_expect(r, ':');
+            }
+            json_skip_value(r, depth + 1);
+        } while (!r->error && json_accept(r, ','));
+        json_expect(r, close);
+    }
+    else {
+        /* number or literal */
+        while (r->p < r->end && *r->p != ',' && *r->p != '}' && *r->p != ']'
+               && *r->p != ' ' && *r->p != '\n') {
+            r->p++;
+        }
+    }
+}
+
+static void json_get_node(json_reader_t *r, net_node_addr_t *node) {
+    char name[16];
+
+    memset(node, 0, sizeof(*node));
+    json_expect(r, '{');
+    if (json_accept(r, '}')) {
+        return;
+    }
+    do {
+        json_get_str(r, name, sizeof(name));
+        json_expect(r, ':');
+        if (r->error) {
+            return;
+        }
+        if (strcmp(name, "id") == 0) {
+            json_get_str(r, node->id, sizeof(node->id));
+        }
+        else if (strcmp(name, "key") == 0) {
+            node->key = (int)json_get_int(r);
+        }
+        else if (strcmp(name, "url") == 0) {
+            json_get_str(r, node->url, sizeof(node->url));
+        }
+        else {
+            json_skip_value(r, 1);
+        }
+    } while (!r->error && json_accept(r, ','));
+    json_expect(r, '}');
+}
+
+static void json_get_fields(json_reader_t *r, json_fields_t *fields) {
+    char name[16];
+
+    json_expect(r, '{');
+    if (json_accept(r, '}')) {
+        return;
+    }
+    do {
+        json_get_str(r, name, sizeof(name));
+        json_expect(r, ':');
+        if (r->error) {
+            return;
+        }
+        if (strcmp(name, "key") == 0) {
+            fields->key = json_get_int(r);
+            fields->has_key = 1;
+        }
+        else if (strcmp(name, "node") == 0) {
+            json_get_node(r, &fields->node);
+            fields->has_node = 1;
+        }
+        else if (strcmp(name, "has_node") == 0) {
+            fields->has_node_value = json_get_int(r);
+            fields->has_has_node = 1;
+        }
+        else if (strcmp(name, "success") == 0) {
+            fields->success = json_get_int(r);
+            fields->has_success = 1;
+        }
+        else if (strcmp(name, "alive") == 0) {
+            fields->alive = json_get_int(r);
+            fields->has_alive = 1;
+        }
+        else if (strcmp(name, "state") == 0) {
+            fields->state = json_get_int(r);
+            fields->has_state = 1;
+        }
+        else if (strcmp(name, "code") == 0) {
+            fields->code = json_get_int(r);
+            fields->has_code = 1;
+        }
+        else if (strcmp(name, "done") == 0) {
+            fields->done = json_get_int(r);
+            fields->has_done = 1;
+        }
+        else if (strcmp(name, "hops") == 0) {
+            fields->hops = json_get_int(r);
+            fields->has_hops = 1;
+        }
+        else if (strcmp(name, "to") == 0) {
+            json_get_str(r, fields->to, sizeof(fields->to));
+            fields->has_to = 1;
+        }
+        else if (strcmp(name, "frame") == 0) {
+            json_skip_ws(r);
+            fields->frame = r->p;
+            json_skip_value(r, 1);
+            fields->frame_len = (size_t)(r->p - fields->frame);
+            fields->has_frame = 1;
+        }
+        else if (strcmp(name, "frames") == 0) {
+            json_skip_ws(r);
+            fields->frames = r->p;
+            json_skip_value(r, 1);
+            fields->frames_len = (size_t)(r->p - fields->frames);
+            fields->has_frames = 1;
+        }
+        else if (strcmp(name, "successors") == 0) {
+            json_skip_ws(r);
+            fields->successors = r->p;
+            json_skip_value(r, 1);
+            fields->successors_len = (size_t)(r->p - fields->successors);
+            fields->has_successors = 1;
+        }
+        else if (strcmp(name, "message") == 0) {
+            json_get_str(r, fields->message, sizeof(fields->message));
+            fields->has_message = 1;
+        }
+        else {
+            json_skip_value(r, 1);
+        }
+    } while (!r->error && json_accept(r, ','));
+    json_expect(r, '}');
+}
+
+static int json_fields_to_payload(const json_fields_t *f, net_message_t *msg) {
+    switch (msg->header.msg_type) {
+        case NET_MSG_FIND_SUCCESSOR:
+            if (!f->has_key) return NET_ERR_INVALID_MESSAGE;
+            msg->payload.find_successor_req.key = (int)f->key;
+            break;
+        case NET_MSG_FIND_SUCCESSOR_RESPONSE:
+            if (!f->has_node) return NET_ERR_INVALID_MESSAGE;
+            msg->payload.find_successor_resp.node = f->node;
+            break;
+        case NET_MSG_GET_PREDECESSOR:
+        case NET_MSG_GET_SUCCESSOR:
+        case NET_MSG_PING:
+            break;
+        case NET_MSG_GET_PREDECESSOR_RESPONSE:
+        case NET_MSG_GET_SUCCESSOR_RESPONSE:
+            if (!f->has_has_node || (f->has_node_value && !f->has_node)) return NET_ERR_INVALID_MESSAGE;
+            msg->payload.get_node_resp.has_node = f->has_node_value ? 1 : 0;
+            msg->payload.get_node_resp.node = f->node;
+            break;
+        case NET_MSG_NOTIFY:
+        case NET_MSG_STABILIZE:
+            if (!f->has_node) return NET_ERR_INVALID_MESSAGE;
+            msg->payload.notify_req.node = f->node;
+            break;
+        case NET_MSG_NOTIFY_RESPONSE:
+            if (!f->has_success) return NET_ERR_INVALID_MESSAGE;
+            msg->payload.notify_resp.success = f->success ? 1 : 0;
+            break;
+        case NET_MSG_STABILIZE_RESPONSE: {
+            net_stabilize_resp_t *resp = &msg->payload.stabilize_resp;
+            json_reader_t r = { f->successors, f->successors + f->successors_len, 0 };
+
+            if (!f->has_has_node || (f->has_node_value && !f->has_node) || !f->has_successors) {
+                return NET_ERR_INVALID_MESSAGE;
+            }
+            resp->has_node = f->has_node_value ? 1 : 0;
+            resp->node = f->node;
+            resp->count = 0;
+            json_expect(&r, '[');
+            if (!json_accept(&r, ']')) {
+                do {
+                    if (resp->count == NET_PROTOCOL_MAX_SUCCESSORS) return NET_ERR_INVALID_MESSAGE;
+                    json_get_node(&r, &resp->successors[resp->count++]);
+                } while (!r.error && json_accept(&r, ','));
+                json_expect(&r, ']');
+            }
+            if (r.error) return NET_ERR_INVALID_MESSAGE;
+            break;
+        }
+        case NET_MSG_CLOSEST_PRECEDING:
+            if (!f->has_key) return NET_ERR_INVALID_MESSAGE;
+            msg->payload.closest_preceding_req.key = (int)f->key;
+            break;
+        case NET_MSG_CLOSEST_PRECEDING_RESPONSE:
+            if (!f->has_node) return NET_ERR_INVALID_MESSAGE;
+            msg->payload.closest_preceding_resp.node = f->node;
+            break;
+        case NET_MSG_PING_RESPONSE:
+            if (!f->has_alive || !f->has_state) return NET_ERR_INVALID_MESSAGE;
+            msg->payload.ping_resp.alive = (int)f->alive;
+            msg->payload.ping_resp.state = (int)f->state;
+            break;
+        case NET_MSG_NEXT_HOP:
+            if (!f->has_key) return NET_ERR_INVALID_MESSAGE;
+            msg->payload.find_successor_req.key = (int)f->key;
+            break;
+        case NET_MSG_NEXT_HOP_RESPONSE:
+            if (!f->has_done || !f->has_node) return NET_ERR_INVALID_MESSAGE;
+            msg->payload.next_hop_resp.done = f->done ? 1 : 0;
+            msg->payload.next_hop_resp.node = f->node;
+            break;
+        case NET_MSG_FORWARD_LOOKUP:
+        case NET_MSG_LOOKUP_RESULT:
+            if (!f->has_key || !f->has_hops || !f->has_node) return NET_ERR_INVALID_MESSAGE;
+            msg->payload.lookup.key = (int)f->key;
+            msg->payload.lookup.hops = (int)f->hops;
+            msg->payload.lookup.node = f->node;
+            break;
+        case NET_MSG_ADDRESSED:
+            if (!f->has_to || !f->has_frame || f->frame_len == 0 || f->frame[0] != '{'
+                || f->frame_len > sizeof(msg->payload.addressed.frame)) {
+                return NET_ERR_INVALID_MESSAGE;
+            }
+            memcpy(msg->payload.addressed.node_id, f->to, sizeof(msg->payload.addressed.node_id));
+            memcpy(msg->payload.addressed.frame, f->frame, f->frame_len);
+            msg->payload.addressed.frame_len = (uint32_t)f->frame_len;
+            break;
+        case NET_MSG_BATCH:
+        case NET_MSG_BATCH_RESPONSE: {
+            json_reader_t r = { f->frames, f->frames + f->frames_len, 0 };
+
+            if (!f->has_frames) return NET_ERR_INVALID_MESSAGE;
+            net_protocol_batch_init(&msg->payload.batch);
+            json_expect(&r, '[');
+            do {
+                const char *frame;
+
+                json_skip_ws(&r);
+                frame = r.p;
+                json_skip_value(&r, 1);
+                if (r.error || frame == r.end || frame[0] != '{'
+                    || net_protocol_batch_add(&msg->payload.batch, frame, (size_t)(r.p - frame)) != 0) {
+                    return NET_ERR_INVALID_MESSAGE;
+                }
+            } while (json_accept(&r, ','));
+            json_expect(&r, ']');
+            if (r.error) return NET_ERR_INVALID_MESSAGE;
+            break;
+        }
+        case NET_MSG_ERROR:
+            if (!f->has_code) return NET_ERR_INVALID_MESSAGE;
+            msg->payload.error.error_code = (net_error_t)f->code;
+            memcpy(msg->payload.error.error_msg, f->message, sizeof(msg->payload.error.error_msg));
+            break;
+        default:
+            return NET_ERR_INVALID_MESSAGE;
+    }
+    return NET_ERR_OK;
+}
+
+static int deserialize_json(net_message_t *msg, const char *data, size_t size) {
+    json_reader_t r = { data, data + size, 0 };
+    json_reader_t payload = { NULL, NULL, 0 };
+    json_fields_t fields;
+    char name[16];
+    char type_name[40] = "";
+    long long version = -1, request_id = -1;
+
+    json_expect(&r, '{');
+    do {
+        json_get_str(&r, name, sizeof(name));
+        json_expect(&r, ':');
+        if (r.error) {
+            break;
+        }
+        if (strcmp(name, "v") == 0) {
+            version = json_get_int(&r);
+        }
+        else if (strcmp(name, "type") == 0) {
+            json_get_str(&r, type_name, sizeof(type_name));
+        }
+        else if (strcmp(name, "id") == 0) {
+            request_id = json_get_int(&r);
+        }
+        else if (strcmp(name, "payload") == 0) {
+            /* decoded once the type is known, members may come in any order */
+            json_skip_ws(&r);
+            payload.p = r.p;
+            json_skip_value(&r, 0);
+            payload.end = r.p;
+        }
+        else {
+            json_skip_value(&r, 0);
+        }
+    } while (!r.error && json_accept(&r, ','));
+    json_expect(&r, '}');
+    json_skip_ws(&r);
+
+    if (r.error || r.p != r.end || !payload.p || request_id < 0 || request_id > UINT32_MAX) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+    if (version != NET_PROTOCOL_VERSION) {
+        return NET_ERR_VERSION_MISMATCH;
+    }
+
+    int msg_type = msg_type_from_name(type_name);
+    if (msg_type < 0) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+
+    memset(&fields, 0, sizeof(fields));
+    json_get_fields(&payload, &fields);
+    if (payload.error) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+
+    msg->header.version = (uint8_t)version;
+    msg->header.msg_type = (uint8_t)msg_type;
+    msg->header.request_id = (uint32_t)request_id;
+    msg->header.payload_len = (uint16_t)(payload.end - payload.p);
+
+    return json_fields_to_payload(&fields, msg);
+}
+
+/*
+ * Protocol API
+ */
+
+void net_protocol_init_message(net_message_t *msg, net_msg_type_t type, uint32_t request_id) {
+    msg->header.version = NET_PROTOCOL_VERSION;
+    msg->header.msg_type = (uint8_t)type;
+    msg->header.payload_len = 0;
+    msg->header.request_id = request_id;
+}
+
+int net_protocol_serialize(const net_message_t *msg, void *buffer, size_t buffer_size) {
+    return net_protocol_serialize_as(msg, net_protocol_get_format(), buffer, buffer_size);
+}
+
+int net_protocol_serialize_as(const net_message_t *msg, net_protocol_format_t format,
+                              void *buffer, size_t buffer_size) {
+    if (!msg || !buffer) {
+        return -1;
+    }
+    if (format == NET_PROTOCOL_FORMAT_JSON) {
+        return serialize_json(msg, buffer, buffer_size);
+    }
+    return serialize_binary(msg, buffer, buffer_size);
+}
+
+int net_protocol_deserialize(net_message_t *msg, const void *buffer, size_t buffer_size) {
+    const uint8_t *data = (const uint8_t*)buffer;
+
+    if (!msg || !buffer || buffer_size == 0) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+    if (data[0] == '{') {
+        return deserialize_json(msg, (const char*)buffer, buffer_size);
+    }
+    return deserialize_binary(msg, data, buffer_size);
+}
+
+void net_protocol_create_error(net_message_t *msg, uint32_t request_id,
+                                net_error_t error_code, const char *error_msg) {
+    net_protocol_init_message(msg, NET_MSG_ERROR, request_id);
+    msg->payload.error.error_code = error_code;
+    snprintf(msg->payload.error.error_msg, sizeof(msg->payload.error.error_msg), "%s",
+             error_msg ? error_msg : "");
+}
+
+void net_protocol_copy_node_addr(net_node_addr_t *dest, const char *id, int key, const char *url) {
+    snprintf(dest->id, sizeof(dest->id), "%s", id ? id : "");
+    dest->key = key;
+    snprintf(dest->url, sizeof(dest->url), "%s", url ? url : "");
+}
+
+static int node_addr_valid(const net_node_addr_t *node) {
+    return memchr(node->id, '\0', sizeof(node->id)) != NULL
+        && memchr(node->url, '\0', sizeof(node->url)) != NULL;
+}
+
+int net_protocol_validate(const net_message_t *msg) {
+    if (!msg) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+    if (msg->header.version != NET_PROTOCOL_VERSION) {
+        return NET_ERR_VERSION_MISMATCH;
+    }
+
+    switch (msg->header.msg_type) {
+        case NET_MSG_FIND_SUCCESSOR:
+            return msg->payload.find_successor_req.key >= 0 ? NET_ERR_OK : NET_ERR_INVALID_MESSAGE;
+        case NET_MSG_CLOSEST_PRECEDING:
+            return msg->payload.closest_preceding_req.key >= 0 ? NET_ERR_OK : NET_ERR_INVALID_MESSAGE;
+        case NET_MSG_NEXT_HOP:
+            return msg->payload.find_successor_req.key >= 0 ? NET_ERR_OK : NET_ERR_INVALID_MESSAGE;
+        case NET_MSG_NEXT_HOP_RESPONSE:
+            return node_addr_valid(&msg->payload.next_hop_resp.node) ? NET_ERR_OK : NET_ERR_INVALID_MESSAGE;
+        case NET_MSG_FORWARD_LOOKUP:
+        case NET_MSG_LOOKUP_RESULT:
+            if (msg->payload.lookup.key < 0 || msg->payload.lookup.hops < 0) {
+                return NET_ERR_INVALID_MESSAGE;
+            }
+            return node_addr_valid(&msg->payload.lookup.node) ? NET_ERR_OK : NET_ERR_INVALID_MESSAGE;
+        case NET_MSG_ADDRESSED:
+            if (!memchr(msg->payload.addressed.node_id, '\0', sizeof(msg->payload.addressed.node_id))) {
+                return NET_ERR_INVALID_MESSAGE;
+            }
+            return msg->payload.addressed.frame_len <= sizeof(msg->payload.addressed.frame)
+                ? NET_ERR_OK : NET_ERR_INVALID_MESSAGE;
+        case NET_MSG_BATCH:
+        case NET_MSG_BATCH_RESPONSE:
+            return batch_records_valid(msg->payload.batch.data, msg->payload.batch.len,
+                                       msg->payload.batch.count) ? NET_ERR_OK : NET_ERR_INVALID_MESSAGE;
+        case NET_MSG_FIND_SUCCESSOR_RESPONSE:
+            return node_addr_valid(&msg->payload.find_successor_resp.node) ? NET_ERR_OK : NET_ERR_INVALID_MESSAGE;
+        case NET_MSG_CLOSEST_PRECEDING_RESPONSE:
+            return node_addr_valid(&msg->payload.closest_preceding_resp.node) ? NET_ERR_OK : NET_ERR_INVALID_MESSAGE;
+        case NET_MSG_NOTIFY:
+        case NET_MSG_STABILIZE:
+            return node_addr_valid(&msg->payload.notify_req.node) ? NET_ERR_OK : NET_ERR_INVALID_MESSAGE;
+        case NET_MSG_STABILIZE_RESPONSE:
+            if (msg->payload.stabilize_resp.count > NET_PROTOCOL_MAX_SUCCESSORS
+                || (msg->payload.stabilize_resp.has_node
+                    && !node_addr_valid(&msg->payload.stabilize_resp.node))) {
+                return NET_ERR_INVALID_MESSAGE;
+            }
+            for (uint32_t i = 0; i < msg->payload.stabilize_resp.count; i++) {
+                if (!node_addr_valid(&msg->payload.stabilize_resp.successors[i])) {
+                    return NET_ERR_INVALID_MESSAGE;
+                }
+            }
+            return NET_ERR_OK;
+        case NET_MSG_GET_PREDECESSOR_RESPONSE:
+        case NET_MSG_GET_SUCCESSOR_RESPONSE:
+            if (msg->payload.get_node_resp.has_node && !node_addr_valid(&msg->payload.get_node_resp.node)) {
+                return NET_ERR_INVALID_MESSAGE;
+            }
+            return NET_ERR_OK;
+        case NET_MSG_ERROR:
+            return memchr(msg->payload.error.error_msg, '\0', sizeof(msg->payload.error.error_msg))
+                ? NET_ERR_OK : NET_ERR_INVALID_MESSAGE;
+        case NET_MSG_GET_PREDECESSOR:
+        case NET_MSG_GET_SUCCESSOR:
+        case NET_MSG_NOTIFY_RESPONSE:
+        case NET_MSG_PING:
+        case NET_MSG_PING_RESPONSE:
+            return NET_ERR_OK;
+        default:
+            return NET_ERR_INVALID_MESSAGE;
+    }
+}
+
+/*
+ * Zero-copy encode/decode
+ */
+
+static int binary_put_request_payload(wire_writer_t *w, net_msg_type_t type, int key,
+                                      const net_node_addr_t *node) {
+    switch (type) {
+        case NET_MSG_FIND_SUCCESSOR:
+        case NET_MSG_CLOSEST_PRECEDING:
+        case NET_MSG_NEXT_HOP:
+            wire_put_int(w, key);
+            break;
+        case NET_MSG_NOTIFY:
+        case NET_MSG_STABILIZE:
+            if (!node) {
+                return -1;
+            }
+            wire_put_node(w, node);
+            break;
+        case NET_MSG_GET_PREDECESSOR:
+        case NET_MSG_GET_SUCCESSOR:
+        case NET_MSG_PING:
+            break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+static int encode_request_json(void *buffer, size_t buffer_size, net_msg_type_t type,
+                               uint32_t request_id, int key, const net_node_addr_t *node) {
+    /* debug format: go through a full message */
+    static _Thread_local net_message_t msg;
+
+    net_protocol_init_message(&msg, type, request_id);
+    switch (type) {
+        case NET_MSG_FIND_SUCCESSOR:
+        case NET_MSG_NEXT_HOP:
+            msg.payload.find_successor_req.key = key;
+            break;
+        case NET_MSG_CLOSEST_PRECEDING:
+            msg.payload.closest_preceding_req.key = key;
+            break;
+        case NET_MSG_NOTIFY:
+        case NET_MSG_STABILIZE:
+            if (!node) {
+                return -1;
+            }
+            msg.payload.notify_req.node = *node;
+            break;
+        case NET_MSG_GET_PREDECESSOR:
+        case NET_MSG_GET_SUCCESSOR:
+        case NET_MSG_PING:
+            break;
+        default:
+            return -1;
+    }
+    return serialize_json(&msg, buffer, buffer_size);
+}
+
+int net_protocol_encode_request(void *buffer, size_t buffer_size, net_msg_type_t type,
+                                uint32_t request_id, int key, const net_node_addr_t *node) {
+    wire_writer_t sizing = { NULL, 0, 0, 0 };
+    wire_writer_t w = { (uint8_t*)buffer, buffer_size, 0, 0 };
+
+    if (!buffer) {
+        return -1;
+    }
+    if (net_protocol_get_format() == NET_PROTOCOL_FORMAT_JSON) {
+        return encode_request_json(buffer, buffer_size, type, request_id, key, node);
+    }
+    if (binary_put_request_payload(&sizing, type, key, node) != 0) {
+        return -1;
+    }
+
+    wire_put_u8(&w, NET_PROTOCOL_VERSION);
+    wire_put_u8(&w, (uint8_t)type);
+    wire_put_varint(&w, request_id);
+    wire_put_varint(&w, (uint32_t)sizing.len);
+    binary_put_request_payload(&w, type, key, node);
+
+    return w.overflow ? -1 : (int)w.len;
+}
+
+int net_protocol_encode_lookup(void *buffer, size_t buffer_size, net_msg_type_t type,
+                               uint32_t lookup_id, int key, int hops,
+                               const net_node_addr_t *node) {
+    wire_writer_t sizing = { NULL, 0, 0, 0 };
+    wire_writer_t w = { (uint8_t*)buffer, buffer_size, 0, 0 };
+
+    if (!buffer || !node || (type != NET_MSG_FORWARD_LOOKUP && type != NET_MSG_LOOKUP_RESULT)) {
+        return -1;
+    }
+    if (net_protocol_get_format() == NET_PROTOCOL_FORMAT_JSON) {
+        static _Thread_local net_message_t msg;
+
+        net_protocol_init_message(&msg, type, lookup_id);
+        msg.payload.lookup.key = key;
+        msg.payload.lookup.hops = hops;
+        msg.payload.lookup.node = *node;
+        return serialize_json(&msg, buffer, buffer_size);
+    }
+
+    wire_put_int(&sizing, key);
+    wire_put_int(&sizing, hops);
+    wire_put_node(&sizing, node);
+
+    wire_put_u8(&w, NET_PROTOCOL_VERSION);
+    wire_put_u8(&w, (uint8_t)type);
+    wire_put_varint(&w, lookup_id);
+    wire_put_varint(&w, (uint32_t)sizing.len);
+    wire_put_int(&w, key);
+    wire_put_int(&w, hops);
+    wire_put_node(&w, node);
+
+    return w.overflow ? -1 : (int)w.len;
+}
+
+int net_protocol_encode_addressed(void *buffer, size_t buffer_size, uint32_t request_id,
+                                  const char *node_id, const void *frame, size_t frame_len) {
+    wire_writer_t sizing = { NULL, 0, 0, 0 };
+    wire_writer_t w = { (uint8_t*)buffer, buffer_size, 0, 0 };
+
+    if (!buffer || !node_id || !frame || frame_len == 0 || frame_len > NET_PROTOCOL_MAX_FRAME) {
+        return -1;
+    }
+    if (((const uint8_t*)frame)[0] == '{') {
+        static _Thread_local net_message_t msg;
+
+        net_protocol_init_message(&msg, NET_MSG_ADDRESSED, request_id);
+        snprintf(msg.payload.addressed.node_id, sizeof(msg.payload.addressed.node_id), "%s", node_id);
+        memcpy(msg.payload.addressed.frame, frame, frame_len);
+        msg.payload.addressed.frame_len = (uint32_t)frame_len;
+        return serialize_json(&msg, buffer, buffer_size);
+    }
+
+    wire_put_str(&sizing, node_id, NET_PROTOCOL_MAX_NODE_ID - 1);
+    wire_put_varint(&sizing, (uint32_t)frame_len);
+    wire_put_bytes(&sizing, frame, frame_len);
+
+    wire_put_u8(&w, NET_PROTOCOL_VERSION);
+    wire_put_u8(&w, NET_MSG_ADDRESSED);
+    wire_put_varint(&w, request_id);
+    wire_put_varint(&w, (uint32_t)sizing.len);
+    wire_put_str(&w, node_id, NET_PROTOCOL_MAX_NODE_ID - 1);
+    wire_put_varint(&w, (uint32_t)frame_len);
+    wire_put_bytes(&w, frame, frame_len);
+
+    return w.overflow ? -1 : (int)w.len;
+}
+
+void net_protocol_batch_init(net_batch_t *batch) {
+    batch->count = 0;
+    batch->len = 0;
+}
+
+int net_protocol_batch_add(net_batch_t *batch, const void *frame, size_t frame_len) {
+    wire_writer_t sizing = { NULL, 0, 0, 0 };
+    wire_writer_t w = { batch->data, sizeof(batch->data), batch->len, 0 };
+
+    if (!frame || frame_len == 0 || batch->count >= NET_PROTOCOL_MAX_BATCH) {
+        return -1;
+    }
+    wire_put_varint(&sizing, (uint32_t)frame_len);
+    if (frame_len > sizeof(batch->data) || sizing.len + frame_len > sizeof(batch->data) - batch->len) {
+        return -1;
+    }
+    wire_put_varint(&w, (uint32_t)frame_len);
+    wire_put_bytes(&w, frame, frame_len);
+    batch->len = (uint32_t)w.len;
+    batch->count++;
+    return 0;
+}
+
+int net_protocol_batch_next(const void *records, size_t records_len, size_t *offset,
+                            const uint8_t **frame, size_t *frame_len) {
+    wire_reader_t r = { (const uint8_t*)records, records_len, *offset, 0 };
+    uint32_t n;
+
+    if (!records || *offset >= records_len) {
+        return 0;
+    }
+    n = wire_get_varint(&r);
+    if (r.error || n == 0 || n > r.len - r.pos) {
+        return 0;
+    }
+    *frame = r.data + r.pos;
+    *frame_len = n;
+    *offset = r.pos + n;
+    return 1;
+}
+
+int net_protocol_encode_batch(void *buffer, size_t buffer_size, net_msg_type_t type,
+                              uint32_t request_id, const net_batch_t *batch) {
+    wire_writer_t w = { (uint8_t*)buffer, buffer_size, 0, 0 };
+    wire_writer_t sizing = { NULL, 0, 0, 0 };
+    const uint8_t *first;
+    size_t first_len;
+    size_t offset = 0;
+
+    if (!buffer || !batch || (type != NET_MSG_BATCH && type != NET_MSG_BATCH_RESPONSE)
+        || !batch_records_valid(batch->data, batch->len, batch->count)) {
+        return -1;
+    }
+    net_protocol_batch_next(batch->data, batch->len, &offset, &first, &first_len);
+    if (first[0] == '{') {
+        static _Thread_local net_message_t msg;
+
+        net_protocol_init_message(&msg, type, request_id);
+        msg.payload.batch = *batch;
+        return serialize_json(&msg, buffer, buffer_size);
+    }
+
+    wire_put_varint(&sizing, batch->count);
+    wire_put_u8(&w, NET_PROTOCOL_VERSION);
+    wire_put_u8(&w, (uint8_t)type);
+    wire_put_varint(&w, request_id);
+    wire_put_varint(&w, (uint32_t)(sizing.len + batch->len));
+    wire_put_varint(&w, batch->count);
+    wire_put_bytes(&w, batch->data, batch->len);
+
+    return w.overflow ? -1 : (int)w.len;
+}
+
+static void wire_view_str(wire_reader_t *r, const char **str, uint32_t *len, size_t max) {
+    uint32_t n = wire_get_varint(r);
+
+    if (r->error || n > max || n > r->len - r->pos) {
+        r->error = 1;
+        *str = NULL;
+        *len = 0;
+        return;
+    }
+    *str = (const char*)(r->data + r->pos);
+    *len = n;
+    r->pos += n;
+}
+
+static void wire_view_node(wire_reader_t *r, net_node_view_t *node) {
+    wire_view_str(r, &node->id, &node->id_len, NET_PROTOCOL_MAX_NODE_ID - 1);
+    node->key = wire_get_int(r);
+    wire_view_str(r, &node->url, &node->url_len, NET_PROTOCOL_MAX_URL - 1);
+}
+
+static int binary_view_payload(wire_reader_t *r, net_frame_view_t *view) {
+    switch (view->header.msg_type) {
+        case NET_MSG_FIND_SUCCESSOR:
+        case NET_MSG_CLOSEST_PRECEDING:
+        case NET_MSG_NEXT_HOP:
+            view->key = wire_get_int(r);
+            break;
+        case NET_MSG_NEXT_HOP_RESPONSE:
+            view->done = wire_get_varint(r) ? 1 : 0;
+            view->has_node = 1;
+            wire_view_node(r, &view->node);
+            break;
+        case NET_MSG_FORWARD_LOOKUP:
+        case NET_MSG_LOOKUP_RESULT:
+            view->key = wire_get_int(r);
+            view->hops = wire_get_int(r);
+            view->has_node = 1;
+            wire_view_node(r, &view->node);
+            break;
+        case NET_MSG_ADDRESSED: {
+            const char *frame;
+
+            wire_view_str(r, &view->to, &view->to_len, NET_PROTOCOL_MAX_NODE_ID - 1);
+            wire_view_str(r, &frame, &view->frame_len, NET_PROTOCOL_MAX_FRAME);
+            view->frame = (const uint8_t*)frame;
+            break;
+        }
+        case NET_MSG_BATCH:
+        case NET_MSG_BATCH_RESPONSE:
+            view->count = wire_get_varint(r);
+            if (r->error || !batch_records_valid(r->data + r->pos, r->len - r->pos, view->count)) {
+                return NET_ERR_INVALID_MESSAGE;
+            }
+            view->frame = r->data + r->pos;
+            view->frame_len = (uint32_t)(r->len - r->pos);
+            r->pos = r->len;
+            break;
+        case NET_MSG_FIND_SUCCESSOR_RESPONSE:
+        case NET_MSG_CLOSEST_PRECEDING_RESPONSE:
+        case NET_MSG_NOTIFY:
+        case NET_MSG_STABILIZE:
+            view->has_node = 1;
+            wire_view_node(r, &view->node);
+            break;
+        case NET_MSG_STABILIZE_RESPONSE:
+            view->has_node = wire_get_varint(r) ? 1 : 0;
+            if (view->has_node) {
+                wire_view_node(r, &view->node);
+            }
+            view->count = wire_get_varint(r);
+            if (view->count > NET_PROTOCOL_MAX_SUCCESSORS) {
+                return NET_ERR_INVALID_MESSAGE;
+            }
+            for (uint32_t i = 0; i < view->count; i++) {
+                wire_view_node(r, &view->successors[i]);
+            }
+            break;
+        case NET_MSG_GET_PREDECESSOR:
+        case NET_MSG_GET_SUCCESSOR:
+        case NET_MSG_PING:
+            break;
+        case NET_MSG_GET_PREDECESSOR_RESPONSE:
+        case NET_MSG_GET_SUCCESSOR_RESPONSE:
+            view->has_node = wire_get_varint(r) ? 1 : 0;
+            if (view->has_node) {
+                wire_view_node(r, &view->node);
+            }
+            break;
+        case NET_MSG_NOTIFY_RESPONSE:
+            view->success = wire_get_varint(r) ? 1 : 0;
+            break;
+        case NET_MSG_PING_RESPONSE:
+            view->alive = wire_get_int(r);
+            view->state = wire_get_int(r);
+            break;
+        case NET_MSG_ERROR:
+            view->error_code = (net_error_t)wire_get_varint(r);
+            wire_view_str(r, &view->error_msg, &view->error_msg_len, 255);
+            break;
+        default:
+            return NET_ERR_INVALID_MESSAGE;
+    }
+
+    if (r->error || r->pos != r->len) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+    return NET_ERR_OK;
+}
+
+static void node_view_from_addr(net_node_view_t *view, const net_node_addr_t *node) {
+    view->id = node->id;
+    view->id_len = (uint32_t)strlen(node->id);
+    view->key = node->key;
+    view->url = node->url;
+    view->url_len = (uint32_t)strlen(node->url);
+}
+
+static int decode_view_json(net_frame_view_t *view, const void *buffer, size_t buffer_size) {
+    /* debug format: decode fully, then point the view at the scratch message
+     * (a batch's records get their own, so decoding them keeps the batch) */
+    static _Thread_local net_message_t msg;
+    static _Thread_local net_batch_t batch;
+    int err = net_protocol_deserialize(&msg, buffer, buffer_size);
+
+    if (err != NET_ERR_OK) {
+        return err;
+    }
+
+    view->header = msg.header;
+    switch (msg.header.msg_type) {
+        case NET_MSG_FIND_SUCCESSOR:
+        case NET_MSG_NEXT_HOP:
+            view->key = msg.payload.find_successor_req.key;
+            break;
+        case NET_MSG_CLOSEST_PRECEDING:
+            view->key = msg.payload.closest_preceding_req.key;
+            break;
+        case NET_MSG_NEXT_HOP_RESPONSE:
+            view->done = msg.payload.next_hop_resp.done;
+            view->has_node = 1;
+            node_view_from_addr(&view->node, &msg.payload.next_hop_resp.node);
+            break;
+        case NET_MSG_FORWARD_LOOKUP:
+        case NET_MSG_LOOKUP_RESULT:
+            view->key = msg.payload.lookup.key;
+            view->hops = msg.payload.lookup.hops;
+            view->has_node = 1;
+            node_view_from_addr(&view->node, &msg.payload.lookup.node);
+            break;
+        case NET_MSG_ADDRESSED:
+            view->to = msg.payload.addressed.node_id;
+            view->to_len = (uint32_t)strlen(msg.payload.addressed.node_id);
+            view->frame = msg.payload.addressed.frame;
+            view->frame_len = msg.payload.addressed.frame_len;
+            break;
+        case NET_MSG_BATCH:
+        case NET_MSG_BATCH_RESPONSE:
+            batch.count = msg.payload.batch.count;
+            batch.len = msg.payload.batch.len;
+            memcpy(batch.data, msg.payload.batch.data, batch.len);
+            view->count = batch.count;
+            view->frame = batch.data;
+            view->frame_len = batch.len;
+            break;
+        case NET_MSG_FIND_SUCCESSOR_RESPONSE:
+            view->has_node = 1;
+            node_view_from_addr(&view->node, &msg.payload.find_successor_resp.node);
+            break;
+        case NET_MSG_CLOSEST_PRECEDING_RESPONSE:
+            view->has_node = 1;
+            node_view_from_addr(&view->node, &msg.payload.closest_preceding_resp.node);
+            break;
+        case NET_MSG_NOTIFY:
+        case NET_MSG_STABILIZE:
+            view->has_node = 1;
+            node_view_from_addr(&view->node, &msg.payload.notify_req.node);
+            break;
+        case NET_MSG_STABILIZE_RESPONSE:
+            view->has_node = msg.payload.stabilize_resp.has_node;
+            if (view->has_node) {
+                node_view_from_addr(&view->node, &msg.payload.stabilize_resp.node);
+            }
+            view->count = msg.payload.stabilize_resp.count;
+            for (uint32_t i = 0; i < view->count; i++) {
+                node_view_from_addr(&view->successors[i], &msg.payload.stabilize_resp.successors[i]);
+            }
+            break;
+        case NET_MSG_GET_PREDECESSOR_RESPONSE:
+        case NET_MSG_GET_SUCCESSOR_RESPONSE:
+            view->has_node = msg.payload.get_node_resp.has_node;
+            if (view->has_node) {
+                node_view_from_addr(&view->node, &msg.payload.get_node_resp.node);
+            }
+            break;
+        case NET_MSG_NOTIFY_RESPONSE:
+            view->success = msg.payload.notify_resp.success;
+            break;
+        case NET_MSG_PING_RESPONSE:
+            view->alive = msg.payload.ping_resp.alive;
+            view->state = msg.payload.ping_resp.state;
+            break;
+        case NET_MSG_ERROR:
+            view->error_code = msg.payload.error.error_code;
+            view->error_msg = msg.payload.error.error_msg;
+            view->error_msg_len = (uint32_t)strlen(msg.payload.error.error_msg);
+            break;
+        default:
+            break;
+    }
+    return NET_ERR_OK;
+}
+
+int net_protocol_decode_view(net_frame_view_t *view, const void *buffer, size_t buffer_size) {
+    const uint8_t *data = (const uint8_t*)buffer;
+
+    if (!view || !buffer || buffer_size == 0) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+
+    view->has_node = 0;
+    if (data[0] == '{') {
+        return decode_view_json(view, buffer, buffer_size);
+    }
+
+    wire_reader_t r = { data, buffer_size, 0, 0 };
+    int err = binary_get_header(&r, &view->header);
+    if (err != NET_ERR_OK) {
+        return err;
+    }
+
+    wire_reader_t payload = { data + r.pos, view->header.payload_len, 0, 0 };
+    return binary_view_payload(&payload, view);
+}
+
+void net_protocol_copy_node_view(net_node_addr_t *dest, const net_node_view_t *view) {
+    memcpy(dest->id, view->id, view->id_len);
+    dest->id[view->id_len] = '\0';
+    dest->key = view->key;
+    memcpy(dest->url, view->url, view->url_len);
+    dest->url[view->url_len] = '\0';
+}
@@ -11,10 +11,41 @@
  * Handles message encoding/decoding, versioning, and error codes.
  * 
  * Design principles:
- * - Simple, fixed-size headers for efficiency
- * - JSON payloads for debuggability (can switch to binary later)
+ * - Compact binary frames: varint integers, length-prefixed strings
+ * - JSON frames selectable for debugging (see net_protocol_set_format)
  * - Version field for protocol evolution
  * - Request/response correlation via request_id
+ *
+ * Binary frame layout:
+ *
+ *   u8      version        NET_PROTOCOL_VERSION
+ *   u8      msg_type       net_msg_type_t
+ *   varint  request_id
+ *   varint  payload_len    bytes that follow
+ *   ...     payload        per-type fields, in struct order:
+ *                          ints as zigzag varints, flags as varints,
+ *                          strings as varint length + bytes (no NUL)
+ *
+ * JSON frames are a single object, e.g.
+ *   {"v":1,"type":"FIND_SUCCESSOR","id":7,"payload":{"key":42}}
+ * and are told apart from binary frames by their leading '{'.
+ * net_protocol_deserialize() accepts either.
+ *
+ * Batches: a BATCH frame carries several complete request frames
+ * ("records", each with its own type and request_id) for one receiver,
+ * which answers them with BATCH_RESPONSE frames carrying the records'
+ * responses, normally all in one. Binary payload: varint record count,
+ * then each record as varint length + bytes. JSON payload:
+ *   {"frames":[{...},{...}]}
+ * with the records embedded as they are (so they must be JSON too).
+ * Batches do not nest.
+ *
+ * STABILIZE is one maintenance period in one round trip: it carries
+ * the sender as NOTIFY does, and STABILIZE_RESPONSE carries the
+ * receiver's predecessor (as it was before the notify) and its
+ * successor list. Binary payload: has_node flag, predecessor if set,
+ * varint count, then the successors. JSON payload:
+ *   {"has_node":1,"node":{...},"successors":[{...},{...}]}
  */
 
 /* Protocol version */
@@ -25,6 +56,26 @@
 #define NET_PROTOCOL_MAX_NODE_ID 64
 #define NET_PROTOCOL_MAX_URL 256
 
+/* Largest encoded frame (binary or JSON) for any single message */
+#define NET_PROTOCOL_MAX_FRAME 2048
+
+/* Most records in one batch, and the record bytes it may hold (the
+ * rest of a frame is left for the envelope in either format) */
+#define NET_PROTOCOL_MAX_BATCH 32
+#define NET_PROTOCOL_BATCH_CAPACITY (NET_PROTOCOL_MAX_FRAME - 96)
+
+/* Longest successor list a STABILIZE_RESPONSE carries: the most that
+ * still fit NET_PROTOCOL_MAX_FRAME, in either format, with every id and
+ * URL at its longest and the response inside an ADDRESSED envelope
+ * (checked in net_protocol.c) */
+#define NET_PROTOCOL_MAX_SUCCESSORS 4
+
+/* Wire formats */
+typedef enum {
+    NET_PROTOCOL_FORMAT_BINARY = 0,
+    NET_PROTOCOL_FORMAT_JSON = 1
+} net_protocol_format_t;
+
 /* Message types */
 typedef enum {
     NET_MSG_FIND_SUCCESSOR = 1,
@@ -39,6 +90,15 @@ typedef enum {
     NET_MSG_CLOSEST_PRECEDING_RESPONSE = 10,
     NET_MSG_PING = 11,
     NET_MSG_PING_RESPONSE = 12,
+    NET_MSG_NEXT_HOP = 13,
+    NET_MSG_NEXT_HOP_RESPONSE = 14,
+    NET_MSG_FORWARD_LOOKUP = 15,      /* one-way, request_id names the lookup */
+    NET_MSG_LOOKUP_RESULT = 17,       /* one-way, request_id names the lookup */
+    NET_MSG_ADDRESSED = 19,           /* answered by the inner request's response */
+    NET_MSG_BATCH = 21,               /* request_id is the first record's */
+    NET_MSG_BATCH_RESPONSE = 22,
+    NET_MSG_STABILIZE = 23,           /* carries the sender, as NOTIFY */
+    NET_MSG_STABILIZE_RESPONSE = 24,
     NET_MSG_ERROR = 255
 } net_msg_type_t;
 
@@ -49,7 +109,8 @@ typedef enum {
     NET_ERR_TIMEOUT = 2,
     NET_ERR_NODE_NOT_FOUND = 3,
     NET_ERR_INTERNAL = 4,
-    NET_ERR_VERSION_MISMATCH = 5
+    NET_ERR_VERSION_MISMATCH = 5,
+    NET_ERR_CONNECTION_CLOSED = 6
 } net_error_t;
 
 /* Node address structure (replaces Node* for remote references) */
@@ -109,6 +170,44 @@ typedef struct {
     int state;
 } net_ping_resp_t;
 
+/* Next hop response: the key's successor if done, else the node to ask next */
+typedef struct {
+    int done;
+    net_node_addr_t node;
+} net_next_hop_resp_t;
+
+/* Recursive lookup: FORWARD_LOOKUP carries the origin, LOOKUP_RESULT the successor */
+typedef struct {
+    int key;
+    int hops;
+    net_node_addr_t node;
+} net_lookup_msg_t;
+
+/* Stabilize response: predecessor (as before the request's notify)
+ * and successor list, nearest first */
+typedef struct {
+    int has_node;               /* 0 if no predecessor */
+    net_node_addr_t node;
+    uint32_t count;
+    net_node_addr_t successors[NET_PROTOCOL_MAX_SUCCESSORS];
+} net_stabilize_resp_t;
+
+/* Request for one node of a multi-node host: the node's id and the
+ * request frame itself (same format as the envelope) */
+typedef struct {
+    char node_id[NET_PROTOCOL_MAX_NODE_ID];
+    uint32_t frame_len;
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+} net_addressed_t;
+
+/* Records of a BATCH or BATCH_RESPONSE: encoded frames, each
+ * prefixed by its varint length (build with net_protocol_batch_add) */
+typedef struct {
+    uint32_t count;
+    uint32_t len;
+    uint8_t data[NET_PROTOCOL_BATCH_CAPACITY];
+} net_batch_t;
+
 /* Error message */
 typedef struct {
     net_error_t error_code;
@@ -127,6 +226,11 @@ typedef struct {
         net_closest_preceding_req_t closest_preceding_req;
         net_closest_preceding_resp_t closest_preceding_resp;
         net_ping_resp_t ping_resp;
+        net_next_hop_resp_t next_hop_resp;
+        net_lookup_msg_t lookup;
+        net_stabilize_resp_t stabilize_resp;
+        net_addressed_t addressed;
+        net_batch_t batch;
         net_error_msg_t error;
         char raw_payload[NET_PROTOCOL_MAX_PAYLOAD];
     } payload;
@@ -139,12 +243,26 @@ typedef struct {
 /* Initialize a message with header */
 void net_protocol_init_message(net_message_t *msg, net_msg_type_t type, uint32_t request_id);
 
-/* Serialize message to buffer (returns bytes written, or -1 on error) */
+/* Select the format used by net_protocol_serialize() (default: binary) */
+void net_protocol_set_format(net_protocol_format_t format);
+net_protocol_format_t net_protocol_get_format(void);
+
+/* Serialize message to buffer in the selected format
+ * (returns bytes written, or -1 on error or if buffer is too small) */
 int net_protocol_serialize(const net_message_t *msg, void *buffer, size_t buffer_size);
 
-/* Deserialize buffer to message (returns 0 on success, error code on failure) */
+/* Serialize message to buffer in an explicit format */
+int net_protocol_serialize_as(const net_message_t *msg, net_protocol_format_t format,
+                              void *buffer, size_t buffer_size);
+
+/* Deserialize a binary or JSON frame to message
+ * (returns 0 on success, net_error_t code on failure; msg->header.payload_len
+ * is set to the encoded payload size) */
 int net_protocol_deserialize(net_message_t *msg, const void *buffer, size_t buffer_size);
 
+/* Printable message type name ("FIND_SUCCESSOR", ...), "UNKNOWN" if invalid */
+const char* net_protocol_msg_type_name(int msg_type);
+
 /* Create error message */
 void net_protocol_create_error(net_message_t *msg, uint32_t request_id, 
                                 net_error_t error_code, const char *error_msg);
@@ -155,4 +273,91 @@ void net_protocol_copy_node_addr(net_node_addr_t *dest, const char *id, int key,
 /* Validate message (returns 0 if valid, error code otherwise) */
 int net_protocol_validate(const net_message_t *msg);
 
+/*
+ * Zero-copy encode/decode
+ *
+ * The RPC hot path never materialises a net_message_t: requests are
+ * encoded straight into a transport buffer and responses are decoded
+ * into a small view whose strings point into the received bytes.
+ */
+
+/* Node address inside a received frame (strings are NOT NUL-terminated) */
+typedef struct {
+    const char *id;
+    uint32_t id_len;
+    int key;
+    const char *url;
+    uint32_t url_len;
+} net_node_view_t;
+
+/* Decoded frame; only the fields used by header.msg_type are set */
+typedef struct {
+    net_msg_header_t header;
+    int key;                    /* key-carrying requests and lookups */
+    int has_node;               /* 1 if node is set */
+    net_node_view_t node;       /* NOTIFY, STABILIZE*, lookups and node-carrying responses */
+    int success;                /* NOTIFY_RESPONSE */
+    int done;                   /* NEXT_HOP_RESPONSE */
+    int hops;                   /* FORWARD_LOOKUP, LOOKUP_RESULT */
+    const char *to;             /* ADDRESSED: node id (not NUL-terminated) */
+    uint32_t to_len;
+    const uint8_t *frame;       /* ADDRESSED: inner request frame; BATCH*: records */
+    uint32_t frame_len;
+    uint32_t count;             /* BATCH*: records in frame; STABILIZE_RESPONSE: successors */
+    net_node_view_t successors[NET_PROTOCOL_MAX_SUCCESSORS];   /* STABILIZE_RESPONSE */
+    int alive;                  /* PING_RESPONSE */
+    int state;                  /* PING_RESPONSE */
+    net_error_t error_code;     /* ERROR */
+    const char *error_msg;      /* ERROR (not NUL-terminated) */
+    uint32_t error_msg_len;
+} net_frame_view_t;
+
+/* Encode a request frame in the selected format. key is used by
+ * FIND_SUCCESSOR, CLOSEST_PRECEDING and NEXT_HOP, node by NOTIFY and
+ * STABILIZE; the others carry no payload. Returns bytes written, or -1
+ * on error. */
+int net_protocol_encode_request(void *buffer, size_t buffer_size, net_msg_type_t type,
+                                uint32_t request_id, int key, const net_node_addr_t *node);
+
+/* Encode a FORWARD_LOOKUP or LOOKUP_RESULT frame in the selected format.
+ * Returns bytes written, or -1 on error. */
+int net_protocol_encode_lookup(void *buffer, size_t buffer_size, net_msg_type_t type,
+                               uint32_t lookup_id, int key, int hops,
+                               const net_node_addr_t *node);
+
+/* Encode an ADDRESSED envelope carrying frame (an encoded request
+ * with the given request_id) to node_id. The envelope takes the
+ * frame's format. Returns bytes written, or -1 on error. */
+int net_protocol_encode_addressed(void *buffer, size_t buffer_size, uint32_t request_id,
+                                  const char *node_id, const void *frame, size_t frame_len);
+
+/* Empty a batch */
+void net_protocol_batch_init(net_batch_t *batch);
+
+/* Append an encoded frame as the batch's next record. Returns 0, or -1
+ * if the batch already holds NET_PROTOCOL_MAX_BATCH records or the
+ * frame does not fit in what is left of NET_PROTOCOL_BATCH_CAPACITY. */
+int net_protocol_batch_add(net_batch_t *batch, const void *frame, size_t frame_len);
+
+/* Step through the records of a batch (net_batch_t data/len, or a
+ * BATCH* view's frame/frame_len): *offset starts at 0. Returns 1 with
+ * the next record in frame/frame_len, 0 after the last. */
+int net_protocol_batch_next(const void *records, size_t records_len, size_t *offset,
+                            const uint8_t **frame, size_t *frame_len);
+
+/* Encode a BATCH or BATCH_RESPONSE frame of batch's records, in the
+ * format of its first record. Returns bytes written, or -1 on error
+ * (empty batch, or JSON with a binary record). */
+int net_protocol_encode_batch(void *buffer, size_t buffer_size, net_msg_type_t type,
+                              uint32_t request_id, const net_batch_t *batch);
+
+/* Decode a frame into a view over buffer. The view is valid while
+ * buffer is; for JSON frames it instead points into thread-local
+ * scratch valid until the thread's next decode.
+ * Returns 0 on success, net_error_t code on failure. */
+int net_protocol_decode_view(net_frame_view_t *view, const void *buffer, size_t buffer_size);
+
+/* Copy a node view into an address (copies only the string bytes) */
+void net_protocol_copy_node_view(net_node_addr_t *dest, const net_node_view_t *view);
+
 #endif /* NET_PROTOCOL_H */
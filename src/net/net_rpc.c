@@ -0,0 +1,504 @@
+#include "net_rpc.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Async RPC engine implementation
+ *
+ * Pending calls are indexed by request_id in a chained hash table whose
+ * bucket is simply id & mask: IDs are handed out sequentially, so live
+ * calls spread evenly and chains stay at about one entry. The table
+ * doubles whenever calls in flight outnumber buckets. Call objects are
+ * recycled through a per-engine free list, so steady-state calls do
+ * not allocate.
+ *
+ * With retransmission on, a call keeps its encoded request and its one
+ * timer alternates roles: each expiry before the deadline resends and
+ * re-arms with a doubled interval, the last one times the call out.
+ *
+ * With batching on, a call is linked and its timer armed as usual, but
+ * its request is copied into the engine's open batch instead of being
+ * sent. The batch goes out when full, from its window timer or from a
+ * loop hook; a batch of one is sent as the bare request. Links hook
+ * their own output flush into the same loop earlier, and hooks added
+ * later run first, so a batch flushed by the hook still leaves in that
+ * turn.
+ */
+
+#define RPC_TABLE_INITIAL 64
+
+typedef struct rpc_call {
+    struct rpc_call *next;          /* Bucket chain, or free list */
+    net_rpc_t *rpc;
+    uint32_t request_id;
+    net_msg_type_t expected;
+    net_rpc_callback_t callback;
+    void *context;
+    net_timer_t timer;
+    net_buf_t *request;             /* Kept for resending, else NULL */
+    uint64_t deadline_ms;
+    int retry_ms;
+} rpc_call_t;
+
+struct net_rpc {
+    net_loop_t *loop;
+    net_rpc_send_fn send;
+    void *link;
+    rpc_call_t **table;
+    uint32_t table_mask;
+    size_t pending_count;
+    rpc_call_t *free_calls;
+    int closing;
+    int retransmit_ms;
+    size_t retransmits;
+
+    net_batch_t *batch;             /* Requests waiting to go out, NULL until batching */
+    uint32_t batch_ids[NET_PROTOCOL_MAX_BATCH];
+    unsigned batch_max;             /* 0 = not batching */
+    int batch_window_ms;            /* 0 = until the loop's next hooks */
+    net_timer_t batch_timer;
+    net_hook_t batch_hook;
+    size_t batches;
+};
+
+static void rpc_call_timeout(net_timer_t *timer, void *context);
+static void rpc_batch_timeout(net_timer_t *timer, void *context);
+
+net_rpc_t* net_rpc_create(net_loop_t *loop, net_rpc_send_fn send, void *link) {
+    net_rpc_t *rpc;
+
+    if (!loop || !send) {
+        return NULL;
+    }
+
+    rpc = (net_rpc_t*)calloc(1, sizeof(net_rpc_t));
+    if (!rpc) {
+        return NULL;
+    }
+
+    rpc->table = (rpc_call_t**)calloc(RPC_TABLE_INITIAL, sizeof(rpc_call_t*));
+    if (!rpc->table) {
+        free(rpc);
+        return NULL;
+    }
+    rpc->table_mask = RPC_TABLE_INITIAL - 1;
+
+    rpc->loop = loop;
+    rpc->send = send;
+    rpc->link = link;
+    net_timer_init(&rpc->batch_timer, rpc_batch_timeout, rpc);
+    return rpc;
+}
+
+void net_rpc_destroy(net_rpc_t *rpc) {
+    if (!rpc) {
+        return;
+    }
+
+    rpc->closing = 1;
+    net_rpc_fail_all(rpc, NET_ERR_CONNECTION_CLOSED);
+    free(rpc->batch);
+    while (rpc->free_calls) {
+        rpc_call_t *call = rpc->free_calls;
+        rpc->free_calls = call->next;
+        free(call);
+    }
+    free(rpc->table);
+    free(rpc);
+}
+
+size_t net_rpc_pending(const net_rpc_t *rpc) {
+    return rpc->pending_count;
+}
+
+void net_rpc_set_retransmit(net_rpc_t *rpc, int interval_ms) {
+    rpc->retransmit_ms = interval_ms > 0 ? interval_ms : 0;
+}
+
+size_t net_rpc_retransmits(const net_rpc_t *rpc) {
+    return rpc->retransmits;
+}
+
+size_t net_rpc_batches(const net_rpc_t *rpc) {
+    return rpc->batches;
+}
+
+static rpc_call_t* rpc_call_alloc(net_rpc_t *rpc) {
+    rpc_call_t *call = rpc->free_calls;
+
+    if (call) {
+        rpc->free_calls = call->next;
+    }
+    else {
+        call = (rpc_call_t*)malloc(sizeof(rpc_call_t));
+        if (!call) {
+            return NULL;
+        }
+    }
+
+    call->rpc = rpc;
+    call->request = NULL;
+    net_timer_init(&call->timer, rpc_call_timeout, call);
+    return call;
+}
+
+static void rpc_call_recycle(net_rpc_t *rpc, rpc_call_t *call) {
+    call->next = rpc->free_calls;
+    rpc->free_calls = call;
+}
+
+static int rpc_table_grow(net_rpc_t *rpc) {
+    uint32_t size = (rpc->table_mask + 1) * 2;
+    rpc_call_t **table = (rpc_call_t**)calloc(size, sizeof(rpc_call_t*));
+
+    if (!table) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i <= rpc->table_mask; i++) {
+        while (rpc->table[i]) {
+            rpc_call_t *call = rpc->table[i];
+            rpc->table[i] = call->next;
+            call->next = table[call->request_id & (size - 1)];
+            table[call->request_id & (size - 1)] = call;
+        }
+    }
+
+    free(rpc->table);
+    rpc->table = table;
+    rpc->table_mask = size - 1;
+    return 0;
+}
+
+static rpc_call_t* rpc_call_find(net_rpc_t *rpc, uint32_t request_id) {
+    for (rpc_call_t *call = rpc->table[request_id & rpc->table_mask]; call; call = call->next) {
+        if (call->request_id == request_id) {
+            return call;
+        }
+    }
+    return NULL;
+}
+
+/* Add call to the pending table (fails if its ID is already pending) */
+static int rpc_call_link(net_rpc_t *rpc, rpc_call_t *call) {
+    if (rpc_call_find(rpc, call->request_id)) {
+        return -1;
+    }
+    if (rpc->pending_count > rpc->table_mask && rpc_table_grow(rpc) != 0) {
+        return -1;
+    }
+
+    rpc_call_t **bucket = &rpc->table[call->request_id & rpc->table_mask];
+    call->next = *bucket;
+    *bucket = call;
+    rpc->pending_count++;
+    return 0;
+}
+
+/* Remove call from the pending table and return it to the free list */
+static void rpc_call_release(net_rpc_t *rpc, rpc_call_t *call) {
+    rpc_call_t **link = &rpc->table[call->request_id & rpc->table_mask];
+
+    net_loop_timer_stop(rpc->loop, &call->timer);
+
+    while (*link != call) {
+        link = &(*link)->next;
+    }
+    *link = call->next;
+    rpc->pending_count--;
+
+    net_buf_free(call->request);
+    call->request = NULL;
+    rpc_call_recycle(rpc, call);
+}
+
+/* Release call, then run its callback (which may start new calls) */
+static void rpc_call_complete(net_rpc_t *rpc, rpc_call_t *call,
+                              const net_frame_view_t *response, int error) {
+    net_rpc_callback_t callback = call->callback;
+    void *context = call->context;
+
+    rpc_call_release(rpc, call);
+    callback(context, response, error);
+}
+
+static void rpc_call_timeout(net_timer_t *timer, void *context) {
+    rpc_call_t *call = (rpc_call_t*)context;
+    net_rpc_t *rpc = call->rpc;
+    uint64_t now = net_loop_now_ms(rpc->loop);
+    int err;
+
+    (void)timer;
+    if (!call->request || now >= call->deadline_ms) {
+        rpc_call_complete(rpc, call, NULL, NET_ERR_TIMEOUT);
+        return;
+    }
+
+    err = rpc->send(rpc->link, call->request);
+    if (err != NET_ERR_OK) {
+        rpc_call_complete(rpc, call, NULL, err);
+        return;
+    }
+    rpc->retransmits++;
+    call->retry_ms *= 2;
+    net_loop_timer_start(rpc->loop, &call->timer,
+                         (int)(call->deadline_ms - now < (uint64_t)call->retry_ms ?
+                               call->deadline_ms - now : (uint64_t)call->retry_ms));
+}
+
+/*
+ * Batching
+ */
+
+static void rpc_batch_on_hook(void *context) {
+    net_rpc_flush((net_rpc_t*)context);
+}
+
+static void rpc_batch_timeout(net_timer_t *timer, void *context) {
+    (void)timer;
+    net_rpc_flush((net_rpc_t*)context);
+}
+
+/* Forget the open batch (its calls stay pending) */
+static void rpc_batch_drop(net_rpc_t *rpc) {
+    if (rpc->batch) {
+        net_protocol_batch_init(rpc->batch);
+    }
+    net_loop_timer_stop(rpc->loop, &rpc->batch_timer);
+    net_loop_remove_hook(rpc->loop, &rpc->batch_hook);
+}
+
+void net_rpc_set_batching(net_rpc_t *rpc, unsigned max_records, int window_ms) {
+    net_rpc_flush(rpc);
+    if (max_records > NET_PROTOCOL_MAX_BATCH) {
+        max_records = NET_PROTOCOL_MAX_BATCH;
+    }
+    if (max_records > 1 && !rpc->batch) {
+        rpc->batch = (net_batch_t*)malloc(sizeof(net_batch_t));
+        if (rpc->batch) {
+            net_protocol_batch_init(rpc->batch);
+        }
+    }
+    rpc->batch_max = max_records > 1 && rpc->batch ? max_records : 0;
+    rpc->batch_window_ms = window_ms > 0 ? window_ms : 0;
+}
+
+int net_rpc_flush(net_rpc_t *rpc) {
+    uint32_t ids[NET_PROTOCOL_MAX_BATCH];
+    unsigned count;
+    net_buf_t *frame;
+    int err = NET_ERR_OK;
+
+    if (!rpc->batch || rpc->batch->count == 0) {
+        return NET_ERR_OK;
+    }
+
+    count = rpc->batch->count;
+    memcpy(ids, rpc->batch_ids, count * sizeof(ids[0]));
+    frame = net_buf_alloc();
+    if (!frame) {
+        err = NET_ERR_INTERNAL;
+    }
+    else if (count == 1) {
+        const uint8_t *record;
+        size_t len;
+        size_t offset = 0;
+
+        net_protocol_batch_next(rpc->batch->data, rpc->batch->len, &offset, &record, &len);
+        memcpy(frame->data, record, len);
+        frame->len = len;
+    }
+    else {
+        int len = net_protocol_encode_batch(frame->data, sizeof(frame->data), NET_MSG_BATCH,
+                                            ids[0], rpc->batch);
+        frame->len = len > 0 ? (size_t)len : 0;
+        err = len > 0 ? NET_ERR_OK : NET_ERR_INTERNAL;
+    }
+    /* Closed before sending: a link may deliver responses inline */
+    rpc_batch_drop(rpc);
+
+    if (err == NET_ERR_OK) {
+        err = rpc->send(rpc->link, frame);
+    }
+    net_buf_free(frame);
+    if (err != NET_ERR_OK) {
+        for (unsigned i = 0; i < count; i++) {
+            rpc_call_t *call = rpc_call_find(rpc, ids[i]);
+            if (call) {
+                rpc_call_complete(rpc, call, NULL, err);
+            }
+        }
+        return err;
+    }
+    if (count > 1) {
+        rpc->batches++;
+    }
+    return NET_ERR_OK;
+}
+
+/* Put a pending call's request into the open batch, sending the batch
+ * if that fills it. Returns NET_ERR_OK, or the error of sending the
+ * request alone when it does not fit in any batch. */
+static int rpc_batch_add(net_rpc_t *rpc, uint32_t request_id, const net_buf_t *request) {
+    net_batch_t *batch = rpc->batch;
+
+    if (net_protocol_batch_add(batch, request->data, request->len) != 0) {
+        if (batch->count == 0) {
+            return rpc->send(rpc->link, request);
+        }
+        net_rpc_flush(rpc);
+        if (net_protocol_batch_add(batch, request->data, request->len) != 0) {
+            return rpc->send(rpc->link, request);
+        }
+    }
+    rpc->batch_ids[batch->count - 1] = request_id;
+
+    if (batch->count >= rpc->batch_max) {
+        net_rpc_flush(rpc);
+    }
+    else if (batch->count == 1) {
+        if (rpc->batch_window_ms > 0) {
+            net_loop_timer_start(rpc->loop, &rpc->batch_timer, rpc->batch_window_ms);
+        }
+        else {
+            net_loop_add_hook(rpc->loop, &rpc->batch_hook, rpc_batch_on_hook, rpc);
+        }
+    }
+    return NET_ERR_OK;
+}
+
+int net_rpc_call(net_rpc_t *rpc, uint32_t request_id, net_msg_type_t type, int key,
+                 const net_node_addr_t *node, net_rpc_callback_t callback, void *context,
+                 int timeout_ms) {
+    net_buf_t *request;
+    rpc_call_t *call;
+    int len, err, kept;
+
+    if (!rpc || !callback) {
+        return NET_ERR_INTERNAL;
+    }
+    if (rpc->closing) {
+        return NET_ERR_CONNECTION_CLOSED;
+    }
+
+    request = net_buf_alloc();
+    call = rpc_call_alloc(rpc);
+    if (!request || !call) {
+        net_buf_free(request);
+        if (call) {
+            rpc_call_recycle(rpc, call);
+        }
+        return NET_ERR_INTERNAL;
+    }
+
+    call->request_id = request_id;
+    call->expected = (net_msg_type_t)(type + 1);  /* responses follow their request */
+    call->callback = callback;
+    call->context = context;
+
+    len = net_protocol_encode_request(request->data, sizeof(request->data), type,
+                                      call->request_id, key, node);
+    if (len < 0) {
+        net_buf_free(request);
+        rpc_call_recycle(rpc, call);
+        return NET_ERR_INTERNAL;
+    }
+    request->len = (size_t)len;
+
+    /* Pending before sending: a link may deliver the response inline */
+    if (rpc_call_link(rpc, call) != 0) {
+        net_buf_free(request);
+        rpc_call_recycle(rpc, call);
+        return NET_ERR_INTERNAL;
+    }
+    if (rpc->retransmit_ms > 0 && timeout_ms > rpc->retransmit_ms) {
+        call->request = request;  /* Freed with the call */
+        call->deadline_ms = net_loop_now_ms(rpc->loop) + (uint64_t)timeout_ms;
+        call->retry_ms = rpc->retransmit_ms;
+        net_loop_timer_start(rpc->loop, &call->timer, rpc->retransmit_ms);
+    }
+    else {
+        net_loop_timer_start(rpc->loop, &call->timer, timeout_ms);
+    }
+
+    kept = call->request != NULL;
+    err = rpc->batch_max ? rpc_batch_add(rpc, request_id, request) : rpc->send(rpc->link, request);
+    if (!kept) {
+        net_buf_free(request);
+    }
+    if (err != NET_ERR_OK) {
+        rpc_call_t *sent = rpc_call_find(rpc, request_id);
+        if (sent) {
+            rpc_call_release(rpc, sent);
+        }
+        return err;
+    }
+
+    return NET_ERR_OK;
+}
+
+static int rpc_receive_frame(net_rpc_t *rpc, const void *frame, size_t len, int nested);
+
+/* Complete the calls answered by a BATCH_RESPONSE */
+static int rpc_receive_batch(net_rpc_t *rpc, const net_frame_view_t *view) {
+    /* Copied: a callback may decode (JSON) or receive the next batch */
+    uint8_t records[NET_PROTOCOL_BATCH_CAPACITY];
+    uint32_t records_len = view->frame_len;
+    const uint8_t *record;
+    size_t record_len;
+    size_t offset = 0;
+    int result = NET_ERR_NODE_NOT_FOUND;
+
+    memcpy(records, view->frame, records_len);
+    while (net_protocol_batch_next(records, records_len, &offset, &record, &record_len)) {
+        if (rpc_receive_frame(rpc, record, record_len, 1) == NET_ERR_OK) {
+            result = NET_ERR_OK;
+        }
+    }
+    return result;
+}
+
+int net_rpc_receive(net_rpc_t *rpc, const void *frame, size_t len) {
+    return rpc_receive_frame(rpc, frame, len, 0);
+}
+
+static int rpc_receive_frame(net_rpc_t *rpc, const void *frame, size_t len, int nested) {
+    net_frame_view_t view;
+    rpc_call_t *call;
+    int err;
+
+    err = net_protocol_decode_view(&view, frame, len);
+    if (err != NET_ERR_OK) {
+        return err;
+    }
+    if (view.header.msg_type == NET_MSG_BATCH_RESPONSE) {
+        return nested ? NET_ERR_INVALID_MESSAGE : rpc_receive_batch(rpc, &view);
+    }
+
+    call = rpc_call_find(rpc, view.header.request_id);
+    if (!call) {
+        return NET_ERR_NODE_NOT_FOUND;
+    }
+
+    if (view.header.msg_type == NET_MSG_ERROR) {
+        rpc_call_complete(rpc, call, NULL,
+                          view.error_code != NET_ERR_OK ? (int)view.error_code : NET_ERR_INTERNAL);
+    }
+    else if (view.header.msg_type != call->expected) {
+        rpc_call_complete(rpc, call, NULL, NET_ERR_INVALID_MESSAGE);
+    }
+    else {
+        rpc_call_complete(rpc, call, &view, NET_ERR_OK);
+    }
+
+    return NET_ERR_OK;
+}
+
+void net_rpc_fail_all(net_rpc_t *rpc, int error) {
+    rpc_batch_drop(rpc);
+    for (uint32_t i = 0; i <= rpc->table_mask && rpc->pending_count > 0; i++) {
+        while (rpc->table[i]) {
+            rpc_call_complete(rpc, rpc->table[i], NULL, error);
+        }
+    }
+}
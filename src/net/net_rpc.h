@@ -0,0 +1,96 @@
+#ifndef NET_RPC_H
+#define NET_RPC_H
+
+#include "net_protocol.h"
+#include "net_buf.h"
+#include "net_loop.h"
+
+/*
+ * Async RPC Engine
+ *
+ * Multiplexes many in-flight calls over one link (a connection to one
+ * remote node). A call encodes its request, records a pending entry
+ * and returns immediately; the transport hands every received frame
+ * to net_rpc_receive(), which matches it to its call by request_id
+ * in O(1) and completes it. Responses may arrive in any order, and a
+ * slow call never holds up the ones behind it. Calls that see no
+ * response before their deadline are completed with NET_ERR_TIMEOUT
+ * from the loop's timer wheel.
+ *
+ * On links that may lose frames (datagrams), net_rpc_set_retransmit()
+ * makes the engine keep each request and send it again until a
+ * response arrives or the call times out.
+ *
+ * With net_rpc_set_batching(), requests are not sent one by one but
+ * coalesced: calls started within a short window go out together as
+ * one BATCH frame, and the BATCH_RESPONSE that comes back completes
+ * them all. Resends always go out on their own.
+ *
+ * Every call that net_rpc_call() accepted completes exactly once, with
+ * its callback run on the loop thread. Responses arriving after a call
+ * completed (late or duplicate) are dropped.
+ *
+ * Thread safety: an engine belongs to its loop's thread.
+ */
+
+/* Completion callback: response is NULL unless error is NET_ERR_OK,
+ * and is only valid during the callback */
+typedef void (*net_rpc_callback_t)(void *context, const net_frame_view_t *response, int error);
+
+/* Transmit one encoded frame on the link (returns NET_ERR_OK or error) */
+typedef int (*net_rpc_send_fn)(void *link, const net_buf_t *frame);
+
+typedef struct net_rpc net_rpc_t;
+
+/* Create an engine sending through send(link, frame) (NULL on failure) */
+net_rpc_t* net_rpc_create(net_loop_t *loop, net_rpc_send_fn send, void *link);
+
+/* Destroy engine; pending calls complete with NET_ERR_CONNECTION_CLOSED
+ * and new calls from their callbacks are refused */
+void net_rpc_destroy(net_rpc_t *rpc);
+
+/* Resend unanswered requests after interval_ms, doubling the interval
+ * each time, until the call's timeout (0 = never resend, the default).
+ * Applies to calls started afterwards. */
+void net_rpc_set_retransmit(net_rpc_t *rpc, int interval_ms);
+
+/* Requests sent again so far */
+size_t net_rpc_retransmits(const net_rpc_t *rpc);
+
+/* Coalesce requests into BATCH frames of up to max_records (at most
+ * NET_PROTOCOL_MAX_BATCH; 1 or 0 sends each request at once, the
+ * default). A batch is sent when full, or window_ms after its first
+ * request; window_ms 0 sends it when the loop next runs its hooks,
+ * i.e. it collects the calls made during one turn of the loop. */
+void net_rpc_set_batching(net_rpc_t *rpc, unsigned max_records, int window_ms);
+
+/* Send the requests waiting for their batch now (returns NET_ERR_OK,
+ * or the link's error, with which those calls were completed) */
+int net_rpc_flush(net_rpc_t *rpc);
+
+/* BATCH frames sent so far */
+size_t net_rpc_batches(const net_rpc_t *rpc);
+
+/* Start a call. request_id must not match a call still in flight
+ * (use net_peer_next_request_id()). key is used by FIND_SUCCESSOR and
+ * CLOSEST_PRECEDING, node by NOTIFY. Returns NET_ERR_OK once the
+ * request is sent (or waits in a batch, whose send failure completes
+ * the call with the link's error); on any other return the callback
+ * will not be invoked. */
+int net_rpc_call(net_rpc_t *rpc, uint32_t request_id, net_msg_type_t type, int key,
+                 const net_node_addr_t *node, net_rpc_callback_t callback, void *context,
+                 int timeout_ms);
+
+/* Feed a frame received on the link (a BATCH_RESPONSE is unpacked).
+ * Returns NET_ERR_OK if it completed a call, NET_ERR_NODE_NOT_FOUND if
+ * no call was waiting for it, or the decode error. */
+int net_rpc_receive(net_rpc_t *rpc, const void *frame, size_t len);
+
+/* Complete every pending call with error (e.g. link went down); an
+ * unsent batch is dropped */
+void net_rpc_fail_all(net_rpc_t *rpc, int error);
+
+/* Number of calls in flight */
+size_t net_rpc_pending(const net_rpc_t *rpc);
+
+#endif /* NET_RPC_H */
@@ -0,0 +1,871 @@
+#define _GNU_SOURCE
+
+#include "net_server.h"
+#include "net_loop.h"
+#include "net_transport.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/*
+ * RPC server implementation
+ *
+ * A request becomes a job on the I/O thread that read it: the frame is
+ * received straight into the job, decoded there and pushed onto one
+ * worker's queue. The worker runs the handler under the server's
+ * reader/writer lock, serializes the response into the same job and
+ * hands it back to the job's I/O thread through a mutex-protected
+ * completion list and an eventfd. Jobs are allocated and freed only by
+ * their I/O thread, so it keeps them on a private free list.
+ *
+ * Worker queues are small mutex-protected rings: the owner takes from
+ * the head (oldest first) and thieves take from the tail. An atomic
+ * count of queued jobs lets an idle worker go to sleep on a condition
+ * variable without missing a submit: the submitter publishes the job
+ * before reading the sleeper count, the worker announces itself before
+ * reading the job count.
+ *
+ * A BATCH is one job: the worker decodes it again on its own thread
+ * (JSON decodes into thread-local scratch), runs each record's handler
+ * under that record's lock and collects the responses into a
+ * BATCH_RESPONSE in the job. Responses that do not fit go into further
+ * BATCH_RESPONSE frames chained to the job.
+ *
+ * A connection counts its jobs in flight. Closing it (peer hang-up,
+ * send failure) unwatches and closes the socket at once but frees it
+ * only when the last job comes back.
+ */
+
+#define SERVER_QUEUE_INITIAL 64
+
+typedef struct server_io server_io_t;
+typedef struct server_conn server_conn_t;
+
+typedef struct {
+    net_server_handler_t handler;
+    void *context;
+    net_server_access_t access;
+} server_route_t;
+
+typedef struct server_spill {
+    struct server_spill *next;
+    size_t len;
+    uint8_t data[NET_PROTOCOL_MAX_FRAME];
+} server_spill_t;
+
+typedef struct server_job {
+    struct server_job *next;
+    server_conn_t *conn;
+    const server_route_t *route;    /* NULL for a BATCH */
+    server_spill_t *spill;          /* Further response frames */
+    net_frame_view_t view;
+    size_t len;                     /* Request length, then response length */
+    char node_id[NET_PROTOCOL_MAX_NODE_ID];
+    char node_url[NET_PROTOCOL_MAX_URL];
+    uint8_t data[NET_PROTOCOL_MAX_FRAME];
+    uint8_t reply[NET_PROTOCOL_MAX_FRAME];
+} server_job_t;
+
+struct server_conn {
+    server_conn_t *prev;            /* I/O thread's connection list */
+    server_conn_t *next;
+    server_conn_t *handoff;         /* Pending adoption by its I/O thread */
+    server_io_t *io;
+    net_transport_t *transport;
+    net_watch_t watch;
+    int jobs;                       /* Jobs in flight */
+    int closed;
+};
+
+struct server_io {
+    net_server_t *server;
+    pthread_t thread;
+    net_loop_t *loop;
+    int wake_fd;                    /* eventfd */
+    net_watch_t wake_watch;
+    server_conn_t *conns;
+    server_job_t *free_jobs;
+
+    pthread_mutex_t lock;           /* Guards the two lists below */
+    server_job_t *done;             /* Completed jobs, newest first */
+    server_conn_t *adopt;           /* Connections handed over by the acceptor */
+};
+
+typedef struct {
+    net_server_t *server;
+    int index;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    server_job_t **jobs;            /* Ring of capacity mask + 1 */
+    size_t mask;
+    size_t head;
+    size_t count;
+} server_worker_t;
+
+struct net_server {
+    net_server_config_t config;
+    server_route_t routes[256];
+    net_transport_listener_t *listener;
+    server_io_t *io;
+    server_worker_t *workers;
+    unsigned next_io;               /* Acceptor's round-robin cursor */
+    _Atomic unsigned next_worker;   /* I/O threads' round-robin cursor */
+    int running;
+
+    pthread_rwlock_t state_lock;    /* Readers share, writers run alone */
+
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    _Atomic size_t queued;
+    _Atomic int sleepers;
+    _Atomic int stopping;
+
+    _Atomic uint64_t connections;
+    _Atomic uint64_t requests;
+    _Atomic uint64_t errors;
+    _Atomic uint64_t steals;
+    _Atomic uint64_t batches;
+};
+
+/*
+ * Worker pool
+ */
+
+static int worker_push(server_worker_t *worker, server_job_t *job) {
+    pthread_mutex_lock(&worker->lock);
+    if (worker->count > worker->mask) {
+        size_t size = (worker->mask + 1) * 2;
+        server_job_t **jobs = (server_job_t**)malloc(size * sizeof(server_job_t*));
+
+        if (!jobs) {
+            pthread_mutex_unlock(&worker->lock);
+            return -1;
+        }
+        for (size_t i = 0; i < worker->count; i++) {
+            jobs[i] = worker->jobs[(worker->head + i) & worker->mask];
+        }
+        free(worker->jobs);
+        worker->jobs = jobs;
+        worker->mask = size - 1;
+        worker->head = 0;
+    }
+    worker->jobs[(worker->head + worker->count) & worker->mask] = job;
+    worker->count++;
+    pthread_mutex_unlock(&worker->lock);
+    return 0;
+}
+
+/* Oldest job for the owner, newest for a thief */
+static server_job_t* worker_take(server_worker_t *worker, int steal) {
+    server_job_t *job = NULL;
+
+    pthread_mutex_lock(&worker->lock);
+    if (worker->count > 0) {
+        if (steal) {
+            job = worker->jobs[(worker->head + worker->count - 1) & worker->mask];
+        } else {
+            job = worker->jobs[worker->head];
+            worker->head = (worker->head + 1) & worker->mask;
+        }
+        worker->count--;
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return job;
+}
+
+static server_job_t* worker_next(server_worker_t *worker) {
+    net_server_t *server = worker->server;
+    int workers = server->config.workers;
+    server_job_t *job = worker_take(worker, 0);
+
+    for (int i = 1; !job && i < workers; i++) {
+        job = worker_take(&server->workers[(worker->index + i) % workers], 1);
+        if (job) {
+            atomic_fetch_add(&server->steals, 1);
+        }
+    }
+    if (job) {
+        atomic_fetch_sub(&server->queued, 1);
+    }
+    return job;
+}
+
+static int server_submit(net_server_t *server, server_job_t *job) {
+    unsigned index = atomic_fetch_add_explicit(&server->next_worker, 1, memory_order_relaxed) %
+                     (unsigned)server->config.workers;
+
+    if (worker_push(&server->workers[index], job) != 0) {
+        return -1;
+    }
+    atomic_fetch_add(&server->queued, 1);
+    if (atomic_load(&server->sleepers) > 0) {
+        pthread_mutex_lock(&server->idle_lock);
+        pthread_cond_signal(&server->idle_cond);
+        pthread_mutex_unlock(&server->idle_lock);
+    }
+    return 0;
+}
+
+static void job_complete(server_job_t *job);
+
+/* Run request's handler and serialize its response into frame.
+ * Returns the length, or 0 for nothing to send. */
+static size_t job_answer(net_server_t *server, const server_route_t *route,
+                         const net_frame_view_t *request, uint8_t *frame, size_t frame_size) {
+    uint32_t request_id = request->header.request_id;
+    net_message_t response;
+    int err = NET_ERR_INVALID_MESSAGE;
+    int len;
+
+    memset(&response, 0, sizeof(response));
+    net_protocol_init_message(&response, (net_msg_type_t)(request->header.msg_type + 1), request_id);
+    if (route->handler) {
+        if (route->access == NET_SERVER_WRITE) {
+            pthread_rwlock_wrlock(&server->state_lock);
+        } else {
+            pthread_rwlock_rdlock(&server->state_lock);
+        }
+        err = route->handler(route->context, request, &response);
+        pthread_rwlock_unlock(&server->state_lock);
+    }
+    atomic_fetch_add(&server->requests, 1);
+
+    if (err == NET_SERVER_NO_REPLY) {
+        return 0;
+    }
+    if (err != NET_ERR_OK) {
+        net_protocol_create_error(&response, request_id, (net_error_t)err, "request failed");
+        atomic_fetch_add(&server->errors, 1);
+    }
+    len = net_protocol_serialize(&response, frame, frame_size);
+    return len > 0 ? (size_t)len : 0;
+}
+
+/* Encode the responses collected in batch into the job's reply, or a
+ * new spill frame once the reply is taken (a lone one goes out bare) */
+static void job_emit_batch(server_job_t *job, net_batch_t *batch, server_spill_t ***tail) {
+    uint8_t *frame = job->reply;
+    size_t *len = &job->len;
+    const uint8_t *record;
+    size_t record_len;
+    size_t offset = 0;
+    int n;
+
+    if (batch->count == 0) {
+        return;
+    }
+    if (job->len > 0) {
+        server_spill_t *spill = (server_spill_t*)malloc(sizeof(server_spill_t));
+
+        if (!spill) {
+            net_protocol_batch_init(batch);
+            return;
+        }
+        spill->next = NULL;
+        spill->len = 0;
+        **tail = spill;
+        *tail = &spill->next;
+        frame = spill->data;
+        len = &spill->len;
+    }
+
+    if (batch->count == 1) {
+        net_protocol_batch_next(batch->data, batch->len, &offset, &record, &record_len);
+        memcpy(frame, record, record_len);
+        *len = record_len;
+    } else {
+        n = net_protocol_encode_batch(frame, NET_PROTOCOL_MAX_FRAME, NET_MSG_BATCH_RESPONSE,
+                                      job->view.header.request_id, batch);
+        *len = n > 0 ? (size_t)n : 0;
+    }
+    net_protocol_batch_init(batch);
+}
+
+static void job_run_batch(net_server_t *server, server_job_t *job) {
+    static _Thread_local net_batch_t records;
+    static _Thread_local net_batch_t responses;
+    static const server_route_t unrouted;
+    server_spill_t **tail = &job->spill;
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+    net_frame_view_t batch;
+    const uint8_t *record;
+    size_t record_len;
+    size_t offset = 0;
+
+    int err = net_protocol_decode_view(&batch, job->data, job->len);
+
+    job->len = 0;
+    if (err != NET_ERR_OK) {
+        return;
+    }
+    /* Copied: decoding a JSON record reuses the scratch batch.frame is in */
+    memcpy(records.data, batch.frame, batch.frame_len);
+    records.len = batch.frame_len;
+    net_protocol_batch_init(&responses);
+    atomic_fetch_add(&server->batches, 1);
+
+    while (net_protocol_batch_next(records.data, records.len, &offset, &record, &record_len)) {
+        const server_route_t *route = &unrouted;
+        net_frame_view_t request;
+        size_t len;
+
+        if (net_protocol_decode_view(&request, record, record_len) != NET_ERR_OK) {
+            continue;
+        }
+        if (request.header.msg_type != NET_MSG_BATCH) {
+            route = &server->routes[request.header.msg_type];
+        }
+        len = job_answer(server, route, &request, frame, sizeof(frame));
+        if (len > 0 && net_protocol_batch_add(&responses, frame, len) != 0) {
+            job_emit_batch(job, &responses, &tail);
+            net_protocol_batch_add(&responses, frame, len);
+        }
+    }
+    job_emit_batch(job, &responses, &tail);
+}
+
+static void job_run(net_server_t *server, server_job_t *job) {
+    if (job->route) {
+        job->len = job_answer(server, job->route, &job->view, job->reply, sizeof(job->reply));
+    } else {
+        job_run_batch(server, job);
+    }
+    job_complete(job);
+}
+
+static void* worker_main(void *arg) {
+    server_worker_t *worker = (server_worker_t*)arg;
+    net_server_t *server = worker->server;
+
+    for (;;) {
+        server_job_t *job = worker_next(worker);
+
+        if (job) {
+            job_run(server, job);
+            continue;
+        }
+
+        pthread_mutex_lock(&server->idle_lock);
+        atomic_fetch_add(&server->sleepers, 1);
+        while (atomic_load(&server->queued) == 0 && !atomic_load(&server->stopping)) {
+            pthread_cond_wait(&server->idle_cond, &server->idle_lock);
+        }
+        atomic_fetch_sub(&server->sleepers, 1);
+        pthread_mutex_unlock(&server->idle_lock);
+
+        if (atomic_load(&server->queued) == 0 && atomic_load(&server->stopping)) {
+            return NULL;
+        }
+    }
+}
+
+/*
+ * Connections (owned by their I/O thread)
+ */
+
+static void io_wake(server_io_t *io) {
+    uint64_t one = 1;
+
+    if (write(io->wake_fd, &one, sizeof(one)) < 0) {
+        /* Counter saturated: a wake-up is already pending */
+    }
+}
+
+static void conn_free_if_done(server_conn_t *conn) {
+    if (conn->closed && conn->jobs == 0) {
+        net_transport_destroy(conn->transport);
+        free(conn);
+    }
+}
+
+static void conn_close(server_conn_t *conn) {
+    server_io_t *io = conn->io;
+
+    if (conn->closed) {
+        return;
+    }
+    conn->closed = 1;
+    net_loop_unwatch(io->loop, &conn->watch);
+    net_transport_close(conn->transport);
+    if (conn->prev) {
+        conn->prev->next = conn->next;
+    } else {
+        io->conns = conn->next;
+    }
+    if (conn->next) {
+        conn->next->prev = conn->prev;
+    }
+    conn_free_if_done(conn);
+}
+
+static void conn_send(server_conn_t *conn, const void *frame, size_t len) {
+    if (!conn->closed && len > 0 &&
+        net_transport_send(conn->transport, frame, len, NET_SERVER_SEND_TIMEOUT_MS) != 0) {
+        conn_close(conn);
+    }
+}
+
+static server_job_t* io_job_alloc(server_io_t *io) {
+    server_job_t *job = io->free_jobs;
+
+    if (job) {
+        io->free_jobs = job->next;
+        return job;
+    }
+    return (server_job_t*)malloc(sizeof(server_job_t));
+}
+
+static void io_job_free(server_io_t *io, server_job_t *job) {
+    job->next = io->free_jobs;
+    io->free_jobs = job;
+}
+
+/* Worker side: hand a finished job back to its I/O thread */
+static void job_complete(server_job_t *job) {
+    server_io_t *io = job->conn->io;
+    int was_empty;
+
+    pthread_mutex_lock(&io->lock);
+    was_empty = io->done == NULL;
+    job->next = io->done;
+    io->done = job;
+    pthread_mutex_unlock(&io->lock);
+    if (was_empty) {
+        io_wake(io);
+    }
+}
+
+/* Copy strings a JSON decode left in thread-local scratch into the job */
+static void job_pin_view(server_job_t *job) {
+    net_node_view_t *node = &job->view.node;
+    const uint8_t *begin = job->data;
+    const uint8_t *end = job->data + job->len;
+
+    if (!job->view.has_node ||
+        ((const uint8_t*)node->id >= begin && (const uint8_t*)node->id < end)) {
+        return;
+    }
+    if (node->id_len > sizeof(job->node_id)) {
+        node->id_len = sizeof(job->node_id);
+    }
+    if (node->url_len > sizeof(job->node_url)) {
+        node->url_len = sizeof(job->node_url);
+    }
+    memcpy(job->node_id, node->id, node->id_len);
+    memcpy(job->node_url, node->url, node->url_len);
+    node->id = job->node_id;
+    node->url = job->node_url;
+}
+
+static void conn_reply_error(server_conn_t *conn, uint32_t request_id, int code) {
+    net_server_t *server = conn->io->server;
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+    net_message_t error;
+    int len;
+
+    net_protocol_create_error(&error, request_id, (net_error_t)code, "request refused");
+    len = net_protocol_serialize(&error, frame, sizeof(frame));
+    atomic_fetch_add(&server->errors, 1);
+    if (len > 0) {
+        conn_send(conn, frame, (size_t)len);
+    }
+}
+
+static void conn_on_ready(void *context, uint32_t events) {
+    server_conn_t *conn = (server_conn_t*)context;
+    server_io_t *io = conn->io;
+    net_server_t *server = io->server;
+
+    (void)events;
+    while (!conn->closed) {
+        server_job_t *job = io_job_alloc(io);
+        int n;
+        int err;
+
+        if (!job) {
+            return;  /* Level-triggered: retried on the next wakeup */
+        }
+        n = net_transport_recv(conn->transport, job->data, sizeof(job->data), 0);
+        if (n < 0) {
+            io_job_free(io, job);
+            if (errno == EMSGSIZE) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                conn_close(conn);
+            }
+            return;
+        }
+
+        job->len = (size_t)n;
+        memset(&job->view, 0, sizeof(job->view));
+        err = net_protocol_decode_view(&job->view, job->data, job->len);
+        job->spill = NULL;
+        if (err == NET_ERR_OK && job->view.header.msg_type == NET_MSG_BATCH) {
+            job->route = NULL;  /* Routed record by record on the worker */
+        } else if (err == NET_ERR_OK) {
+            job->route = &server->routes[job->view.header.msg_type];
+            if (!job->route->handler) {
+                err = NET_ERR_INVALID_MESSAGE;
+            }
+        }
+        if (err != NET_ERR_OK) {
+            conn_reply_error(conn, job->view.header.request_id, err);
+            io_job_free(io, job);
+            continue;
+        }
+
+        job_pin_view(job);
+        job->conn = conn;
+        if (server_submit(server, job) != 0) {
+            conn_reply_error(conn, job->view.header.request_id, NET_ERR_INTERNAL);
+            io_job_free(io, job);
+            continue;
+        }
+        conn->jobs++;
+    }
+}
+
+static void io_adopt(server_io_t *io, server_conn_t *conn) {
+    int fd = net_transport_fd(conn->transport);
+
+    conn->io = io;
+    if (fd < 0 ||
+        net_loop_watch(io->loop, &conn->watch, fd, EPOLLIN, conn_on_ready, conn) != 0) {
+        net_transport_destroy(conn->transport);
+        free(conn);
+        return;
+    }
+    conn->prev = NULL;
+    conn->next = io->conns;
+    if (io->conns) {
+        io->conns->prev = conn;
+    }
+    io->conns = conn;
+}
+
+/* Acceptor (first I/O thread) */
+static void server_on_accept(net_transport_t *client, void *context) {
+    net_server_t *server = (net_server_t*)context;
+    server_io_t *io = &server->io[server->next_io++ % (unsigned)server->config.io_threads];
+    server_conn_t *conn = (server_conn_t*)calloc(1, sizeof(server_conn_t));
+
+    if (!conn) {
+        net_transport_destroy(client);
+        return;
+    }
+    conn->transport = client;
+    atomic_fetch_add(&server->connections, 1);
+    if (io == &server->io[0]) {
+        io_adopt(io, conn);
+        return;
+    }
+    pthread_mutex_lock(&io->lock);
+    conn->handoff = io->adopt;
+    io->adopt = conn;
+    pthread_mutex_unlock(&io->lock);
+    io_wake(io);
+}
+
+static void io_on_wake(void *context, uint32_t events) {
+    server_io_t *io = (server_io_t*)context;
+    server_job_t *done;
+    server_conn_t *adopt;
+    server_job_t *ordered = NULL;
+    uint64_t count;
+
+    (void)events;
+    if (read(io->wake_fd, &count, sizeof(count)) < 0) {
+        /* Nothing pending (EAGAIN) */
+    }
+
+    pthread_mutex_lock(&io->lock);
+    done = io->done;
+    adopt = io->adopt;
+    io->done = NULL;
+    io->adopt = NULL;
+    pthread_mutex_unlock(&io->lock);
+
+    while (adopt) {
+        server_conn_t *next = adopt->handoff;
+        io_adopt(io, adopt);
+        adopt = next;
+    }
+
+    /* Completions were pushed newest first; answer oldest first */
+    while (done) {
+        server_job_t *next = done->next;
+        done->next = ordered;
+        ordered = done;
+        done = next;
+    }
+    while (ordered) {
+        server_job_t *job = ordered;
+        server_conn_t *conn = job->conn;
+
+        ordered = job->next;
+        conn_send(conn, job->reply, job->len);
+        while (job->spill) {
+            server_spill_t *spill = job->spill;
+
+            job->spill = spill->next;
+            conn_send(conn, spill->data, spill->len);
+            free(spill);
+        }
+        conn->jobs--;
+        conn_free_if_done(conn);
+        io_job_free(io, job);
+    }
+}
+
+static void* io_main(void *arg) {
+    server_io_t *io = (server_io_t*)arg;
+
+    while (!atomic_load(&io->server->stopping)) {
+        if (net_loop_run_once(io->loop, -1) < 0 && errno != EINTR) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Server
+ */
+
+void net_server_config_default(net_server_config_t *config) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    config->io_threads = 1;
+    config->workers = cpus > 0 ? (int)cpus : 1;
+}
+
+static void server_free_io(server_io_t *io) {
+    while (io->conns) {
+        conn_close(io->conns);
+    }
+    while (io->free_jobs) {
+        server_job_t *next = io->free_jobs->next;
+        free(io->free_jobs);
+        io->free_jobs = next;
+    }
+    if (io->wake_fd >= 0) {
+        net_loop_unwatch(io->loop, &io->wake_watch);
+        close(io->wake_fd);
+    }
+    net_loop_destroy(io->loop);
+    pthread_mutex_destroy(&io->lock);
+}
+
+net_server_t* net_server_create(const net_server_config_t *config) {
+    net_server_t *server;
+    pthread_rwlockattr_t attr;
+
+    if (!config || config->io_threads < 1 || config->workers < 1) {
+        return NULL;
+    }
+    server = (net_server_t*)calloc(1, sizeof(net_server_t));
+    if (!server) {
+        return NULL;
+    }
+    server->config = *config;
+    server->io = (server_io_t*)calloc((size_t)config->io_threads, sizeof(server_io_t));
+    server->workers = (server_worker_t*)calloc((size_t)config->workers, sizeof(server_worker_t));
+    if (!server->io || !server->workers) {
+        free(server->io);
+        free(server->workers);
+        free(server);
+        return NULL;
+    }
+
+    /* Writers first: a stream of lookups must not starve NOTIFY */
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&server->state_lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    pthread_mutex_init(&server->idle_lock, NULL);
+    pthread_cond_init(&server->idle_cond, NULL);
+
+    for (int i = 0; i < config->workers; i++) {
+        server_worker_t *worker = &server->workers[i];
+        worker->server = server;
+        worker->index = i;
+        pthread_mutex_init(&worker->lock, NULL);
+    }
+    for (int i = 0; i < config->io_threads; i++) {
+        server_io_t *io = &server->io[i];
+        io->server = server;
+        io->wake_fd = -1;
+        pthread_mutex_init(&io->lock, NULL);
+    }
+
+    for (int i = 0; i < config->workers; i++) {
+        server_worker_t *worker = &server->workers[i];
+        worker->jobs = (server_job_t**)malloc(SERVER_QUEUE_INITIAL * sizeof(server_job_t*));
+        worker->mask = SERVER_QUEUE_INITIAL - 1;
+        if (!worker->jobs) {
+            net_server_destroy(server);
+            return NULL;
+        }
+    }
+    for (int i = 0; i < config->io_threads; i++) {
+        server_io_t *io = &server->io[i];
+        io->loop = net_loop_create();
+        io->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (!io->loop || io->wake_fd < 0 ||
+            net_loop_watch(io->loop, &io->wake_watch, io->wake_fd, EPOLLIN, io_on_wake, io) != 0) {
+            net_server_destroy(server);
+            return NULL;
+        }
+    }
+    return server;
+}
+
+void net_server_destroy(net_server_t *server) {
+    if (!server) {
+        return;
+    }
+    net_server_stop(server);
+    net_transport_listener_destroy(server->listener);
+    for (int i = 0; i < server->config.io_threads; i++) {
+        server_free_io(&server->io[i]);
+    }
+    for (int i = 0; i < server->config.workers; i++) {
+        free(server->workers[i].jobs);
+        pthread_mutex_destroy(&server->workers[i].lock);
+    }
+    pthread_cond_destroy(&server->idle_cond);
+    pthread_mutex_destroy(&server->idle_lock);
+    pthread_rwlock_destroy(&server->state_lock);
+    free(server->io);
+    free(server->workers);
+    free(server);
+}
+
+int net_server_handle(net_server_t *server, net_msg_type_t type, net_server_access_t access,
+                      net_server_handler_t handler, void *context) {
+    /* Requests have odd types, their responses the next even one */
+    if (!server || !handler || type == NET_MSG_ERROR || !(type & 1)) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+    server->routes[type].handler = handler;
+    server->routes[type].context = context;
+    server->routes[type].access = access;
+    return NET_ERR_OK;
+}
+
+int net_server_listen(net_server_t *server, const char *url) {
+    net_transport_type_t type;
+
+    if (!server || !url || server->listener || server->running) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (net_transport_url_type(url, &type) != 0) {
+        return -1;
+    }
+
+    server->listener = net_transport_listener_create(type);
+    if (!server->listener ||
+        net_transport_listener_listen(server->listener, url) != 0 ||
+        net_transport_listener_attach(server->listener, server->io[0].loop,
+                                      server_on_accept, server) != 0) {
+        int err = errno;
+        net_transport_listener_destroy(server->listener);
+        server->listener = NULL;
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+const char* net_server_url(const net_server_t *server) {
+    return server && server->listener ? net_transport_listener_url(server->listener) : NULL;
+}
+
+/* Stop and join the first io_threads I/O threads and workers workers */
+static void server_join(net_server_t *server, int io_threads, int workers) {
+    atomic_store(&server->stopping, 1);
+
+    /* I/O threads first, so no new jobs arrive */
+    for (int i = 0; i < io_threads; i++) {
+        io_wake(&server->io[i]);
+    }
+    for (int i = 0; i < io_threads; i++) {
+        pthread_join(server->io[i].thread, NULL);
+    }
+
+    /* Workers drain the queues and exit */
+    pthread_mutex_lock(&server->idle_lock);
+    pthread_cond_broadcast(&server->idle_cond);
+    pthread_mutex_unlock(&server->idle_lock);
+    for (int i = 0; i < workers; i++) {
+        pthread_join(server->workers[i].thread, NULL);
+    }
+
+    /* Deliver what the workers finished after the I/O threads left */
+    for (int i = 0; i < server->config.io_threads; i++) {
+        io_on_wake(&server->io[i], 0);
+    }
+}
+
+int net_server_start(net_server_t *server) {
+    int workers = 0;
+    int ios = 0;
+
+    if (!server || server->running) {
+        errno = EINVAL;
+        return -1;
+    }
+    atomic_store(&server->stopping, 0);
+    while (workers < server->config.workers &&
+           pthread_create(&server->workers[workers].thread, NULL, worker_main,
+                          &server->workers[workers]) == 0) {
+        workers++;
+    }
+    while (workers == server->config.workers && ios < server->config.io_threads &&
+           pthread_create(&server->io[ios].thread, NULL, io_main, &server->io[ios]) == 0) {
+        ios++;
+    }
+    if (ios < server->config.io_threads) {
+        server_join(server, ios, workers);
+        errno = EAGAIN;
+        return -1;
+    }
+    server->running = 1;
+    return 0;
+}
+
+void net_server_stop(net_server_t *server) {
+    if (!server || !server->running) {
+        return;
+    }
+    server_join(server, server->config.io_threads, server->config.workers);
+    server->running = 0;
+}
+
+void net_server_lock(net_server_t *server, net_server_access_t access) {
+    if (access == NET_SERVER_WRITE) {
+        pthread_rwlock_wrlock(&server->state_lock);
+    } else {
+        pthread_rwlock_rdlock(&server->state_lock);
+    }
+}
+
+void net_server_unlock(net_server_t *server) {
+    pthread_rwlock_unlock(&server->state_lock);
+}
+
+void net_server_get_stats(const net_server_t *server, net_server_stats_t *stats) {
+    stats->connections = atomic_load(&server->connections);
+    stats->requests = atomic_load(&server->requests);
+    stats->errors = atomic_load(&server->errors);
+    stats->steals = atomic_load(&server->steals);
+    stats->batches = atomic_load(&server->batches);
+}
@@ -0,0 +1,107 @@
+#ifndef NET_SERVER_H
+#define NET_SERVER_H
+
+#include <stdint.h>
+#include "net_protocol.h"
+
+/*
+ * RPC Server
+ *
+ * Serves request frames arriving on net_transport connections with a
+ * handler per message type, on two sets of threads:
+ * - I/O threads each run a net_loop. The first also accepts
+ *   connections and deals them out round-robin; a connection then
+ *   stays on its I/O thread, which reads its frames, decodes them and
+ *   writes back the responses.
+ * - Worker threads run the handlers. Each worker has its own queue;
+ *   I/O threads deal requests out round-robin and a worker whose queue
+ *   is empty steals from the others before it sleeps, so one slow
+ *   handler does not hold up the requests queued behind it.
+ *
+ * Handlers are registered as NET_SERVER_READ (may run in parallel with
+ * other readers: lookups, GET_*, PING) or NET_SERVER_WRITE (runs alone:
+ * NOTIFY and anything else that changes node state). Responses to one
+ * connection may leave in a different order from the requests; clients
+ * match them by request_id. The records of a BATCH are handled in order
+ * by one worker, each under its own type's lock, and answered together
+ * in BATCH_RESPONSE frames.
+ *
+ * Connections are served through epoll, so sockets accepted while the
+ * io_uring backend is selected are refused.
+ *
+ * Usage: create, register handlers, listen, start; stop and destroy
+ * from the thread that created the server.
+ */
+
+/* Longest a response may wait for socket space before the connection
+ * is dropped */
+#define NET_SERVER_SEND_TIMEOUT_MS 1000
+
+typedef struct net_server net_server_t;
+
+/* Returned by a handler of a one-way message: nothing is sent back */
+#define NET_SERVER_NO_REPLY (-1)
+
+/* Fill response (its header is already set) for request. Return
+ * NET_ERR_OK to send it, NET_SERVER_NO_REPLY to send nothing; any other
+ * code is sent back as an ERROR message. request is only valid during
+ * the call. */
+typedef int (*net_server_handler_t)(void *context, const net_frame_view_t *request,
+                                    net_message_t *response);
+
+typedef enum {
+    NET_SERVER_READ,                /* Shared: runs alongside other readers */
+    NET_SERVER_WRITE                /* Exclusive: runs alone */
+} net_server_access_t;
+
+typedef struct {
+    int io_threads;                 /* Threads doing socket I/O */
+    int workers;                    /* Threads running handlers */
+} net_server_config_t;
+
+typedef struct {
+    uint64_t connections;           /* Connections accepted */
+    uint64_t requests;              /* Requests handled */
+    uint64_t errors;                /* ERROR responses sent */
+    uint64_t steals;                /* Requests run by a worker they were not given to */
+    uint64_t batches;               /* BATCH frames served (their records count as requests) */
+} net_server_stats_t;
+
+/* Default configuration (1 I/O thread, one worker per online CPU) */
+void net_server_config_default(net_server_config_t *config);
+
+/* Create server (NULL on failure) */
+net_server_t* net_server_create(const net_server_config_t *config);
+
+/* Stop if running, close every connection and free the server */
+void net_server_destroy(net_server_t *server);
+
+/* Serve requests of type with handler (before net_server_start).
+ * Returns NET_ERR_OK or NET_ERR_INVALID_MESSAGE for a non-request
+ * type. Unregistered types are answered with NET_ERR_INVALID_MESSAGE. */
+int net_server_handle(net_server_t *server, net_msg_type_t type, net_server_access_t access,
+                      net_server_handler_t handler, void *context);
+
+/* Listen on url (tcp:// or ipc://; before net_server_start).
+ * Returns 0 or -1 with errno set. */
+int net_server_listen(net_server_t *server, const char *url);
+
+/* URL actually bound, with the chosen port filled in */
+const char* net_server_url(const net_server_t *server);
+
+/* Start the I/O and worker threads. Returns 0 or -1 with errno set. */
+int net_server_start(net_server_t *server);
+
+/* Stop accepting, finish the requests already queued and join the
+ * threads */
+void net_server_stop(net_server_t *server);
+
+/* Take the lock handlers run under, to read or change node state from
+ * outside a handler. Do not call from a handler. */
+void net_server_lock(net_server_t *server, net_server_access_t access);
+void net_server_unlock(net_server_t *server);
+
+/* Counters (safe to read while running) */
+void net_server_get_stats(const net_server_t *server, net_server_stats_t *stats);
+
+#endif /* NET_SERVER_H */
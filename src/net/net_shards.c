@@ -0,0 +1,353 @@
+#define _GNU_SOURCE
+
+#include "net_shards.h"
+#include "ring.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/*
+ * Sharded runtime implementation
+ *
+ * Inboxes are intrusive Vyukov MPSC queues: a producer swaps itself in
+ * as the head and then links the previous head to it, the shard pops
+ * from the tail. A producer caught between those two steps hides the
+ * rest of the queue for a moment; its wake-up follows the link, so the
+ * shard drains again. The wake-up is an eventfd write made only by the
+ * producer that finds the shard's signalled flag clear; the shard
+ * clears the flag before each drain.
+ *
+ * Shards are cache-line aligned and their counters are written only by
+ * their own thread (relaxed load and store, no locked add), so shards
+ * share no written line in the steady state.
+ */
+
+#define SHARDS_MAX_HOPS (KEY_BITS * 2)
+
+typedef struct {
+    alignas(64) net_shard_lookup_t *_Atomic head;    /* Producers */
+    alignas(64) net_shard_lookup_t *tail;            /* Owner only */
+    net_shard_lookup_t stub;
+    _Atomic int signalled;
+    int wake_fd;
+    net_watch_t wake_watch;
+    net_shards_t *shards;
+    unsigned index;
+    net_loop_t *loop;
+    net_host_t *host;
+    pthread_t thread;
+    _Atomic uint64_t steps;
+    _Atomic uint64_t received;
+    _Atomic uint64_t completed;
+    _Atomic uint64_t wakeups;
+} net_shard_t;
+
+struct net_shards {
+    net_shard_t *shards;
+    unsigned count;
+    unsigned threads;               /* Shard threads running */
+    int key_max;
+    _Atomic int stopping;
+};
+
+/* Owner-only counter bump (readers on other threads see whole values) */
+static void shard_count(_Atomic uint64_t *counter, uint64_t n) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
+/*
+ * Inbox
+ */
+
+static void inbox_init(net_shard_t *shard) {
+    atomic_store_explicit(&shard->stub.next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&shard->head, &shard->stub, memory_order_relaxed);
+    shard->tail = &shard->stub;
+}
+
+static void inbox_push(net_shard_t *shard, net_shard_lookup_t *lookup) {
+    net_shard_lookup_t *prev;
+
+    atomic_store_explicit(&lookup->next, NULL, memory_order_relaxed);
+    prev = atomic_exchange_explicit(&shard->head, lookup, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, lookup, memory_order_release);
+}
+
+/* Oldest lookup, or NULL if empty (or a push is half done) */
+static net_shard_lookup_t* inbox_pop(net_shard_t *shard) {
+    net_shard_lookup_t *tail = shard->tail;
+    net_shard_lookup_t *next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+    if (tail == &shard->stub) {
+        if (!next) {
+            return NULL;
+        }
+        shard->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    }
+    if (next) {
+        shard->tail = next;
+        return tail;
+    }
+    if (tail != atomic_load_explicit(&shard->head, memory_order_acquire)) {
+        return NULL;
+    }
+    /* tail is the last one: put the stub behind it so it can leave */
+    inbox_push(shard, &shard->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next) {
+        shard->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+static void shard_post(net_shard_t *shard, net_shard_lookup_t *lookup) {
+    uint64_t one = 1;
+
+    inbox_push(shard, lookup);
+    if (atomic_exchange(&shard->signalled, 1) == 0 &&
+        write(shard->wake_fd, &one, sizeof(one)) < 0) {
+        /* Counter saturated: a wake-up is already pending */
+    }
+}
+
+/*
+ * Routing
+ */
+
+/* Run lookup's steps while they stay on shard, then complete it or
+ * hand it on. The lookup is not touched after either. */
+static void shard_route(net_shard_t *shard, net_shard_lookup_t *lookup) {
+    net_shards_t *shards = shard->shards;
+    uint64_t steps = 0;
+
+    for (;;) {
+        int done;
+        Node *next;
+        unsigned owner;
+
+        if (lookup->hops >= SHARDS_MAX_HOPS) {
+            shard_count(&shard->steps, steps);
+            shard_count(&shard->completed, 1);
+            lookup->callback(lookup, NET_ERR_INTERNAL);
+            return;
+        }
+        next = node_next_hop(lookup->at, lookup->key, &done);
+        lookup->hops++;
+        steps++;
+        if (done) {
+            lookup->result = next;
+            shard_count(&shard->steps, steps);
+            shard_count(&shard->completed, 1);
+            lookup->callback(lookup, NET_ERR_OK);
+            return;
+        }
+
+        lookup->at = next;
+        owner = net_shards_owner(shards, next->key);
+        if (owner != shard->index) {
+            lookup->crossings++;
+            shard_count(&shard->steps, steps);
+            shard_post(&shards->shards[owner], lookup);
+            return;
+        }
+    }
+}
+
+static void shard_on_wake(void *context, uint32_t events) {
+    net_shard_t *shard = (net_shard_t*)context;
+    net_shard_lookup_t *lookup;
+    uint64_t count;
+    uint64_t received = 0;
+
+    (void)events;
+    if (read(shard->wake_fd, &count, sizeof(count)) < 0) {
+        /* Nothing pending (EAGAIN) */
+    }
+    atomic_store(&shard->signalled, 0);
+    while ((lookup = inbox_pop(shard)) != NULL) {
+        received++;
+        shard_route(shard, lookup);
+    }
+    shard_count(&shard->received, received);
+    shard_count(&shard->wakeups, 1);
+}
+
+static void* shard_main(void *arg) {
+    net_shard_t *shard = (net_shard_t*)arg;
+
+    while (!atomic_load(&shard->shards->stopping)) {
+        if (net_loop_run_once(shard->loop, -1) < 0 && errno != EINTR) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Runtime API
+ */
+
+net_shards_t* net_shards_create(unsigned count, const char *base_url) {
+    net_shards_t *shards;
+    char url[NET_PROTOCOL_MAX_URL];
+
+    if (count == 0 || !base_url) {
+        errno = EINVAL;
+        return NULL;
+    }
+    shards = (net_shards_t*)calloc(1, sizeof(net_shards_t));
+    if (!shards) {
+        return NULL;
+    }
+    shards->shards = (net_shard_t*)aligned_alloc(alignof(net_shard_t), count * sizeof(net_shard_t));
+    if (!shards->shards) {
+        free(shards);
+        return NULL;
+    }
+    memset(shards->shards, 0, count * sizeof(net_shard_t));
+    shards->count = count;
+    shards->key_max = ring_key_max();
+
+    for (unsigned i = 0; i < count; i++) {
+        net_shard_t *shard = &shards->shards[i];
+
+        shard->shards = shards;
+        shard->index = i;
+        shard->wake_fd = -1;
+        inbox_init(shard);
+    }
+    for (unsigned i = 0; i < count; i++) {
+        net_shard_t *shard = &shards->shards[i];
+
+        snprintf(url, sizeof(url), "%s/%u", base_url, i);
+        shard->loop = net_loop_create();
+        shard->host = shard->loop ? net_host_create(shard->loop, url, NULL) : NULL;
+        shard->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (!shard->host || shard->wake_fd < 0 ||
+            net_loop_watch(shard->loop, &shard->wake_watch, shard->wake_fd, EPOLLIN,
+                           shard_on_wake, shard) != 0) {
+            net_shards_destroy(shards);
+            return NULL;
+        }
+    }
+    return shards;
+}
+
+void net_shards_destroy(net_shards_t *shards) {
+    if (!shards) {
+        return;
+    }
+    net_shards_stop(shards);
+    for (unsigned i = 0; i < shards->count; i++) {
+        net_shard_t *shard = &shards->shards[i];
+
+        if (shard->wake_fd >= 0) {
+            if (shard->loop) {
+                net_loop_unwatch(shard->loop, &shard->wake_watch);
+            }
+            close(shard->wake_fd);
+        }
+        net_host_destroy(shard->host);
+        if (shard->loop) {
+            net_loop_destroy(shard->loop);
+        }
+    }
+    free(shards->shards);
+    free(shards);
+}
+
+unsigned net_shards_owner(const net_shards_t *shards, int key) {
+    return (unsigned)(((long long)key * shards->count) / shards->key_max);
+}
+
+unsigned net_shards_count(const net_shards_t *shards) {
+    return shards->count;
+}
+
+net_host_t* net_shards_host(net_shards_t *shards, unsigned shard) {
+    return shard < shards->count ? shards->shards[shard].host : NULL;
+}
+
+Node* net_shards_spawn(net_shards_t *shards, const char *id) {
+    if (!id || shards->threads) {
+        errno = shards->threads ? EBUSY : EINVAL;
+        return NULL;
+    }
+    return net_host_spawn(shards->shards[net_shards_owner(shards, chord_hash((char*)id))].host, id);
+}
+
+int net_shards_start(net_shards_t *shards) {
+    if (shards->threads) {
+        errno = EINVAL;
+        return -1;
+    }
+    atomic_store(&shards->stopping, 0);
+    while (shards->threads < shards->count &&
+           pthread_create(&shards->shards[shards->threads].thread, NULL, shard_main,
+                          &shards->shards[shards->threads]) == 0) {
+        shards->threads++;
+    }
+    if (shards->threads < shards->count) {
+        net_shards_stop(shards);
+        errno = EAGAIN;
+        return -1;
+    }
+    return 0;
+}
+
+void net_shards_stop(net_shards_t *shards) {
+    uint64_t one = 1;
+
+    if (!shards->threads) {
+        return;
+    }
+    atomic_store(&shards->stopping, 1);
+    for (unsigned i = 0; i < shards->threads; i++) {
+        if (write(shards->shards[i].wake_fd, &one, sizeof(one)) < 0) {
+            /* Counter saturated: a wake-up is already pending */
+        }
+    }
+    for (unsigned i = 0; i < shards->threads; i++) {
+        pthread_join(shards->shards[i].thread, NULL);
+    }
+    shards->threads = 0;
+}
+
+int net_shards_lookup(net_shards_t *shards, Node *origin, int key, net_shard_lookup_t *lookup,
+                      net_shard_lookup_callback_t callback, void *context) {
+    if (!origin || !lookup || !callback || key < 0 || key >= shards->key_max) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+    if (shards->threads < shards->count) {
+        return NET_ERR_CONNECTION_CLOSED;
+    }
+    lookup->at = origin;
+    lookup->key = key;
+    lookup->hops = 0;
+    lookup->crossings = 0;
+    lookup->result = NULL;
+    lookup->callback = callback;
+    lookup->context = context;
+    shard_post(&shards->shards[net_shards_owner(shards, origin->key)], lookup);
+    return NET_ERR_OK;
+}
+
+void net_shards_get_stats(const net_shards_t *shards, unsigned shard, net_shard_stats_t *stats) {
+    const net_shard_t *s = &shards->shards[shard];
+
+    stats->steps = atomic_load_explicit(&s->steps, memory_order_relaxed);
+    stats->received = atomic_load_explicit(&s->received, memory_order_relaxed);
+    stats->completed = atomic_load_explicit(&s->completed, memory_order_relaxed);
+    stats->wakeups = atomic_load_explicit(&s->wakeups, memory_order_relaxed);
+}
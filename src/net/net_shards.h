@@ -0,0 +1,89 @@
+#ifndef NET_SHARDS_H
+#define NET_SHARDS_H
+
+#include <stdint.h>
+#include "net_host.h"
+
+/*
+ * Sharded Node Runtime
+ *
+ * Spreads the nodes of a dense cluster over several threads ("shards")
+ * without locking any Node. The keyspace is cut into equal contiguous
+ * ranges, one per shard; a node lives on the shard owning its key and
+ * only that shard's thread ever touches its state. Each shard is a
+ * net_host on its own net_loop, base URL "<base>/<shard>", so hosted
+ * URLs and local peers work as with a single host, per shard.
+ *
+ * Lookups move between shards as messages: a shard runs routing steps
+ * (node_next_hop) while the next node is its own, and hands the lookup
+ * to the owning shard's inbox when it is not. Inboxes are lock-free
+ * MPSC queues; a sleeping shard is woken through an eventfd at most
+ * once per batch it drains. Lookups are intrusive: the caller provides
+ * the net_shard_lookup_t, which travels between shards as the message,
+ * so routing never allocates.
+ *
+ * Reading another node's key (fingers, successor) is the one access
+ * across shards; keys do not change after node_init.
+ *
+ * Thread safety: net_shards_lookup() may be called from any thread
+ * once started. Spawning nodes and forming the ring happen before
+ * net_shards_start(), from one thread.
+ */
+
+typedef struct net_shards net_shards_t;
+typedef struct net_shard_lookup net_shard_lookup_t;
+
+/* Runs on the thread of the shard that finished the lookup */
+typedef void (*net_shard_lookup_callback_t)(net_shard_lookup_t *lookup, int error);
+
+struct net_shard_lookup {
+    net_shard_lookup_t *_Atomic next;   /* Inbox link */
+    Node *at;                           /* Node the next step runs at */
+    int key;
+    int hops;                           /* Routing steps taken */
+    int crossings;                      /* Handoffs between shards */
+    Node *result;                       /* Key's successor once done */
+    net_shard_lookup_callback_t callback;
+    void *context;
+};
+
+typedef struct {
+    uint64_t steps;             /* Routing steps run */
+    uint64_t received;          /* Lookups taken from the inbox */
+    uint64_t completed;         /* Lookups finished here */
+    uint64_t wakeups;           /* Inbox eventfd wake-ups */
+} net_shard_stats_t;
+
+/* Create count shards (threads not started). NULL on failure. */
+net_shards_t* net_shards_create(unsigned count, const char *base_url);
+
+/* Stop the threads and free everything (Nodes stay in the ring) */
+void net_shards_destroy(net_shards_t *shards);
+
+/* Shard owning key */
+unsigned net_shards_owner(const net_shards_t *shards, int key);
+
+unsigned net_shards_count(const net_shards_t *shards);
+
+/* Host of one shard (belongs to that shard's thread once started) */
+net_host_t* net_shards_host(net_shards_t *shards, unsigned shard);
+
+/* Host node id on the shard owning its key (before start) */
+Node* net_shards_spawn(net_shards_t *shards, const char *id);
+
+/* Start one thread per shard. Returns 0 or -1 (errno). */
+int net_shards_start(net_shards_t *shards);
+
+/* Stop and join the threads; lookups still queued are dropped */
+void net_shards_stop(net_shards_t *shards);
+
+/* Find key's successor starting at origin (a node of these shards).
+ * lookup is owned by the runtime until its callback runs. Returns
+ * NET_ERR_OK, or an error without calling callback. */
+int net_shards_lookup(net_shards_t *shards, Node *origin, int key, net_shard_lookup_t *lookup,
+                      net_shard_lookup_callback_t callback, void *context);
+
+/* Counters of one shard (any thread, while it runs) */
+void net_shards_get_stats(const net_shards_t *shards, unsigned shard, net_shard_stats_t *stats);
+
+#endif /* NET_SHARDS_H */
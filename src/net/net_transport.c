@@ -0,0 +1,838 @@
+#define _GNU_SOURCE
+
+#include "net_transport.h"
+#include "net_transport_shm.h"
+#include "net_transport_uring.h"
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+/*
+ * Socket transport implementation
+ *
+ * Sockets are always non-blocking; the timeout semantics of the API are
+ * built from poll() on EAGAIN against a per-call deadline. Received
+ * bytes are read in bulk into a per-connection buffer and frames are
+ * cut from it, so a burst of small frames costs one read(). The buffer
+ * is allocated on first receive and grows only for large frames, which
+ * keeps thousands of idle accepted connections cheap.
+ *
+ * NET_TRANSPORT_SHM transports are dispatched to net_transport_shm.c;
+ * their impl_data is the shared-memory link while connected.
+ *
+ * With the io_uring backend a connection is handed to
+ * net_transport_uring.c on its first send or recv. Framing stays here:
+ * the engine's sink appends received bytes to the same rx buffer, and
+ * recv waits on the ring instead of calling read(). If the ring cannot
+ * be set up the connection quietly stays on the socket path.
+ */
+
+#define TRANSPORT_FRAME_HEADER 4
+#define TRANSPORT_RX_INITIAL 4096
+
+typedef struct {
+    int fd;
+    uint8_t *rx;
+    size_t rx_cap;
+    size_t rx_start;    /* First unconsumed byte */
+    size_t rx_end;      /* One past the last received byte */
+    int use_uring;      /* Connected under the io_uring backend */
+    net_uring_conn_t *uring;
+    int rx_errno;       /* End of stream or error reported by the ring */
+} transport_conn_t;
+
+typedef struct {
+    int fd;
+    char url[NET_TRANSPORT_MAX_URL];
+    char path[sizeof(((struct sockaddr_un*)0)->sun_path)];  /* IPC only */
+    net_shm_listener_t *shm;    /* SHM only */
+    net_loop_t *loop;
+    net_watch_t watch;
+    net_transport_accept_callback_t callback;
+    void *context;
+} transport_listener_t;
+
+static _Atomic int g_transport_backend = NET_TRANSPORT_BACKEND_EPOLL;
+
+/*
+ * Helpers
+ */
+
+static int64_t transport_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int64_t transport_deadline(int timeout_ms) {
+    return timeout_ms < 0 ? -1 : transport_now_ms() + timeout_ms;
+}
+
+/* Wait until fd is ready for events or the deadline passes (ETIMEDOUT) */
+static int transport_wait(int fd, short events, int64_t deadline) {
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = events;
+    for (;;) {
+        int wait_ms = -1;
+        int ready;
+
+        if (deadline >= 0) {
+            int64_t left = deadline - transport_now_ms();
+            wait_ms = left > 0 ? (int)left : 0;
+        }
+        pfd.revents = 0;
+        ready = poll(&pfd, 1, wait_ms);
+        if (ready > 0) {
+            return 0;  /* Errors and hang-ups surface in the next syscall */
+        }
+        if (ready == 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+/* Resolve url for type into addr (passive = for bind) */
+static int transport_resolve(net_transport_type_t type, const char *url, int passive,
+                             struct sockaddr_storage *addr, socklen_t *addr_len) {
+    memset(addr, 0, sizeof(*addr));
+
+    if (type == NET_TRANSPORT_IPC && strncmp(url, "ipc://", 6) == 0) {
+        struct sockaddr_un *un = (struct sockaddr_un*)addr;
+        const char *path = url + 6;
+
+        if (path[0] == '\0' || strlen(path) >= sizeof(un->sun_path)) {
+            errno = EINVAL;
+            return -1;
+        }
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, path);
+        *addr_len = (socklen_t)sizeof(*un);
+        return 0;
+    }
+
+    if (type == NET_TRANSPORT_TCP && strncmp(url, "tcp://", 6) == 0) {
+        struct addrinfo hints;
+        struct addrinfo *result;
+        char host[NET_TRANSPORT_MAX_URL];
+        const char *port = strrchr(url + 6, ':');
+        size_t host_len;
+
+        if (!port || port[1] == '\0') {
+            errno = EINVAL;
+            return -1;
+        }
+        host_len = (size_t)(port - (url + 6));
+        if (host_len >= sizeof(host)) {
+            errno = EINVAL;
+            return -1;
+        }
+        memcpy(host, url + 6, host_len);
+        host[host_len] = '\0';
+        if (host_len >= 2 && host[0] == '[' && host[host_len - 1] == ']') {  /* [::1] */
+            memmove(host, host + 1, host_len - 2);
+            host[host_len - 2] = '\0';
+        }
+
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_NUMERICSERV | (passive ? AI_PASSIVE : 0);
+        if (getaddrinfo(host[0] && strcmp(host, "*") != 0 ? host : NULL, port + 1,
+                        &hints, &result) != 0) {
+            errno = EHOSTUNREACH;
+            return -1;
+        }
+        memcpy(addr, result->ai_addr, result->ai_addrlen);
+        *addr_len = result->ai_addrlen;
+        freeaddrinfo(result);
+        return 0;
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+static void transport_tune(net_transport_type_t type, int fd) {
+    if (type == NET_TRANSPORT_TCP) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+}
+
+/* Make room for need bytes from rx_start */
+static int transport_rx_reserve(transport_conn_t *conn, size_t need) {
+    if (conn->rx_cap - conn->rx_start >= need) {
+        return 0;
+    }
+    if (conn->rx_start > 0) {
+        memmove(conn->rx, conn->rx + conn->rx_start, conn->rx_end - conn->rx_start);
+        conn->rx_end -= conn->rx_start;
+        conn->rx_start = 0;
+    }
+    if (conn->rx_cap < need) {
+        size_t cap = conn->rx_cap ? conn->rx_cap : TRANSPORT_RX_INITIAL;
+        uint8_t *rx;
+
+        while (cap < need) {
+            cap *= 2;
+        }
+        rx = (uint8_t*)realloc(conn->rx, cap);
+        if (!rx) {
+            errno = ENOMEM;
+            return -1;
+        }
+        conn->rx = rx;
+        conn->rx_cap = cap;
+    }
+    return 0;
+}
+
+/* Ring sink: stream bytes land in rx exactly as read() would put them */
+static void transport_uring_sink(void *context, const uint8_t *data, int len) {
+    transport_conn_t *conn = (transport_conn_t*)context;
+
+    if (len <= 0) {
+        conn->rx_errno = len == 0 ? ECONNRESET : -len;
+        return;
+    }
+    if (transport_rx_reserve(conn, conn->rx_end - conn->rx_start + (size_t)len) != 0) {
+        conn->rx_errno = ENOMEM;
+        return;
+    }
+    memcpy(conn->rx + conn->rx_end, data, (size_t)len);
+    conn->rx_end += (size_t)len;
+}
+
+/* The connection's ring binding, made on first use (NULL: socket path) */
+static net_uring_conn_t* transport_uring(transport_conn_t *conn) {
+    if (conn->use_uring && !conn->uring) {
+        conn->uring = net_uring_attach(conn->fd, transport_uring_sink, conn);
+        if (!conn->uring) {
+            conn->use_uring = 0;
+        }
+    }
+    return conn->uring;
+}
+
+/*
+ * Connections
+ */
+
+int net_transport_set_backend(net_transport_backend_t backend) {
+    if (backend != NET_TRANSPORT_BACKEND_EPOLL && backend != NET_TRANSPORT_BACKEND_URING) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (backend == NET_TRANSPORT_BACKEND_URING && !net_uring_supported()) {
+        errno = ENOSYS;
+        return -1;
+    }
+    atomic_store(&g_transport_backend, (int)backend);
+    return 0;
+}
+
+net_transport_backend_t net_transport_get_backend(void) {
+    return (net_transport_backend_t)atomic_load(&g_transport_backend);
+}
+
+int net_transport_url_type(const char *url, net_transport_type_t *type) {
+    if (url && strncmp(url, "tcp://", 6) == 0) {
+        *type = NET_TRANSPORT_TCP;
+    } else if (url && strncmp(url, "ipc://", 6) == 0) {
+        *type = NET_TRANSPORT_IPC;
+    } else if (url && strncmp(url, "shm://", 6) == 0) {
+        *type = NET_TRANSPORT_SHM;
+    } else {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+net_transport_t* net_transport_create(net_transport_type_t type) {
+    net_transport_t *transport;
+    transport_conn_t *conn;
+
+    if (type == NET_TRANSPORT_SHM) {
+        transport = (net_transport_t*)calloc(1, sizeof(net_transport_t));
+        if (transport) {
+            transport->type = type;
+        }
+        return transport;
+    }
+    if (type != NET_TRANSPORT_TCP && type != NET_TRANSPORT_IPC) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    transport = (net_transport_t*)calloc(1, sizeof(net_transport_t));
+    conn = (transport_conn_t*)calloc(1, sizeof(transport_conn_t));
+    if (!transport || !conn) {
+        free(transport);
+        free(conn);
+        return NULL;
+    }
+
+    conn->fd = -1;
+    transport->type = type;
+    transport->impl_data = conn;
+    return transport;
+}
+
+int net_transport_connect(net_transport_t *transport, const char *url, int timeout_ms) {
+    transport_conn_t *conn;
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    int fd;
+
+    if (!transport || !url) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    net_transport_close(transport);
+    if (transport->type == NET_TRANSPORT_SHM) {
+        return net_shm_connect(transport, url, timeout_ms);
+    }
+    if (transport_resolve(transport->type, url, 0, &addr, &addr_len) != 0) {
+        return -1;
+    }
+
+    fd = socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    transport_tune(transport->type, fd);
+
+    if (connect(fd, (struct sockaddr*)&addr, addr_len) != 0) {
+        int err = errno;
+
+        if (err == EINPROGRESS) {
+            socklen_t err_len = sizeof(err);
+            if (transport_wait(fd, POLLOUT, transport_deadline(timeout_ms)) != 0 ||
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) != 0) {
+                err = errno;
+            }
+        }
+        if (err != 0) {
+            close(fd);
+            errno = err;
+            return -1;
+        }
+    }
+
+    conn = (transport_conn_t*)transport->impl_data;
+    conn->fd = fd;
+    conn->rx_start = conn->rx_end = 0;
+    conn->use_uring = net_transport_get_backend() == NET_TRANSPORT_BACKEND_URING;
+    transport->connected = 1;
+    return 0;
+}
+
+int net_transport_send(net_transport_t *transport, const void *data, size_t len, int timeout_ms) {
+    transport_conn_t *conn;
+    uint8_t header[TRANSPORT_FRAME_HEADER];
+    struct iovec iov[2];
+    struct msghdr msg;
+    size_t sent = 0;
+    size_t total = TRANSPORT_FRAME_HEADER + len;
+    int64_t deadline = transport_deadline(timeout_ms);
+
+    if (!transport || !transport->connected) {
+        errno = ENOTCONN;
+        return -1;
+    }
+    if (len > NET_TRANSPORT_MAX_FRAME) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    if (transport->type == NET_TRANSPORT_SHM) {
+        return net_shm_send(transport, data, len, timeout_ms);
+    }
+    conn = (transport_conn_t*)transport->impl_data;
+
+    header[0] = (uint8_t)(len >> 24);
+    header[1] = (uint8_t)(len >> 16);
+    header[2] = (uint8_t)(len >> 8);
+    header[3] = (uint8_t)len;
+
+    if (transport_uring(conn)) {
+        if (net_uring_send(conn->uring, header, sizeof(header), data, len, deadline,
+                           timeout_ms == 0) != 0) {
+            int err = errno;
+            if (err != EAGAIN && err != ETIMEDOUT) {
+                net_transport_close(transport);
+            }
+            errno = err;
+            return -1;
+        }
+        return 0;
+    }
+    iov[0].iov_base = header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = (void*)(uintptr_t)data;
+    iov[1].iov_len = len;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    while (sent < total) {
+        ssize_t n = sendmsg(conn->fd, &msg, MSG_NOSIGNAL);
+
+        if (n > 0) {
+            size_t done = (size_t)n;
+            sent += done;
+            while (done > 0 && msg.msg_iovlen > 0) {
+                size_t step = done < msg.msg_iov->iov_len ? done : msg.msg_iov->iov_len;
+                msg.msg_iov->iov_base = (uint8_t*)msg.msg_iov->iov_base + step;
+                msg.msg_iov->iov_len -= step;
+                done -= step;
+                if (msg.msg_iov->iov_len == 0) {
+                    msg.msg_iov++;
+                    msg.msg_iovlen--;
+                }
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (timeout_ms == 0 && sent == 0) {
+                return -1;  /* Nothing written: stream still intact */
+            }
+            if (transport_wait(conn->fd, POLLOUT, deadline) == 0) {
+                continue;
+            }
+            if (sent == 0) {
+                return -1;
+            }
+        }
+
+        /* Failed mid-frame: the stream can no longer be framed */
+        {
+            int err = errno;
+            net_transport_close(transport);
+            errno = err;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+int net_transport_recv(net_transport_t *transport, void *buffer, size_t buffer_size, int timeout_ms) {
+    transport_conn_t *conn;
+    int64_t deadline = transport_deadline(timeout_ms);
+
+    if (!transport || !transport->connected) {
+        errno = ENOTCONN;
+        return -1;
+    }
+    if (transport->type == NET_TRANSPORT_SHM) {
+        return net_shm_recv(transport, buffer, buffer_size, timeout_ms);
+    }
+    conn = (transport_conn_t*)transport->impl_data;
+
+    for (;;) {
+        size_t avail = conn->rx_end - conn->rx_start;
+        size_t need = TRANSPORT_FRAME_HEADER;
+        ssize_t n;
+
+        if (avail >= TRANSPORT_FRAME_HEADER) {
+            const uint8_t *p = conn->rx + conn->rx_start;
+            size_t len = (size_t)p[0] << 24 | (size_t)p[1] << 16 | (size_t)p[2] << 8 | p[3];
+
+            if (len > NET_TRANSPORT_MAX_FRAME) {
+                net_transport_close(transport);
+                errno = EMSGSIZE;
+                return -1;
+            }
+            need += len;
+            if (avail >= need) {
+                conn->rx_start += need;
+                if (conn->rx_start == conn->rx_end) {
+                    conn->rx_start = conn->rx_end = 0;
+                }
+                if (len > buffer_size) {
+                    errno = EMSGSIZE;
+                    return -1;
+                }
+                memcpy(buffer, p + TRANSPORT_FRAME_HEADER, len);
+                return (int)len;
+            }
+        }
+
+        if (transport_uring(conn)) {
+            size_t before = conn->rx_end - conn->rx_start;
+
+            if (conn->rx_errno) {
+                int err = conn->rx_errno;
+                net_transport_close(transport);
+                errno = err;
+                return -1;
+            }
+            if (net_uring_wait(conn->uring, deadline, timeout_ms == 0) != 0) {
+                return -1;  /* Partial frame stays buffered */
+            }
+            if (timeout_ms == 0 && conn->rx_end - conn->rx_start == before && !conn->rx_errno) {
+                errno = EAGAIN;
+                return -1;
+            }
+            continue;
+        }
+
+        if (transport_rx_reserve(conn, need) != 0) {
+            return -1;
+        }
+        n = read(conn->fd, conn->rx + conn->rx_end, conn->rx_cap - conn->rx_end);
+        if (n > 0) {
+            conn->rx_end += (size_t)n;
+            continue;
+        }
+        if (n == 0) {
+            net_transport_close(transport);
+            errno = ECONNRESET;
+            return -1;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (timeout_ms == 0 || transport_wait(conn->fd, POLLIN, deadline) != 0) {
+                return -1;  /* Partial frame stays buffered */
+            }
+            continue;
+        }
+
+        {
+            int err = errno;
+            net_transport_close(transport);
+            errno = err;
+        }
+        return -1;
+    }
+}
+
+int net_transport_flush(net_transport_t *transport) {
+    if (!transport || !transport->connected) {
+        errno = ENOTCONN;
+        return -1;
+    }
+    if (transport->type != NET_TRANSPORT_SHM &&
+        ((transport_conn_t*)transport->impl_data)->uring) {
+        net_uring_flush();
+    }
+    return 0;
+}
+
+int net_transport_fd(const net_transport_t *transport) {
+    const transport_conn_t *conn;
+
+    if (!transport || !transport->connected || transport->type == NET_TRANSPORT_SHM) {
+        return -1;
+    }
+    conn = (const transport_conn_t*)transport->impl_data;
+    return conn->use_uring ? -1 : conn->fd;
+}
+
+void net_transport_close(net_transport_t *transport) {
+    transport_conn_t *conn;
+
+    if (!transport || !transport->connected) {
+        return;
+    }
+    if (transport->type == NET_TRANSPORT_SHM) {
+        net_shm_close(transport);
+        return;
+    }
+    conn = (transport_conn_t*)transport->impl_data;
+    if (conn->uring) {
+        net_uring_detach(conn->uring);
+        conn->uring = NULL;
+    }
+    close(conn->fd);
+    conn->fd = -1;
+    conn->rx_start = conn->rx_end = 0;
+    conn->use_uring = 0;
+    conn->rx_errno = 0;
+    transport->connected = 0;
+}
+
+void net_transport_destroy(net_transport_t *transport) {
+    transport_conn_t *conn;
+
+    if (!transport) {
+        return;
+    }
+    net_transport_close(transport);
+    conn = (transport_conn_t*)transport->impl_data;
+    if (conn) {
+        free(conn->rx);
+        free(conn);
+    }
+    free(transport);
+}
+
+/*
+ * Listener
+ */
+
+net_transport_listener_t* net_transport_listener_create(net_transport_type_t type) {
+    net_transport_listener_t *listener;
+    transport_listener_t *impl;
+
+    if (type != NET_TRANSPORT_TCP && type != NET_TRANSPORT_IPC && type != NET_TRANSPORT_SHM) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    listener = (net_transport_listener_t*)calloc(1, sizeof(net_transport_listener_t));
+    impl = (transport_listener_t*)calloc(1, sizeof(transport_listener_t));
+    if (!listener || !impl) {
+        free(listener);
+        free(impl);
+        return NULL;
+    }
+
+    impl->fd = -1;
+    listener->type = type;
+    listener->impl_data = impl;
+    return listener;
+}
+
+/* Record the bound URL, filling in the port the kernel chose */
+static void listener_set_url(net_transport_listener_t *listener, const char *url) {
+    transport_listener_t *impl = (transport_listener_t*)listener->impl_data;
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    const char *port = strrchr(url + 6, ':');
+    unsigned bound = 0;
+
+    if (listener->type == NET_TRANSPORT_IPC || !port ||
+        getsockname(impl->fd, (struct sockaddr*)&addr, &addr_len) != 0) {
+        snprintf(impl->url, sizeof(impl->url), "%s", url);
+        return;
+    }
+
+    if (addr.ss_family == AF_INET) {
+        bound = ntohs(((struct sockaddr_in*)&addr)->sin_port);
+    }
+    else if (addr.ss_family == AF_INET6) {
+        bound = ntohs(((struct sockaddr_in6*)&addr)->sin6_port);
+    }
+    snprintf(impl->url, sizeof(impl->url), "%.*s:%u", (int)(port - url), url, bound);
+}
+
+int net_transport_listener_listen(net_transport_listener_t *listener, const char *url) {
+    transport_listener_t *impl;
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    int fd;
+
+    if (!listener || !url) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    net_transport_listener_stop(listener);
+    impl = (transport_listener_t*)listener->impl_data;
+    if (listener->type == NET_TRANSPORT_SHM) {
+        impl->shm = net_shm_listen(url);
+        if (!impl->shm) {
+            return -1;
+        }
+        snprintf(impl->url, sizeof(impl->url), "%s", url);
+        listener->listening = 1;
+        return 0;
+    }
+    if (transport_resolve(listener->type, url, 1, &addr, &addr_len) != 0) {
+        return -1;
+    }
+
+    if (addr.ss_family == AF_UNIX) {
+        /* Replace a stale socket left by a previous run, nothing else */
+        const char *path = ((struct sockaddr_un*)&addr)->sun_path;
+        struct stat st;
+
+        if (lstat(path, &st) == 0) {
+            if (!S_ISSOCK(st.st_mode)) {
+                errno = EADDRINUSE;
+                return -1;
+            }
+            unlink(path);
+        }
+    }
+
+    fd = socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (addr.ss_family != AF_UNIX) {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (bind(fd, (struct sockaddr*)&addr, addr_len) != 0 || listen(fd, SOMAXCONN) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    impl->fd = fd;
+    if (addr.ss_family == AF_UNIX) {
+        strcpy(impl->path, ((struct sockaddr_un*)&addr)->sun_path);
+    }
+    listener_set_url(listener, url);
+    listener->listening = 1;
+    return 0;
+}
+
+const char* net_transport_listener_url(const net_transport_listener_t *listener) {
+    if (!listener || !listener->listening) {
+        return NULL;
+    }
+    return ((const transport_listener_t*)listener->impl_data)->url;
+}
+
+/* Accept one pending connection without waiting (NULL, errno EAGAIN if none) */
+static net_transport_t* listener_accept_now(net_transport_listener_t *listener) {
+    transport_listener_t *impl = (transport_listener_t*)listener->impl_data;
+
+    for (;;) {
+        net_transport_t *client;
+        int fd = accept4(impl->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return NULL;
+        }
+
+        client = net_transport_create(listener->type);
+        if (!client) {
+            close(fd);
+            errno = ENOMEM;
+            return NULL;
+        }
+        transport_tune(listener->type, fd);
+        ((transport_conn_t*)client->impl_data)->fd = fd;
+        ((transport_conn_t*)client->impl_data)->use_uring =
+            net_transport_get_backend() == NET_TRANSPORT_BACKEND_URING;
+        client->connected = 1;
+        return client;
+    }
+}
+
+net_transport_t* net_transport_listener_accept(net_transport_listener_t *listener, int timeout_ms) {
+    int64_t deadline = transport_deadline(timeout_ms);
+
+    if (!listener || !listener->listening) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (listener->type == NET_TRANSPORT_SHM) {
+        return net_shm_accept(((transport_listener_t*)listener->impl_data)->shm, timeout_ms);
+    }
+
+    for (;;) {
+        net_transport_t *client = listener_accept_now(listener);
+
+        if (client || (errno != EAGAIN && errno != EWOULDBLOCK) || timeout_ms == 0) {
+            return client;
+        }
+        if (transport_wait(((transport_listener_t*)listener->impl_data)->fd, POLLIN, deadline) != 0) {
+            return NULL;
+        }
+    }
+}
+
+static void listener_on_ready(void *context, uint32_t events) {
+    net_transport_listener_t *listener = (net_transport_listener_t*)context;
+    transport_listener_t *impl = (transport_listener_t*)listener->impl_data;
+    net_transport_t *client;
+
+    (void)events;
+    while ((client = listener_accept_now(listener)) != NULL) {
+        impl->callback(client, impl->context);
+    }
+}
+
+int net_transport_listener_attach(net_transport_listener_t *listener, net_loop_t *loop,
+                                  net_transport_accept_callback_t callback, void *context) {
+    transport_listener_t *impl;
+
+    if (listener && listener->type == NET_TRANSPORT_SHM) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    if (!listener || !listener->listening || !loop || !callback) {
+        errno = EINVAL;
+        return -1;
+    }
+    impl = (transport_listener_t*)listener->impl_data;
+
+    impl->callback = callback;
+    impl->context = context;
+    if (net_loop_watch(loop, &impl->watch, impl->fd, EPOLLIN, listener_on_ready, listener) != 0) {
+        return -1;
+    }
+    impl->loop = loop;
+    return 0;
+}
+
+void net_transport_listener_stop(net_transport_listener_t *listener) {
+    transport_listener_t *impl;
+
+    if (!listener || !listener->listening) {
+        return;
+    }
+    impl = (transport_listener_t*)listener->impl_data;
+
+    if (impl->shm) {
+        net_shm_listener_close(impl->shm);
+        impl->shm = NULL;
+        listener->listening = 0;
+        return;
+    }
+    if (impl->loop) {
+        net_loop_unwatch(impl->loop, &impl->watch);
+        impl->loop = NULL;
+    }
+    close(impl->fd);
+    impl->fd = -1;
+    if (impl->path[0]) {
+        unlink(impl->path);
+        impl->path[0] = '\0';
+    }
+    listener->listening = 0;
+}
+
+void net_transport_listener_destroy(net_transport_listener_t *listener) {
+    if (!listener) {
+        return;
+    }
+    net_transport_listener_stop(listener);
+    free(listener->impl_data);
+    free(listener);
+}
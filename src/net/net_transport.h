@@ -2,20 +2,59 @@
 #define NET_TRANSPORT_H
 
 #include <stddef.h>
+#include "net_loop.h"
 
 /*
  * Network Transport Layer
  * 
- * Raw network I/O abstraction.
- * Wraps NNG sockets or provides fake implementations for testing.
+ * Raw network I/O abstraction over non-blocking stream sockets:
+ * TCP (tcp://host:port) and Unix domain sockets (ipc:///path), plus
+ * shared-memory rings between processes on one host (shm://name).
  * 
  * Design principles:
  * - Minimal interface (connect, send, receive, close)
  * - Timeout support
  * - Error handling
  * - Can be implemented with NNG, raw sockets, or fakes
+ *
+ * Framing: every message travels as a 4-byte big-endian length followed
+ * by that many bytes, so one send is one recv on the other side however
+ * the stream is split. Frames are limited to NET_TRANSPORT_MAX_FRAME.
+ *
+ * Timeouts: timeout_ms < 0 waits forever, 0 never waits (-1 with errno
+ * EAGAIN if the call cannot complete now), > 0 is a deadline for the
+ * whole call (errno ETIMEDOUT). Blocking calls wait on their own socket
+ * with poll(); event-driven code instead registers the sockets with a
+ * net_loop (epoll) via net_transport_fd() and
+ * net_transport_listener_attach() and calls recv/send with timeout 0.
+ *
+ * Shared memory: each connection is a pair of SPSC rings in a segment
+ * mapped by both processes, with futex wake-ups, so a round trip never
+ * enters the socket stack. Its connections have no descriptor: they
+ * cannot be registered with a net_loop (net_transport_fd() is -1 and
+ * attaching a listener fails with ENOTSUP); serve them from a thread.
+ *
+ * Backends: TCP and IPC connections do their I/O with plain syscalls
+ * (NET_TRANSPORT_BACKEND_EPOLL, the default) or through io_uring
+ * (NET_TRANSPORT_BACKEND_URING), chosen at runtime for connections made
+ * or accepted afterwards. With io_uring, received data arrives by
+ * multishot recv into provided buffers and sends are queued into
+ * registered buffers, coalesced per connection and submitted in batches
+ * when the thread next waits (or on net_transport_flush()). A uring
+ * connection belongs to the thread that first sends or receives on it
+ * and has no descriptor for a net_loop.
+ *
+ * Errors: functions returning int return -1 with errno set. A send that
+ * fails part-way through a frame, a malformed length or the peer
+ * hanging up (ECONNRESET) closes the connection.
  */
 
+/* Largest frame payload accepted in either direction */
+#define NET_TRANSPORT_MAX_FRAME (1u << 20)
+
+/* Longest URL, including the terminator */
+#define NET_TRANSPORT_MAX_URL 256
+
 /* Forward declaration */
 typedef struct net_transport net_transport_t;
 
@@ -23,9 +62,16 @@ typedef struct net_transport net_transport_t;
 typedef enum {
     NET_TRANSPORT_TCP,
     NET_TRANSPORT_IPC,
+    NET_TRANSPORT_SHM,
     NET_TRANSPORT_FAKE
 } net_transport_type_t;
 
+/* Socket I/O backends */
+typedef enum {
+    NET_TRANSPORT_BACKEND_EPOLL = 0,
+    NET_TRANSPORT_BACKEND_URING = 1
+} net_transport_backend_t;
+
 /*
  * Transport structure
  */
@@ -39,18 +85,37 @@ struct net_transport {
  * Transport API
  */
 
+/* Select the backend for TCP/IPC connections made from now on
+ * (default: epoll). Returns -1 with errno ENOSYS, keeping epoll, when
+ * the kernel lacks the io_uring features used. */
+int net_transport_set_backend(net_transport_backend_t backend);
+net_transport_backend_t net_transport_get_backend(void);
+
+/* Transport type named by url's scheme (tcp://, ipc:// or shm://).
+ * Returns 0, or -1 with errno EINVAL for any other URL. */
+int net_transport_url_type(const char *url, net_transport_type_t *type);
+
 /* Create transport */
 net_transport_t* net_transport_create(net_transport_type_t type);
 
 /* Connect to remote endpoint */
 int net_transport_connect(net_transport_t *transport, const char *url, int timeout_ms);
 
-/* Send data */
+/* Send one frame (returns 0 or -1) */
 int net_transport_send(net_transport_t *transport, const void *data, size_t len, int timeout_ms);
 
-/* Receive data (returns bytes received, or -1 on error) */
+/* Receive one frame (returns bytes received, or -1 on error). A frame
+ * larger than buffer_size is discarded with errno EMSGSIZE. */
 int net_transport_recv(net_transport_t *transport, void *buffer, size_t buffer_size, int timeout_ms);
 
+/* Push out frames still queued by send (io_uring backend; a no-op
+ * otherwise). recv flushes by itself. Returns 0 or -1. */
+int net_transport_flush(net_transport_t *transport);
+
+/* Socket descriptor for event loop registration (-1 if not connected
+ * or the connection uses io_uring) */
+int net_transport_fd(const net_transport_t *transport);
+
 /* Close connection */
 void net_transport_close(net_transport_t *transport);
 
@@ -75,12 +140,21 @@ struct net_transport_listener {
 /* Create listener */
 net_transport_listener_t* net_transport_listener_create(net_transport_type_t type);
 
-/* Start listening on URL */
+/* Start listening on URL (tcp://host:0 picks a free port) */
 int net_transport_listener_listen(net_transport_listener_t *listener, const char *url);
 
-/* Accept connection (blocking) */
+/* URL actually bound, with the chosen port filled in */
+const char* net_transport_listener_url(const net_transport_listener_t *listener);
+
+/* Accept connection (blocking; NULL with errno set on failure) */
 net_transport_t* net_transport_listener_accept(net_transport_listener_t *listener, int timeout_ms);
 
+/* Accept on loop instead: whenever the listening socket is readable,
+ * every pending connection is accepted and handed to callback, which
+ * owns the new transport. Returns 0 or -1. */
+int net_transport_listener_attach(net_transport_listener_t *listener, net_loop_t *loop,
+                                  net_transport_accept_callback_t callback, void *context);
+
 /* Stop listening */
 void net_transport_listener_stop(net_transport_listener_t *listener);
 
@@ -0,0 +1,731 @@
+#define _GNU_SOURCE
+
+#include "net_transport_shm.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/*
+ * Shared-memory transport implementation
+ *
+ * A listener publishes a named segment holding a bounded MPSC queue of
+ * connection IDs (any number of connecting processes, one acceptor).
+ * A connecting process creates a segment for the connection, queues
+ * its ID and waits for the acceptor to map it; the name is unlinked
+ * once both sides have it mapped, so nothing is left behind.
+ *
+ * A connection segment holds two SPSC byte rings, one per direction,
+ * carrying the same length-prefixed frames as the socket transport.
+ * head and tail are free-running byte counters on separate cache
+ * lines. A frame that fits the ring is published with a single store
+ * of head, so the reader sees all of it or none of it; larger frames
+ * are streamed through.
+ *
+ * Waiting spins briefly (on multi-core hosts) and then sleeps on a
+ * futex in the shared mapping. Each ring has a sequence word that the
+ * producer (data_seq) or consumer (space_seq) bumps after every
+ * update, and a waiting flag so a wake-up syscall is made only when
+ * the other side actually sleeps. Sleeps are capped at
+ * SHM_LIVENESS_MS so a peer that died without closing is noticed.
+ */
+
+#define SHM_MAGIC 0x43484d31u        /* "CHM1" */
+#define SHM_FRAME_HEADER 4
+#define SHM_RING_MASK ((uint64_t)NET_SHM_RING_SIZE - 1)
+#define SHM_SPIN 2000
+#define SHM_LIVENESS_MS 100
+#define SHM_MAX_NAME 100
+
+enum {
+    SHM_PENDING = 0,
+    SHM_ACCEPTED = 1,
+    SHM_REFUSED = 2
+};
+
+typedef struct {
+    _Atomic uint64_t head;               /* Bytes published by the writer */
+    char pad0[56];
+    _Atomic uint64_t tail;               /* Bytes consumed by the reader */
+    char pad1[56];
+    _Atomic uint32_t data_seq;           /* Futex: bumped after publish */
+    _Atomic uint32_t space_seq;          /* Futex: bumped after consume */
+    _Atomic uint32_t reader_waiting;
+    _Atomic uint32_t writer_waiting;
+    char pad2[48];
+    uint8_t data[NET_SHM_RING_SIZE];
+} shm_ring_t;
+
+typedef struct {
+    uint32_t magic;
+    _Atomic uint32_t state;              /* Futex: SHM_PENDING until accepted */
+    int32_t pid[2];                      /* Client, server */
+    _Atomic uint32_t closed[2];
+    shm_ring_t ring[2];                  /* [0] client to server, [1] back */
+} shm_conn_t;
+
+typedef struct {
+    _Atomic uint64_t seq;
+    uint64_t id;
+} shm_slot_t;
+
+typedef struct {
+    _Atomic uint32_t magic;              /* Set last, once initialised */
+    int32_t pid;
+    _Atomic uint32_t open;
+    _Atomic uint32_t accept_seq;         /* Futex: bumped after enqueue */
+    _Atomic uint32_t acceptor_waiting;
+    _Atomic uint64_t enqueue_pos;
+    shm_slot_t slots[NET_SHM_BACKLOG];
+} shm_queue_t;
+
+typedef struct {
+    shm_conn_t *conn;
+    shm_ring_t *tx;
+    shm_ring_t *rx;
+    int side;                            /* 0 client, 1 server */
+    pid_t peer_pid;
+} shm_link_t;
+
+struct net_shm_listener {
+    shm_queue_t *queue;
+    uint64_t dequeue_pos;
+    char name[SHM_MAX_NAME + 8];
+};
+
+/*
+ * Helpers
+ */
+
+static int64_t shm_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Spinning only pays off when the peer can run at the same time */
+static int shm_spin_limit(void) {
+    static _Atomic int limit = -1;
+    int value = atomic_load_explicit(&limit, memory_order_relaxed);
+
+    if (value < 0) {
+        value = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SHM_SPIN : 0;
+        atomic_store_explicit(&limit, value, memory_order_relaxed);
+    }
+    return value;
+}
+
+static inline void shm_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/* Sleep while *word == expected, at most until deadline and never
+ * longer than SHM_LIVENESS_MS (-1 with ETIMEDOUT once past deadline) */
+static int shm_futex_wait(_Atomic uint32_t *word, uint32_t expected, int64_t deadline) {
+    int64_t wait_ms = SHM_LIVENESS_MS;
+    struct timespec ts;
+
+    if (deadline >= 0) {
+        int64_t left = deadline - shm_now_ms();
+        if (left <= 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        if (left < wait_ms) {
+            wait_ms = left;
+        }
+    }
+    ts.tv_sec = (time_t)(wait_ms / 1000);
+    ts.tv_nsec = (long)(wait_ms % 1000) * 1000000L;
+    syscall(SYS_futex, (void*)word, FUTEX_WAIT, expected, &ts, NULL, 0);
+    return 0;
+}
+
+static void shm_futex_wake(_Atomic uint32_t *word) {
+    syscall(SYS_futex, (void*)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static int shm_pid_alive(pid_t pid) {
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+/* Parse shm://name into the listener segment name "/chord-name" */
+static int shm_queue_name(const char *url, char *name, size_t size) {
+    const char *base;
+
+    if (strncmp(url, "shm://", 6) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    base = url + 6;
+    if (base[0] == '\0' || strlen(base) > SHM_MAX_NAME || strchr(base, '/')) {
+        errno = EINVAL;
+        return -1;
+    }
+    snprintf(name, size, "/chord-%s", base);
+    return 0;
+}
+
+static void shm_conn_name(char *name, size_t size, const char *queue_name, uint64_t id) {
+    snprintf(name, size, "%s.%u.%u", queue_name, (unsigned)(id >> 32), (unsigned)id);
+}
+
+static void* shm_map(const char *name, int flags, size_t size) {
+    void *addr;
+    int fd = shm_open(name, flags, 0600);
+
+    if (fd < 0) {
+        return NULL;
+    }
+    if ((flags & O_CREAT) && ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        if (flags & O_CREAT) {
+            shm_unlink(name);
+        }
+        return NULL;
+    }
+    return addr;
+}
+
+/*
+ * Rings
+ */
+
+static size_t shm_ring_ready(shm_ring_t *ring, int reading) {
+    uint64_t used = atomic_load(&ring->head) - atomic_load(&ring->tail);
+    return (size_t)(reading ? used : NET_SHM_RING_SIZE - used);
+}
+
+/* Wait until the ring has need bytes to read, or free to write.
+ * Returns -1 with ETIMEDOUT, or ECONNRESET/EPIPE if the peer went away
+ * (a reader still drains whatever the peer sent before closing). */
+static int shm_ring_wait(shm_link_t *link, shm_ring_t *ring, int reading, size_t need,
+                         int64_t deadline) {
+    _Atomic uint32_t *seq = reading ? &ring->data_seq : &ring->space_seq;
+    _Atomic uint32_t *waiting = reading ? &ring->reader_waiting : &ring->writer_waiting;
+    _Atomic uint32_t *peer_closed = &link->conn->closed[!link->side];
+    int spins = deadline < 0 || deadline > shm_now_ms() ? shm_spin_limit() : 0;
+
+    for (;;) {
+        uint32_t expected;
+
+        if (shm_ring_ready(ring, reading) >= need) {
+            return 0;
+        }
+        if (atomic_load(peer_closed)) {
+            errno = reading ? ECONNRESET : EPIPE;
+            return -1;
+        }
+        if (spins > 0) {
+            spins--;
+            shm_cpu_relax();
+            continue;
+        }
+
+        atomic_store(waiting, 1);
+        expected = atomic_load(seq);
+        if (shm_ring_ready(ring, reading) < need && !atomic_load(peer_closed)) {
+            if (shm_futex_wait(seq, expected, deadline) != 0) {
+                atomic_store(waiting, 0);
+                return -1;
+            }
+        }
+        atomic_store(waiting, 0);
+
+        if (!shm_pid_alive(link->peer_pid)) {
+            errno = reading ? ECONNRESET : EPIPE;
+            return -1;
+        }
+    }
+}
+
+static void shm_ring_put(shm_ring_t *ring, uint64_t pos, const void *src, size_t len) {
+    size_t offset = (size_t)(pos & SHM_RING_MASK);
+    size_t first = len < NET_SHM_RING_SIZE - offset ? len : NET_SHM_RING_SIZE - offset;
+
+    if (len == 0) {
+        return;
+    }
+    memcpy(ring->data + offset, src, first);
+    memcpy(ring->data, (const uint8_t*)src + first, len - first);
+}
+
+static void shm_ring_get(const shm_ring_t *ring, uint64_t pos, void *dst, size_t len) {
+    size_t offset = (size_t)(pos & SHM_RING_MASK);
+    size_t first = len < NET_SHM_RING_SIZE - offset ? len : NET_SHM_RING_SIZE - offset;
+
+    if (len == 0) {
+        return;
+    }
+    memcpy(dst, ring->data + offset, first);
+    memcpy((uint8_t*)dst + first, ring->data, len - first);
+}
+
+static void shm_ring_publish(shm_ring_t *ring, size_t len) {
+    atomic_store(&ring->head, atomic_load_explicit(&ring->head, memory_order_relaxed) + len);
+    atomic_fetch_add(&ring->data_seq, 1);
+    if (atomic_load(&ring->reader_waiting)) {
+        shm_futex_wake(&ring->data_seq);
+    }
+}
+
+static void shm_ring_consume(shm_ring_t *ring, size_t len) {
+    atomic_store(&ring->tail, atomic_load_explicit(&ring->tail, memory_order_relaxed) + len);
+    atomic_fetch_add(&ring->space_seq, 1);
+    if (atomic_load(&ring->writer_waiting)) {
+        shm_futex_wake(&ring->space_seq);
+    }
+}
+
+/*
+ * Connections
+ */
+
+static int shm_attach(net_transport_t *transport, shm_conn_t *conn, int side) {
+    shm_link_t *link = (shm_link_t*)calloc(1, sizeof(shm_link_t));
+
+    if (!link) {
+        errno = ENOMEM;
+        return -1;
+    }
+    link->conn = conn;
+    link->side = side;
+    link->tx = &conn->ring[side];
+    link->rx = &conn->ring[!side];
+    link->peer_pid = conn->pid[!side];
+    transport->impl_data = link;
+    transport->connected = 1;
+    return 0;
+}
+
+/* Queue a connection ID for the acceptor (-1 if the backlog is full) */
+static int shm_enqueue(shm_queue_t *queue, uint64_t id) {
+    uint64_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+
+    for (;;) {
+        shm_slot_t *slot = &queue->slots[pos & (NET_SHM_BACKLOG - 1)];
+        int64_t diff = (int64_t)(atomic_load_explicit(&slot->seq, memory_order_acquire) - pos);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak(&queue->enqueue_pos, &pos, pos + 1)) {
+                slot->id = id;
+                atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return -1;
+        }
+        else {
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    atomic_fetch_add(&queue->accept_seq, 1);
+    if (atomic_load(&queue->acceptor_waiting)) {
+        shm_futex_wake(&queue->accept_seq);
+    }
+    return 0;
+}
+
+int net_shm_connect(net_transport_t *transport, const char *url, int timeout_ms) {
+    static _Atomic uint32_t next_conn = 0;
+    int64_t deadline = timeout_ms < 0 ? -1 : shm_now_ms() + timeout_ms;
+    char queue_name[SHM_MAX_NAME + 8];
+    char conn_name[SHM_MAX_NAME + 32];
+    shm_queue_t *queue;
+    shm_conn_t *conn;
+    uint64_t id;
+    pid_t listener_pid;
+
+    if (shm_queue_name(url, queue_name, sizeof(queue_name)) != 0) {
+        return -1;
+    }
+
+    queue = (shm_queue_t*)shm_map(queue_name, O_RDWR, sizeof(shm_queue_t));
+    if (!queue || atomic_load(&queue->magic) != SHM_MAGIC ||
+        !atomic_load(&queue->open) || !shm_pid_alive(queue->pid)) {
+        if (queue) {
+            munmap(queue, sizeof(shm_queue_t));
+        }
+        errno = ECONNREFUSED;
+        return -1;
+    }
+    listener_pid = queue->pid;
+
+    id = (uint64_t)getpid() << 32 | (atomic_fetch_add(&next_conn, 1) + 1);
+    shm_conn_name(conn_name, sizeof(conn_name), queue_name, id);
+    conn = (shm_conn_t*)shm_map(conn_name, O_RDWR | O_CREAT | O_EXCL, sizeof(shm_conn_t));
+    if (!conn) {
+        munmap(queue, sizeof(shm_queue_t));
+        return -1;
+    }
+    conn->magic = SHM_MAGIC;
+    conn->pid[0] = getpid();
+
+    if (shm_enqueue(queue, id) != 0) {
+        atomic_store(&conn->state, SHM_REFUSED);
+    }
+
+    /* Wait for the acceptor; on timeout withdraw unless it just won */
+    while (atomic_load(&conn->state) == SHM_PENDING) {
+        int err = 0;
+
+        if (!atomic_load(&queue->open) || !shm_pid_alive(listener_pid)) {
+            err = ECONNREFUSED;
+        }
+        else if (shm_futex_wait(&conn->state, SHM_PENDING, deadline) != 0) {
+            err = ETIMEDOUT;
+        }
+        if (err != 0) {
+            uint32_t pending = SHM_PENDING;
+            if (atomic_compare_exchange_strong(&conn->state, &pending, SHM_REFUSED)) {
+                munmap(queue, sizeof(shm_queue_t));
+                shm_unlink(conn_name);
+                munmap(conn, sizeof(shm_conn_t));
+                errno = err;
+                return -1;
+            }
+        }
+    }
+    munmap(queue, sizeof(shm_queue_t));
+
+    if (atomic_load(&conn->state) != SHM_ACCEPTED) {
+        shm_unlink(conn_name);
+        munmap(conn, sizeof(shm_conn_t));
+        errno = ECONNREFUSED;
+        return -1;
+    }
+    if (shm_attach(transport, conn, 0) != 0) {
+        atomic_store(&conn->closed[0], 1);
+        munmap(conn, sizeof(shm_conn_t));
+        return -1;
+    }
+    return 0;
+}
+
+/* Nothing of the frame was written: only a vanished peer closes */
+static int shm_send_failed(net_transport_t *transport, int timeout_ms) {
+    int err = errno;
+
+    if (err == EPIPE) {
+        net_shm_close(transport);
+    }
+    else if (err == ETIMEDOUT && timeout_ms == 0) {
+        err = EAGAIN;
+    }
+    errno = err;
+    return -1;
+}
+
+int net_shm_send(net_transport_t *transport, const void *data, size_t len, int timeout_ms) {
+    shm_link_t *link = (shm_link_t*)transport->impl_data;
+    int64_t deadline = timeout_ms < 0 ? -1 : shm_now_ms() + timeout_ms;
+    shm_ring_t *ring = link->tx;
+    uint8_t header[SHM_FRAME_HEADER];
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t total = SHM_FRAME_HEADER + len;
+    size_t sent;
+
+    header[0] = (uint8_t)(len >> 24);
+    header[1] = (uint8_t)(len >> 16);
+    header[2] = (uint8_t)(len >> 8);
+    header[3] = (uint8_t)len;
+
+    if (total <= NET_SHM_RING_SIZE) {
+        if (shm_ring_wait(link, ring, 0, total, deadline) != 0) {
+            return shm_send_failed(transport, timeout_ms);
+        }
+        shm_ring_put(ring, head, header, SHM_FRAME_HEADER);
+        shm_ring_put(ring, head + SHM_FRAME_HEADER, data, len);
+        shm_ring_publish(ring, total);
+        return 0;
+    }
+
+    /* Larger than the ring: stream it, publishing as space frees up */
+    if (shm_ring_wait(link, ring, 0, SHM_FRAME_HEADER, deadline) != 0) {
+        return shm_send_failed(transport, timeout_ms);
+    }
+    shm_ring_put(ring, head, header, SHM_FRAME_HEADER);
+    shm_ring_publish(ring, SHM_FRAME_HEADER);
+
+    for (sent = 0; sent < len; ) {
+        size_t chunk;
+
+        if (shm_ring_wait(link, ring, 0, 1, deadline) != 0) {
+            int err = errno;
+            net_shm_close(transport);  /* Stream can no longer be framed */
+            errno = err;
+            return -1;
+        }
+        chunk = shm_ring_ready(ring, 0);
+        if (chunk > len - sent) {
+            chunk = len - sent;
+        }
+        shm_ring_put(ring, atomic_load_explicit(&ring->head, memory_order_relaxed),
+                     (const uint8_t*)data + sent, chunk);
+        shm_ring_publish(ring, chunk);
+        sent += chunk;
+    }
+    return 0;
+}
+
+int net_shm_recv(net_transport_t *transport, void *buffer, size_t buffer_size, int timeout_ms) {
+    shm_link_t *link = (shm_link_t*)transport->impl_data;
+    int64_t deadline = timeout_ms < 0 ? -1 : shm_now_ms() + timeout_ms;
+    shm_ring_t *ring = link->rx;
+    uint8_t header[SHM_FRAME_HEADER];
+    size_t len, total, got;
+    int err;
+
+    if (shm_ring_wait(link, ring, 1, SHM_FRAME_HEADER, deadline) != 0) {
+        goto fail;
+    }
+    shm_ring_get(ring, atomic_load_explicit(&ring->tail, memory_order_relaxed), header, SHM_FRAME_HEADER);
+    len = (size_t)header[0] << 24 | (size_t)header[1] << 16 | (size_t)header[2] << 8 | header[3];
+    if (len > NET_TRANSPORT_MAX_FRAME) {
+        net_shm_close(transport);
+        errno = EMSGSIZE;
+        return -1;
+    }
+    total = SHM_FRAME_HEADER + len;
+
+    if (total <= NET_SHM_RING_SIZE) {
+        if (shm_ring_wait(link, ring, 1, total, deadline) != 0) {
+            goto fail;  /* Partial frame stays in the ring */
+        }
+        if (len <= buffer_size) {
+            shm_ring_get(ring, atomic_load_explicit(&ring->tail, memory_order_relaxed) + SHM_FRAME_HEADER,
+                         buffer, len);
+        }
+        shm_ring_consume(ring, total);
+    }
+    else {
+        /* Larger than the ring: consume it as it streams in */
+        shm_ring_consume(ring, SHM_FRAME_HEADER);
+        for (got = 0; got < len; ) {
+            size_t chunk;
+
+            if (shm_ring_wait(link, ring, 1, 1, deadline) != 0) {
+                err = errno;
+                net_shm_close(transport);
+                errno = err;
+                return -1;
+            }
+            chunk = shm_ring_ready(ring, 1);
+            if (chunk > len - got) {
+                chunk = len - got;
+            }
+            if (got < buffer_size) {
+                shm_ring_get(ring, atomic_load_explicit(&ring->tail, memory_order_relaxed),
+                             (uint8_t*)buffer + got, chunk < buffer_size - got ? chunk : buffer_size - got);
+            }
+            shm_ring_consume(ring, chunk);
+            got += chunk;
+        }
+    }
+
+    if (len > buffer_size) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    return (int)len;
+
+fail:
+    err = errno;
+    if (err == ECONNRESET) {
+        net_shm_close(transport);
+    }
+    else if (err == ETIMEDOUT && timeout_ms == 0) {
+        err = EAGAIN;
+    }
+    errno = err;
+    return -1;
+}
+
+void net_shm_close(net_transport_t *transport) {
+    shm_link_t *link = (shm_link_t*)transport->impl_data;
+
+    if (!link) {
+        return;
+    }
+
+    /* Wake the peer wherever it sleeps so it sees the close */
+    atomic_store(&link->conn->closed[link->side], 1);
+    atomic_fetch_add(&link->tx->data_seq, 1);
+    shm_futex_wake(&link->tx->data_seq);
+    atomic_fetch_add(&link->rx->space_seq, 1);
+    shm_futex_wake(&link->rx->space_seq);
+
+    munmap(link->conn, sizeof(shm_conn_t));
+    free(link);
+    transport->impl_data = NULL;
+    transport->connected = 0;
+}
+
+/*
+ * Listener
+ */
+
+net_shm_listener_t* net_shm_listen(const char *url) {
+    net_shm_listener_t *listener = (net_shm_listener_t*)calloc(1, sizeof(net_shm_listener_t));
+    shm_queue_t *queue;
+
+    if (!listener) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (shm_queue_name(url, listener->name, sizeof(listener->name)) != 0) {
+        free(listener);
+        return NULL;
+    }
+
+    queue = (shm_queue_t*)shm_map(listener->name, O_RDWR | O_CREAT | O_EXCL, sizeof(shm_queue_t));
+    if (!queue && errno == EEXIST) {
+        /* Replace a queue left by a listener that is gone, nothing else */
+        shm_queue_t *old = (shm_queue_t*)shm_map(listener->name, O_RDWR, sizeof(shm_queue_t));
+        int stale = !old || !atomic_load(&old->open) || !shm_pid_alive(old->pid);
+
+        if (old) {
+            munmap(old, sizeof(shm_queue_t));
+        }
+        if (!stale) {
+            free(listener);
+            errno = EADDRINUSE;
+            return NULL;
+        }
+        shm_unlink(listener->name);
+        queue = (shm_queue_t*)shm_map(listener->name, O_RDWR | O_CREAT | O_EXCL, sizeof(shm_queue_t));
+    }
+    if (!queue) {
+        free(listener);
+        return NULL;
+    }
+
+    for (uint64_t i = 0; i < NET_SHM_BACKLOG; i++) {
+        atomic_init(&queue->slots[i].seq, i);
+    }
+    queue->pid = getpid();
+    atomic_store(&queue->open, 1);
+    atomic_store(&queue->magic, SHM_MAGIC);
+    listener->queue = queue;
+    return listener;
+}
+
+/* Take the next queued connection ID (0 if none) */
+static uint64_t shm_dequeue(net_shm_listener_t *listener) {
+    shm_slot_t *slot = &listener->queue->slots[listener->dequeue_pos & (NET_SHM_BACKLOG - 1)];
+    uint64_t id;
+
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != listener->dequeue_pos + 1) {
+        return 0;
+    }
+    id = slot->id;
+    atomic_store_explicit(&slot->seq, listener->dequeue_pos + NET_SHM_BACKLOG, memory_order_release);
+    listener->dequeue_pos++;
+    return id;
+}
+
+/* Map a queued connection and settle its state (accept or refuse) */
+static shm_conn_t* shm_claim(net_shm_listener_t *listener, uint64_t id, uint32_t outcome) {
+    char conn_name[SHM_MAX_NAME + 32];
+    uint32_t pending = SHM_PENDING;
+    shm_conn_t *conn;
+
+    shm_conn_name(conn_name, sizeof(conn_name), listener->name, id);
+    conn = (shm_conn_t*)shm_map(conn_name, O_RDWR, sizeof(shm_conn_t));
+    if (!conn) {
+        return NULL;  /* Client gave up and removed it */
+    }
+    shm_unlink(conn_name);
+
+    conn->pid[1] = getpid();
+    if (conn->magic != SHM_MAGIC ||
+        !atomic_compare_exchange_strong(&conn->state, &pending, outcome)) {
+        munmap(conn, sizeof(shm_conn_t));
+        return NULL;
+    }
+    shm_futex_wake(&conn->state);
+    return conn;
+}
+
+net_transport_t* net_shm_accept(net_shm_listener_t *listener, int timeout_ms) {
+    int64_t deadline = timeout_ms < 0 ? -1 : shm_now_ms() + timeout_ms;
+    shm_queue_t *queue = listener->queue;
+
+    for (;;) {
+        uint64_t id = shm_dequeue(listener);
+        uint32_t expected;
+
+        if (id != 0) {
+            shm_conn_t *conn = shm_claim(listener, id, SHM_ACCEPTED);
+            net_transport_t *client;
+
+            if (!conn) {
+                continue;
+            }
+            client = net_transport_create(NET_TRANSPORT_SHM);
+            if (!client || shm_attach(client, conn, 1) != 0) {
+                atomic_store(&conn->closed[1], 1);
+                munmap(conn, sizeof(shm_conn_t));
+                net_transport_destroy(client);
+                errno = ENOMEM;
+                return NULL;
+            }
+            return client;
+        }
+
+        if (timeout_ms == 0) {
+            errno = EAGAIN;
+            return NULL;
+        }
+        atomic_store(&queue->acceptor_waiting, 1);
+        expected = atomic_load(&queue->accept_seq);
+        if (atomic_load(&queue->slots[listener->dequeue_pos & (NET_SHM_BACKLOG - 1)].seq) !=
+            listener->dequeue_pos + 1 &&
+            shm_futex_wait(&queue->accept_seq, expected, deadline) != 0) {
+            atomic_store(&queue->acceptor_waiting, 0);
+            return NULL;
+        }
+        atomic_store(&queue->acceptor_waiting, 0);
+    }
+}
+
+void net_shm_listener_close(net_shm_listener_t *listener) {
+    uint64_t id;
+
+    if (!listener) {
+        return;
+    }
+
+    /* Stop new connections, then refuse the ones already queued */
+    atomic_store(&listener->queue->open, 0);
+    shm_unlink(listener->name);
+    while ((id = shm_dequeue(listener)) != 0) {
+        shm_conn_t *conn = shm_claim(listener, id, SHM_REFUSED);
+        if (conn) {
+            munmap(conn, sizeof(shm_conn_t));
+        }
+    }
+
+    munmap(listener->queue, sizeof(shm_queue_t));
+    free(listener);
+}
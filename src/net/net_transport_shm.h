@@ -0,0 +1,31 @@
+#ifndef NET_TRANSPORT_SHM_H
+#define NET_TRANSPORT_SHM_H
+
+#include "net_transport.h"
+
+/*
+ * Shared-memory transport (NET_TRANSPORT_SHM, shm://name URLs)
+ *
+ * Internal to net_transport.c, which dispatches here for SHM
+ * transports; callers use the net_transport_* API. Connected
+ * transports keep their link in impl_data (NULL when closed).
+ */
+
+/* Ring capacity per direction; larger frames are streamed through */
+#define NET_SHM_RING_SIZE (64 * 1024)
+
+/* Accept queue capacity (connections waiting for accept) */
+#define NET_SHM_BACKLOG 1024
+
+typedef struct net_shm_listener net_shm_listener_t;
+
+int net_shm_connect(net_transport_t *transport, const char *url, int timeout_ms);
+int net_shm_send(net_transport_t *transport, const void *data, size_t len, int timeout_ms);
+int net_shm_recv(net_transport_t *transport, void *buffer, size_t buffer_size, int timeout_ms);
+void net_shm_close(net_transport_t *transport);
+
+net_shm_listener_t* net_shm_listen(const char *url);
+net_transport_t* net_shm_accept(net_shm_listener_t *listener, int timeout_ms);
+void net_shm_listener_close(net_shm_listener_t *listener);
+
+#endif /* NET_TRANSPORT_SHM_H */
@@ -0,0 +1,872 @@
+#define _GNU_SOURCE
+
+#include "net_transport_uring.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+/*
+ * io_uring engine implementation (raw syscalls, no liburing)
+ *
+ * Receiving: every connection has one multishot RECV armed that picks
+ * buffers from the ring's provided-buffer ring. Each completion is
+ * handed to the connection's sink and the buffer is recycled at once,
+ * so one enter can deliver data for many connections.
+ *
+ * Sending: frames are copied into a registered slot buffer per
+ * connection ("stage") and nothing is submitted until the thread next
+ * enters the kernel. At most one write per connection is in flight,
+ * which keeps the byte stream in order; frames queued meanwhile keep
+ * coalescing in the stage and go out as one write when it completes.
+ * Writes of URING_ZC_MIN bytes or more go out as SEND_ZC from the
+ * registered slot (the only send that takes a fixed buffer), so the
+ * kernel neither pins pages per call nor copies on real NICs; a slot
+ * is reused only after its zero-copy notification. Smaller writes, and
+ * sockets without zero-copy support (Unix), use plain SEND, where the
+ * copy is cheaper than the notification. Frames larger than a slot are
+ * sent from the caller's memory with SENDMSG and waited for.
+ *
+ * Completions carry (connection index, generation, slot, op) in
+ * user_data. A detached connection's index gets a new generation, so
+ * its late completions only return their buffers.
+ */
+
+#define URING_ENTRIES 256
+#define URING_RX_GROUP 1
+#define URING_DETACH_MS 1000
+#define URING_NO_SLOT 0xffffu
+#define URING_ZC_MIN 4096
+
+enum {
+    URING_OP_RECV = 1,
+    URING_OP_SEND,
+    URING_OP_SEND_BIG,
+    URING_OP_CANCEL
+};
+
+typedef struct uring_thread uring_thread_t;
+
+struct net_uring_conn {
+    uring_thread_t *ring;
+    net_uring_conn_t *dirty_next;
+    net_uring_sink_t sink;
+    void *context;
+    int fd;
+    uint32_t index;
+    uint32_t gen;
+    int recv_armed;
+    int rx_done;            /* End of stream or error delivered */
+    int dirty;              /* Stage waiting to be written */
+    unsigned tx_busy;       /* Slot being written */
+    size_t tx_busy_off;
+    size_t tx_busy_len;
+    unsigned tx_stage;      /* Slot collecting frames */
+    size_t tx_stage_len;
+    int tx_error;           /* Sticky errno of a failed write */
+    int tx_no_zc;           /* Socket refused SEND_ZC */
+    int big_pending;
+    int big_result;
+    struct msghdr big_msg;
+    struct iovec big_iov[2];
+};
+
+struct uring_thread {
+    int fd;
+    void *sq_map;
+    size_t sq_map_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sq_pending;    /* Queued but not yet submitted */
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    uint8_t *tx_mem;
+    uint16_t tx_free[NET_URING_TX_SLOTS];
+    unsigned tx_free_count;
+    uint16_t tx_refs[NET_URING_TX_SLOTS];   /* Sends the kernel may still read */
+    uint8_t tx_owned[NET_URING_TX_SLOTS];   /* Held by a connection */
+
+    struct io_uring_buf_ring *rx_ring;
+    size_t rx_ring_len;
+    uint8_t *rx_mem;
+    uint16_t rx_tail;
+
+    net_uring_conn_t **conns;
+    uint32_t *gens;
+    uint32_t *free_ids;
+    uint32_t conn_cap;
+    uint32_t conn_used;     /* Indices ever handed out */
+    uint32_t free_count;
+
+    net_uring_conn_t *dirty;
+    unsigned dirty_count;
+};
+
+static pthread_key_t uring_key;
+static pthread_once_t uring_key_once = PTHREAD_ONCE_INIT;
+static __thread uring_thread_t *uring_self = NULL;
+
+static int64_t uring_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint64_t uring_tag(const net_uring_conn_t *conn, unsigned slot, unsigned op) {
+    return (uint64_t)conn->index << 40 | (uint64_t)(conn->gen & 0xffffu) << 24 |
+           (uint64_t)slot << 8 | op;
+}
+
+/*
+ * Ring setup
+ */
+
+static int uring_sys_setup(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_sys_register(int fd, unsigned opcode, const void *arg, unsigned nr) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr);
+}
+
+/* Ring fd with the features the engine relies on, or -1 */
+static int uring_open(unsigned entries, struct io_uring_params *params) {
+    const unsigned needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    int fd;
+
+    memset(params, 0, sizeof(*params));
+    params->flags = IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SUBMIT_ALL;
+    fd = uring_sys_setup(entries, params);
+    if (fd < 0 && errno == EINVAL) {
+        memset(params, 0, sizeof(*params));
+        fd = uring_sys_setup(entries, params);
+    }
+    if (fd >= 0 && (params->features & needed) != needed) {
+        close(fd);
+        errno = ENOSYS;
+        return -1;
+    }
+    return fd;
+}
+
+int net_uring_supported(void) {
+    static _Atomic int supported = -1;
+    int result = atomic_load(&supported);
+
+    if (result < 0) {
+        struct io_uring_params params;
+        struct io_uring_probe *probe;
+        struct io_uring_buf_reg reg;
+        void *buf_ring;
+        int fd = uring_open(4, &params);
+
+        result = 0;
+        probe = (struct io_uring_probe*)calloc(1, sizeof(*probe) + 256 * sizeof(struct io_uring_probe_op));
+        buf_ring = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (fd >= 0 && probe && buf_ring != MAP_FAILED &&
+            uring_sys_register(fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+            probe->last_op >= IORING_OP_SEND_ZC &&
+            (probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED)) {
+            /* SEND_ZC arrived with multishot recv and fixed-buffer send */
+            memset(&reg, 0, sizeof(reg));
+            reg.ring_addr = (uint64_t)(uintptr_t)buf_ring;
+            reg.ring_entries = 1;
+            reg.bgid = URING_RX_GROUP;
+            result = uring_sys_register(fd, IORING_REGISTER_PBUF_RING, &reg, 1) == 0;
+        }
+        if (buf_ring != MAP_FAILED) {
+            munmap(buf_ring, 4096);
+        }
+        free(probe);
+        if (fd >= 0) {
+            close(fd);
+        }
+        atomic_store(&supported, result);
+    }
+    return result;
+}
+
+static void uring_rx_recycle(uring_thread_t *r, unsigned bid) {
+    struct io_uring_buf *buf = &r->rx_ring->bufs[r->rx_tail & (NET_URING_RX_BUFS - 1)];
+
+    buf->addr = (uint64_t)(uintptr_t)(r->rx_mem + (size_t)bid * NET_URING_RX_BUF_SIZE);
+    buf->len = NET_URING_RX_BUF_SIZE;
+    buf->bid = (uint16_t)bid;
+    r->rx_tail++;
+    __atomic_store_n(&r->rx_ring->tail, r->rx_tail, __ATOMIC_RELEASE);
+}
+
+static void uring_thread_destroy(void *arg) {
+    uring_thread_t *r = (uring_thread_t*)arg;
+
+    if (!r) {
+        return;
+    }
+    if (r->fd >= 0) {
+        close(r->fd);  /* Cancels whatever is still in flight */
+    }
+    if (r->sq_map && r->sq_map != MAP_FAILED) {
+        munmap(r->sq_map, r->sq_map_len);
+    }
+    if (r->sqes && (void*)r->sqes != MAP_FAILED) {
+        munmap(r->sqes, r->sqes_len);
+    }
+    if (r->rx_ring && (void*)r->rx_ring != MAP_FAILED) {
+        munmap(r->rx_ring, r->rx_ring_len);
+    }
+    free(r->tx_mem);
+    free(r->rx_mem);
+    free(r->conns);
+    free(r->gens);
+    free(r->free_ids);
+    free(r);
+    if (uring_self == r) {
+        uring_self = NULL;
+    }
+}
+
+/* A forked child must not share the parent's ring */
+static void uring_atfork_child(void) {
+    if (uring_self) {
+        uring_thread_destroy(uring_self);
+        pthread_setspecific(uring_key, NULL);
+    }
+}
+
+static void uring_key_create(void) {
+    pthread_key_create(&uring_key, uring_thread_destroy);
+    pthread_atfork(NULL, NULL, uring_atfork_child);
+}
+
+static uring_thread_t* uring_thread_create(void) {
+    struct io_uring_params params;
+    struct iovec iov[NET_URING_TX_SLOTS];
+    struct io_uring_buf_reg reg;
+    uring_thread_t *r = (uring_thread_t*)calloc(1, sizeof(uring_thread_t));
+    uint8_t *sq;
+    size_t cq_len;
+
+    if (!r) {
+        return NULL;
+    }
+    r->fd = uring_open(URING_ENTRIES, &params);
+    if (r->fd < 0) {
+        goto fail;
+    }
+
+    r->sq_map_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (cq_len > r->sq_map_len) {
+        r->sq_map_len = cq_len;
+    }
+    r->sq_map = mmap(NULL, r->sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     r->fd, (off_t)IORING_OFF_SQ_RING);
+    r->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = (struct io_uring_sqe*)mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_POPULATE, r->fd, (off_t)IORING_OFF_SQES);
+    if (r->sq_map == MAP_FAILED || (void*)r->sqes == MAP_FAILED) {
+        goto fail;
+    }
+    sq = (uint8_t*)r->sq_map;
+    r->sq_head = (unsigned*)(sq + params.sq_off.head);
+    r->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    r->sq_array = (unsigned*)(sq + params.sq_off.array);
+    r->sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    r->sq_entries = params.sq_entries;
+    r->cq_head = (unsigned*)(sq + params.cq_off.head);
+    r->cq_tail = (unsigned*)(sq + params.cq_off.tail);
+    r->cq_mask = *(unsigned*)(sq + params.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)(sq + params.cq_off.cqes);
+
+    /* Send slots, registered once so writes skip per-call page pinning */
+    r->tx_mem = (uint8_t*)aligned_alloc(4096, (size_t)NET_URING_TX_SLOTS * NET_URING_TX_SLOT_SIZE);
+    if (!r->tx_mem) {
+        goto fail;
+    }
+    for (unsigned i = 0; i < NET_URING_TX_SLOTS; i++) {
+        iov[i].iov_base = r->tx_mem + (size_t)i * NET_URING_TX_SLOT_SIZE;
+        iov[i].iov_len = NET_URING_TX_SLOT_SIZE;
+        r->tx_free[i] = (uint16_t)(NET_URING_TX_SLOTS - 1 - i);
+    }
+    r->tx_free_count = NET_URING_TX_SLOTS;
+    if (uring_sys_register(r->fd, IORING_REGISTER_BUFFERS, iov, NET_URING_TX_SLOTS) != 0) {
+        goto fail;
+    }
+
+    /* Provided receive buffers */
+    r->rx_ring_len = NET_URING_RX_BUFS * sizeof(struct io_uring_buf);
+    r->rx_ring = (struct io_uring_buf_ring*)mmap(NULL, r->rx_ring_len, PROT_READ | PROT_WRITE,
+                                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    r->rx_mem = (uint8_t*)malloc((size_t)NET_URING_RX_BUFS * NET_URING_RX_BUF_SIZE);
+    if ((void*)r->rx_ring == MAP_FAILED || !r->rx_mem) {
+        goto fail;
+    }
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)r->rx_ring;
+    reg.ring_entries = NET_URING_RX_BUFS;
+    reg.bgid = URING_RX_GROUP;
+    if (uring_sys_register(r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        goto fail;
+    }
+    for (unsigned bid = 0; bid < NET_URING_RX_BUFS; bid++) {
+        uring_rx_recycle(r, bid);
+    }
+    return r;
+
+fail:
+    {
+        int err = errno;
+        uring_thread_destroy(r);
+        errno = err;
+    }
+    return NULL;
+}
+
+static uring_thread_t* uring_thread_get(void) {
+    if (!uring_self) {
+        pthread_once(&uring_key_once, uring_key_create);
+        uring_self = uring_thread_create();
+        if (uring_self) {
+            pthread_setspecific(uring_key, uring_self);
+        }
+    }
+    return uring_self;
+}
+
+/*
+ * Submission and completion
+ */
+
+static int uring_enter(uring_thread_t *r, unsigned min_complete, int64_t deadline_ms) {
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    unsigned flags = IORING_ENTER_GETEVENTS;
+    const void *argp = NULL;
+    size_t argsz = 0;
+
+    if (min_complete > 0 && deadline_ms >= 0) {
+        int64_t left = deadline_ms - uring_now_ms();
+        if (left < 0) {
+            left = 0;
+        }
+        ts.tv_sec = left / 1000;
+        ts.tv_nsec = (left % 1000) * 1000000;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        argp = &arg;
+        argsz = sizeof(arg);
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+
+    for (;;) {
+        int ret = (int)syscall(__NR_io_uring_enter, r->fd, r->sq_pending, min_complete,
+                               flags, argp, argsz);
+        if (ret >= 0) {
+            r->sq_pending -= (unsigned)ret < r->sq_pending ? (unsigned)ret : r->sq_pending;
+            return 0;
+        }
+        if (errno == ETIME) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+/* Next free SQE, zeroed; submits the queue first if it is full */
+static struct io_uring_sqe* uring_sqe(uring_thread_t *r) {
+    unsigned tail = *r->sq_tail;
+    struct io_uring_sqe *sqe;
+
+    if (tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries) {
+        uring_enter(r, 0, -1);
+    }
+    sqe = &r->sqes[tail & r->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    r->sq_array[tail & r->sq_mask] = tail & r->sq_mask;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->sq_pending++;
+    return sqe;
+}
+
+static void uring_arm_recv(net_uring_conn_t *conn) {
+    struct io_uring_sqe *sqe = uring_sqe(conn->ring);
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_RX_GROUP;
+    sqe->user_data = uring_tag(conn, URING_NO_SLOT, URING_OP_RECV);
+    conn->recv_armed = 1;
+}
+
+static unsigned uring_slot_take(uring_thread_t *r) {
+    unsigned slot = r->tx_free[--r->tx_free_count];
+
+    r->tx_owned[slot] = 1;
+    return slot;
+}
+
+/* Back to the pool once no connection holds it and the kernel is done */
+static void uring_slot_put(uring_thread_t *r, unsigned slot) {
+    if (!r->tx_owned[slot] && r->tx_refs[slot] == 0) {
+        r->tx_free[r->tx_free_count++] = (uint16_t)slot;
+    }
+}
+
+static void uring_slot_release(uring_thread_t *r, unsigned slot) {
+    r->tx_owned[slot] = 0;
+    uring_slot_put(r, slot);
+}
+
+static void uring_write_busy(net_uring_conn_t *conn) {
+    uring_thread_t *r = conn->ring;
+    struct io_uring_sqe *sqe = uring_sqe(r);
+    size_t len = conn->tx_busy_len - conn->tx_busy_off;
+
+    sqe->opcode = IORING_OP_SEND;
+    if (len >= URING_ZC_MIN && !conn->tx_no_zc) {
+        sqe->opcode = IORING_OP_SEND_ZC;
+        sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+        sqe->buf_index = (uint16_t)conn->tx_busy;
+    }
+    sqe->fd = conn->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(r->tx_mem + (size_t)conn->tx_busy * NET_URING_TX_SLOT_SIZE +
+                                      conn->tx_busy_off);
+    sqe->len = (uint32_t)len;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = uring_tag(conn, conn->tx_busy, URING_OP_SEND);
+    r->tx_refs[conn->tx_busy]++;
+}
+
+/* Start writing the stage (no write may be in flight) */
+static void uring_promote(net_uring_conn_t *conn) {
+    conn->tx_busy = conn->tx_stage;
+    conn->tx_busy_off = 0;
+    conn->tx_busy_len = conn->tx_stage_len;
+    conn->tx_stage = URING_NO_SLOT;
+    conn->tx_stage_len = 0;
+    uring_write_busy(conn);
+}
+
+static void uring_cancel(net_uring_conn_t *conn, uint64_t target) {
+    struct io_uring_sqe *sqe = uring_sqe(conn->ring);
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = uring_tag(conn, URING_NO_SLOT, URING_OP_CANCEL);
+}
+
+static void uring_complete(uring_thread_t *r, uint64_t user_data, int res, unsigned flags) {
+    unsigned op = (unsigned)(user_data & 0xff);
+    unsigned slot = (unsigned)(user_data >> 8) & 0xffffu;
+    uint32_t gen = (uint32_t)(user_data >> 24) & 0xffffu;
+    uint32_t index = (uint32_t)(user_data >> 40);
+    net_uring_conn_t *conn = NULL;
+
+    if (index < r->conn_used && r->conns[index] && (r->gens[index] & 0xffffu) == gen) {
+        conn = r->conns[index];
+    }
+
+    switch (op) {
+    case URING_OP_RECV:
+        if (flags & IORING_CQE_F_BUFFER) {
+            unsigned bid = flags >> IORING_CQE_BUFFER_SHIFT;
+            if (conn && res > 0) {
+                conn->sink(conn->context, r->rx_mem + (size_t)bid * NET_URING_RX_BUF_SIZE, res);
+            }
+            uring_rx_recycle(r, bid);
+        }
+        if (!conn) {
+            break;
+        }
+        if (!(flags & IORING_CQE_F_MORE)) {
+            conn->recv_armed = 0;  /* Re-armed by the next wait */
+        }
+        if ((res == 0 || (res < 0 && res != -ENOBUFS && res != -ECANCELED)) && !conn->rx_done) {
+            conn->rx_done = 1;
+            conn->sink(conn->context, NULL, res);
+        }
+        break;
+
+    case URING_OP_SEND:
+        if (flags & IORING_CQE_F_NOTIF) {
+            r->tx_refs[slot]--;  /* Zero-copy send done with the slot */
+            uring_slot_put(r, slot);
+            break;
+        }
+        if (!(flags & IORING_CQE_F_MORE)) {
+            r->tx_refs[slot]--;  /* No notification follows */
+        }
+        if (!conn) {
+            uring_slot_release(r, slot);
+            break;
+        }
+        if (res == -EOPNOTSUPP && !conn->tx_no_zc) {
+            conn->tx_no_zc = 1;
+            uring_write_busy(conn);
+            break;
+        }
+        if (res > 0 && conn->tx_busy_off + (size_t)res < conn->tx_busy_len) {
+            conn->tx_busy_off += (size_t)res;
+            uring_write_busy(conn);  /* Short write: send the rest */
+            break;
+        }
+        if (res < 0) {
+            conn->tx_error = -res;
+        }
+        uring_slot_release(r, slot);
+        conn->tx_busy = URING_NO_SLOT;
+        if (conn->tx_stage != URING_NO_SLOT && !conn->tx_error) {
+            uring_promote(conn);
+        }
+        break;
+
+    case URING_OP_SEND_BIG:
+        if (conn) {
+            conn->big_pending = 0;
+            conn->big_result = res;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+static unsigned uring_reap(uring_thread_t *r) {
+    unsigned head = *r->cq_head;
+    unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    unsigned count = 0;
+
+    while (head != tail) {
+        const struct io_uring_cqe *cqe = &r->cqes[head & r->cq_mask];
+        uint64_t user_data = cqe->user_data;
+        int res = cqe->res;
+        unsigned flags = cqe->flags;
+
+        __atomic_store_n(r->cq_head, ++head, __ATOMIC_RELEASE);
+        uring_complete(r, user_data, res, flags);
+        count++;
+        if (head == tail) {
+            tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+        }
+    }
+    return count;
+}
+
+/* Start writes for every connection with a stage and nothing in flight */
+static void uring_flush_dirty(uring_thread_t *r) {
+    while (r->dirty) {
+        net_uring_conn_t *conn = r->dirty;
+
+        r->dirty = conn->dirty_next;
+        conn->dirty = 0;
+        if (conn->tx_busy == URING_NO_SLOT && conn->tx_stage != URING_NO_SLOT) {
+            uring_promote(conn);
+        }
+    }
+    r->dirty_count = 0;
+}
+
+/* Submit queued work and reap; wait for one completion unless nowait.
+ * Returns completions reaped, or -1 (ETIMEDOUT) */
+static int uring_progress(uring_thread_t *r, int64_t deadline_ms, int nowait) {
+    unsigned reaped;
+
+    uring_flush_dirty(r);
+    reaped = uring_reap(r);
+    if (reaped > 0 || nowait) {
+        if (r->sq_pending > 0) {
+            uring_enter(r, 0, -1);
+        }
+        return (int)(reaped + uring_reap(r));
+    }
+    if (uring_enter(r, 1, deadline_ms) != 0) {
+        return -1;
+    }
+    return (int)uring_reap(r);
+}
+
+/*
+ * Connections
+ */
+
+net_uring_conn_t* net_uring_attach(int fd, net_uring_sink_t sink, void *context) {
+    uring_thread_t *r = uring_thread_get();
+    net_uring_conn_t *conn;
+    uint32_t index;
+    int fl;
+
+    if (!r) {
+        return NULL;
+    }
+
+    if (r->free_count == 0 && r->conn_used == r->conn_cap) {
+        uint32_t cap = r->conn_cap ? r->conn_cap * 2 : 64;
+        net_uring_conn_t **conns = (net_uring_conn_t**)realloc(r->conns, cap * sizeof(*conns));
+        uint32_t *gens;
+        uint32_t *ids;
+
+        if (conns) {
+            r->conns = conns;
+        }
+        gens = (uint32_t*)realloc(r->gens, cap * sizeof(*gens));
+        if (gens) {
+            r->gens = gens;
+        }
+        ids = (uint32_t*)realloc(r->free_ids, cap * sizeof(*ids));
+        if (ids) {
+            r->free_ids = ids;
+        }
+        if (!conns || !gens || !ids) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        r->conn_cap = cap;
+    }
+
+    conn = (net_uring_conn_t*)calloc(1, sizeof(net_uring_conn_t));
+    if (!conn) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    /* Blocking mode lets the ring arm poll for the socket itself */
+    fl = fcntl(fd, F_GETFL);
+    if (fl >= 0) {
+        fcntl(fd, F_SETFL, fl & ~O_NONBLOCK);
+    }
+
+    if (r->free_count > 0) {
+        index = r->free_ids[--r->free_count];
+    }
+    else {
+        index = r->conn_used++;
+        r->gens[index] = 0;
+    }
+    r->conns[index] = conn;
+
+    conn->ring = r;
+    conn->sink = sink;
+    conn->context = context;
+    conn->fd = fd;
+    conn->index = index;
+    conn->gen = r->gens[index];
+    conn->tx_busy = URING_NO_SLOT;
+    conn->tx_stage = URING_NO_SLOT;
+    uring_arm_recv(conn);
+    return conn;
+}
+
+static int uring_send_big(net_uring_conn_t *conn, const uint8_t *header, size_t header_len,
+                          const void *data, size_t len, int64_t deadline_ms, int nowait) {
+    uring_thread_t *r = conn->ring;
+    size_t left = header_len + len;
+
+    /* Earlier frames first */
+    while (conn->tx_busy != URING_NO_SLOT || conn->tx_stage != URING_NO_SLOT) {
+        if (conn->tx_error) {
+            errno = conn->tx_error;
+            return -1;
+        }
+        if (nowait) {
+            uring_progress(r, deadline_ms, 1);
+            if (conn->tx_busy != URING_NO_SLOT || conn->tx_stage != URING_NO_SLOT) {
+                errno = EAGAIN;
+                return -1;
+            }
+        }
+        else if (uring_progress(r, deadline_ms, 0) < 0) {
+            return -1;
+        }
+    }
+
+    conn->big_iov[0].iov_base = (void*)(uintptr_t)header;
+    conn->big_iov[0].iov_len = header_len;
+    conn->big_iov[1].iov_base = (void*)(uintptr_t)data;
+    conn->big_iov[1].iov_len = len;
+    memset(&conn->big_msg, 0, sizeof(conn->big_msg));
+    conn->big_msg.msg_iov = conn->big_iov;
+    conn->big_msg.msg_iovlen = 2;
+
+    while (left > 0) {
+        struct io_uring_sqe *sqe = uring_sqe(r);
+        size_t done;
+
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = conn->fd;
+        sqe->addr = (uint64_t)(uintptr_t)&conn->big_msg;
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        sqe->user_data = uring_tag(conn, URING_NO_SLOT, URING_OP_SEND_BIG);
+        conn->big_pending = 1;
+
+        while (conn->big_pending) {
+            if (uring_progress(r, deadline_ms < 0 ? -1 : deadline_ms, 0) < 0) {
+                /* The kernel must be done with the caller's memory before
+                 * we return; the stream is broken either way */
+                uring_cancel(conn, uring_tag(conn, URING_NO_SLOT, URING_OP_SEND_BIG));
+                while (conn->big_pending) {
+                    uring_progress(r, -1, 0);
+                }
+                conn->tx_error = ECONNABORTED;
+                errno = ETIMEDOUT;
+                return -1;
+            }
+        }
+        if (conn->big_result <= 0) {
+            conn->tx_error = conn->big_result < 0 ? -conn->big_result : EPIPE;
+            errno = conn->tx_error;
+            return -1;
+        }
+
+        done = (size_t)conn->big_result;
+        left -= done;
+        while (done > 0) {
+            struct iovec *iov = conn->big_msg.msg_iov;
+            size_t step = done < iov->iov_len ? done : iov->iov_len;
+            iov->iov_base = (uint8_t*)iov->iov_base + step;
+            iov->iov_len -= step;
+            done -= step;
+            if (iov->iov_len == 0) {
+                conn->big_msg.msg_iov++;
+                conn->big_msg.msg_iovlen--;
+            }
+        }
+    }
+    return 0;
+}
+
+int net_uring_send(net_uring_conn_t *conn, const uint8_t *header, size_t header_len,
+                   const void *data, size_t len, int64_t deadline_ms, int nowait) {
+    uring_thread_t *r = conn->ring;
+    size_t total = header_len + len;
+    uint8_t *stage;
+
+    if (conn->tx_error) {
+        errno = conn->tx_error;
+        return -1;
+    }
+    if (total > NET_URING_TX_SLOT_SIZE) {
+        return uring_send_big(conn, header, header_len, data, len, deadline_ms, nowait);
+    }
+
+    /* Find room: the current stage, or a fresh slot */
+    for (;;) {
+        if (conn->tx_stage != URING_NO_SLOT && conn->tx_stage_len + total <= NET_URING_TX_SLOT_SIZE) {
+            break;
+        }
+        if (conn->tx_stage != URING_NO_SLOT && conn->tx_busy == URING_NO_SLOT) {
+            uring_promote(conn);  /* Full stage, idle link: write it now */
+            continue;
+        }
+        if (conn->tx_stage == URING_NO_SLOT && r->tx_free_count > 0) {
+            conn->tx_stage = uring_slot_take(r);
+            conn->tx_stage_len = 0;
+            break;
+        }
+        if (uring_progress(r, deadline_ms, nowait) <= 0 && nowait) {
+            errno = EAGAIN;
+            return -1;
+        }
+        if (errno == ETIMEDOUT && conn->tx_stage == URING_NO_SLOT && r->tx_free_count == 0) {
+            return -1;
+        }
+        if (conn->tx_error) {
+            errno = conn->tx_error;
+            return -1;
+        }
+    }
+
+    stage = r->tx_mem + (size_t)conn->tx_stage * NET_URING_TX_SLOT_SIZE + conn->tx_stage_len;
+    memcpy(stage, header, header_len);
+    if (len > 0) {
+        memcpy(stage + header_len, data, len);
+    }
+    conn->tx_stage_len += total;
+
+    if (conn->tx_busy == URING_NO_SLOT && !conn->dirty) {
+        conn->dirty = 1;
+        conn->dirty_next = r->dirty;
+        r->dirty = conn;
+        if (++r->dirty_count >= NET_URING_BATCH) {
+            uring_progress(r, -1, 1);
+        }
+    }
+    return 0;
+}
+
+int net_uring_wait(net_uring_conn_t *conn, int64_t deadline_ms, int nowait) {
+    if (!conn->recv_armed && !conn->rx_done) {
+        uring_arm_recv(conn);
+    }
+    if (uring_progress(conn->ring, deadline_ms, nowait) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+void net_uring_flush(void) {
+    if (uring_self) {
+        uring_progress(uring_self, -1, 1);
+    }
+}
+
+void net_uring_detach(net_uring_conn_t *conn) {
+    uring_thread_t *r = conn->ring;
+    int64_t deadline = uring_now_ms() + URING_DETACH_MS;
+
+    /* Let queued frames reach the socket before it is closed */
+    while ((conn->tx_busy != URING_NO_SLOT || conn->tx_stage != URING_NO_SLOT) && !conn->tx_error) {
+        if (uring_progress(r, deadline, 0) < 0) {
+            break;
+        }
+    }
+
+    if (conn->dirty) {
+        net_uring_conn_t **link = &r->dirty;
+        while (*link != conn) {
+            link = &(*link)->dirty_next;
+        }
+        *link = conn->dirty_next;
+        r->dirty_count--;
+    }
+    if (conn->tx_stage != URING_NO_SLOT) {
+        uring_slot_release(r, conn->tx_stage);
+    }
+    if (conn->recv_armed) {
+        uring_cancel(conn, uring_tag(conn, URING_NO_SLOT, URING_OP_RECV));
+    }
+    if (conn->tx_busy != URING_NO_SLOT) {
+        /* Its slot returns to the pool when the cancelled write completes */
+        uring_cancel(conn, uring_tag(conn, conn->tx_busy, URING_OP_SEND));
+    }
+
+    r->conns[conn->index] = NULL;
+    r->gens[conn->index]++;
+    r->free_ids[r->free_count++] = conn->index;
+    free(conn);
+
+    uring_progress(r, -1, 1);
+}
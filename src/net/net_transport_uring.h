@@ -0,0 +1,63 @@
+#ifndef NET_TRANSPORT_URING_H
+#define NET_TRANSPORT_URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * io_uring socket I/O (NET_TRANSPORT_BACKEND_URING)
+ *
+ * Internal to net_transport.c, which keeps framing and hands the byte
+ * stream of a TCP or Unix socket connection to this engine instead of
+ * calling read()/sendmsg() itself. Each thread owns one ring, created
+ * on first use; a connection binds to the ring of the thread that
+ * attaches it and must only be used from that thread afterwards. A
+ * forked child starts without a ring.
+ */
+
+/* Registered send buffers per thread ring and their size; frames
+ * queued on one connection are coalesced into one buffer */
+#define NET_URING_TX_SLOTS 64
+#define NET_URING_TX_SLOT_SIZE (16 * 1024)
+
+/* Provided receive buffers per thread ring (multishot recv) */
+#define NET_URING_RX_BUFS 256
+#define NET_URING_RX_BUF_SIZE 4096
+
+/* Submissions queued before the engine enters the kernel unasked */
+#define NET_URING_BATCH 32
+
+typedef struct net_uring_conn net_uring_conn_t;
+
+/* Receives stream bytes for a connection (len > 0), end of stream
+ * (len == 0) or an error (len = -errno). Called from inside
+ * net_uring_send/wait/flush for any connection on the thread's ring. */
+typedef void (*net_uring_sink_t)(void *context, const uint8_t *data, int len);
+
+/* 1 if the kernel has what the engine needs (checked once) */
+int net_uring_supported(void);
+
+/* Bind fd to the calling thread's ring and start receiving
+ * (NULL with errno set if the ring cannot be set up) */
+net_uring_conn_t* net_uring_attach(int fd, net_uring_sink_t sink, void *context);
+
+/* Queue one frame (header then payload). Returns 0 once queued; the
+ * bytes reach the socket at the next enter (wait, flush, or a full
+ * batch). -1 with errno: EAGAIN/ETIMEDOUT when no buffer frees up in
+ * time, or the error of an earlier send on this connection. */
+int net_uring_send(net_uring_conn_t *conn, const uint8_t *header, size_t header_len,
+                   const void *data, size_t len, int64_t deadline_ms, int nowait);
+
+/* Submit queued work and process completions until at least one
+ * arrives or the deadline passes (-1 with ETIMEDOUT; nowait only
+ * processes what is already complete and never fails) */
+int net_uring_wait(net_uring_conn_t *conn, int64_t deadline_ms, int nowait);
+
+/* Submit everything queued on the calling thread's ring */
+void net_uring_flush(void);
+
+/* Push out queued sends (bounded wait), stop receiving and unbind;
+ * the caller closes fd afterwards */
+void net_uring_detach(net_uring_conn_t *conn);
+
+#endif /* NET_TRANSPORT_URING_H */
@@ -0,0 +1,726 @@
+#define _GNU_SOURCE
+
+#include "net_udp.h"
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+/*
+ * UDP control plane implementation
+ *
+ * Outgoing datagrams are copied into a fixed outbox of NET_UDP_BATCH
+ * entries; a full outbox or the loop hook sends it with sendmmsg().
+ * Each peer is an ordinary net_rpc engine with retransmission on,
+ * whose link is the peer's address on the shared socket. Peers are
+ * found by the source address of a response through a chained hash
+ * table that doubles like the RPC engine's call table. The server's
+ * dedup cache is direct-mapped by (address, request_id): a collision
+ * only costs running an idempotent handler again. Each record of a
+ * BATCH goes through it like a request of its own, so a record resent
+ * alone after its batch was answered is still answered from the cache.
+ */
+
+#define UDP_PEERS_INITIAL 64
+#define UDP_DEDUP_BYTES 400
+#define UDP_RCVBUF (1 << 20)
+
+typedef struct {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    size_t len;
+    uint8_t data[NET_PROTOCOL_MAX_FRAME];
+} udp_datagram_t;
+
+typedef struct udp_peer {
+    struct udp_peer *next;          /* Address table chain */
+    net_udp_t *udp;
+    net_rpc_t *rpc;
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    uint32_t hash;
+    int linked;
+} udp_peer_t;
+
+typedef struct {
+    struct sockaddr_storage addr;
+    uint64_t stamp_ms;
+    uint32_t request_id;
+    uint16_t len;                   /* 0 = empty */
+    uint8_t msg_type;
+    uint8_t data[UDP_DEDUP_BYTES];
+} udp_dedup_t;
+
+struct net_udp {
+    net_loop_t *loop;
+    int fd;
+    char url[NET_PROTOCOL_MAX_URL];
+    net_watch_t watch;
+    net_hook_t hook;
+    net_udp_handler_t handler;
+    void *handler_context;
+
+    udp_datagram_t *outbox;
+    unsigned outbox_count;
+    udp_datagram_t *inbox;
+
+    udp_peer_t **peers;
+    uint32_t peers_mask;
+    size_t peer_count;
+
+    udp_dedup_t *dedup;             /* Allocated on the first request */
+    unsigned batch_max;             /* Applied to new peers */
+    int batch_window_ms;
+    net_udp_stats_t stats;
+};
+
+/*
+ * Addresses
+ */
+
+static uint32_t udp_hash_bytes(uint32_t hash, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t*)data;
+
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t udp_addr_hash(const struct sockaddr_storage *addr) {
+    uint32_t hash = 2166136261u;
+
+    if (addr->ss_family == AF_INET) {
+        const struct sockaddr_in *in = (const struct sockaddr_in*)addr;
+        hash = udp_hash_bytes(hash, &in->sin_port, sizeof(in->sin_port));
+        hash = udp_hash_bytes(hash, &in->sin_addr, sizeof(in->sin_addr));
+    }
+    else if (addr->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6*)addr;
+        hash = udp_hash_bytes(hash, &in6->sin6_port, sizeof(in6->sin6_port));
+        hash = udp_hash_bytes(hash, &in6->sin6_addr, sizeof(in6->sin6_addr));
+    }
+    return hash;
+}
+
+static int udp_addr_equal(const struct sockaddr_storage *a, const struct sockaddr_storage *b) {
+    if (a->ss_family != b->ss_family) {
+        return 0;
+    }
+    if (a->ss_family == AF_INET) {
+        const struct sockaddr_in *x = (const struct sockaddr_in*)a;
+        const struct sockaddr_in *y = (const struct sockaddr_in*)b;
+        return x->sin_port == y->sin_port && x->sin_addr.s_addr == y->sin_addr.s_addr;
+    }
+    if (a->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *x = (const struct sockaddr_in6*)a;
+        const struct sockaddr_in6 *y = (const struct sockaddr_in6*)b;
+        return x->sin6_port == y->sin6_port &&
+               memcmp(&x->sin6_addr, &y->sin6_addr, sizeof(x->sin6_addr)) == 0;
+    }
+    return 0;
+}
+
+/* Resolve udp://host:port (passive = for bind) */
+static int udp_resolve(const char *url, int passive, struct sockaddr_storage *addr, socklen_t *addr_len) {
+    struct addrinfo hints;
+    struct addrinfo *result;
+    char host[NET_PROTOCOL_MAX_URL];
+    const char *port;
+    size_t host_len;
+
+    if (!url || strncmp(url, "udp://", 6) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    port = strrchr(url + 6, ':');
+    if (!port || port[1] == '\0') {
+        errno = EINVAL;
+        return -1;
+    }
+    host_len = (size_t)(port - (url + 6));
+    if (host_len >= sizeof(host)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(host, url + 6, host_len);
+    host[host_len] = '\0';
+    if (host_len >= 2 && host[0] == '[' && host[host_len - 1] == ']') {  /* [::1] */
+        memmove(host, host + 1, host_len - 2);
+        host[host_len - 2] = '\0';
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICSERV | (passive ? AI_PASSIVE : 0);
+    if (getaddrinfo(host[0] && strcmp(host, "*") != 0 ? host : NULL, port + 1, &hints, &result) != 0) {
+        errno = EHOSTUNREACH;
+        return -1;
+    }
+    memset(addr, 0, sizeof(*addr));
+    memcpy(addr, result->ai_addr, result->ai_addrlen);
+    *addr_len = result->ai_addrlen;
+    freeaddrinfo(result);
+    return 0;
+}
+
+/*
+ * Peer table
+ */
+
+static udp_peer_t* udp_peer_find(net_udp_t *udp, const struct sockaddr_storage *addr) {
+    uint32_t hash = udp_addr_hash(addr);
+
+    for (udp_peer_t *p = udp->peers[hash & udp->peers_mask]; p; p = p->next) {
+        if (p->hash == hash && udp_addr_equal(&p->addr, addr)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static int udp_peers_grow(net_udp_t *udp) {
+    uint32_t size = (udp->peers_mask + 1) * 2;
+    udp_peer_t **table = (udp_peer_t**)calloc(size, sizeof(udp_peer_t*));
+
+    if (!table) {
+        return -1;
+    }
+    for (uint32_t i = 0; i <= udp->peers_mask; i++) {
+        while (udp->peers[i]) {
+            udp_peer_t *p = udp->peers[i];
+            udp->peers[i] = p->next;
+            p->next = table[p->hash & (size - 1)];
+            table[p->hash & (size - 1)] = p;
+        }
+    }
+    free(udp->peers);
+    udp->peers = table;
+    udp->peers_mask = size - 1;
+    return 0;
+}
+
+static void udp_peer_unlink(udp_peer_t *p) {
+    net_udp_t *udp = p->udp;
+    udp_peer_t **link;
+
+    if (!p->linked) {
+        return;
+    }
+    link = &udp->peers[p->hash & udp->peers_mask];
+    while (*link != p) {
+        link = &(*link)->next;
+    }
+    *link = p->next;
+    p->linked = 0;
+    udp->peer_count--;
+}
+
+/* Responses from one address reach one peer */
+static int udp_peer_link(udp_peer_t *p) {
+    net_udp_t *udp = p->udp;
+    udp_peer_t **bucket;
+
+    if (udp_peer_find(udp, &p->addr)) {
+        return -1;
+    }
+    if (udp->peer_count > udp->peers_mask && udp_peers_grow(udp) != 0) {
+        return -1;
+    }
+    bucket = &udp->peers[p->hash & udp->peers_mask];
+    p->next = *bucket;
+    *bucket = p;
+    p->linked = 1;
+    udp->peer_count++;
+    return 0;
+}
+
+/*
+ * Datagram I/O
+ */
+
+int net_udp_flush(net_udp_t *udp) {
+    struct mmsghdr msgs[NET_UDP_BATCH];
+    struct iovec iov[NET_UDP_BATCH];
+    unsigned count = udp->outbox_count;
+    unsigned sent = 0;
+    int result = 0;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    memset(msgs, 0, sizeof(msgs[0]) * count);
+    for (unsigned i = 0; i < count; i++) {
+        udp_datagram_t *d = &udp->outbox[i];
+        iov[i].iov_base = d->data;
+        iov[i].iov_len = d->len;
+        msgs[i].msg_hdr.msg_name = &d->addr;
+        msgs[i].msg_hdr.msg_namelen = d->addr_len;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (sent < count) {
+        int n = sendmmsg(udp->fd, msgs + sent, count - sent, 0);
+
+        if (n > 0) {
+            udp->stats.send_calls++;
+            udp->stats.datagrams_sent += (uint64_t)n;
+            sent += (unsigned)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        result = -1;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)) {
+            udp->stats.dropped += count - sent;  /* Retransmission recovers */
+            break;
+        }
+        udp->stats.dropped++;  /* This destination failed; go on with the rest */
+        sent++;
+    }
+
+    udp->outbox_count = 0;
+    return result;
+}
+
+static void udp_queue(net_udp_t *udp, const struct sockaddr_storage *addr, socklen_t addr_len,
+                      const void *data, size_t len) {
+    udp_datagram_t *d;
+
+    if (len > sizeof(d->data)) {
+        udp->stats.dropped++;
+        return;
+    }
+    if (udp->outbox_count == NET_UDP_BATCH) {
+        net_udp_flush(udp);
+    }
+    d = &udp->outbox[udp->outbox_count++];
+    memcpy(&d->addr, addr, sizeof(d->addr));
+    d->addr_len = addr_len;
+    memcpy(d->data, data, len);
+    d->len = len;
+}
+
+static udp_dedup_t* udp_dedup_slot(net_udp_t *udp, const struct sockaddr_storage *addr, uint32_t request_id) {
+    uint32_t hash = udp_addr_hash(addr) ^ (request_id * 2654435761u);
+
+    if (!udp->dedup) {
+        udp->dedup = (udp_dedup_t*)calloc(NET_UDP_DEDUP_SLOTS, sizeof(udp_dedup_t));
+        if (!udp->dedup) {
+            return NULL;
+        }
+    }
+    return &udp->dedup[hash % NET_UDP_DEDUP_SLOTS];
+}
+
+/* Encode the response to request from addr into frame, from the dedup
+ * cache or the handler. Returns its length, or -1. */
+static int udp_answer(net_udp_t *udp, const struct sockaddr_storage *addr,
+                      const net_frame_view_t *request, uint8_t *frame, size_t frame_size) {
+    uint64_t now = net_loop_now_ms(udp->loop);
+    uint32_t request_id = request->header.request_id;
+    udp_dedup_t *slot = udp_dedup_slot(udp, addr, request_id);
+    net_message_t response;
+    int err = NET_ERR_INVALID_MESSAGE;
+    int len;
+
+    if (slot && slot->len > 0 && slot->request_id == request_id &&
+        slot->msg_type == request->header.msg_type && now - slot->stamp_ms < NET_UDP_DEDUP_MS &&
+        udp_addr_equal(&slot->addr, addr) && slot->len <= frame_size) {
+        udp->stats.duplicates++;
+        memcpy(frame, slot->data, slot->len);
+        return slot->len;
+    }
+
+    memset(&response, 0, sizeof(response));
+    if (net_udp_supports((net_msg_type_t)request->header.msg_type)) {
+        net_protocol_init_message(&response, (net_msg_type_t)(request->header.msg_type + 1), request_id);
+        err = udp->handler(udp->handler_context, request, &response);
+    }
+    if (err != NET_ERR_OK) {
+        net_protocol_create_error(&response, request_id, (net_error_t)err, "request failed");
+    }
+    response.header.request_id = request_id;
+
+    len = net_protocol_serialize(&response, frame, frame_size);
+    if (len < 0) {
+        return -1;
+    }
+    if (slot && (size_t)len <= sizeof(slot->data)) {
+        memcpy(&slot->addr, addr, sizeof(slot->addr));
+        slot->request_id = request_id;
+        slot->msg_type = request->header.msg_type;
+        slot->stamp_ms = now;
+        slot->len = (uint16_t)len;
+        memcpy(slot->data, frame, (size_t)len);
+    }
+    return len;
+}
+
+static void udp_serve(net_udp_t *udp, const udp_datagram_t *d, const net_frame_view_t *request) {
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+    int len = udp_answer(udp, &d->addr, request, frame, sizeof(frame));
+
+    if (len > 0) {
+        udp_queue(udp, &d->addr, d->addr_len, frame, (size_t)len);
+    }
+}
+
+/* Queue the responses collected in batch (a lone one goes out bare) */
+static void udp_queue_batch(net_udp_t *udp, const udp_datagram_t *d, uint32_t request_id,
+                            net_batch_t *batch) {
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+    const uint8_t *record;
+    size_t record_len;
+    size_t offset = 0;
+    int len;
+
+    if (batch->count == 1 &&
+        net_protocol_batch_next(batch->data, batch->len, &offset, &record, &record_len)) {
+        udp_queue(udp, &d->addr, d->addr_len, record, record_len);
+    }
+    else if (batch->count > 1) {
+        len = net_protocol_encode_batch(frame, sizeof(frame), NET_MSG_BATCH_RESPONSE, request_id, batch);
+        if (len > 0) {
+            udp_queue(udp, &d->addr, d->addr_len, frame, (size_t)len);
+        }
+    }
+    net_protocol_batch_init(batch);
+}
+
+/* Answer every request record of a BATCH, in as few BATCH_RESPONSE
+ * datagrams as they fit in */
+static void udp_serve_batch(net_udp_t *udp, const udp_datagram_t *d, const net_frame_view_t *view) {
+    static _Thread_local net_batch_t records;
+    static _Thread_local net_batch_t responses;
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+    const uint8_t *record;
+    size_t record_len;
+    size_t offset = 0;
+
+    /* Copied: decoding a JSON record reuses the scratch view->frame is in */
+    memcpy(records.data, view->frame, view->frame_len);
+    records.len = view->frame_len;
+    net_protocol_batch_init(&responses);
+    udp->stats.batches++;
+
+    while (net_protocol_batch_next(records.data, records.len, &offset, &record, &record_len)) {
+        net_frame_view_t request;
+        int len;
+
+        if (net_protocol_decode_view(&request, record, record_len) != NET_ERR_OK ||
+            request.header.msg_type == NET_MSG_BATCH || !(request.header.msg_type & 1)) {
+            continue;
+        }
+        len = udp_answer(udp, &d->addr, &request, frame, sizeof(frame));
+        if (len <= 0) {
+            continue;
+        }
+        if (net_protocol_batch_add(&responses, frame, (size_t)len) != 0) {
+            udp_queue_batch(udp, d, view->header.request_id, &responses);
+            net_protocol_batch_add(&responses, frame, (size_t)len);
+        }
+    }
+    udp_queue_batch(udp, d, view->header.request_id, &responses);
+}
+
+static void udp_dispatch(net_udp_t *udp, const udp_datagram_t *d) {
+    net_frame_view_t view;
+    udp_peer_t *peer;
+
+    if (net_protocol_decode_view(&view, d->data, d->len) != NET_ERR_OK) {
+        return;
+    }
+
+    /* Requests have odd types, their responses the next even one */
+    if (view.header.msg_type == NET_MSG_BATCH) {
+        if (udp->handler) {
+            udp_serve_batch(udp, d, &view);
+        }
+        return;
+    }
+    if (view.header.msg_type != NET_MSG_ERROR && (view.header.msg_type & 1)) {
+        if (udp->handler) {
+            udp_serve(udp, d, &view);
+        }
+        return;
+    }
+
+    peer = udp_peer_find(udp, &d->addr);
+    if (peer) {
+        net_rpc_receive(peer->rpc, d->data, d->len);
+    }
+}
+
+static void udp_on_ready(void *context, uint32_t events) {
+    net_udp_t *udp = (net_udp_t*)context;
+    struct mmsghdr msgs[NET_UDP_BATCH];
+    struct iovec iov[NET_UDP_BATCH];
+
+    (void)events;
+    for (;;) {
+        int n;
+
+        memset(msgs, 0, sizeof(msgs));
+        for (unsigned i = 0; i < NET_UDP_BATCH; i++) {
+            iov[i].iov_base = udp->inbox[i].data;
+            iov[i].iov_len = sizeof(udp->inbox[i].data);
+            msgs[i].msg_hdr.msg_name = &udp->inbox[i].addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(udp->inbox[i].addr);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        n = recvmmsg(udp->fd, msgs, NET_UDP_BATCH, MSG_DONTWAIT, NULL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        udp->stats.recv_calls++;
+        udp->stats.datagrams_received += (uint64_t)n;
+
+        for (int i = 0; i < n; i++) {
+            udp_datagram_t *d = &udp->inbox[i];
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                continue;
+            }
+            d->len = msgs[i].msg_len;
+            d->addr_len = msgs[i].msg_hdr.msg_namelen;
+            udp_dispatch(udp, d);
+        }
+        if (n < NET_UDP_BATCH) {
+            return;
+        }
+    }
+}
+
+static void udp_on_hook(void *context) {
+    net_udp_flush((net_udp_t*)context);
+}
+
+/*
+ * Endpoint
+ */
+
+/* Record the bound URL, filling in the port the kernel chose */
+static void udp_set_url(net_udp_t *udp, const char *url) {
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    const char *port = strrchr(url + 6, ':');
+    unsigned bound = 0;
+
+    if (getsockname(udp->fd, (struct sockaddr*)&addr, &addr_len) != 0) {
+        snprintf(udp->url, sizeof(udp->url), "%s", url);
+        return;
+    }
+    if (addr.ss_family == AF_INET) {
+        bound = ntohs(((struct sockaddr_in*)&addr)->sin_port);
+    }
+    else if (addr.ss_family == AF_INET6) {
+        bound = ntohs(((struct sockaddr_in6*)&addr)->sin6_port);
+    }
+    snprintf(udp->url, sizeof(udp->url), "%.*s:%u", (int)(port - url), url, bound);
+}
+
+net_udp_t* net_udp_create(net_loop_t *loop, const char *url) {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    net_udp_t *udp;
+    int rcvbuf = UDP_RCVBUF;
+
+    if (!loop || udp_resolve(url, 1, &addr, &addr_len) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    udp = (net_udp_t*)calloc(1, sizeof(net_udp_t));
+    if (!udp) {
+        return NULL;
+    }
+    udp->fd = -1;
+    udp->loop = loop;
+    udp->outbox = (udp_datagram_t*)malloc(NET_UDP_BATCH * sizeof(udp_datagram_t));
+    udp->inbox = (udp_datagram_t*)malloc(NET_UDP_BATCH * sizeof(udp_datagram_t));
+    udp->peers = (udp_peer_t**)calloc(UDP_PEERS_INITIAL, sizeof(udp_peer_t*));
+    udp->peers_mask = UDP_PEERS_INITIAL - 1;
+    if (!udp->outbox || !udp->inbox || !udp->peers) {
+        errno = ENOMEM;
+        goto fail;
+    }
+
+    udp->fd = socket(addr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (udp->fd < 0) {
+        goto fail;
+    }
+    setsockopt(udp->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    if (bind(udp->fd, (struct sockaddr*)&addr, addr_len) != 0 ||
+        net_loop_watch(loop, &udp->watch, udp->fd, EPOLLIN, udp_on_ready, udp) != 0) {
+        goto fail;
+    }
+    udp_set_url(udp, url);
+    net_loop_add_hook(loop, &udp->hook, udp_on_hook, udp);
+    return udp;
+
+fail:
+    {
+        int err = errno;
+        if (udp->fd >= 0) {
+            close(udp->fd);
+        }
+        free(udp->outbox);
+        free(udp->inbox);
+        free(udp->peers);
+        free(udp);
+        errno = err;
+    }
+    return NULL;
+}
+
+void net_udp_destroy(net_udp_t *udp) {
+    if (!udp) {
+        return;
+    }
+    net_udp_flush(udp);
+    net_loop_remove_hook(udp->loop, &udp->hook);
+    net_loop_unwatch(udp->loop, &udp->watch);
+    close(udp->fd);
+    free(udp->outbox);
+    free(udp->inbox);
+    free(udp->peers);
+    free(udp->dedup);
+    free(udp);
+}
+
+const char* net_udp_url(const net_udp_t *udp) {
+    return udp ? udp->url : NULL;
+}
+
+void net_udp_set_handler(net_udp_t *udp, net_udp_handler_t handler, void *context) {
+    udp->handler = handler;
+    udp->handler_context = context;
+}
+
+void net_udp_set_batching(net_udp_t *udp, unsigned max_records, int window_ms) {
+    udp->batch_max = max_records;
+    udp->batch_window_ms = window_ms;
+}
+
+int net_udp_supports(net_msg_type_t type) {
+    return type == NET_MSG_PING || type == NET_MSG_NOTIFY ||
+           type == NET_MSG_GET_PREDECESSOR || type == NET_MSG_GET_SUCCESSOR ||
+           type == NET_MSG_STABILIZE;
+}
+
+void net_udp_get_stats(const net_udp_t *udp, net_udp_stats_t *stats) {
+    *stats = udp->stats;
+}
+
+/*
+ * Peer implementation
+ */
+
+static int udp_link_send(void *link, const net_buf_t *frame) {
+    udp_peer_t *p = (udp_peer_t*)link;
+
+    udp_queue(p->udp, &p->addr, p->addr_len, frame->data, frame->len);
+    return NET_ERR_OK;
+}
+
+static int udp_peer_connect(net_peer_t *peer, const char *url) {
+    udp_peer_t *p = (udp_peer_t*)peer->impl_data;
+
+    udp_peer_unlink(p);
+    peer->connected = 0;
+    if (udp_resolve(url, 0, &p->addr, &p->addr_len) != 0) {
+        return NET_ERR_NODE_NOT_FOUND;
+    }
+    p->hash = udp_addr_hash(&p->addr);
+    if (udp_peer_link(p) != 0) {
+        return NET_ERR_INTERNAL;  /* Another peer already talks to this address */
+    }
+    snprintf(peer->remote_url, sizeof(peer->remote_url), "%s", url);
+    peer->connected = 1;
+    return NET_ERR_OK;
+}
+
+static int udp_peer_call_async(net_peer_t *peer, uint32_t request_id, net_msg_type_t type, int key,
+                               const net_node_addr_t *node, net_peer_callback_t callback,
+                               void *context, int timeout_ms) {
+    udp_peer_t *p = (udp_peer_t*)peer->impl_data;
+
+    if (!net_udp_supports(type)) {
+        return NET_ERR_INVALID_MESSAGE;
+    }
+    if (!peer->connected) {
+        return NET_ERR_CONNECTION_CLOSED;
+    }
+    return net_rpc_call(p->rpc, request_id, type, key, node, callback, context, timeout_ms);
+}
+
+static void udp_peer_close(net_peer_t *peer) {
+    udp_peer_t *p = (udp_peer_t*)peer->impl_data;
+
+    udp_peer_unlink(p);
+    peer->connected = 0;
+    net_rpc_fail_all(p->rpc, NET_ERR_CONNECTION_CLOSED);
+}
+
+static void udp_peer_destroy(net_peer_t *peer) {
+    udp_peer_t *p = (udp_peer_t*)peer->impl_data;
+
+    udp_peer_unlink(p);
+    net_rpc_destroy(p->rpc);
+    free(p);
+    free(peer);
+}
+
+static const net_peer_iface_t udp_peer_iface = {
+    .connect = udp_peer_connect,
+    .send_request = NULL,
+    .send_frame = NULL,
+    .call_async = udp_peer_call_async,
+    .close = udp_peer_close,
+    .destroy = udp_peer_destroy
+};
+
+net_peer_t* net_udp_peer_create(net_udp_t *udp) {
+    net_peer_t *peer;
+    udp_peer_t *p;
+
+    if (!udp) {
+        return NULL;
+    }
+    peer = net_peer_create(&udp_peer_iface);
+    p = (udp_peer_t*)calloc(1, sizeof(udp_peer_t));
+    if (!peer || !p) {
+        free(peer);
+        free(p);
+        return NULL;
+    }
+    p->udp = udp;
+    p->rpc = net_rpc_create(udp->loop, udp_link_send, p);
+    if (!p->rpc) {
+        free(peer);
+        free(p);
+        return NULL;
+    }
+    net_rpc_set_retransmit(p->rpc, NET_UDP_RETRANSMIT_MS);
+    net_rpc_set_batching(p->rpc, udp->batch_max, udp->batch_window_ms);
+    peer->impl_data = p;
+    return peer;
+}
+
+net_rpc_t* net_udp_peer_rpc(net_peer_t *peer) {
+    return peer && peer->iface == &udp_peer_iface ? ((udp_peer_t*)peer->impl_data)->rpc : NULL;
+}
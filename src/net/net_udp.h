@@ -0,0 +1,104 @@
+#ifndef NET_UDP_H
+#define NET_UDP_H
+
+#include "net_loop.h"
+#include "net_peer.h"
+#include "net_protocol.h"
+
+/*
+ * UDP Control Plane
+ *
+ * Carries the small, idempotent maintenance RPCs that every node sends
+ * to every neighbour each stabilization period (PING, NOTIFY,
+ * GET_PREDECESSOR, GET_SUCCESSOR, STABILIZE) as one datagram each way, so they
+ * need neither a connection per neighbour nor stream framing. Lookups
+ * and anything else stay on net_transport connections.
+ *
+ * One endpoint (one socket on udp://host:port) serves a node in both
+ * directions:
+ * - Client: net_udp_peer_create() returns a net_peer_t whose async
+ *   helpers (net_peer_ping_async() and friends) send through the
+ *   endpoint. Lost requests are resent by the RPC engine every
+ *   NET_UDP_RETRANSMIT_MS, doubling, until the call's timeout.
+ *   Responses are matched to the peer by source address and to the
+ *   call by request_id; late and duplicate responses are dropped.
+ * - Server: requests are handed to the handler, and its response is
+ *   remembered per (sender, request_id) for NET_UDP_DEDUP_MS, so a
+ *   retransmitted request is answered again without running the
+ *   handler twice.
+ *
+ * Batching: datagrams queued by callbacks are sent with one
+ * sendmmsg() when the loop next runs its hooks (or on
+ * net_udp_flush()), and each wakeup drains the socket with recvmmsg()
+ * NET_UDP_BATCH datagrams at a time. With net_udp_set_batching(),
+ * requests to the same peer are also coalesced into BATCH datagrams
+ * (see net_rpc_set_batching()); the server answers all the records of
+ * a BATCH in one BATCH_RESPONSE.
+ *
+ * Thread safety: an endpoint and its peers belong to its loop's
+ * thread. Peers are async only; the blocking net_peer_* helpers return
+ * NET_ERR_INTERNAL.
+ */
+
+/* Datagrams per sendmmsg()/recvmmsg() call */
+#define NET_UDP_BATCH 64
+
+/* First resend of an unanswered request; doubles each time */
+#define NET_UDP_RETRANSMIT_MS 100
+
+/* Server-side duplicate detection: remembered responses and for how long */
+#define NET_UDP_DEDUP_SLOTS 256
+#define NET_UDP_DEDUP_MS 10000
+
+typedef struct net_udp net_udp_t;
+
+/* Fill response (its header is set by the endpoint) for request.
+ * Return NET_ERR_OK to send it; any other code is sent back as an
+ * ERROR message. */
+typedef int (*net_udp_handler_t)(void *context, const net_frame_view_t *request,
+                                 net_message_t *response);
+
+typedef struct {
+    uint64_t datagrams_sent;
+    uint64_t datagrams_received;
+    uint64_t send_calls;            /* sendmmsg() calls */
+    uint64_t recv_calls;            /* recvmmsg() calls */
+    uint64_t duplicates;            /* Requests answered from the dedup cache */
+    uint64_t batches;               /* BATCH requests served */
+    uint64_t dropped;               /* Datagrams the socket would not take */
+} net_udp_stats_t;
+
+/* Bind an endpoint on udp://host:port (port 0 picks one) and watch it
+ * on loop. NULL with errno set on failure. */
+net_udp_t* net_udp_create(net_loop_t *loop, const char *url);
+
+/* Destroy endpoint (destroy its peers first) */
+void net_udp_destroy(net_udp_t *udp);
+
+/* URL actually bound, with the chosen port filled in */
+const char* net_udp_url(const net_udp_t *udp);
+
+/* Serve incoming requests with handler (none by default: ignored) */
+void net_udp_set_handler(net_udp_t *udp, net_udp_handler_t handler, void *context);
+
+/* Coalesce requests of peers created afterwards, as
+ * net_rpc_set_batching() (max_records 0, the default, turns it off) */
+void net_udp_set_batching(net_udp_t *udp, unsigned max_records, int window_ms);
+
+/* 1 if type is a request the control plane carries */
+int net_udp_supports(net_msg_type_t type);
+
+/* Peer sending through udp; net_peer_connect() it to udp://host:port.
+ * Calls of other types return NET_ERR_INVALID_MESSAGE. */
+net_peer_t* net_udp_peer_create(net_udp_t *udp);
+
+/* RPC engine of a UDP peer (for its retransmit counter) */
+net_rpc_t* net_udp_peer_rpc(net_peer_t *peer);
+
+/* Send queued datagrams now (returns 0 or -1) */
+int net_udp_flush(net_udp_t *udp);
+
+/* Traffic counters */
+void net_udp_get_stats(const net_udp_t *udp, net_udp_stats_t *stats);
+
+#endif /* NET_UDP_H */
@@ -0,0 +1,249 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Lookup tracing implementation
+ *
+ * Buffers are registered on a lock-free singly linked list and never
+ * freed, so a dump taken after a thread exits still sees its records.
+ */
+
+_Thread_local trace_buffer_t *trace_tls_buffer = NULL;
+_Thread_local uint32_t trace_tls_lookup_id = 0;
+
+static _Atomic(trace_buffer_t*) g_trace_buffers = NULL;
+static _Atomic uint32_t g_trace_threads = 0;
+static _Atomic uint32_t g_trace_lookup_ids = 0;
+
+/* Clock pair captured at first use, for tick -> ns calibration at dump */
+static _Atomic int g_trace_epoch_set = 0;
+static uint64_t g_trace_epoch_ticks;
+static uint64_t g_trace_epoch_ns;
+
+/* On-disk layout (native endianness; decode on the same architecture) */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    double ns_per_tick;
+    uint32_t num_buffers;
+    uint32_t reserved;
+} trace_file_header_t;
+
+typedef struct {
+    uint32_t thread;
+    uint32_t count;
+} trace_file_buffer_t;
+
+uint64_t trace_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void trace_epoch_init(void) {
+    int expected = 0;
+    if (atomic_compare_exchange_strong(&g_trace_epoch_set, &expected, 1)) {
+        g_trace_epoch_ns = trace_clock_ns();
+        g_trace_epoch_ticks = trace_now();
+        atomic_store(&g_trace_epoch_set, 2);
+    }
+}
+
+trace_buffer_t* trace_thread_buffer(void) {
+    trace_buffer_t *buffer;
+    trace_buffer_t *head;
+
+    if (trace_tls_buffer) {
+        return trace_tls_buffer;
+    }
+
+    trace_epoch_init();
+
+    buffer = (trace_buffer_t*)calloc(1, sizeof(trace_buffer_t));
+    if (!buffer) {
+        fprintf(stderr, "FATAL: Failed to allocate trace buffer\n");
+        exit(EXIT_FAILURE);
+    }
+    buffer->thread = (uint16_t)atomic_fetch_add(&g_trace_threads, 1);
+    atomic_init(&buffer->head, 0);
+
+    head = atomic_load(&g_trace_buffers);
+    do {
+        buffer->next = head;
+    } while (!atomic_compare_exchange_weak(&g_trace_buffers, &head, buffer));
+
+    trace_tls_buffer = buffer;
+    return buffer;
+}
+
+uint32_t trace_lookup_id_next(void) {
+    uint32_t id;
+    do {
+        id = atomic_fetch_add_explicit(&g_trace_lookup_ids, 1, memory_order_relaxed) + 1;
+    } while (id == 0);
+    return id;
+}
+
+static double trace_ns_per_tick(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t ticks, ns;
+
+    if (atomic_load(&g_trace_epoch_set) != 2) {
+        return 1.0;
+    }
+    ticks = trace_now() - g_trace_epoch_ticks;
+    ns = trace_clock_ns() - g_trace_epoch_ns;
+    if (ticks == 0 || ns == 0) {
+        return 1.0;
+    }
+    return (double)ns / (double)ticks;
+#else
+    return 1.0;
+#endif
+}
+
+int trace_dump(const char *path) {
+    trace_file_header_t header;
+    trace_buffer_t *buffer;
+    FILE *file;
+
+    file = fopen(path, "wb");
+    if (!file) {
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_DUMP_MAGIC, sizeof(header.magic));
+    header.version = TRACE_DUMP_VERSION;
+    header.record_size = (uint32_t)sizeof(trace_record_t);
+    header.ns_per_tick = trace_ns_per_tick();
+    for (buffer = atomic_load(&g_trace_buffers); buffer; buffer = buffer->next) {
+        header.num_buffers++;
+    }
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        return -1;
+    }
+
+    for (buffer = atomic_load(&g_trace_buffers); buffer; buffer = buffer->next) {
+        uint32_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        uint32_t count = head < TRACE_BUFFER_RECORDS ? head : TRACE_BUFFER_RECORDS;
+        uint32_t first = head - count;
+        trace_file_buffer_t info = { buffer->thread, count };
+
+        if (fwrite(&info, sizeof(info), 1, file) != 1) {
+            fclose(file);
+            return -1;
+        }
+
+        /* Oldest record first; the live window may wrap the array end */
+        for (uint32_t i = 0; i < count; i++) {
+            const trace_record_t *record = &buffer->records[(first + i) & (TRACE_BUFFER_RECORDS - 1)];
+            if (fwrite(record, sizeof(*record), 1, file) != 1) {
+                fclose(file);
+                return -1;
+            }
+        }
+    }
+
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+static int trace_record_compare(const void *a, const void *b) {
+    const trace_record_t *ra = (const trace_record_t*)a;
+    const trace_record_t *rb = (const trace_record_t*)b;
+
+    if (ra->timestamp != rb->timestamp) {
+        return ra->timestamp < rb->timestamp ? -1 : 1;
+    }
+    return (int)ra->thread - (int)rb->thread;
+}
+
+int trace_dump_load(const char *path, trace_dump_t *dump) {
+    trace_file_header_t header;
+    trace_file_buffer_t info;
+    trace_record_t *records = NULL;
+    size_t count = 0;
+    FILE *file;
+
+    file = fopen(path, "rb");
+    if (!file) {
+        return -1;
+    }
+
+    if (fread(&header, sizeof(header), 1, file) != 1
+        || memcmp(header.magic, TRACE_DUMP_MAGIC, sizeof(header.magic)) != 0
+        || header.version != TRACE_DUMP_VERSION
+        || header.record_size != sizeof(trace_record_t)) {
+        fclose(file);
+        return -1;
+    }
+
+    for (uint32_t b = 0; b < header.num_buffers; b++) {
+        trace_record_t *grown;
+
+        if (fread(&info, sizeof(info), 1, file) != 1 || info.count > TRACE_BUFFER_RECORDS) {
+            free(records);
+            fclose(file);
+            return -1;
+        }
+        if (info.count == 0) {
+            continue;
+        }
+
+        grown = (trace_record_t*)realloc(records, (count + info.count) * sizeof(trace_record_t));
+        if (!grown) {
+            free(records);
+            fclose(file);
+            return -1;
+        }
+        records = grown;
+
+        if (fread(&records[count], sizeof(trace_record_t), info.count, file) != info.count) {
+            free(records);
+            fclose(file);
+            return -1;
+        }
+        count += info.count;
+    }
+    fclose(file);
+
+    if (count > 0) {
+        qsort(records, count, sizeof(trace_record_t), trace_record_compare);
+    }
+
+    dump->ns_per_tick = header.ns_per_tick;
+    dump->count = count;
+    dump->records = records;
+    return 0;
+}
+
+void trace_dump_free(trace_dump_t *dump) {
+    free(dump->records);
+    dump->records = NULL;
+    dump->count = 0;
+}
+
+const char* trace_event_name(uint16_t event) {
+    switch (event) {
+        case TRACE_EV_CLI_BEGIN:    return "CLI_BEGIN";
+        case TRACE_EV_CLI_END:      return "CLI_END";
+        case TRACE_EV_LOOKUP_BEGIN: return "LOOKUP_BEGIN";
+        case TRACE_EV_LOOKUP_HOP:   return "HOP";
+        case TRACE_EV_LOOKUP_END:   return "LOOKUP_END";
+        default:                    return "UNKNOWN";
+    }
+}
+
+void trace_reset(void) {
+    for (trace_buffer_t *buffer = atomic_load(&g_trace_buffers); buffer; buffer = buffer->next) {
+        atomic_store(&buffer->head, 0);
+    }
+}
@@ -0,0 +1,173 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/*
+ * Lookup Tracing
+ *
+ * Per-thread binary ring buffers of fixed-size trace records.
+ *
+ * Each thread owns one buffer and is its only writer, so emitting a
+ * record is a timestamp read, a 24-byte store and a release store of
+ * the head index - no locks, no syscalls, no formatting. Buffers
+ * wrap, keeping the most recent TRACE_BUFFER_RECORDS records.
+ *
+ * Emission is compiled out entirely unless CHORD_TRACE is non-zero
+ * (see `make trace`). trace_dump() writes all buffers to a binary file
+ * which the offline decoder (build/chord_trace) turns into per-lookup
+ * route timelines.
+ */
+
+#ifndef CHORD_TRACE
+#define CHORD_TRACE 0
+#endif
+
+/* Records kept per thread (must be a power of two) */
+#define TRACE_BUFFER_RECORDS 65536
+
+/* Dump file identification */
+#define TRACE_DUMP_MAGIC "CHTRACE1"
+#define TRACE_DUMP_VERSION 1
+
+/* Event types */
+typedef enum {
+    TRACE_EV_CLI_BEGIN = 1,     /* CLI command started at node_key   (arg: key) */
+    TRACE_EV_CLI_END = 2,       /* CLI command finished at node_key  (arg: key) */
+    TRACE_EV_LOOKUP_BEGIN = 3,  /* lookup started at node_key        (arg: key) */
+    TRACE_EV_LOOKUP_HOP = 4,    /* lookup visited node_key           (arg: depth) */
+    TRACE_EV_LOOKUP_END = 5,    /* lookup resolved to node_key       (arg: key) */
+    TRACE_EV_MAX
+} trace_event_t;
+
+/* Fixed-size trace record (24 bytes on the wire and in memory) */
+typedef struct {
+    uint64_t timestamp;     /* Raw clock ticks, see trace_now() */
+    uint32_t lookup_id;     /* 0 if not part of a lookup */
+    int32_t node_key;
+    uint16_t event;         /* trace_event_t */
+    uint16_t thread;        /* Index assigned at first emit */
+    int32_t arg;
+} trace_record_t;
+
+_Static_assert(sizeof(trace_record_t) == 24, "trace_record_t must stay 24 bytes");
+
+/* Per-thread ring buffer */
+typedef struct trace_buffer {
+    struct trace_buffer *next;  /* Registry link (immutable once published) */
+    uint16_t thread;
+    _Atomic uint32_t head;      /* Total records ever written */
+    trace_record_t records[TRACE_BUFFER_RECORDS];
+} trace_buffer_t;
+
+extern _Thread_local trace_buffer_t *trace_tls_buffer;
+extern _Thread_local uint32_t trace_tls_lookup_id;
+
+/* Allocate and register the calling thread's buffer (slow path) */
+trace_buffer_t* trace_thread_buffer(void);
+
+/* CLOCK_MONOTONIC in nanoseconds */
+uint64_t trace_clock_ns(void);
+
+/* Read the trace clock (TSC on x86, CLOCK_MONOTONIC elsewhere) */
+static inline uint64_t trace_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return trace_clock_ns();
+#endif
+}
+
+/* Append a record to the calling thread's buffer */
+static inline void trace_emit(trace_event_t event, uint32_t lookup_id, int node_key, int arg) {
+    trace_buffer_t *buffer = trace_tls_buffer;
+    if (!buffer) {
+        buffer = trace_thread_buffer();
+    }
+
+    uint32_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    trace_record_t *record = &buffer->records[head & (TRACE_BUFFER_RECORDS - 1)];
+    record->timestamp = trace_now();
+    record->lookup_id = lookup_id;
+    record->node_key = node_key;
+    record->event = (uint16_t)event;
+    record->thread = buffer->thread;
+    record->arg = arg;
+    atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+/* Allocate a new process-unique lookup ID (never 0) */
+uint32_t trace_lookup_id_next(void);
+
+/* Open a traced scope: joins the enclosing lookup if one is active,
+ * otherwise allocates a new lookup ID. Returns the outer ID. */
+static inline uint32_t trace_scope_begin(trace_event_t event, int node_key, int arg) {
+    uint32_t outer = trace_tls_lookup_id;
+    if (!outer) {
+        trace_tls_lookup_id = trace_lookup_id_next();
+    }
+    trace_emit(event, trace_tls_lookup_id, node_key, arg);
+    return outer;
+}
+
+/* Close a traced scope and restore the outer lookup ID */
+static inline void trace_scope_end(uint32_t outer, trace_event_t event, int node_key, int arg) {
+    trace_emit(event, trace_tls_lookup_id, node_key, arg);
+    trace_tls_lookup_id = outer;
+}
+
+/*
+ * Tracing macros
+ *
+ * The current lookup ID is thread-local so that the recursive lookup
+ * path does not need an extra parameter; a lookup started inside a
+ * traced CLI command shares the command's ID. When CHORD_TRACE is 0
+ * the arguments are not evaluated.
+ */
+#if CHORD_TRACE
+#define TRACE(event, node_key, arg) \
+    trace_emit((event), trace_tls_lookup_id, (node_key), (arg))
+#define TRACE_SCOPE_BEGIN(event, node_key, arg) \
+    trace_scope_begin((event), (node_key), (arg))
+#define TRACE_SCOPE_END(outer, event, node_key, arg) \
+    trace_scope_end((outer), (event), (node_key), (arg))
+#else
+#define TRACE(event, node_key, arg) \
+    ((void)sizeof((event) + (node_key) + (arg)))
+#define TRACE_SCOPE_BEGIN(event, node_key, arg) \
+    ((void)sizeof((event) + (node_key) + (arg)), (uint32_t)0)
+#define TRACE_SCOPE_END(outer, event, node_key, arg) \
+    ((void)sizeof((outer) + (event) + (node_key) + (arg)))
+#endif
+
+/*
+ * Dump and decode
+ */
+
+/* Write all thread buffers to path. Returns 0 on success, -1 on error.
+ * Records written concurrently with the dump may be torn; dump from a
+ * quiescent point (e.g. at exit) for exact results. */
+int trace_dump(const char *path);
+
+/* Loaded dump (records from all threads, sorted by timestamp) */
+typedef struct {
+    double ns_per_tick;
+    size_t count;
+    trace_record_t *records;  /* Owned, free with trace_dump_free() */
+} trace_dump_t;
+
+/* Read a dump written by trace_dump(). Returns 0 on success, -1 on error. */
+int trace_dump_load(const char *path, trace_dump_t *dump);
+
+/* Release records owned by dump */
+void trace_dump_free(trace_dump_t *dump);
+
+/* Printable event name */
+const char* trace_event_name(uint16_t event);
+
+/* Discard all buffered records (tests) */
+void trace_reset(void);
+
+#endif /* TRACE_H */
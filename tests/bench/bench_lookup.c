@@ -0,0 +1,283 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../chord_bench.h"
+#include "../../src/core/ring.h"
+#include "../../src/net/net_node_service.h"
+#include "../../src/net/net_shards.h"
+#include <stdatomic.h>
+
+/*
+ * Lookup routing: BENCH_NODES core nodes in one ring, each behind its
+ * own net_server on loopback TCP, resolve BENCH_LOOKUPS keys from
+ * varying origins, once iteratively (the origin sends NEXT_HOP to every
+ * hop) and once recursively (FORWARD_LOOKUP passed along, the result
+ * sent straight back). Each message between servers is held for a
+ * simulated one-way link latency first. Reports the end-to-end latency
+ * per lookup, the mean hops and the link trips they cost.
+ *
+ * Stabilization: the same ring runs BENCH_PERIODS stabilization
+ * periods per node over those links, with node_stabilise()'s reads and
+ * NOTIFY sent one by one and then as one STABILIZE. Reports the time
+ * per node and period and the round trips it cost.
+ *
+ * Sharded throughput: BENCH_SHARD_NODES nodes spread over 1, 2 and 4
+ * shards (net_shards) resolve BENCH_SHARD_LOOKUPS keys submitted all at
+ * once. Reports lookups per second and the shard crossings per lookup;
+ * scaling needs as many free cores as shards.
+ */
+
+#define BENCH_NODES 32
+#define BENCH_LOOKUPS 200
+#define BENCH_TIMEOUT_MS 5000
+#define BENCH_SHARD_NODES 128
+#define BENCH_SHARD_LOOKUPS 200000
+#define BENCH_PERIODS 10
+
+typedef struct {
+    Node *nodes[BENCH_NODES];
+    net_server_t *servers[BENCH_NODES];
+    net_node_service_t *services[BENCH_NODES];
+} bench_ring_t;
+
+static const unsigned bench_delays_us[] = { 0, 100, 500 };
+static const unsigned bench_shard_counts[] = { 1, 2, 4 };
+
+typedef struct {
+    _Atomic long done;
+    _Atomic long crossings;
+    _Atomic long failures;
+} bench_tally_t;
+
+static const char* bench_resolve(void *context, const Node *node) {
+    bench_ring_t *ring = (bench_ring_t*)context;
+
+    for (int i = 0; i < BENCH_NODES; i++) {
+        if (ring->nodes[i] == node) {
+            return net_server_url(ring->servers[i]);
+        }
+    }
+    return NULL;
+}
+
+static int bench_ring_start(bench_ring_t *ring) {
+    static char names[BENCH_NODES][16];
+    net_server_config_t config;
+
+    for (int i = 0; i < BENCH_NODES; i++) {
+        snprintf(names[i], sizeof(names[i]), "%d-bench", i);
+        ring->nodes[i] = node_init(names[i]);
+        if (i == 0) {
+            node_create(ring->nodes[0]);
+        } else {
+            node_join(ring->nodes[0], ring->nodes[i]);
+            node_stabilise(ring->nodes[i]);
+            node_fix_fingers(ring->nodes[i]);
+        }
+    }
+    for (int round = 0; round < 2 * BENCH_NODES; round++) {
+        for (int i = 0; i < BENCH_NODES; i++) {
+            node_stabilise(ring->nodes[i]);
+            node_fix_fingers(ring->nodes[i]);
+        }
+    }
+
+    net_server_config_default(&config);
+    config.workers = 1;
+    for (int i = 0; i < BENCH_NODES; i++) {
+        ring->servers[i] = net_server_create(&config);
+        if (!ring->servers[i] || net_server_listen(ring->servers[i], "tcp://127.0.0.1:0") != 0) {
+            return -1;
+        }
+        ring->services[i] = net_node_service_create(ring->servers[i], ring->nodes[i]);
+        if (!ring->services[i]) {
+            return -1;
+        }
+        net_node_service_set_resolver(ring->services[i], bench_resolve, ring);
+    }
+    for (int i = 0; i < BENCH_NODES; i++) {
+        if (net_server_start(ring->servers[i]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void bench_ring_stop(bench_ring_t *ring) {
+    for (int i = 0; i < BENCH_NODES; i++) {
+        net_server_destroy(ring->servers[i]);
+        net_node_service_destroy(ring->services[i]);
+    }
+}
+
+static void bench_mode(bench_ring_t *ring, net_lookup_mode_t mode, unsigned delay_us) {
+    char name[64];
+    net_node_addr_t result;
+    uint64_t start;
+    uint64_t elapsed;
+    long total_hops = 0;
+    long total_trips = 0;
+    int failures = 0;
+
+    for (int i = 0; i < BENCH_NODES; i++) {
+        net_node_service_set_link_delay(ring->services[i], delay_us);
+    }
+
+    start = chord_bench_now_ns();
+    for (int i = 0; i < BENCH_LOOKUPS; i++) {
+        int key = (i * 97 + 13) % ring_key_max();
+        int hops = 0;
+
+        if (net_node_service_lookup(ring->services[i % BENCH_NODES], key, mode,
+                                    BENCH_TIMEOUT_MS, &result, &hops) != NET_ERR_OK) {
+            failures++;
+        }
+        total_hops += hops;
+        if (hops > 0) {
+            total_trips += mode == NET_LOOKUP_RECURSIVE ? hops + 1 : 2 * hops;
+        }
+    }
+    elapsed = chord_bench_now_ns() - start;
+
+    snprintf(name, sizeof(name), "%s, %u us links",
+             mode == NET_LOOKUP_RECURSIVE ? "recursive" : "iterative", delay_us);
+    CHORD_BENCH_REPORT(name, BENCH_LOOKUPS, elapsed);
+    printf("  %-40s %12.2f hops/lookup %6.2f link trips/lookup\n", "",
+           (double)total_hops / BENCH_LOOKUPS, (double)total_trips / BENCH_LOOKUPS);
+    if (failures) {
+        printf("  %-40s %12d lookups failed\n", "", failures);
+    }
+}
+
+static void bench_stabilise(bench_ring_t *ring, net_stabilise_mode_t mode, unsigned delay_us) {
+    char name[64];
+    uint64_t start;
+    uint64_t elapsed;
+    long total_trips = 0;
+    int failures = 0;
+
+    for (int i = 0; i < BENCH_NODES; i++) {
+        net_node_service_set_link_delay(ring->services[i], delay_us);
+    }
+
+    start = chord_bench_now_ns();
+    for (int period = 0; period < BENCH_PERIODS; period++) {
+        for (int i = 0; i < BENCH_NODES; i++) {
+            int trips = 0;
+
+            if (net_node_service_stabilise(ring->services[i], mode, BENCH_TIMEOUT_MS, &trips) != NET_ERR_OK) {
+                failures++;
+            }
+            total_trips += trips;
+        }
+    }
+    elapsed = chord_bench_now_ns() - start;
+
+    snprintf(name, sizeof(name), "%s, %u us links",
+             mode == NET_STABILISE_COMBINED ? "STABILIZE" : "separate RPCs", delay_us);
+    CHORD_BENCH_REPORT(name, BENCH_PERIODS * BENCH_NODES, elapsed);
+    printf("  %-40s %12.2f round trips/period\n", "",
+           (double)total_trips / (BENCH_PERIODS * BENCH_NODES));
+    if (failures) {
+        printf("  %-40s %12d periods failed\n", "", failures);
+    }
+}
+
+static void bench_on_shard_lookup(net_shard_lookup_t *lookup, int error) {
+    bench_tally_t *tally = (bench_tally_t*)lookup->context;
+
+    if (error != NET_ERR_OK) {
+        atomic_fetch_add_explicit(&tally->failures, 1, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&tally->crossings, lookup->crossings, memory_order_relaxed);
+    atomic_fetch_add_explicit(&tally->done, 1, memory_order_release);
+}
+
+static void bench_shards(unsigned count) {
+    static net_shard_lookup_t lookups[BENCH_SHARD_LOOKUPS];
+    Node *nodes[BENCH_SHARD_NODES];
+    net_shards_t *shards = net_shards_create(count, "tcp://127.0.0.1:7000");
+    bench_tally_t tally = { 0 };
+    char name[64];
+    uint64_t start;
+    uint64_t elapsed;
+
+    if (!shards) {
+        fprintf(stderr, "bench_lookup: cannot create %u shards\n", count);
+        return;
+    }
+    for (int i = 0; i < BENCH_SHARD_NODES; i++) {
+        char id[32];
+
+        snprintf(id, sizeof(id), "%d-shard%u", i, count);
+        nodes[i] = net_shards_spawn(shards, id);
+        if (i == 0) {
+            node_create(nodes[0]);
+        } else {
+            node_join(nodes[0], nodes[i]);
+            node_stabilise(nodes[i]);
+            node_fix_fingers(nodes[i]);
+        }
+    }
+    for (int round = 0; round < 2 * BENCH_SHARD_NODES; round++) {
+        for (int i = 0; i < BENCH_SHARD_NODES; i++) {
+            node_stabilise(nodes[i]);
+            node_fix_fingers(nodes[i]);
+        }
+    }
+    if (net_shards_start(shards) != 0) {
+        fprintf(stderr, "bench_lookup: cannot start %u shards\n", count);
+        net_shards_destroy(shards);
+        return;
+    }
+
+    start = chord_bench_now_ns();
+    for (int i = 0; i < BENCH_SHARD_LOOKUPS; i++) {
+        net_shards_lookup(shards, nodes[i % BENCH_SHARD_NODES], (i * 97 + 13) % ring_key_max(),
+                          &lookups[i], bench_on_shard_lookup, &tally);
+    }
+    while (atomic_load_explicit(&tally.done, memory_order_acquire) < BENCH_SHARD_LOOKUPS) {
+        struct timespec ts = { 0, 100000 };
+
+        nanosleep(&ts, NULL);
+    }
+    elapsed = chord_bench_now_ns() - start;
+    net_shards_stop(shards);
+
+    snprintf(name, sizeof(name), "%u shard%s", count, count == 1 ? "" : "s");
+    CHORD_BENCH_REPORT(name, BENCH_SHARD_LOOKUPS, elapsed);
+    printf("  %-40s %12.2f crossings/lookup\n", "",
+           (double)atomic_load(&tally.crossings) / BENCH_SHARD_LOOKUPS);
+    if (atomic_load(&tally.failures)) {
+        printf("  %-40s %12ld lookups failed\n", "", atomic_load(&tally.failures));
+    }
+    net_shards_destroy(shards);
+}
+
+int main(void) {
+    bench_ring_t ring;
+
+    if (bench_ring_start(&ring) != 0) {
+        fprintf(stderr, "bench_lookup: cannot start the ring\n");
+        return 1;
+    }
+
+    CHORD_BENCH_SECTION("Lookup latency, 32 nodes (iterative vs recursive)");
+    for (size_t i = 0; i < sizeof(bench_delays_us) / sizeof(bench_delays_us[0]); i++) {
+        bench_mode(&ring, NET_LOOKUP_ITERATIVE, bench_delays_us[i]);
+        bench_mode(&ring, NET_LOOKUP_RECURSIVE, bench_delays_us[i]);
+    }
+
+    CHORD_BENCH_SECTION("Stabilization periods, 32 nodes (separate RPCs vs STABILIZE)");
+    for (size_t i = 0; i < sizeof(bench_delays_us) / sizeof(bench_delays_us[0]); i++) {
+        bench_stabilise(&ring, NET_STABILISE_SEPARATE, bench_delays_us[i]);
+        bench_stabilise(&ring, NET_STABILISE_COMBINED, bench_delays_us[i]);
+    }
+
+    bench_ring_stop(&ring);
+
+    CHORD_BENCH_SECTION("Sharded lookup throughput, 128 nodes");
+    for (size_t i = 0; i < sizeof(bench_shard_counts) / sizeof(bench_shard_counts[0]); i++) {
+        bench_shards(bench_shard_counts[i]);
+    }
+    return 0;
+}
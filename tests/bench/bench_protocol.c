@@ -0,0 +1,79 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../chord_bench.h"
+#include "../../src/net/net_protocol.h"
+
+/*
+ * Wire format throughput: encode/decode rate and frame size per
+ * message type, binary vs JSON.
+ */
+
+#define BENCH_ITERATIONS 2000000
+
+typedef struct {
+    const char *name;
+    net_message_t msg;
+} bench_case_t;
+
+static void bench_format(const bench_case_t *bc, net_protocol_format_t format) {
+    uint8_t buffer[NET_PROTOCOL_MAX_FRAME];
+    net_message_t out;
+    char label[64];
+    uint64_t start, elapsed;
+    int len = 0;
+
+    start = chord_bench_now_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        len = net_protocol_serialize_as(&bc->msg, format, buffer, sizeof(buffer));
+        CHORD_BENCH_KEEP(len);
+    }
+    elapsed = chord_bench_now_ns() - start;
+
+    snprintf(label, sizeof(label), "%s %s encode", format == NET_PROTOCOL_FORMAT_JSON ? "json" : "bin ", bc->name);
+    CHORD_BENCH_REPORT(label, BENCH_ITERATIONS, elapsed);
+    printf("  %-40s %12d bytes %9.1f MB/s\n", "    frame size", len,
+           (double)len * BENCH_ITERATIONS * 1e3 / (double)elapsed);
+
+    start = chord_bench_now_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        int err = net_protocol_deserialize(&out, buffer, (size_t)len);
+        CHORD_BENCH_KEEP(err);
+    }
+    elapsed = chord_bench_now_ns() - start;
+
+    snprintf(label, sizeof(label), "%s %s decode", format == NET_PROTOCOL_FORMAT_JSON ? "json" : "bin ", bc->name);
+    CHORD_BENCH_REPORT(label, BENCH_ITERATIONS, elapsed);
+}
+
+int main(void) {
+    static bench_case_t cases[4];
+
+    cases[0].name = "FIND_SUCCESSOR";
+    net_protocol_init_message(&cases[0].msg, NET_MSG_FIND_SUCCESSOR, 48213);
+    cases[0].msg.payload.find_successor_req.key = 200;
+
+    cases[1].name = "FIND_SUCCESSOR_RESPONSE";
+    net_protocol_init_message(&cases[1].msg, NET_MSG_FIND_SUCCESSOR_RESPONSE, 48213);
+    net_protocol_copy_node_addr(&cases[1].msg.payload.find_successor_resp.node,
+                                "a3f09c12be", 211, "tcp://10.0.0.17:5555");
+
+    cases[2].name = "GET_PREDECESSOR_RESPONSE";
+    net_protocol_init_message(&cases[2].msg, NET_MSG_GET_PREDECESSOR_RESPONSE, 48214);
+    cases[2].msg.payload.get_node_resp.has_node = 1;
+    net_protocol_copy_node_addr(&cases[2].msg.payload.get_node_resp.node,
+                                "77b1e0d4c2", 12, "tcp://10.0.0.3:5555");
+
+    cases[3].name = "PING";
+    net_protocol_init_message(&cases[3].msg, NET_MSG_PING, 48215);
+
+    printf("sizeof(net_message_t) = %zu bytes, sizeof(net_node_addr_t) = %zu bytes\n",
+           sizeof(net_message_t), sizeof(net_node_addr_t));
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        CHORD_BENCH_SECTION(cases[i].name);
+        bench_format(&cases[i], NET_PROTOCOL_FORMAT_BINARY);
+        bench_format(&cases[i], NET_PROTOCOL_FORMAT_JSON);
+    }
+
+    return 0;
+}
@@ -0,0 +1,864 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../chord_bench.h"
+#include "../../src/core/ring.h"
+#include "../../src/core/host.h"
+
+/*
+ * Ring maintenance in the in-memory core, counted in the messages a
+ * networked node would send (lookup hops and predecessor probes).
+ *
+ * Finger maintenance: a settled ring of BENCH_NODES nodes takes
+ * BENCH_JOINS joins, one per period, then runs on to BENCH_PERIODS;
+ * each period every node stabilises and fixes its fingers under one
+ * FingerPolicy. Reports the maintenance messages per node and period,
+ * the mean hops of BENCH_PROBES lookups per node and period, and the
+ * share of fingers on their start's successor.
+ *
+ * Join: BENCH_JOIN_NODES new nodes join a settled ring of BENCH_NODES,
+ * one at a time, by node_join() and a full fix_fingers, or by
+ * node_join_copy(). Reports the time and messages per join and the
+ * share of the new node's fingers right at once, then the periods of
+ * FINGER_FIX_CHANGED maintenance until every finger is right.
+ *
+ * Join storm: BENCH_STORM nodes join a settled ring of BENCH_STORM_SEED
+ * at once, each by node_join() against the ring as it was, or all by
+ * node_join_batch(). Then every node stabilises and fixes its fingers
+ * (FINGER_FIX_CHANGED) per round until all successors, predecessors
+ * and fingers are right. Reports the time to that point, the rounds
+ * and the messages per joiner, joins and maintenance together. The
+ * 8-bit key space caps the ring at 256 nodes.
+ *
+ * Maintenance periods: a settled ring of BENCH_NODES runs node_maintain()
+ * every tick with fixed periods or adaptive ones (node_schedule()
+ * bounds). After BENCH_QUIET_TICKS, BENCH_CHURN nodes fail and as many
+ * join. Reports the steady-state messages per node and tick before the
+ * churn, and the ticks and messages until the live ring is right
+ * again, averaged over BENCH_TRIALS rings.
+ *
+ * Routing under churn: a settled ring of BENCH_NODES loses one node and
+ * gains one every period for BENCH_JOINS periods, then runs on to
+ * BENCH_PERIODS, repairing fingers one per period (FINGER_FIX_NEXT).
+ * Each period the same lookups are routed by fingers alone and by the
+ * unified view (fingers, successor list and predecessor, live nodes
+ * only). Reports the mean hops, the hops to dead nodes (timeouts on a
+ * real network) and the share of correct results for each.
+ *
+ * Finger base: settled rings of BENCH_BASE_NODES built with finger
+ * bases 2 to 16. Reports the fingers and finger-table bytes per node,
+ * the mean hops of lookups routed by fingers alone, and the messages
+ * per node of one maintenance period under FINGER_FIX_ALL and
+ * FINGER_FIX_CHANGED.
+ *
+ * One-hop routing: a settled ring of BENCH_BASE_NODES with membership
+ * tables loses one node and gains one every period for BENCH_JOINS
+ * periods, then runs on to BENCH_PERIODS, stabilising (which carries
+ * the table changes) and fixing one finger per period. Each period the
+ * same lookups are routed by fingers (node_lookup()) and by the table
+ * (node_lookup_one_hop()). Reports the mean hops, the share answered
+ * in at most one hop and the share correct for each, the table bytes
+ * per node, and the periods after the last churn until every table
+ * lists exactly the live ring.
+ *
+ * Virtual nodes: BENCH_HOSTS physical hosts running 1 to 8 virtual
+ * nodes each form a settled ring. Reports the keys per host as the
+ * largest and smallest against the mean and the standard deviation
+ * over the mean, and the mean hops of lookups routed with each host's
+ * combined fingers, averaged over BENCH_TRIALS sets of host names.
+ *
+ * Item balancing: a settled ring of BENCH_NODES holds BENCH_DOCUMENTS
+ * documents, half of them on a hot BENCH_HOT_KEYS-key range. Each
+ * round every node probes one other at random with node_balance(),
+ * then every node stabilises and fixes its fingers (FINGER_FIX_CHANGED).
+ * Reports the max/mean documents per node over the rounds, the moves,
+ * and whether every document is still at its key's successor.
+ */
+
+#define BENCH_NODES 64
+#define BENCH_JOINS 16
+#define BENCH_PERIODS 48
+#define BENCH_PROBES 8
+#define BENCH_JOIN_NODES 32
+#define BENCH_STORM_SEED 32
+#define BENCH_STORM 192
+#define BENCH_RING_MAX 256
+#define BENCH_QUIET_TICKS 500
+#define BENCH_TRIALS 8
+#define BENCH_BASE_NODES 128
+#define BENCH_CHURN 8
+#define BENCH_ONE_HOP_NODES 128
+#define BENCH_HOSTS 16
+#define BENCH_DOCUMENTS 2048
+#define BENCH_HOT_KEYS 16
+#define BENCH_BALANCE_ROUNDS 32
+
+typedef struct {
+    Node *nodes[BENCH_RING_MAX];
+    int count;
+} bench_ring_t;
+
+static const FingerPolicy bench_policies[] = {
+    FINGER_FIX_ALL, FINGER_FIX_NEXT, FINGER_FIX_SHARED, FINGER_FIX_CHANGED
+};
+static const char *bench_policy_names[] = {
+    "FINGER_FIX_ALL", "FINGER_FIX_NEXT", "FINGER_FIX_SHARED", "FINGER_FIX_CHANGED"
+};
+
+/* A node named "<n>-<suffix>" on a key no node of ring holds yet */
+static Node* bench_node(bench_ring_t *ring, const char *suffix, int *n) {
+    char name[32];
+
+    for (;; (*n)++) {
+        int taken = 0;
+
+        snprintf(name, sizeof(name), "%d-%s", *n, suffix);
+        for (int i = 0; i < ring->count; i++) {
+            taken |= ring->nodes[i]->key == chord_hash(name);
+        }
+        if (!taken) {
+            (*n)++;
+            return node_init(strdup(name));
+        }
+    }
+}
+
+static Node* bench_true_successor(const bench_ring_t *ring, int key) {
+    Node *best = NULL;
+    int best_distance = 0;
+
+    for (int i = 0; i < ring->count; i++) {
+        int distance = ((ring->nodes[i]->key - key) % ring_key_max() + ring_key_max()) % ring_key_max();
+
+        if (!best || distance < best_distance) {
+            best = ring->nodes[i];
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+static void bench_settle(bench_ring_t *ring) {
+    for (int round = 0; round < 2 * ring->count; round++) {
+        /* backwards: a node stabilising alone would take itself as predecessor */
+        for (int i = ring->count - 1; i >= 0; i--) {
+            node_stabilise(ring->nodes[i]);
+            node_fix_fingers(ring->nodes[i]);
+        }
+    }
+}
+
+static void bench_fingers(size_t p) {
+    bench_ring_t ring = { .count = 0 };
+    char suffix[16];
+    int n = 0;
+    long messages = 0;
+    int hops = 0;
+    long lookups = 0;
+    long right = 0;
+    long fingers = 0;
+    uint64_t elapsed = 0;
+    uint64_t node_periods;
+
+    snprintf(suffix, sizeof(suffix), "fix%zu", p);
+    for (int i = 0; i < BENCH_NODES; i++) {
+        ring.nodes[ring.count] = bench_node(&ring, suffix, &n);
+        if (i == 0) {
+            node_create(ring.nodes[0]);
+        } else {
+            node_join(ring.nodes[0], ring.nodes[ring.count]);
+        }
+        ring.count++;
+    }
+    bench_settle(&ring);
+
+    for (int period = 0; period < BENCH_PERIODS; period++) {
+        uint64_t start;
+
+        if (period < BENCH_JOINS) {
+            ring.nodes[ring.count] = bench_node(&ring, suffix, &n);
+            node_join(ring.nodes[period % BENCH_NODES], ring.nodes[ring.count]);
+            ring.count++;
+        }
+
+        start = chord_bench_now_ns();
+        for (int i = ring.count - 1; i >= 0; i--) {
+            node_stabilise(ring.nodes[i]);
+            messages += node_fix_fingers_policy(ring.nodes[i], bench_policies[p]);
+        }
+        elapsed += chord_bench_now_ns() - start;
+
+        for (int i = 0; i < ring.count; i++) {
+            for (int k = 0; k < BENCH_PROBES; k++) {
+                int key = (i * 53 + k * 31 + period * 7) % ring_key_max();
+
+                node_lookup(ring.nodes[i], key, &hops);
+                lookups++;
+            }
+            for (int f = 0; f < KEY_BITS; f++) {
+                Finger *finger = ring.nodes[i]->finger_table->fingers[f];
+
+                right += finger->node == bench_true_successor(&ring, finger->start);
+                fingers++;
+            }
+        }
+    }
+
+    node_periods = (uint64_t)ring.count * BENCH_PERIODS;
+    CHORD_BENCH_REPORT(bench_policy_names[p], node_periods, elapsed);
+    printf("  %-40s %12.2f msgs/node/period %6.2f hops/lookup %6.1f%% fingers right\n", "",
+           (double)messages / (double)node_periods,
+           (double)hops / (double)lookups, 100.0 * (double)right / (double)fingers);
+}
+
+static int bench_fingers_right(const bench_ring_t *ring, const Node *node) {
+    int right = 0;
+
+    for (int f = 0; f < KEY_BITS; f++) {
+        Finger *finger = node->finger_table->fingers[f];
+
+        right += finger->node == bench_true_successor(ring, finger->start);
+    }
+    return right;
+}
+
+static void bench_join(int copy) {
+    bench_ring_t ring = { .count = 0 };
+    const char *suffix = copy ? "copy" : "plain";
+    int n = 0;
+    long messages = 0;
+    long right = 0;
+    int periods = 0;
+    int settled = 0;
+    uint64_t elapsed = 0;
+
+    for (int i = 0; i < BENCH_NODES; i++) {
+        ring.nodes[ring.count] = bench_node(&ring, suffix, &n);
+        if (i == 0) {
+            node_create(ring.nodes[0]);
+        } else {
+            node_join(ring.nodes[0], ring.nodes[ring.count]);
+        }
+        ring.count++;
+    }
+    bench_settle(&ring);
+
+    for (int j = 0; j < BENCH_JOIN_NODES; j++) {
+        Node *joining = bench_node(&ring, suffix, &n);
+        Node *existing = ring.nodes[(j * 7) % BENCH_NODES];
+        int sent = 1;
+        uint64_t start = chord_bench_now_ns();
+
+        if (copy) {
+            sent = node_join_copy(existing, joining);
+        } else {
+            /* node_join(), with its lookup's hops counted */
+            joining->predecessor = NULL;
+            joining->successor = node_lookup(existing, joining->key, &sent);
+            sent += node_fix_fingers_policy(joining, FINGER_FIX_ALL);
+        }
+        elapsed += chord_bench_now_ns() - start;
+
+        messages += sent;
+        ring.nodes[ring.count++] = joining;
+        right += bench_fingers_right(&ring, joining);
+    }
+
+    while (!settled && periods < 4 * KEY_BITS) {
+        settled = 1;
+        for (int i = ring.count - 1; i >= 0; i--) {
+            node_stabilise(ring.nodes[i]);
+            node_fix_fingers_policy(ring.nodes[i], FINGER_FIX_CHANGED);
+        }
+        periods++;
+        for (int i = 0; i < ring.count; i++) {
+            settled &= bench_fingers_right(&ring, ring.nodes[i]) == KEY_BITS;
+        }
+    }
+
+    CHORD_BENCH_REPORT(copy ? "node_join_copy" : "node_join + FINGER_FIX_ALL", BENCH_JOIN_NODES, elapsed);
+    printf("  %-40s %12.2f msgs/join %6.1f%% fingers right %3d periods to settle\n", "",
+           (double)messages / BENCH_JOIN_NODES,
+           100.0 * (double)right / (BENCH_JOIN_NODES * KEY_BITS), periods);
+}
+
+static int bench_converged(const bench_ring_t *ring) {
+    for (int i = 0; i < ring->count; i++) {
+        Node *node = ring->nodes[i];
+
+        if (node->successor != bench_true_successor(ring, (node->key + 1) % ring_key_max())
+            || node->predecessor == NULL || node->predecessor->successor != node
+            || bench_fingers_right(ring, node) != KEY_BITS) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void bench_storm(int batched) {
+    bench_ring_t ring = { .count = 0 };
+    const char *suffix = batched ? "batch" : "storm";
+    int n = 0;
+    int rounds = 0;
+    long messages = 0;
+    uint64_t elapsed;
+    uint64_t start;
+
+    for (int i = 0; i < BENCH_STORM_SEED; i++) {
+        ring.nodes[ring.count] = bench_node(&ring, suffix, &n);
+        if (i == 0) {
+            node_create(ring.nodes[0]);
+        } else {
+            node_join(ring.nodes[0], ring.nodes[ring.count]);
+        }
+        ring.count++;
+    }
+    bench_settle(&ring);
+    for (int i = 0; i < BENCH_STORM; i++) {
+        ring.nodes[ring.count] = bench_node(&ring, suffix, &n);
+        ring.count++;
+    }
+
+    start = chord_bench_now_ns();
+    if (batched) {
+        messages += node_join_batch(ring.nodes[0], &ring.nodes[BENCH_STORM_SEED], BENCH_STORM);
+    } else {
+        for (int i = 0; i < BENCH_STORM; i++) {
+            Node *joining = ring.nodes[BENCH_STORM_SEED + i];
+            int sent = 1;
+
+            /* node_join(), with its lookup's hops counted */
+            joining->predecessor = NULL;
+            joining->successor = node_lookup(ring.nodes[i % BENCH_STORM_SEED], joining->key, &sent);
+            messages += sent;
+        }
+    }
+    elapsed = chord_bench_now_ns() - start;
+
+    while (!bench_converged(&ring) && rounds < 4 * BENCH_RING_MAX) {
+        start = chord_bench_now_ns();
+        for (int i = ring.count - 1; i >= 0; i--) {
+            node_stabilise(ring.nodes[i]);
+            messages += 1 + node_fix_fingers_policy(ring.nodes[i], FINGER_FIX_CHANGED);
+        }
+        elapsed += chord_bench_now_ns() - start;
+        rounds++;
+    }
+
+    CHORD_BENCH_REPORT(batched ? "node_join_batch" : "node_join each", BENCH_STORM, elapsed);
+    printf("  %-40s %12.2f ms to converge %4d rounds %8.1f msgs/joiner\n", "",
+           (double)elapsed / 1e6, rounds, (double)messages / BENCH_STORM);
+}
+
+/* One churn trial; adds its traffic and recovery to the totals */
+static void bench_periods_trial(int trial, int min_period, int max_period, double *quiet,
+                                double *ticks, double *recovery) {
+    bench_ring_t ring = { .count = 0 };
+    char suffix[16];
+    int n = 0;
+    int tick;
+    int recovered = 4 * BENCH_QUIET_TICKS;
+    long sent = 0;
+
+    /* the same rings and failures for every configuration */
+    snprintf(suffix, sizeof(suffix), "churn%d", trial);
+    for (int i = 0; i < BENCH_NODES; i++) {
+        ring.nodes[ring.count] = bench_node(&ring, suffix, &n);
+        if (i == 0) {
+            node_create(ring.nodes[0]);
+        } else {
+            node_join(ring.nodes[0], ring.nodes[ring.count]);
+        }
+        ring.count++;
+    }
+    bench_settle(&ring);
+    for (int i = 0; i < ring.count; i++) {
+        node_schedule(ring.nodes[i], min_period, max_period);
+        /* nodes start at different times, so their periods are out of step */
+        for (int task = 0; task < MAINTAIN_TASKS; task++) {
+            ring.nodes[i]->schedule.due[task] = (i * 7 + task) % max_period;
+        }
+    }
+
+    for (tick = 0; tick < BENCH_QUIET_TICKS; tick++) {
+        for (int i = ring.count - 1; i >= 0; i--) {
+            int messages = node_maintain(ring.nodes[i], tick, FINGER_FIX_CHANGED);
+
+            /* the second half, once adaptive periods have settled */
+            sent += tick >= BENCH_QUIET_TICKS / 2 ? messages : 0;
+        }
+    }
+    *quiet += (double)sent / ((double)ring.count * (BENCH_QUIET_TICKS / 2));
+
+    for (int c = 0; c < BENCH_CHURN; c++) {
+        Node *joining = bench_node(&ring, suffix, &n);
+
+        /* joins first: a joiner knows only its successor until it stabilises */
+        node_join(ring.nodes[c], joining);
+        node_stabilise(joining);
+        joining->schedule.tick = tick;
+        node_schedule(joining, min_period, max_period);
+        ring.nodes[ring.count++] = joining;
+    }
+    for (int c = 0; c < BENCH_CHURN; c++) {
+        int victim = (c * 7 + 3) % ring.count;
+
+        /* no two neighbours: the successor list must keep a live entry */
+        while (ring.nodes[victim]->successor->state == NODE_STATE_DEAD
+               || ring.nodes[victim]->predecessor->state == NODE_STATE_DEAD) {
+            victim = (victim + 1) % ring.count;
+        }
+        ring.nodes[victim]->state = NODE_STATE_DEAD;
+        ring.nodes[victim] = ring.nodes[--ring.count];
+    }
+
+    sent = 0;
+    for (int start = tick; tick < start + 4 * BENCH_QUIET_TICKS; tick++) {
+        for (int i = ring.count - 1; i >= 0; i--) {
+            sent += node_maintain(ring.nodes[i], tick, FINGER_FIX_CHANGED);
+        }
+        if (bench_converged(&ring)) {
+            recovered = tick - start + 1;
+            break;
+        }
+    }
+    *ticks += recovered;
+    *recovery += (double)sent;
+}
+
+static void bench_periods(const char *name, int min_period, int max_period) {
+    double quiet = 0;
+    double ticks = 0;
+    double recovery = 0;
+
+    for (int trial = 0; trial < BENCH_TRIALS; trial++) {
+        bench_periods_trial(trial, min_period, max_period, &quiet, &ticks, &recovery);
+    }
+    printf("  %-40s %12.3f msgs/node/tick %6.1f ticks %8.1f msgs to recover\n", name,
+           quiet / BENCH_TRIALS, ticks / BENCH_TRIALS, recovery / BENCH_TRIALS);
+}
+
+typedef struct {
+    long lookups;
+    long hops;
+    long dead;
+    long right;
+} bench_route_t;
+
+static void bench_route_lookups(const bench_ring_t *ring, int period, bench_route_t *route) {
+    for (int i = 0; i < ring->count; i++) {
+        for (int k = 0; k < BENCH_PROBES; k++) {
+            int key = (i * 53 + k * 31 + period * 7) % ring_key_max();
+            Node *at = ring->nodes[i];
+            Node *result = NULL;
+            int done = FALSE;
+
+            for (int step = 0; step < BENCH_RING_MAX && !done; step++) {
+                Node *next = node_next_hop(at, key, &done);
+
+                if (done) {
+                    result = next;
+                    break;
+                }
+                at = next;
+                route->hops++;
+                route->dead += at->state == NODE_STATE_DEAD;
+            }
+            route->right += result == bench_true_successor(ring, key);
+            route->lookups++;
+        }
+    }
+}
+
+static void bench_routing(void) {
+    bench_ring_t ring = { .count = 0 };
+    bench_route_t routes[2];
+    static const char *names[] = { "ROUTE_FINGERS", "ROUTE_UNIFIED" };
+    int n = 0;
+
+    memset(routes, 0, sizeof(routes));
+    for (int i = 0; i < BENCH_NODES; i++) {
+        ring.nodes[ring.count] = bench_node(&ring, "route", &n);
+        if (i == 0) {
+            node_create(ring.nodes[0]);
+        } else {
+            node_join(ring.nodes[0], ring.nodes[ring.count]);
+        }
+        ring.count++;
+    }
+    bench_settle(&ring);
+
+    for (int period = 0; period < BENCH_PERIODS; period++) {
+        if (period < BENCH_JOINS) {
+            Node *joining = bench_node(&ring, "route", &n);
+            int victim = (period * 11 + 5) % ring.count;
+
+            node_join(ring.nodes[period % ring.count], joining);
+            node_stabilise(joining);
+            ring.nodes[ring.count++] = joining;
+            while (ring.nodes[victim]->successor->state == NODE_STATE_DEAD
+                   || ring.nodes[victim]->predecessor == NULL
+                   || ring.nodes[victim]->predecessor->state == NODE_STATE_DEAD) {
+                victim = (victim + 1) % ring.count;
+            }
+            ring.nodes[victim]->state = NODE_STATE_DEAD;
+            ring.nodes[victim] = ring.nodes[--ring.count];
+        }
+        for (int i = ring.count - 1; i >= 0; i--) {
+            node_stabilise(ring.nodes[i]);
+            node_check_predecessor(ring.nodes[i]);
+            node_fix_fingers_policy(ring.nodes[i], FINGER_FIX_NEXT);
+        }
+
+        for (int view = 0; view < 2; view++) {
+            ring_get()->routing = view ? ROUTE_UNIFIED : ROUTE_FINGERS;
+            bench_route_lookups(&ring, period, &routes[view]);
+        }
+    }
+    ring_get()->routing = ROUTE_UNIFIED;
+
+    for (int view = 0; view < 2; view++) {
+        bench_route_t *route = &routes[view];
+
+        printf("  %-40s %12.2f hops/lookup %6.3f dead hops %6.1f%% right\n", names[view],
+               (double)route->hops / (double)route->lookups,
+               (double)route->dead / (double)route->lookups,
+               100.0 * (double)route->right / (double)route->lookups);
+    }
+}
+
+static void bench_base(int base) {
+    bench_ring_t ring = { .count = 0 };
+    char suffix[16];
+    char name[32];
+    int n = 0;
+    int hops = 0;
+    long lookups = 0;
+    long all = 0;
+    long changed = 0;
+    int fingers;
+    uint64_t start;
+    uint64_t elapsed;
+
+    ring_get()->finger_base = base;
+    snprintf(suffix, sizeof(suffix), "base%d", base);
+    for (int i = 0; i < BENCH_BASE_NODES; i++) {
+        ring.nodes[ring.count] = bench_node(&ring, suffix, &n);
+        if (i == 0) {
+            node_create(ring.nodes[0]);
+        } else {
+            node_join(ring.nodes[0], ring.nodes[ring.count]);
+        }
+        ring.count++;
+    }
+    bench_settle(&ring);
+    ring_get()->finger_base = 2;
+    fingers = ring.nodes[0]->finger_table->length;
+
+    ring_get()->routing = ROUTE_FINGERS;
+    start = chord_bench_now_ns();
+    for (int i = 0; i < ring.count; i++) {
+        for (int key = i % 4; key < ring_key_max(); key += 4) {
+            node_lookup(ring.nodes[i], key, &hops);
+            lookups++;
+        }
+    }
+    elapsed = chord_bench_now_ns() - start;
+    ring_get()->routing = ROUTE_UNIFIED;
+
+    for (int i = 0; i < ring.count; i++) {
+        all += node_fix_fingers_policy(ring.nodes[i], FINGER_FIX_ALL);
+    }
+    for (int i = 0; i < ring.count; i++) {
+        changed += node_fix_fingers_policy(ring.nodes[i], FINGER_FIX_CHANGED);
+    }
+
+    snprintf(name, sizeof(name), "base %d lookups", base);
+    CHORD_BENCH_REPORT(name, lookups, elapsed);
+    printf("  %-40s %5d fingers %6zu bytes %6.2f hops %7.1f msgs ALL %6.1f msgs CHANGED\n", "",
+           fingers, sizeof(FingerTable) + (size_t)fingers * (sizeof(Finger*) + sizeof(Finger)),
+           (double)hops / (double)lookups, (double)all / ring.count, (double)changed / ring.count);
+}
+
+/* live nodes whose table is not exactly the ring */
+static int bench_tables_stale(const bench_ring_t *ring) {
+    int stale = 0;
+
+    for (int i = 0; i < ring->count; i++) {
+        Membership *members = ring->nodes[i]->members;
+        int exact = members->count == ring->count;
+
+        for (int m = 0; exact && m < members->count; m++) {
+            exact = members->nodes[m]->state != NODE_STATE_DEAD;
+        }
+        stale += !exact;
+    }
+    return stale;
+}
+
+static void bench_one_hop(void) {
+    bench_ring_t ring = { .count = 0 };
+    static const char *names[] = { "node_lookup (fingers)", "node_lookup_one_hop" };
+    Node *expected[BENCH_RING_MAX];
+    long lookups = 0;
+    long hops[2] = { 0 };
+    long single[2] = { 0 };
+    long right[2] = { 0 };
+    uint64_t elapsed[2] = { 0 };
+    size_t bytes = 0;
+    int settled = -1;
+    int n = 0;
+
+    for (int i = 0; i < BENCH_ONE_HOP_NODES; i++) {
+        ring.nodes[ring.count] = bench_node(&ring, "onehop", &n);
+        if (i == 0) {
+            node_create(ring.nodes[0]);
+        } else {
+            node_join(ring.nodes[0], ring.nodes[ring.count]);
+        }
+        ring.count++;
+    }
+    bench_settle(&ring);
+    for (int i = 0; i < ring.count; i++) {
+        node_members_enable(ring.nodes[i]);
+    }
+
+    for (int period = 0; period < BENCH_PERIODS; period++) {
+        if (period < BENCH_JOINS) {
+            Node *joining = bench_node(&ring, "onehop", &n);
+            int victim = (period * 11 + 5) % ring.count;
+
+            node_join(ring.nodes[period % ring.count], joining);
+            node_members_enable(joining);
+            node_stabilise(joining);
+            ring.nodes[ring.count++] = joining;
+            while (ring.nodes[victim]->successor->state == NODE_STATE_DEAD
+                   || ring.nodes[victim]->predecessor == NULL
+                   || ring.nodes[victim]->predecessor->state == NODE_STATE_DEAD) {
+                victim = (victim + 1) % ring.count;
+            }
+            ring.nodes[victim]->state = NODE_STATE_DEAD;
+            ring.nodes[victim] = ring.nodes[--ring.count];
+        }
+        for (int i = ring.count - 1; i >= 0; i--) {
+            node_stabilise(ring.nodes[i]);
+            node_check_predecessor(ring.nodes[i]);
+            node_fix_fingers_policy(ring.nodes[i], FINGER_FIX_NEXT);
+        }
+        if (settled < 0 && period >= BENCH_JOINS - 1 && bench_tables_stale(&ring) == 0) {
+            settled = period - (BENCH_JOINS - 1);
+        }
+
+        for (int key = 0; key < ring_key_max(); key++) {
+            expected[key] = bench_true_successor(&ring, key);
+        }
+        /* fingers first: one-hop lookups correct the tables they read */
+        for (int mode = 0; mode < 2; mode++) {
+            uint64_t start = chord_bench_now_ns();
+
+            for (int i = 0; i < ring.count; i++) {
+                for (int k = 0; k < BENCH_PROBES; k++) {
+                    int key = (i * 53 + k * 31 + period * 7) % ring_key_max();
+                    int taken = 0;
+                    Node *result = mode ? node_lookup_one_hop(ring.nodes[i], key, &taken)
+                        : node_lookup(ring.nodes[i], key, &taken);
+
+                    hops[mode] += taken;
+                    single[mode] += taken <= 1;
+                    right[mode] += result == expected[key];
+                    lookups += mode;
+                }
+            }
+            elapsed[mode] += chord_bench_now_ns() - start;
+        }
+    }
+
+    for (int i = 0; i < ring.count; i++) {
+        Membership *members = ring.nodes[i]->members;
+
+        bytes += sizeof(Membership) + (size_t)members->capacity * (sizeof(int) + sizeof(Node*));
+    }
+    for (int mode = 0; mode < 2; mode++) {
+        CHORD_BENCH_REPORT(names[mode], lookups, elapsed[mode]);
+        printf("  %-40s %12.2f hops/lookup %6.1f%% in one hop %6.1f%% right\n", "",
+               (double)hops[mode] / (double)lookups,
+               100.0 * (double)single[mode] / (double)lookups,
+               100.0 * (double)right[mode] / (double)lookups);
+    }
+    printf("  %-40s %12zu bytes/node %6d periods to exact tables\n", "membership table",
+           bytes / (size_t)ring.count, settled);
+}
+
+static void bench_vnodes(int vnodes) {
+    double most = 0.0;
+    double least = 0.0;
+    double deviation = 0.0;
+    double hops = 0.0;
+    char name[32];
+
+    for (int trial = 0; trial < BENCH_TRIALS; trial++) {
+        bench_ring_t ring = { .count = 0 };
+        Host *hosts[BENCH_HOSTS];
+        double mean = (double)ring_key_max() / BENCH_HOSTS;
+        double squares = 0.0;
+        int most_keys = 0;
+        int least_keys = ring_key_max();
+        int taken_hops = 0;
+        int lookups = 0;
+
+        srand((unsigned)trial + 1);
+        for (int h = 0; h < BENCH_HOSTS;) {
+            Host *host;
+            int taken = 0;
+
+            /* random ids, as the driver gives its nodes */
+            for (int c = 0; c < NODE_ID_LENGTH; c++) {
+                name[c] = (char)('a' + rand() % 26);
+            }
+            name[NODE_ID_LENGTH] = '\0';
+            host = host_spawn(strdup(name), vnodes);
+            for (int v = 0; v < host->num_vnodes; v++) {
+                for (int i = 0; i < ring.count; i++) {
+                    taken |= ring.nodes[i]->key == host->vnodes[v]->key;
+                }
+            }
+            if (taken) {
+                continue;
+            }
+            host_join(host, h == 0 ? NULL : ring.nodes[0]);
+            for (int v = 0; v < host->num_vnodes; v++) {
+                ring.nodes[ring.count++] = host->vnodes[v];
+            }
+            hosts[h++] = host;
+        }
+        bench_settle(&ring);
+
+        for (int h = 0; h < BENCH_HOSTS; h++) {
+            int keys = host_keys(hosts[h]);
+
+            most_keys = MAX(most_keys, keys);
+            least_keys = MIN(least_keys, keys);
+            squares += (keys - mean) * (keys - mean);
+        }
+        for (int i = 0; i < ring.count; i++) {
+            for (int key = i % 8; key < ring_key_max(); key += 8) {
+                node_lookup(ring.nodes[i], key, &taken_hops);
+                lookups++;
+            }
+        }
+        most += most_keys / mean;
+        least += least_keys / mean;
+        deviation += sqrt(squares / BENCH_HOSTS) / mean;
+        hops += (double)taken_hops / lookups;
+    }
+
+    snprintf(name, sizeof(name), "%d virtual node%s per host", vnodes, vnodes == 1 ? "" : "s");
+    printf("  %-40s %7.2f max/mean %5.2f min/mean %5.2f stddev/mean %6.2f hops\n", name,
+           most / BENCH_TRIALS, least / BENCH_TRIALS, deviation / BENCH_TRIALS, hops / BENCH_TRIALS);
+}
+
+/* most documents on one node over the mean */
+static double bench_load(const bench_ring_t *ring) {
+    int most = 0;
+
+    for (int i = 0; i < ring->count; i++) {
+        most = MAX(most, ring->nodes[i]->num_documents);
+    }
+    return most / ((double)BENCH_DOCUMENTS / ring->count);
+}
+
+static void bench_balance(void) {
+    static Document docs[BENCH_DOCUMENTS];
+    bench_ring_t ring = { .count = 0 };
+    int n = 0;
+    int moves = 0;
+    int placed = 0;
+    int report = 1;
+
+    for (int i = 0; i < BENCH_NODES; i++) {
+        ring.nodes[ring.count] = bench_node(&ring, "balance", &n);
+        if (i == 0) {
+            node_create(ring.nodes[0]);
+        } else {
+            node_join(ring.nodes[0], ring.nodes[ring.count]);
+        }
+        ring.count++;
+    }
+    bench_settle(&ring);
+
+    srand(1);
+    for (int d = 0; d < BENCH_DOCUMENTS; d++) {
+        docs[d].key = d % 2 ? 100 + rand() % BENCH_HOT_KEYS : rand() % ring_key_max();
+        node_document_keep(bench_true_successor(&ring, docs[d].key), &docs[d]);
+    }
+    printf("  %-40s %12.2f max/mean\n", "round 0", bench_load(&ring));
+
+    for (int round = 1; round <= BENCH_BALANCE_ROUNDS; round++) {
+        for (int i = 0; i < ring.count; i++) {
+            moves += node_balance(ring.nodes[i], ring.nodes[rand() % ring.count]);
+        }
+        for (int i = ring.count - 1; i >= 0; i--) {
+            node_stabilise(ring.nodes[i]);
+            node_fix_fingers_policy(ring.nodes[i], FINGER_FIX_CHANGED);
+        }
+        if (round == report) {
+            char name[32];
+
+            snprintf(name, sizeof(name), "round %d", round);
+            printf("  %-40s %12.2f max/mean %6d moves\n", name, bench_load(&ring), moves);
+            report *= 2;
+        }
+    }
+
+    for (int i = 0; i < ring.count; i++) {
+        for (int d = 0; d < ring.nodes[i]->num_documents; d++) {
+            placed += bench_true_successor(&ring, ring.nodes[i]->documents[d]->key) == ring.nodes[i];
+        }
+    }
+    printf("  %-40s %11.1f%% of documents at their successor\n", "after balancing",
+           100.0 * placed / BENCH_DOCUMENTS);
+}
+
+int main(void) {
+    CHORD_BENCH_SECTION("Finger maintenance, 64 nodes + 16 joins (per policy)");
+    for (size_t p = 0; p < sizeof(bench_policies) / sizeof(bench_policies[0]); p++) {
+        bench_fingers(p);
+    }
+
+    CHORD_BENCH_SECTION("Join into 64 settled nodes (lookups vs copied fingers)");
+    bench_join(0);
+    bench_join(1);
+
+    CHORD_BENCH_SECTION("Join storm, 192 nodes into 32 at once (each vs batched)");
+    bench_storm(0);
+    bench_storm(1);
+
+    CHORD_BENCH_SECTION("Maintenance periods, 64 nodes, 8 fail and 8 join (fixed vs adaptive)");
+    bench_periods("fixed, every tick", 1, 1);
+    bench_periods("fixed, every 4 ticks", 4, 4);
+    bench_periods("fixed, every 16 ticks", 16, 16);
+    bench_periods("fixed, every 32 ticks", 32, 32);
+    bench_periods("adaptive, 1 to 16 ticks", 1, 16);
+    bench_periods("adaptive, 1 to 32 ticks", 1, 32);
+
+    CHORD_BENCH_SECTION("Routing under churn, 64 nodes, 16 fail and 16 join (routing views)");
+    bench_routing();
+
+    CHORD_BENCH_SECTION("Finger base, 128 nodes (hops, memory and maintenance per base)");
+    bench_base(2);
+    bench_base(4);
+    bench_base(8);
+    bench_base(16);
+
+    CHORD_BENCH_SECTION("One-hop routing, 128 nodes, 16 fail and 16 join (fingers vs table)");
+    bench_one_hop();
+
+    CHORD_BENCH_SECTION("Virtual nodes, 16 hosts (keys per host, hops with combined fingers)");
+    bench_vnodes(1);
+    bench_vnodes(2);
+    bench_vnodes(4);
+    bench_vnodes(8);
+
+    CHORD_BENCH_SECTION("Item balancing, 64 nodes, 2048 documents, half on 16 hot keys");
+    bench_balance();
+    return 0;
+}
@@ -0,0 +1,79 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../chord_bench.h"
+#include "../../src/net/net_rpc.h"
+
+/*
+ * Request multiplexing: cost per call (encode, pending insert, response
+ * match, completion) with N calls in flight on one link and responses
+ * returned in reverse order. A constant per-call cost across depths
+ * shows the pending table stays O(1).
+ */
+
+#define BENCH_CALLS 2000000
+#define BENCH_MAX_DEPTH 1024
+
+typedef struct {
+    uint32_t ids[BENCH_MAX_DEPTH];
+    int count;
+} bench_link_t;
+
+static int bench_link_send(void *link, const net_buf_t *frame) {
+    bench_link_t *bl = (bench_link_t*)link;
+    net_frame_view_t view;
+    net_protocol_decode_view(&view, frame->data, frame->len);
+    bl->ids[bl->count++] = view.header.request_id;
+    return NET_ERR_OK;
+}
+
+static void on_done(void *context, const net_frame_view_t *response, int error) {
+    (void)response;
+    *(int*)context += error == NET_ERR_OK;
+}
+
+static void bench_depth(int depth) {
+    static bench_link_t link;
+    static uint8_t frames[BENCH_MAX_DEPTH][64];
+    static int lens[BENCH_MAX_DEPTH];
+    net_loop_t *loop = net_loop_create();
+    net_rpc_t *rpc = net_rpc_create(loop, bench_link_send, &link);
+    net_message_t msg;
+    uint32_t next_id = 1;
+    int completed = 0;
+    char label[64];
+
+    net_protocol_init_message(&msg, NET_MSG_FIND_SUCCESSOR_RESPONSE, 0);
+    net_protocol_copy_node_addr(&msg.payload.find_successor_resp.node, "a3f09c12be", 211, "tcp://10.0.0.17:5555");
+
+    uint64_t start = chord_bench_now_ns();
+    for (int done = 0; done < BENCH_CALLS; done += depth) {
+        link.count = 0;
+        for (int i = 0; i < depth; i++) {
+            net_rpc_call(rpc, next_id++, NET_MSG_FIND_SUCCESSOR, i, NULL, on_done, &completed, 5000);
+        }
+        /* answer newest first: every response overtakes older calls */
+        for (int i = depth - 1; i >= 0; i--) {
+            msg.header.request_id = link.ids[i];
+            lens[i] = net_protocol_serialize(&msg, frames[i], sizeof(frames[i]));
+            net_rpc_receive(rpc, frames[i], (size_t)lens[i]);
+        }
+    }
+    uint64_t elapsed = chord_bench_now_ns() - start;
+
+    snprintf(label, sizeof(label), "%4d in flight, reversed replies", depth);
+    CHORD_BENCH_REPORT(label, (uint64_t)completed, elapsed);
+
+    net_rpc_destroy(rpc);
+    net_loop_destroy(loop);
+}
+
+int main(void) {
+    static const int depths[] = { 1, 16, 256, 1024 };
+
+    CHORD_BENCH_SECTION("FIND_SUCCESSOR call + response on one link");
+    for (size_t i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+        bench_depth(depths[i]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,190 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "../chord_bench.h"
+#include "../../src/net/net_transport.h"
+#include "../../src/net/net_protocol.h"
+
+/*
+ * Transports on one machine: request/response round trips against an
+ * echo process over TCP loopback, Unix domain sockets and shared-memory
+ * rings, one frame at a time and pipelined 64 deep, with a typical RPC
+ * frame. Then TCP loopback once per socket backend (epoll, io_uring),
+ * reporting RPCs/sec and the CPU both processes spent per RPC.
+ */
+
+#define BENCH_ROUND_TRIPS 100000
+#define BENCH_PIPELINE 64
+
+/* Child process: connect and echo frames until the parent hangs up */
+static void echo_process(net_transport_type_t type, const char *url) {
+    net_transport_t *client = net_transport_create(type);
+    uint8_t buf[NET_PROTOCOL_MAX_FRAME];
+    int n;
+
+    if (net_transport_connect(client, url, 1000) == 0) {
+        while ((n = net_transport_recv(client, buf, sizeof(buf), -1)) >= 0) {
+            if (net_transport_send(client, buf, (size_t)n, -1) != 0) {
+                break;
+            }
+        }
+    }
+    net_transport_destroy(client);
+}
+
+static void bench_transport(net_transport_type_t type, const char *url, const char *name) {
+    net_transport_listener_t *listener = net_transport_listener_create(type);
+    net_transport_t *server = NULL;
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+    uint8_t reply[NET_PROTOCOL_MAX_FRAME];
+    net_node_addr_t node;
+    char label[64];
+    pid_t child = -1;
+    int len;
+
+    if (net_transport_listener_listen(listener, url) == 0) {
+        fflush(stdout);
+        child = fork();
+        if (child == 0) {
+            echo_process(type, net_transport_listener_url(listener));
+            _exit(0);
+        }
+        server = net_transport_listener_accept(listener, 1000);
+    }
+    if (!server) {
+        printf("  %s: setup failed\n", name);
+        net_transport_listener_destroy(listener);
+        if (child > 0) {
+            waitpid(child, NULL, 0);
+        }
+        return;
+    }
+
+    net_protocol_copy_node_addr(&node, "a3f09c12be", 211, "tcp://10.0.0.17:5555");
+    len = net_protocol_encode_request(frame, sizeof(frame), NET_MSG_NOTIFY, 1, 0, &node);
+
+    uint64_t start = chord_bench_now_ns();
+    for (int i = 0; i < BENCH_ROUND_TRIPS; i++) {
+        net_transport_send(server, frame, (size_t)len, -1);
+        net_transport_recv(server, reply, sizeof(reply), -1);
+    }
+    uint64_t elapsed = chord_bench_now_ns() - start;
+    snprintf(label, sizeof(label), "%s, 1 in flight (%d B)", name, len);
+    CHORD_BENCH_REPORT(label, BENCH_ROUND_TRIPS, elapsed);
+
+    start = chord_bench_now_ns();
+    for (int i = 0; i < BENCH_ROUND_TRIPS; i += BENCH_PIPELINE) {
+        for (int j = 0; j < BENCH_PIPELINE; j++) {
+            net_transport_send(server, frame, (size_t)len, -1);
+        }
+        for (int j = 0; j < BENCH_PIPELINE; j++) {
+            net_transport_recv(server, reply, sizeof(reply), -1);
+        }
+    }
+    elapsed = chord_bench_now_ns() - start;
+    snprintf(label, sizeof(label), "%s, %d in flight", name, BENCH_PIPELINE);
+    CHORD_BENCH_REPORT(label, BENCH_ROUND_TRIPS, elapsed);
+
+    net_transport_destroy(server);  /* echo process sees the hang-up */
+    waitpid(child, NULL, 0);
+    net_transport_listener_destroy(listener);
+}
+
+static uint64_t children_cpu_ns(void) {
+    struct rusage usage;
+
+    getrusage(RUSAGE_CHILDREN, &usage);
+    return ((uint64_t)usage.ru_utime.tv_sec + (uint64_t)usage.ru_stime.tv_sec) * 1000000000ull +
+           ((uint64_t)usage.ru_utime.tv_usec + (uint64_t)usage.ru_stime.tv_usec) * 1000ull;
+}
+
+/* One echo process per run so its CPU time covers exactly that run */
+static void bench_backend(net_transport_backend_t backend, const char *name, int depth) {
+    net_transport_listener_t *listener = net_transport_listener_create(NET_TRANSPORT_TCP);
+    net_transport_t *server = NULL;
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+    uint8_t reply[NET_PROTOCOL_MAX_FRAME];
+    net_node_addr_t node;
+    char label[64];
+    pid_t child = -1;
+    int rpcs = BENCH_ROUND_TRIPS / depth * depth;
+    int echoed = 0;
+    int len;
+
+    if (net_transport_set_backend(backend) != 0) {
+        printf("  %s: not supported by this kernel\n", name);
+        net_transport_listener_destroy(listener);
+        return;
+    }
+    if (net_transport_listener_listen(listener, "tcp://127.0.0.1:0") == 0) {
+        fflush(stdout);
+        child = fork();
+        if (child == 0) {
+            echo_process(NET_TRANSPORT_TCP, net_transport_listener_url(listener));
+            _exit(0);
+        }
+        server = net_transport_listener_accept(listener, 1000);
+    }
+    net_transport_set_backend(NET_TRANSPORT_BACKEND_EPOLL);
+    if (!server) {
+        printf("  %s: setup failed\n", name);
+        net_transport_listener_destroy(listener);
+        if (child > 0) {
+            waitpid(child, NULL, 0);
+        }
+        return;
+    }
+
+    net_protocol_copy_node_addr(&node, "a3f09c12be", 211, "tcp://10.0.0.17:5555");
+    len = net_protocol_encode_request(frame, sizeof(frame), NET_MSG_NOTIFY, 1, 0, &node);
+
+    uint64_t child_cpu = children_cpu_ns();
+    uint64_t cpu = chord_bench_cpu_ns();
+    uint64_t start = chord_bench_now_ns();
+    for (int i = 0; i < rpcs; i += depth) {
+        for (int j = 0; j < depth; j++) {
+            net_transport_send(server, frame, (size_t)len, -1);
+        }
+        for (int j = 0; j < depth; j++) {
+            echoed += net_transport_recv(server, reply, sizeof(reply), -1) == len;
+        }
+    }
+    uint64_t elapsed = chord_bench_now_ns() - start;
+    cpu = chord_bench_cpu_ns() - cpu;
+
+    net_transport_destroy(server);
+    waitpid(child, NULL, 0);
+    net_transport_listener_destroy(listener);
+    child_cpu = children_cpu_ns() - child_cpu;
+
+    snprintf(label, sizeof(label), "%s, %d in flight", name, depth);
+    CHORD_BENCH_REPORT(label, rpcs, elapsed);
+    printf("  %-40s %12.0f ns CPU/RPC (both ends)\n", "",
+           (double)(cpu + child_cpu) / rpcs);
+    if (echoed != rpcs) {
+        printf("  %s: only %d of %d echoed\n", name, echoed, rpcs);
+    }
+}
+
+int main(void) {
+    char ipc[NET_TRANSPORT_MAX_URL];
+    char shm[NET_TRANSPORT_MAX_URL];
+
+    snprintf(ipc, sizeof(ipc), "ipc:///tmp/chord_bench_%d.sock", (int)getpid());
+    snprintf(shm, sizeof(shm), "shm://chord_bench_%d", (int)getpid());
+
+    CHORD_BENCH_SECTION("Round trips to an echo process");
+    bench_transport(NET_TRANSPORT_TCP, "tcp://127.0.0.1:0", "TCP loopback");
+    bench_transport(NET_TRANSPORT_IPC, ipc, "Unix socket");
+    bench_transport(NET_TRANSPORT_SHM, shm, "Shared memory");
+
+    CHORD_BENCH_SECTION("TCP loopback RPCs per socket backend");
+    bench_backend(NET_TRANSPORT_BACKEND_EPOLL, "epoll", 1);
+    bench_backend(NET_TRANSPORT_BACKEND_URING, "io_uring", 1);
+    bench_backend(NET_TRANSPORT_BACKEND_EPOLL, "epoll", BENCH_PIPELINE);
+    bench_backend(NET_TRANSPORT_BACKEND_URING, "io_uring", BENCH_PIPELINE);
+
+    return 0;
+}
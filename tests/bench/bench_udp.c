@@ -0,0 +1,311 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "../chord_bench.h"
+#include "../../src/net/net_transport.h"
+#include "../../src/net/net_udp.h"
+
+/*
+ * Control plane: stabilization rounds from one node to BENCH_NEIGHBOURS
+ * neighbours hosted by a second process, each round sending PING,
+ * NOTIFY, GET_PREDECESSOR and GET_SUCCESSOR to every neighbour and
+ * waiting for all the answers. Once over one TCP connection per
+ * neighbour (echoed back), then over the batched UDP control plane,
+ * with one datagram per message and with the four messages to each
+ * neighbour coalesced into one BATCH datagram.
+ * Reports messages/sec, the CPU each side spent per message and,
+ * for UDP, the syscalls and datagrams this node sent per message.
+ */
+
+#define BENCH_NEIGHBOURS 64
+#define BENCH_ROUNDS 500
+#define BENCH_PER_ROUND 4
+#define BENCH_MESSAGES (BENCH_ROUNDS * BENCH_NEIGHBOURS * BENCH_PER_ROUND)
+
+static const net_msg_type_t bench_types[BENCH_PER_ROUND] = {
+    NET_MSG_PING, NET_MSG_NOTIFY, NET_MSG_GET_PREDECESSOR, NET_MSG_GET_SUCCESSOR
+};
+
+static uint64_t children_cpu_ns(void) {
+    struct rusage usage;
+
+    getrusage(RUSAGE_CHILDREN, &usage);
+    return ((uint64_t)usage.ru_utime.tv_sec + (uint64_t)usage.ru_stime.tv_sec) * 1000000000ull +
+           ((uint64_t)usage.ru_utime.tv_usec + (uint64_t)usage.ru_stime.tv_usec) * 1000ull;
+}
+
+static void report(const char *name, uint64_t elapsed, uint64_t cpu, uint64_t child_cpu) {
+    CHORD_BENCH_REPORT(name, BENCH_MESSAGES, elapsed);
+    printf("  %-40s %12.0f ns CPU/message (this node)\n", "", (double)cpu / BENCH_MESSAGES);
+    printf("  %-40s %12.0f ns CPU/message (neighbours)\n", "", (double)child_cpu / BENCH_MESSAGES);
+}
+
+/* Child process: one connection per neighbour, echoing every frame */
+static void tcp_neighbours(const char *url) {
+    net_transport_t *conns[BENCH_NEIGHBOURS];
+    struct pollfd fds[BENCH_NEIGHBOURS];
+    uint8_t buf[NET_PROTOCOL_MAX_FRAME];
+    int open = 0;
+    int n;
+
+    for (int i = 0; i < BENCH_NEIGHBOURS; i++) {
+        conns[i] = net_transport_create(NET_TRANSPORT_TCP);
+        if (net_transport_connect(conns[i], url, 1000) == 0) {
+            open++;
+        }
+        fds[i].fd = net_transport_fd(conns[i]);
+        fds[i].events = POLLIN;
+    }
+    while (open > 0 && poll(fds, BENCH_NEIGHBOURS, -1) > 0) {
+        for (int i = 0; i < BENCH_NEIGHBOURS; i++) {
+            if (fds[i].fd < 0 || !fds[i].revents) {
+                continue;
+            }
+            while ((n = net_transport_recv(conns[i], buf, sizeof(buf), 0)) >= 0) {
+                net_transport_send(conns[i], buf, (size_t)n, -1);
+            }
+            if (errno != EAGAIN) {
+                fds[i].fd = -1;
+                open--;
+            }
+        }
+    }
+    for (int i = 0; i < BENCH_NEIGHBOURS; i++) {
+        net_transport_destroy(conns[i]);
+    }
+}
+
+static void bench_tcp(void) {
+    net_transport_listener_t *listener = net_transport_listener_create(NET_TRANSPORT_TCP);
+    net_transport_t *conns[BENCH_NEIGHBOURS] = { 0 };
+    uint8_t frames[BENCH_PER_ROUND][NET_PROTOCOL_MAX_FRAME];
+    int lens[BENCH_PER_ROUND];
+    uint8_t reply[NET_PROTOCOL_MAX_FRAME];
+    net_node_addr_t self;
+    pid_t child = -1;
+    int answered = 0;
+    int accepted = 0;
+
+    if (net_transport_listener_listen(listener, "tcp://127.0.0.1:0") == 0) {
+        fflush(stdout);
+        child = fork();
+        if (child == 0) {
+            tcp_neighbours(net_transport_listener_url(listener));
+            _exit(0);
+        }
+        while (accepted < BENCH_NEIGHBOURS &&
+               (conns[accepted] = net_transport_listener_accept(listener, 1000)) != NULL) {
+            accepted++;
+        }
+    }
+    if (accepted < BENCH_NEIGHBOURS) {
+        printf("  TCP: setup failed\n");
+        for (int i = 0; i < accepted; i++) {
+            net_transport_destroy(conns[i]);
+        }
+        net_transport_listener_destroy(listener);
+        if (child > 0) {
+            waitpid(child, NULL, 0);
+        }
+        return;
+    }
+
+    net_protocol_copy_node_addr(&self, "a3f09c12be", 211, "tcp://10.0.0.17:5555");
+    for (int t = 0; t < BENCH_PER_ROUND; t++) {
+        lens[t] = net_protocol_encode_request(frames[t], sizeof(frames[t]), bench_types[t], 1, 0, &self);
+    }
+
+    uint64_t child_cpu = children_cpu_ns();
+    uint64_t cpu = chord_bench_cpu_ns();
+    uint64_t start = chord_bench_now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < BENCH_NEIGHBOURS; i++) {
+            for (int t = 0; t < BENCH_PER_ROUND; t++) {
+                net_transport_send(conns[i], frames[t], (size_t)lens[t], -1);
+            }
+        }
+        for (int i = 0; i < BENCH_NEIGHBOURS; i++) {
+            for (int t = 0; t < BENCH_PER_ROUND; t++) {
+                answered += net_transport_recv(conns[i], reply, sizeof(reply), -1) == lens[t];
+            }
+        }
+    }
+    uint64_t elapsed = chord_bench_now_ns() - start;
+    cpu = chord_bench_cpu_ns() - cpu;
+
+    for (int i = 0; i < BENCH_NEIGHBOURS; i++) {
+        net_transport_destroy(conns[i]);
+    }
+    waitpid(child, NULL, 0);
+    net_transport_listener_destroy(listener);
+    child_cpu = children_cpu_ns() - child_cpu;
+
+    report("TCP, connection per neighbour", elapsed, cpu, child_cpu);
+    if (answered != BENCH_MESSAGES) {
+        printf("  TCP: only %d of %d answered\n", answered, BENCH_MESSAGES);
+    }
+}
+
+static volatile sig_atomic_t udp_stop;
+
+static void udp_on_term(int sig) {
+    (void)sig;
+    udp_stop = 1;
+}
+
+static int udp_answer(void *context, const net_frame_view_t *request, net_message_t *response) {
+    const net_node_addr_t *self = (const net_node_addr_t*)context;
+
+    switch (request->header.msg_type) {
+    case NET_MSG_PING:
+        response->payload.ping_resp.alive = 1;
+        response->payload.ping_resp.state = 2;
+        break;
+    case NET_MSG_NOTIFY:
+        response->payload.notify_resp.success = 1;
+        break;
+    default:
+        response->payload.get_node_resp.has_node = 1;
+        response->payload.get_node_resp.node = *self;
+        break;
+    }
+    return NET_ERR_OK;
+}
+
+/* Child process: one endpoint per neighbour on one loop; writes their
+ * URLs to out and serves until SIGTERM */
+static void udp_neighbours(int out) {
+    net_loop_t *loop = net_loop_create();
+    net_udp_t *udp[BENCH_NEIGHBOURS];
+    char url[BENCH_NEIGHBOURS][NET_TRANSPORT_MAX_URL];
+    net_node_addr_t self;
+
+    signal(SIGTERM, udp_on_term);
+    net_protocol_copy_node_addr(&self, "5be0c1a9d2", 97, "udp://10.0.0.18:5555");
+    memset(url, 0, sizeof(url));
+    for (int i = 0; i < BENCH_NEIGHBOURS; i++) {
+        udp[i] = net_udp_create(loop, "udp://127.0.0.1:0");
+        if (udp[i]) {
+            net_udp_set_handler(udp[i], udp_answer, &self);
+            snprintf(url[i], sizeof(url[i]), "%s", net_udp_url(udp[i]));
+        }
+    }
+    if (write(out, url, sizeof(url)) != (ssize_t)sizeof(url)) {
+        udp_stop = 1;
+    }
+    close(out);
+    while (!udp_stop) {
+        net_loop_run_once(loop, 100);
+    }
+    for (int i = 0; i < BENCH_NEIGHBOURS; i++) {
+        net_udp_destroy(udp[i]);
+    }
+    net_loop_destroy(loop);
+}
+
+static void udp_on_node(void *context, int error, const net_node_addr_t *node) {
+    (void)node;
+    *(int*)context += error == NET_ERR_OK;
+}
+
+static void udp_on_status(void *context, int error) {
+    *(int*)context += error == NET_ERR_OK;
+}
+
+static void udp_on_ping(void *context, int error, int alive, int state) {
+    (void)alive;
+    (void)state;
+    *(int*)context += error == NET_ERR_OK;
+}
+
+static void bench_udp(const char *name, unsigned coalesce) {
+    char url[BENCH_NEIGHBOURS][NET_TRANSPORT_MAX_URL];
+    net_peer_t *peers[BENCH_NEIGHBOURS] = { 0 };
+    net_loop_t *loop = net_loop_create();
+    net_udp_t *udp = net_udp_create(loop, "udp://127.0.0.1:0");
+    net_udp_stats_t stats;
+    net_node_addr_t self;
+    int pipe_fds[2];
+    pid_t child = -1;
+    int answered = 0;
+    int ready = 0;
+
+    if (udp && pipe(pipe_fds) == 0) {
+        fflush(stdout);
+        child = fork();
+        if (child == 0) {
+            close(pipe_fds[0]);
+            udp_neighbours(pipe_fds[1]);
+            _exit(0);
+        }
+        close(pipe_fds[1]);
+        ready = read(pipe_fds[0], url, sizeof(url)) == (ssize_t)sizeof(url);
+        close(pipe_fds[0]);
+    }
+    net_udp_set_batching(udp, coalesce, 0);
+    for (int i = 0; ready && i < BENCH_NEIGHBOURS; i++) {
+        peers[i] = net_udp_peer_create(udp);
+        ready = net_peer_connect(peers[i], url[i]) == NET_ERR_OK;
+    }
+    if (!ready) {
+        printf("  UDP: setup failed\n");
+    }
+
+    net_protocol_copy_node_addr(&self, "a3f09c12be", 211, "udp://10.0.0.17:5555");
+
+    uint64_t child_cpu = children_cpu_ns();
+    uint64_t cpu = chord_bench_cpu_ns();
+    uint64_t start = chord_bench_now_ns();
+    for (int r = 0; ready && r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < BENCH_NEIGHBOURS; i++) {
+            net_peer_ping_async(peers[i], udp_on_ping, &answered, 2000);
+            net_peer_notify_async(peers[i], &self, udp_on_status, &answered, 2000);
+            net_peer_get_predecessor_async(peers[i], udp_on_node, &answered, 2000);
+            net_peer_get_successor_async(peers[i], udp_on_node, &answered, 2000);
+        }
+        while (answered < (r + 1) * BENCH_NEIGHBOURS * BENCH_PER_ROUND &&
+               net_loop_run_once(loop, 100) >= 0) {
+        }
+    }
+    uint64_t elapsed = chord_bench_now_ns() - start;
+    cpu = chord_bench_cpu_ns() - cpu;
+
+    net_udp_get_stats(udp, &stats);
+    for (int i = 0; i < BENCH_NEIGHBOURS; i++) {
+        net_peer_destroy(peers[i]);
+    }
+    if (child > 0) {
+        kill(child, SIGTERM);
+        waitpid(child, NULL, 0);
+    }
+    child_cpu = children_cpu_ns() - child_cpu;
+
+    if (ready) {
+        report(name, elapsed, cpu, child_cpu);
+        printf("  %-40s %12.3f syscalls/message (this end)\n", "",
+               (double)(stats.send_calls + stats.recv_calls) / BENCH_MESSAGES);
+        printf("  %-40s %12.3f datagrams/message (this end)\n", "",
+               (double)stats.datagrams_sent / BENCH_MESSAGES);
+        if (answered != BENCH_MESSAGES) {
+            printf("  UDP: only %d of %d answered\n", answered, BENCH_MESSAGES);
+        }
+    }
+    net_udp_destroy(udp);
+    net_loop_destroy(loop);
+}
+
+int main(void) {
+    printf("\n%d neighbours x %d messages per round, %d rounds\n",
+           BENCH_NEIGHBOURS, BENCH_PER_ROUND, BENCH_ROUNDS);
+    CHORD_BENCH_SECTION("Stabilization traffic");
+    bench_tcp();
+    bench_udp("UDP, batched", 0);
+    bench_udp("UDP, batched, BATCH frames", BENCH_PER_ROUND);
+
+    return 0;
+}
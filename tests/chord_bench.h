@@ -0,0 +1,45 @@
+#ifndef CHORD_BENCH_H
+#define CHORD_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Minimal benchmark helpers
+ *
+ * Benchmarks are plain programs under tests/bench/ that print one
+ * aligned result row per measurement. They are built optimised (-O2)
+ * without sanitizers and run by `make bench`.
+ */
+
+/* Monotonic clock in nanoseconds */
+static inline uint64_t chord_bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Process CPU time in nanoseconds */
+static inline uint64_t chord_bench_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Keep the optimiser from discarding a computed value */
+#define CHORD_BENCH_KEEP(value) __asm__ volatile("" : : "g"(value) : "memory")
+
+/* Print a section header */
+#define CHORD_BENCH_SECTION(title) \
+    printf("\n=== %s ===\n", title)
+
+/* Report ops/sec and ns/op for a timed loop */
+#define CHORD_BENCH_REPORT(name, ops, elapsed_ns) \
+    printf("  %-40s %12.0f ops/s %10.1f ns/op\n", (name), \
+           (double)(ops) * 1e9 / (double)((elapsed_ns) ? (elapsed_ns) : 1), \
+           (double)(elapsed_ns) / (double)((ops) ? (ops) : 1))
+
+#endif /* CHORD_BENCH_H */
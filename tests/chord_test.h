@@ -62,18 +62,20 @@ static const char *chord_test_current = NULL;
         printf("  " CHORD_TEST_COLOR_GREEN "✓" CHORD_TEST_COLOR_RESET " %s\n", chord_test_current); \
     } while (0)
 
-#define CHORD_TEST_FAIL(msg, ...) \
+#define CHORD_TEST_FAIL(...) \
     do { \
         chord_test_failed++; \
         printf("  " CHORD_TEST_COLOR_RED "✗" CHORD_TEST_COLOR_RESET " %s\n", chord_test_current); \
-        printf("    " CHORD_TEST_COLOR_RED "FAIL:" CHORD_TEST_COLOR_RESET " " msg "\n", ##__VA_ARGS__); \
+        printf("    " CHORD_TEST_COLOR_RED "FAIL:" CHORD_TEST_COLOR_RESET " "); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
         printf("    at %s:%d\n", __FILE__, __LINE__); \
     } while (0)
 
-#define CHORD_TEST_ASSERT(cond, msg, ...) \
+#define CHORD_TEST_ASSERT(cond, ...) \
     do { \
         if (!(cond)) { \
-            CHORD_TEST_FAIL(msg, ##__VA_ARGS__); \
+            CHORD_TEST_FAIL(__VA_ARGS__); \
             return; \
         } \
     } while (0)
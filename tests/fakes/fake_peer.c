@@ -69,6 +69,18 @@ static int fake_peer_send_request_impl(net_peer_t *peer, const net_message_t *re
             response->payload.notify_resp.success = 1;
             break;
             
+        case NET_MSG_STABILIZE:
+            response->header.msg_type = NET_MSG_STABILIZE_RESPONSE;
+            response->payload.stabilize_resp.has_node = data->canned_has_node;
+            if (data->canned_has_node) {
+                memcpy(&response->payload.stabilize_resp.node,
+                       &data->canned_node, sizeof(net_node_addr_t));
+            }
+            response->payload.stabilize_resp.count = 1;
+            memcpy(&response->payload.stabilize_resp.successors[0],
+                   &data->canned_node, sizeof(net_node_addr_t));
+            break;
+            
         case NET_MSG_CLOSEST_PRECEDING:
             response->header.msg_type = NET_MSG_CLOSEST_PRECEDING_RESPONSE;
             memcpy(&response->payload.closest_preceding_resp.node,
@@ -94,17 +106,73 @@ static int fake_peer_send_request_impl(net_peer_t *peer, const net_message_t *re
     return NET_ERR_OK;
 }
 
-static int fake_peer_send_request_async_impl(net_peer_t *peer, const net_message_t *request,
-                                             net_peer_callback_t callback, void *context, int timeout_ms) {
-    /* For now, just call synchronous version and invoke callback */
-    net_message_t response;
-    int result = fake_peer_send_request_impl(peer, request, &response, timeout_ms);
+static int fake_peer_send_frame_impl(net_peer_t *peer, const net_buf_t *request,
+                                     net_buf_t *response, int timeout_ms) {
+    fake_peer_data_t *data = (fake_peer_data_t*)peer->impl_data;
+    
+    /* Decode into scratch so history still records full messages */
+    int err = net_protocol_deserialize(&data->frame_request, request->data, request->len);
+    if (err != NET_ERR_OK) {
+        return err;
+    }
+    
+    err = fake_peer_send_request_impl(peer, &data->frame_request, &data->frame_response, timeout_ms);
+    if (err != NET_ERR_OK) {
+        return err;
+    }
     
-    if (callback) {
-        callback(context, &response, result);
+    int len = net_protocol_serialize(&data->frame_response, response->data, sizeof(response->data));
+    if (len < 0) {
+        return NET_ERR_INTERNAL;
     }
+    response->len = (size_t)len;
     
-    return result;
+    return NET_ERR_OK;
+}
+
+/* net_rpc link: answer the request now, deliver later */
+static int fake_peer_link_send(void *link, const net_buf_t *frame) {
+    net_peer_t *peer = (net_peer_t*)link;
+    fake_peer_data_t *data = (fake_peer_data_t*)peer->impl_data;
+    
+    if (data->outbox_count >= FAKE_PEER_MAX_OUTBOX) {
+        return NET_ERR_INTERNAL;
+    }
+    
+    net_buf_t *response = net_buf_alloc();
+    if (!response) {
+        return NET_ERR_INTERNAL;
+    }
+    
+    int err = fake_peer_send_frame_impl(peer, frame, response, 0);
+    if (err == NET_ERR_TIMEOUT) {
+        net_buf_free(response);  /* lost: the caller's timer will fire */
+        return NET_ERR_OK;
+    }
+    if (err != NET_ERR_OK) {
+        net_protocol_create_error(&data->frame_response, data->frame_request.header.request_id,
+                                  (net_error_t)err, "injected error");
+        int len = net_protocol_serialize(&data->frame_response, response->data, sizeof(response->data));
+        if (len < 0) {
+            net_buf_free(response);
+            return NET_ERR_INTERNAL;
+        }
+        response->len = (size_t)len;
+    }
+    
+    data->outbox[data->outbox_count++] = response;
+    return NET_ERR_OK;
+}
+
+static int fake_peer_call_async_impl(net_peer_t *peer, uint32_t request_id, net_msg_type_t type,
+                                     int key, const net_node_addr_t *node,
+                                     net_peer_callback_t callback, void *context, int timeout_ms) {
+    fake_peer_data_t *data = (fake_peer_data_t*)peer->impl_data;
+    
+    if (!data->rpc) {
+        return NET_ERR_INTERNAL;
+    }
+    return net_rpc_call(data->rpc, request_id, type, key, node, callback, context, timeout_ms);
 }
 
 static void fake_peer_close_impl(net_peer_t *peer) {
@@ -113,6 +181,11 @@ static void fake_peer_close_impl(net_peer_t *peer) {
 
 static void fake_peer_destroy_impl(net_peer_t *peer) {
     if (peer->impl_data) {
+        fake_peer_data_t *data = (fake_peer_data_t*)peer->impl_data;
+        net_rpc_destroy(data->rpc);
+        for (int i = 0; i < data->outbox_count; i++) {
+            net_buf_free(data->outbox[i]);
+        }
         free(peer->impl_data);
         peer->impl_data = NULL;
     }
@@ -123,7 +196,8 @@ static void fake_peer_destroy_impl(net_peer_t *peer) {
 static const net_peer_iface_t fake_peer_iface = {
     .connect = fake_peer_connect_impl,
     .send_request = fake_peer_send_request_impl,
-    .send_request_async = fake_peer_send_request_async_impl,
+    .send_frame = fake_peer_send_frame_impl,
+    .call_async = fake_peer_call_async_impl,
     .close = fake_peer_close_impl,
     .destroy = fake_peer_destroy_impl
 };
@@ -213,6 +287,31 @@ const net_message_t* fake_peer_get_response(net_peer_t *peer, int index) {
     return &data->response_history[index];
 }
 
+int fake_peer_attach_loop(net_peer_t *peer, net_loop_t *loop) {
+    fake_peer_data_t *data = (fake_peer_data_t*)peer->impl_data;
+    net_rpc_destroy(data->rpc);
+    data->rpc = net_rpc_create(loop, fake_peer_link_send, peer);
+    return data->rpc ? 0 : -1;
+}
+
+int fake_peer_deliver(net_peer_t *peer, int reverse) {
+    fake_peer_data_t *data = (fake_peer_data_t*)peer->impl_data;
+    int count = data->outbox_count;
+    
+    /* Callbacks may queue more responses; those wait for the next call */
+    net_buf_t *batch[FAKE_PEER_MAX_OUTBOX];
+    memcpy(batch, data->outbox, (size_t)count * sizeof(net_buf_t*));
+    data->outbox_count = 0;
+    
+    for (int i = 0; i < count; i++) {
+        net_buf_t *response = batch[reverse ? count - 1 - i : i];
+        net_rpc_receive(data->rpc, response->data, response->len);
+        net_buf_free(response);
+    }
+    
+    return count;
+}
+
 void fake_peer_reset_history(net_peer_t *peer) {
     fake_peer_data_t *data = (fake_peer_data_t*)peer->impl_data;
     data->request_count = 0;
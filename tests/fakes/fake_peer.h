@@ -14,11 +14,16 @@
  * - Configurable responses
  * - Error injection for testing failure scenarios
  * - Request/response history for verification
+ * - Async calls through a real net_rpc engine; responses are queued
+ *   until fake_peer_deliver() so tests control order and timing
  */
 
 /* Maximum recorded requests */
 #define FAKE_PEER_MAX_HISTORY 100
 
+/* Maximum async responses waiting for fake_peer_deliver() */
+#define FAKE_PEER_MAX_OUTBOX 1024
+
 /* Fake peer implementation data */
 typedef struct {
     /* Configuration */
@@ -38,6 +43,15 @@ typedef struct {
     /* Response history */
     net_message_t response_history[FAKE_PEER_MAX_HISTORY];
     int response_count;
+    
+    /* Scratch for decoding/encoding frames in send_frame */
+    net_message_t frame_request;
+    net_message_t frame_response;
+    
+    /* Async engine and queued response frames */
+    net_rpc_t *rpc;
+    net_buf_t *outbox[FAKE_PEER_MAX_OUTBOX];
+    int outbox_count;
 } fake_peer_data_t;
 
 /*
@@ -64,6 +78,14 @@ const net_message_t* fake_peer_get_request(net_peer_t *peer, int index);
 int fake_peer_get_response_count(net_peer_t *peer);
 const net_message_t* fake_peer_get_response(net_peer_t *peer, int index);
 
+/* Enable async calls, driven by loop (returns 0 on success) */
+int fake_peer_attach_loop(net_peer_t *peer, net_loop_t *loop);
+
+/* Deliver queued async responses, in send order or reversed;
+ * returns the number delivered. Injected timeouts queue nothing and
+ * injected errors queue an ERROR frame. */
+int fake_peer_deliver(net_peer_t *peer, int reverse);
+
 /* Reset history */
 void fake_peer_reset_history(net_peer_t *peer);
 
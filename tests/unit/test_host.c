@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <string.h>
+#include "../chord_test.h"
+#include "../../src/core/ring.h"
+#include "../../src/core/host.h"
+
+/*
+ * Unit tests for host.c - virtual nodes per physical host
+ *
+ * Tests cover:
+ * - host_spawn() gives each virtual node its own key and the host
+ * - host_keys() splits the whole key space between hosts
+ * - Virtual nodes keep documents in their host's one store
+ * - Routing with the host's combined fingers: correct, and steps
+ *   between virtual nodes of one host are not hops
+ */
+
+#define HOSTS 6
+#define VNODES 4
+
+/* HOSTS hosts of VNODES virtual nodes on distinct keys, joined and settled */
+static int make_hosts(Host **hosts, Node **nodes, const char *suffix) {
+    static char names[4][HOSTS * 8][24];
+    static int made = 0;
+    int count = 0;
+
+    for (int n = 0, h = 0; h < HOSTS; n++) {
+        char *name = names[made][n];
+        Host *host;
+        int taken = 0;
+
+        snprintf(name, sizeof(names[0][0]), "%d-%s", n, suffix);
+        host = host_spawn(name, VNODES);
+        for (int v = 0; v < host->num_vnodes; v++) {
+            for (int i = 0; i < count; i++) {
+                taken |= nodes[i]->key == host->vnodes[v]->key;
+            }
+        }
+        if (taken) {
+            continue;
+        }
+        host_join(host, h == 0 ? NULL : nodes[0]);
+        for (int v = 0; v < host->num_vnodes; v++) {
+            nodes[count++] = host->vnodes[v];
+        }
+        hosts[h++] = host;
+    }
+    made++;
+
+    for (int round = 0; round < 2 * count; round++) {
+        /* backwards: a node stabilising alone would take itself as predecessor */
+        for (int i = count - 1; i >= 0; i--) {
+            node_stabilise(nodes[i]);
+            node_fix_fingers(nodes[i]);
+        }
+    }
+    return count;
+}
+
+static void test_host_spawn(void) {
+    CHORD_TEST("host_spawn gives virtual nodes distinct keys");
+
+    Host *host = host_spawn("spawn", 16);
+    int distinct = 1;
+
+    CHORD_TEST_ASSERT_EQ(host->num_vnodes, 16, "Sixteen virtual nodes");
+    for (int i = 0; i < host->num_vnodes; i++) {
+        CHORD_TEST_ASSERT_TRUE(host->vnodes[i]->host == host, "Virtual node knows its host");
+        for (int j = 0; j < i; j++) {
+            distinct &= host->vnodes[i]->key != host->vnodes[j]->key;
+        }
+    }
+    CHORD_TEST_ASSERT_TRUE(distinct, "No two on one key");
+    CHORD_TEST_ASSERT_TRUE(host_key_taken(host, host->vnodes[3]->key), "Own key taken");
+}
+
+static void test_host_keys(void) {
+    CHORD_TEST("host_keys splits the key space between hosts");
+
+    Host *hosts[HOSTS];
+    Node *nodes[HOSTS * VNODES];
+    int total = 0;
+
+    make_hosts(hosts, nodes, "keys");
+    for (int h = 0; h < HOSTS; h++) {
+        CHORD_TEST_ASSERT_TRUE(host_keys(hosts[h]) > 0, "Every host holds keys");
+        total += host_keys(hosts[h]);
+    }
+    CHORD_TEST_ASSERT_EQ(total, ring_key_max(), "Hosts hold the whole key space");
+}
+
+static void test_host_storage(void) {
+    CHORD_TEST("virtual nodes share their host's store");
+
+    Host *hosts[HOSTS];
+    Node *nodes[HOSTS * VNODES];
+    static Document doc = { .filename = "shared.txt", .data = "data" };
+    Node *owner;
+    Node *sibling;
+
+    make_hosts(hosts, nodes, "store");
+    doc.key = chord_hash(doc.filename);
+    node_document_add(nodes[0], &doc);
+    owner = node_find_successor(nodes[0], doc.key);
+    sibling = owner->host->vnodes[owner == owner->host->vnodes[0]];
+
+    CHORD_TEST_ASSERT_EQ(owner->num_documents, 1, "Owner counts its document");
+    CHORD_TEST_ASSERT_EQ(owner->host->num_documents, 1, "Host store holds it");
+    CHORD_TEST_ASSERT_TRUE(node_document_exists(sibling, doc.filename) == &doc,
+                           "Sibling virtual node sees it");
+}
+
+static void test_host_routing(void) {
+    CHORD_TEST("combined fingers route correctly, local steps free");
+
+    Host *hosts[HOSTS];
+    Node *nodes[HOSTS * VNODES];
+    int count = make_hosts(hosts, nodes, "route");
+    int correct = 0;
+    int hops = 0;
+    int plain = 0;
+
+    for (int key = 0; key < ring_key_max(); key++) {
+        Node *origin = nodes[key % count];
+        Node *expected = node_find_successor(origin, key);
+
+        correct += node_lookup(origin, key, &hops) == expected;
+    }
+    CHORD_TEST_ASSERT_EQ(correct, ring_key_max(), "Every lookup correct");
+
+    /* the same ring as if every virtual node were a host of its own */
+    for (int i = 0; i < count; i++) {
+        nodes[i]->host = NULL;
+    }
+    for (int key = 0; key < ring_key_max(); key++) {
+        node_lookup(nodes[key % count], key, &plain);
+    }
+    CHORD_TEST_ASSERT_TRUE(hops < plain, "Fewer hops than separate nodes");
+    for (int h = 0; h < HOSTS; h++) {
+        for (int v = 0; v < hosts[h]->num_vnodes; v++) {
+            hosts[h]->vnodes[v]->host = hosts[h];
+        }
+    }
+}
+
+int main(void) {
+    CHORD_TEST_INIT();
+
+    CHORD_RUN_TEST(test_host_spawn);
+    CHORD_RUN_TEST(test_host_keys);
+    CHORD_RUN_TEST(test_host_storage);
+    CHORD_RUN_TEST(test_host_routing);
+
+    CHORD_TEST_FINI();
+}
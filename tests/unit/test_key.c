@@ -12,6 +12,7 @@
  * - key_in_range() with open intervals (a, b)
  * - Wrap-around behavior for circular keyspace
  * - Edge cases at boundaries
+ * - key_distance() clockwise, with wrap-around
  */
 
 static void test_key_in_range_half_open_normal(void) {
@@ -132,6 +133,16 @@ static void test_key_in_range_full_circle(void) {
                            "254 in (255, 254]");
 }
 
+static void test_key_distance(void) {
+    CHORD_TEST("key_distance measures clockwise");
+    
+    CHORD_TEST_ASSERT_EQ(key_distance(10, 10), 0, "Same key is 0 apart");
+    CHORD_TEST_ASSERT_EQ(key_distance(10, 20), 10, "10 to 20 is 10");
+    CHORD_TEST_ASSERT_EQ(key_distance(20, 10), 246, "20 to 10 goes round");
+    CHORD_TEST_ASSERT_EQ(key_distance(250, 4), 10, "Wraps past 0");
+    CHORD_TEST_ASSERT_EQ(key_distance(0, 256), 0, "Key 256 is key 0");
+}
+
 int main(void) {
     CHORD_TEST_INIT();
     
@@ -142,6 +153,7 @@ int main(void) {
     CHORD_RUN_TEST(test_key_in_range_open_wraparound);
     CHORD_RUN_TEST(test_key_in_range_edge_cases);
     CHORD_RUN_TEST(test_key_in_range_full_circle);
+    CHORD_RUN_TEST(test_key_distance);
     
     CHORD_TEST_FINI();
 }
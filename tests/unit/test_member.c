@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "../chord_test.h"
+#include "../../src/core/member.h"
+#include "../../src/core/chord_types.h"
+
+/*
+ * Unit tests for member.c - one-hop membership tables
+ * 
+ * Tests cover:
+ * - membership_add() keeps the table sorted and replaces on a key
+ * - membership_successor() with wrap-around
+ * - membership_remove() only takes out the node given
+ * - membership_learn() and membership_exchange() pass each change on
+ *   once per direction, and only onward
+ * - A full change list drops what has been passed on both ways first
+ */
+
+static Node members_nodes[MEMBER_DELTAS + 8];
+
+static Node* member_node(int i, int key) {
+    members_nodes[i].key = key;
+    return &members_nodes[i];
+}
+
+static void test_membership_sorted(void) {
+    CHORD_TEST("membership_add keeps keys sorted");
+    
+    static const int keys[] = { 200, 10, 90, 45, 250, 0, 130 };
+    Membership *members = membership_init();
+    int sorted = TRUE;
+    
+    for (int i = 0; i < 7; i++) {
+        CHORD_TEST_ASSERT_TRUE(membership_add(members, member_node(i, keys[i])), "New member added");
+    }
+    CHORD_TEST_ASSERT_FALSE(membership_add(members, &members_nodes[2]), "Same member again is no change");
+    CHORD_TEST_ASSERT_EQ(members->count, 7, "Seven members");
+    for (int i = 1; i < members->count; i++) {
+        sorted &= members->keys[i - 1] < members->keys[i];
+    }
+    CHORD_TEST_ASSERT_TRUE(sorted, "Keys ascending");
+    
+    CHORD_TEST_ASSERT_TRUE(membership_add(members, member_node(7, 90)), "Node on a taken key replaces it");
+    CHORD_TEST_ASSERT_EQ(members->count, 7, "Still seven members");
+    CHORD_TEST_ASSERT_TRUE(membership_successor(members, 90) == &members_nodes[7], "Replacement found");
+    membership_free(members);
+}
+
+static void test_membership_successor(void) {
+    CHORD_TEST("membership_successor finds the first member at or after key");
+    
+    Membership *members = membership_init();
+    
+    CHORD_TEST_ASSERT_NULL(membership_successor(members, 5), "Empty table has none");
+    membership_add(members, member_node(0, 20));
+    membership_add(members, member_node(1, 100));
+    membership_add(members, member_node(2, 180));
+    
+    CHORD_TEST_ASSERT_TRUE(membership_successor(members, 20) == &members_nodes[0], "Key of a member");
+    CHORD_TEST_ASSERT_TRUE(membership_successor(members, 21) == &members_nodes[1], "Key after a member");
+    CHORD_TEST_ASSERT_TRUE(membership_successor(members, 181) == &members_nodes[0], "Wraps past the last");
+    CHORD_TEST_ASSERT_TRUE(membership_successor(members, 0) == &members_nodes[0], "Key 0");
+    
+    member_node(3, 100);
+    CHORD_TEST_ASSERT_FALSE(membership_remove(members, &members_nodes[3]), "Other node on a key stays");
+    CHORD_TEST_ASSERT_TRUE(membership_remove(members, &members_nodes[1]), "Member removed");
+    CHORD_TEST_ASSERT_TRUE(membership_successor(members, 21) == &members_nodes[2], "Range passes to the next");
+    membership_free(members);
+}
+
+static void test_membership_exchange(void) {
+    CHORD_TEST("membership_exchange passes each change on once, onward");
+    
+    Membership *a = membership_init();
+    Membership *b = membership_init();
+    Membership *c = membership_init();
+    
+    /* a precedes b precedes c */
+    CHORD_TEST_ASSERT_TRUE(membership_learn(b, member_node(0, 60), TRUE), "b hears of a join");
+    CHORD_TEST_ASSERT_EQ(b->num_deltas, 1, "Kept to pass on");
+    
+    CHORD_TEST_ASSERT_EQ(membership_exchange(c, b, TRUE), 1, "Passed forward to c");
+    CHORD_TEST_ASSERT_EQ(membership_exchange(c, b, TRUE), 0, "Not passed forward again");
+    CHORD_TEST_ASSERT_EQ(c->count, 1, "c learnt the join");
+    CHORD_TEST_ASSERT_EQ(membership_exchange(b, c, FALSE), 0, "c does not send it back");
+    
+    CHORD_TEST_ASSERT_EQ(membership_exchange(a, b, FALSE), 1, "Passed back to a");
+    CHORD_TEST_ASSERT_EQ(a->count, 1, "a learnt the join");
+    CHORD_TEST_ASSERT_EQ(membership_exchange(b, a, TRUE), 0, "a does not send it forward");
+    
+    CHORD_TEST_ASSERT_TRUE(membership_learn(a, &members_nodes[0], FALSE), "a sees it leave");
+    CHORD_TEST_ASSERT_EQ(membership_exchange(b, a, TRUE), 1, "Leave passed forward");
+    CHORD_TEST_ASSERT_EQ(b->count, 0, "b dropped the member");
+    CHORD_TEST_ASSERT_EQ(membership_exchange(c, b, TRUE), 1, "And on to c");
+    CHORD_TEST_ASSERT_EQ(c->count, 0, "c dropped the member");
+    CHORD_TEST_ASSERT_EQ(membership_exchange(a, b, FALSE), 0, "Nothing back to where it came from");
+    membership_free(a);
+    membership_free(b);
+    membership_free(c);
+}
+
+static void test_membership_deltas_bounded(void) {
+    CHORD_TEST("A full change list drops changes passed both ways first");
+    
+    Membership *members = membership_init();
+    Membership *next = membership_init();
+    Membership *prev = membership_init();
+    
+    for (int i = 0; i < MEMBER_DELTAS; i++) {
+        membership_learn(members, member_node(i, i * 4), TRUE);
+    }
+    CHORD_TEST_ASSERT_EQ(members->num_deltas, MEMBER_DELTAS, "List full");
+    
+    membership_exchange(next, members, TRUE);
+    membership_exchange(prev, members, FALSE);
+    membership_learn(members, member_node(MEMBER_DELTAS, 250), TRUE);
+    CHORD_TEST_ASSERT_EQ(members->num_deltas, 1, "Changes passed both ways dropped");
+    
+    for (int i = 1; i < MEMBER_DELTAS + 4; i++) {
+        membership_learn(members, &members_nodes[MEMBER_DELTAS], i % 2 == 0);
+    }
+    CHORD_TEST_ASSERT_EQ(members->num_deltas, MEMBER_DELTAS, "Never more than MEMBER_DELTAS");
+    membership_free(members);
+    membership_free(next);
+    membership_free(prev);
+}
+
+int main(void) {
+    CHORD_TEST_INIT();
+    
+    CHORD_RUN_TEST(test_membership_sorted);
+    CHORD_RUN_TEST(test_membership_successor);
+    CHORD_RUN_TEST(test_membership_exchange);
+    CHORD_RUN_TEST(test_membership_deltas_bounded);
+    
+    CHORD_TEST_FINI();
+}
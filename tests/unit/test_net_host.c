@@ -0,0 +1,356 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include "../chord_test.h"
+#include "../fakes/fake_peer.h"
+#include "../../src/net/net_host.h"
+#include "../../src/net/net_transport.h"
+
+/*
+ * Unit tests for net_host.c - many logical nodes in one process
+ *
+ * Tests cover:
+ * - Hosting thousands of nodes, each with its own URL, and their memory
+ * - Local calls served in memory: sync helpers, async completion on the
+ *   next loop turn, calls started from callbacks, STABILIZE
+ * - Other URLs going through the pool's net_peer
+ * - ADDRESSED requests from another process over the listener
+ * - Virtual nodes of one physical host behind the host's URL
+ */
+
+#define TEST_TIMEOUT_MS 2000
+#define MANY_NODES 2000
+#define RING_NODES 16
+
+/* Spawn count nodes named "<i>-<suffix>" and form them into a ring */
+static void spawn_ring(net_host_t *host, Node **nodes, int count, const char *suffix) {
+    char id[32];
+
+    for (int i = 0; i < count; i++) {
+        snprintf(id, sizeof(id), "%d-%s", i, suffix);
+        nodes[i] = net_host_spawn(host, id);
+        if (i == 0) {
+            node_create(nodes[0]);
+        } else {
+            node_join(nodes[0], nodes[i]);
+            node_stabilise(nodes[i]);
+            node_fix_fingers(nodes[i]);
+        }
+    }
+    for (int round = 0; round < 2 * count; round++) {
+        for (int i = 0; i < count; i++) {
+            node_stabilise(nodes[i]);
+            node_fix_fingers(nodes[i]);
+        }
+    }
+}
+
+static void test_host_many_nodes(void) {
+    CHORD_TEST("thousands of hosted nodes, each with its own URL");
+
+    net_loop_t *loop = net_loop_create();
+    net_host_t *host = net_host_create(loop, "tcp://10.0.0.7:5000", NULL);
+    net_host_stats_t stats;
+    char id[32];
+    int found = 0;
+
+    CHORD_TEST_ASSERT_NOT_NULL(host, "Host created");
+    for (int i = 0; i < MANY_NODES; i++) {
+        snprintf(id, sizeof(id), "%d-many", i);
+        if (!net_host_spawn(host, id)) {
+            break;
+        }
+    }
+    for (int i = 0; i < MANY_NODES; i++) {
+        char url[64];
+        Node *node;
+
+        snprintf(url, sizeof(url), "tcp://10.0.0.7:5000/%d-many", i);
+        node = net_host_find(host, url);
+        if (node && strcmp(net_host_node_url(host, node), url) == 0) {
+            found++;
+        }
+    }
+    CHORD_TEST_ASSERT_EQ(found, MANY_NODES, "Every node found by its URL");
+    CHORD_TEST_ASSERT_TRUE(net_host_find(host, "tcp://10.0.0.7:5000/nobody") == NULL, "Unknown id");
+    CHORD_TEST_ASSERT_TRUE(net_host_find(host, "tcp://10.0.0.8:5000/0-many") == NULL, "Other host");
+
+    errno = 0;
+    CHORD_TEST_ASSERT_TRUE(net_host_spawn(host, "7-many") == NULL && errno == EEXIST, "Duplicate id");
+    errno = 0;
+    CHORD_TEST_ASSERT_TRUE(net_host_spawn(host, "a/b") == NULL && errno == EINVAL, "Id with '/'");
+
+    net_host_get_stats(host, &stats);
+    CHORD_TEST_ASSERT_EQ(stats.nodes, MANY_NODES, "Node count");
+    CHORD_TEST_ASSERT_TRUE(stats.node_bytes / stats.nodes > sizeof(Node) &&
+                           stats.node_bytes / stats.nodes < 1024, "Under 1 KiB per node");
+    CHORD_TEST_ASSERT_TRUE(stats.table_bytes <= MANY_NODES * 2 * sizeof(void*), "Index sized to nodes");
+
+    net_host_destroy(host);
+    net_loop_destroy(loop);
+}
+
+typedef struct {
+    int calls;
+    int error;
+    net_node_addr_t node;
+    net_peer_t *chain;              /* Peer to call again from the callback */
+    int chain_left;
+} async_probe_t;
+
+static void on_node(void *context, int error, const net_node_addr_t *node) {
+    async_probe_t *probe = (async_probe_t*)context;
+
+    probe->calls++;
+    probe->error = error;
+    if (node) {
+        probe->node = *node;
+    }
+    if (probe->chain && probe->chain_left-- > 0) {
+        net_peer_get_successor_async(probe->chain, on_node, probe, TEST_TIMEOUT_MS);
+    }
+}
+
+static void on_stabilize(void *context, int error, const net_stabilize_resp_t *result) {
+    net_stabilize_resp_t *out = (net_stabilize_resp_t*)context;
+
+    if (error == NET_ERR_OK) {
+        *out = *result;
+    }
+}
+
+static void test_host_local_calls(void) {
+    CHORD_TEST("calls between hosted nodes stay in memory");
+
+    net_loop_t *loop = net_loop_create();
+    net_host_t *host = net_host_create(loop, "tcp://10.0.0.7:5001", NULL);
+    Node *nodes[RING_NODES];
+    net_node_addr_t result;
+    net_node_addr_t stranger;
+    net_stabilize_resp_t stabilized;
+    net_host_stats_t stats;
+    async_probe_t probe;
+    net_peer_t *peer;
+    int matches = 0;
+    int alive = 0;
+    int state = -1;
+
+    spawn_ring(host, nodes, RING_NODES, "local");
+    peer = net_host_acquire(host, net_host_node_url(host, nodes[3]));
+    CHORD_TEST_ASSERT_NOT_NULL(peer, "Local peer");
+    CHORD_TEST_ASSERT_TRUE(net_host_acquire(host, net_host_node_url(host, nodes[3])) == peer,
+                           "Same peer each time");
+
+    for (int key = 0; key < ring_key_max(); key += 7) {
+        Node *owner = node_find_successor(nodes[3], key);
+
+        if (net_peer_find_successor(peer, key, &result, TEST_TIMEOUT_MS) == NET_ERR_OK &&
+            result.key == owner->key && strcmp(result.url, net_host_node_url(host, owner)) == 0) {
+            matches++;
+        }
+    }
+    CHORD_TEST_ASSERT_EQ(matches, (ring_key_max() + 6) / 7, "Sync lookups answer with hosted URLs");
+    CHORD_TEST_ASSERT_EQ(net_peer_ping(peer, &alive, &state, TEST_TIMEOUT_MS), NET_ERR_OK, "Ping");
+    CHORD_TEST_ASSERT_EQ(alive, 1, "Alive");
+
+    net_protocol_copy_node_addr(&result, nodes[2]->id, nodes[2]->key, net_host_node_url(host, nodes[2]));
+    CHORD_TEST_ASSERT_EQ(net_peer_notify(peer, &result, TEST_TIMEOUT_MS), NET_ERR_OK, "Notify by hosted URL");
+    net_protocol_copy_node_addr(&stranger, "x", 1, "tcp://10.0.0.7:5001/x");
+    CHORD_TEST_ASSERT_EQ(net_peer_notify(peer, &stranger, TEST_TIMEOUT_MS), NET_ERR_NODE_NOT_FOUND,
+                         "Notify by unknown URL");
+
+    memset(&stabilized, 0, sizeof(stabilized));
+    CHORD_TEST_ASSERT_EQ(net_peer_stabilize(peer, &result, &stabilized, TEST_TIMEOUT_MS), NET_ERR_OK,
+                         "Stabilize");
+    CHORD_TEST_ASSERT_TRUE(stabilized.has_node && stabilized.node.key == nodes[3]->predecessor->key,
+                           "Stabilize answers the predecessor");
+    CHORD_TEST_ASSERT_EQ((int)stabilized.count, SUCCESSOR_LIST_SIZE, "Whole successor list");
+    CHORD_TEST_ASSERT_STR_EQ(stabilized.successors[0].url, net_host_node_url(host, nodes[3]->successor),
+                             "List starts at the successor");
+    memset(&stabilized, 0, sizeof(stabilized));
+    net_peer_stabilize_async(peer, &result, on_stabilize, &stabilized, TEST_TIMEOUT_MS);
+    net_loop_run_once(loop, 0);
+    CHORD_TEST_ASSERT_EQ((int)stabilized.count, SUCCESSOR_LIST_SIZE, "Async stabilize");
+
+    memset(&probe, 0, sizeof(probe));
+    CHORD_TEST_ASSERT_EQ(net_peer_find_successor_async(peer, 200, on_node, &probe, TEST_TIMEOUT_MS),
+                         NET_ERR_OK, "Async call queued");
+    CHORD_TEST_ASSERT_EQ(probe.calls, 0, "Not completed inline");
+    net_loop_run_once(loop, 0);
+    CHORD_TEST_ASSERT_EQ(probe.calls, 1, "Completed on the next loop turn");
+    CHORD_TEST_ASSERT_EQ(probe.error, NET_ERR_OK, "No error");
+    CHORD_TEST_ASSERT_EQ(probe.node.key, node_find_successor(nodes[3], 200)->key, "Async answer");
+
+    memset(&probe, 0, sizeof(probe));
+    probe.chain = peer;
+    probe.chain_left = 5;
+    net_peer_get_successor_async(peer, on_node, &probe, TEST_TIMEOUT_MS);
+    net_loop_run_once(loop, 0);
+    CHORD_TEST_ASSERT_EQ(probe.calls, 6, "Calls from callbacks complete in the same turn");
+    CHORD_TEST_ASSERT_EQ(probe.node.key, nodes[3]->successor->key, "Successor answered");
+
+    net_host_release(host, peer);
+    net_host_release(host, peer);
+    net_host_get_stats(host, &stats);
+    CHORD_TEST_ASSERT_EQ((int)stats.local_calls, (ring_key_max() + 6) / 7 + 5 + 1 + 6, "Local calls counted");
+    CHORD_TEST_ASSERT_EQ(stats.remote_acquires, 0, "Nothing remote");
+
+    net_host_destroy(host);
+    net_loop_destroy(loop);
+}
+
+static net_peer_t* fake_factory(void *context, const char *url) {
+    (void)context;
+    (void)url;
+    return fake_peer_create();
+}
+
+static void test_host_remote_calls(void) {
+    CHORD_TEST("other URLs go through the pool's net_peer");
+
+    net_loop_t *loop = net_loop_create();
+    net_pool_config_t config;
+    net_pool_t *pool;
+    net_host_t *host;
+    net_host_t *bare;
+    net_host_stats_t stats;
+    net_peer_t *peer;
+    int alive = 0;
+    int state = 0;
+
+    net_pool_config_default(&config);
+    pool = net_pool_create(&config, fake_factory, NULL);
+    host = net_host_create(loop, "tcp://10.0.0.7:5002", pool);
+    net_host_spawn(host, "0-remote");
+
+    peer = net_host_acquire(host, "tcp://10.0.0.9:5002/0-remote");
+    CHORD_TEST_ASSERT_NOT_NULL(peer, "Remote peer");
+    CHORD_TEST_ASSERT_TRUE(peer->iface == fake_peer_get_interface(), "Pooled net_peer");
+    fake_peer_set_canned_alive(peer, 1, NODE_STATE_RUNNING);
+    CHORD_TEST_ASSERT_EQ(net_peer_ping(peer, &alive, &state, TEST_TIMEOUT_MS), NET_ERR_OK, "Remote ping");
+    CHORD_TEST_ASSERT_EQ(fake_peer_get_request_count(peer), 1, "Request left the host");
+    net_host_release(host, peer);
+
+    net_host_get_stats(host, &stats);
+    CHORD_TEST_ASSERT_EQ(stats.remote_acquires, 1, "One remote acquire");
+    CHORD_TEST_ASSERT_EQ(stats.local_calls, 0, "No local call");
+
+    bare = net_host_create(loop, "tcp://10.0.0.7:5003", NULL);
+    CHORD_TEST_ASSERT_TRUE(net_host_acquire(bare, "tcp://10.0.0.9:5002/0-remote") == NULL,
+                           "No pool, no remote peer");
+
+    net_host_destroy(bare);
+    net_host_destroy(host);
+    net_pool_destroy(pool);
+    net_loop_destroy(loop);
+}
+
+/* Send frame to the host and run its loop until the reply arrives */
+static int exchange(net_loop_t *loop, net_transport_t *client, const uint8_t *frame, int len,
+                    uint8_t *reply, net_frame_view_t *view) {
+    if (len <= 0 || net_transport_send(client, frame, (size_t)len, TEST_TIMEOUT_MS) != 0) {
+        return -1;
+    }
+    for (int turn = 0; turn < 100; turn++) {
+        int n;
+
+        net_loop_run_once(loop, 10);
+        n = net_transport_recv(client, reply, NET_PROTOCOL_MAX_FRAME, 0);
+        if (n > 0) {
+            return net_protocol_decode_view(view, reply, (size_t)n);
+        }
+    }
+    return -1;
+}
+
+static void test_host_addressed(void) {
+    CHORD_TEST("ADDRESSED requests from another process");
+
+    net_loop_t *loop = net_loop_create();
+    net_host_t *host = net_host_create(loop, "tcp://127.0.0.1:0", NULL);
+    net_transport_t *client = net_transport_create(NET_TRANSPORT_TCP);
+    Node *nodes[4];
+    uint8_t inner[NET_PROTOCOL_MAX_FRAME];
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+    uint8_t reply[NET_PROTOCOL_MAX_FRAME];
+    net_frame_view_t view;
+    net_host_stats_t stats;
+    int inner_len;
+    int len;
+
+    CHORD_TEST_ASSERT_EQ(net_host_listen(host), 0, "Listening");
+    CHORD_TEST_ASSERT_TRUE(strstr(net_host_url(host), ":0") == NULL, "Bound port in base URL");
+    spawn_ring(host, nodes, 4, "wire");
+    errno = 0;
+    CHORD_TEST_ASSERT_TRUE(net_transport_connect(client, net_host_url(host), TEST_TIMEOUT_MS) == 0,
+                           "Client connected");
+
+    inner_len = net_protocol_encode_request(inner, sizeof(inner), NET_MSG_FIND_SUCCESSOR, 41, 123, NULL);
+    len = net_protocol_encode_addressed(frame, sizeof(frame), 41, nodes[1]->id, inner, (size_t)inner_len);
+    CHORD_TEST_ASSERT_EQ(exchange(loop, client, frame, len, reply, &view), NET_ERR_OK, "Reply decodes");
+    CHORD_TEST_ASSERT_EQ(view.header.msg_type, NET_MSG_FIND_SUCCESSOR_RESPONSE, "Inner request answered");
+    CHORD_TEST_ASSERT_EQ(view.header.request_id, 41, "Inner request ID");
+    CHORD_TEST_ASSERT_EQ(view.node.key, node_find_successor(nodes[1], 123)->key, "Successor key");
+    CHORD_TEST_ASSERT_TRUE(view.node.url_len > strlen(net_host_url(host)) &&
+                           memcmp(view.node.url, net_host_url(host), strlen(net_host_url(host))) == 0,
+                           "Answered with a hosted URL");
+
+    len = net_protocol_encode_addressed(frame, sizeof(frame), 42, "nobody", inner, (size_t)inner_len);
+    CHORD_TEST_ASSERT_EQ(exchange(loop, client, frame, len, reply, &view), NET_ERR_OK, "Error decodes");
+    CHORD_TEST_ASSERT_EQ(view.header.msg_type, NET_MSG_ERROR, "Unknown node refused");
+    CHORD_TEST_ASSERT_EQ(view.error_code, NET_ERR_NODE_NOT_FOUND, "Not found");
+
+    CHORD_TEST_ASSERT_EQ(exchange(loop, client, inner, inner_len, reply, &view), NET_ERR_OK,
+                         "Bare request answered");
+    CHORD_TEST_ASSERT_EQ(view.header.msg_type, NET_MSG_ERROR, "Bare request refused");
+
+    net_host_get_stats(host, &stats);
+    CHORD_TEST_ASSERT_EQ(stats.served, 2, "Addressed requests served");
+
+    net_transport_destroy(client);
+    net_host_destroy(host);
+    net_loop_destroy(loop);
+}
+
+static void test_host_virtual(void) {
+    CHORD_TEST("virtual nodes of a physical host are hosted nodes");
+
+    net_loop_t *loop = net_loop_create();
+    net_host_t *host = net_host_create(loop, "tcp://10.0.0.7:5004", NULL);
+    Host *vhost = net_host_spawn_virtual(host, "phys", 8);
+    net_host_stats_t stats;
+    int urls = 0;
+
+    CHORD_TEST_ASSERT_NOT_NULL(vhost, "Physical host spawned");
+    CHORD_TEST_ASSERT_EQ(vhost->num_vnodes, 8, "Eight virtual nodes");
+    for (int i = 0; i < vhost->num_vnodes; i++) {
+        const char *url = net_host_node_url(host, vhost->vnodes[i]);
+
+        urls += url != NULL && strncmp(url, "tcp://10.0.0.7:5004/", 20) == 0
+            && strstr(url, ".phys") != NULL && net_host_find(host, url) == vhost->vnodes[i];
+    }
+    CHORD_TEST_ASSERT_EQ(urls, 8, "Each behind the host's URL");
+    net_host_get_stats(host, &stats);
+    CHORD_TEST_ASSERT_EQ((int)stats.nodes, 8, "Hosted as nodes");
+
+    CHORD_TEST_ASSERT_NULL(net_host_spawn_virtual(host, "phys", 2), "Same ids refused");
+    CHORD_TEST_ASSERT_EQ(errno, EEXIST, "EEXIST");
+    CHORD_TEST_ASSERT_NULL(net_host_spawn_virtual(host, "phys", 0), "No virtual nodes refused");
+
+    net_host_destroy(host);
+    net_loop_destroy(loop);
+}
+
+int main(void) {
+    CHORD_TEST_INIT();
+
+    CHORD_RUN_TEST(test_host_many_nodes);
+    CHORD_RUN_TEST(test_host_local_calls);
+    CHORD_RUN_TEST(test_host_remote_calls);
+    CHORD_RUN_TEST(test_host_addressed);
+    CHORD_RUN_TEST(test_host_virtual);
+
+    CHORD_TEST_FINI();
+}
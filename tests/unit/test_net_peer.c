@@ -1,5 +1,7 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "../chord_test.h"
 #include "../fakes/fake_peer.h"
 
@@ -12,6 +14,9 @@
  * - Request/response recording
  * - Error injection
  * - High-level RPC helpers
+ * - Pooled frame buffers (reuse, no heap allocation after warm-up)
+ * - Async RPC helpers (many in flight, out-of-order delivery, timeouts)
+ * - Monotonic request IDs, unique across threads
  */
 
 static void test_fake_peer_creation(void) {
@@ -189,6 +194,266 @@ static void test_fake_peer_timeout_injection(void) {
     net_peer_destroy(peer);
 }
 
+static void test_net_buf_pool_reuse(void) {
+    CHORD_TEST("net_buf pool reuses freed buffers");
+    
+    net_buf_t *first = net_buf_alloc();
+    CHORD_TEST_ASSERT_TRUE(first != NULL, "Buffer allocated");
+    first->len = 10;
+    net_buf_free(first);
+    
+    size_t allocs = net_buf_pool_heap_allocs();
+    net_buf_t *second = net_buf_alloc();
+    CHORD_TEST_ASSERT_TRUE(second == first, "Freed buffer reused");
+    CHORD_TEST_ASSERT_EQ(second->len, 0, "Length reset");
+    CHORD_TEST_ASSERT_EQ(net_buf_pool_heap_allocs(), allocs, "No heap allocation");
+    net_buf_free(second);
+
+    net_buf_pool_release();
+    net_buf_free(net_buf_alloc());
+    CHORD_TEST_ASSERT_EQ(net_buf_pool_heap_allocs(), allocs + 1, "Released pool starts again from the heap");
+}
+
+static void test_rpc_helpers_no_heap_after_warmup(void) {
+    CHORD_TEST("RPC helpers allocate nothing after warm-up");
+    
+    net_peer_t *peer = fake_peer_create();
+    net_peer_connect(peer, "tcp://localhost:5555");
+    fake_peer_set_canned_node(peer, "succ", 77, "tcp://succ:5555");
+    
+    net_node_addr_t result;
+    int alive, state;
+    CHORD_TEST_ASSERT_EQ(net_peer_find_successor(peer, 5, &result, 5000), NET_ERR_OK, "Warm-up call");
+    
+    size_t allocs = net_buf_pool_heap_allocs();
+    for (int i = 0; i < 1000; i++) {
+        int err = net_peer_find_successor(peer, i % 256, &result, 5000);
+        err |= net_peer_notify(peer, &result, 5000);
+        err |= net_peer_ping(peer, &alive, &state, 5000);
+        CHORD_TEST_ASSERT_EQ(err, NET_ERR_OK, "RPC round-trip");
+    }
+    CHORD_TEST_ASSERT_EQ(net_buf_pool_heap_allocs(), allocs, "Pool did not grow");
+    CHORD_TEST_ASSERT_EQ(result.key, 77, "Result copied from view");
+    CHORD_TEST_ASSERT_STR_EQ(result.url, "tcp://succ:5555", "URL copied from view");
+    
+    net_peer_destroy(peer);
+}
+
+typedef struct {
+    int done;
+    int error;
+    int has_node;
+    int key;
+    int alive;
+} async_result_t;
+
+static void on_node(void *context, int error, const net_node_addr_t *node) {
+    async_result_t *r = (async_result_t*)context;
+    r->done++;
+    r->error = error;
+    r->has_node = node != NULL;
+    r->key = node ? node->key : -1;
+}
+
+static void on_status(void *context, int error) {
+    async_result_t *r = (async_result_t*)context;
+    r->done++;
+    r->error = error;
+}
+
+static void on_ping(void *context, int error, int alive, int state) {
+    async_result_t *r = (async_result_t*)context;
+    (void)state;
+    r->done++;
+    r->error = error;
+    r->alive = alive;
+}
+
+static void test_async_helpers(void) {
+    CHORD_TEST("async helpers complete out of order");
+    
+    net_loop_t *loop = net_loop_create();
+    net_peer_t *peer = fake_peer_create();
+    net_node_addr_t self;
+    async_result_t r[6];
+    
+    memset(r, 0, sizeof(r));
+    net_protocol_copy_node_addr(&self, "self", 3, "tcp://self:5555");
+    fake_peer_set_canned_node(peer, "succ", 77, "tcp://succ:5555");
+    fake_peer_set_canned_has_node(peer, 0);
+    CHORD_TEST_ASSERT_EQ(fake_peer_attach_loop(peer, loop), 0, "Loop attached");
+    
+    CHORD_TEST_ASSERT_EQ(net_peer_find_successor_async(peer, 5, on_node, &r[0], 5000), NET_ERR_OK, "find_successor");
+    CHORD_TEST_ASSERT_EQ(net_peer_get_predecessor_async(peer, on_node, &r[1], 5000), NET_ERR_OK, "get_predecessor");
+    CHORD_TEST_ASSERT_EQ(net_peer_get_successor_async(peer, on_node, &r[2], 5000), NET_ERR_OK, "get_successor");
+    CHORD_TEST_ASSERT_EQ(net_peer_notify_async(peer, &self, on_status, &r[3], 5000), NET_ERR_OK, "notify");
+    CHORD_TEST_ASSERT_EQ(net_peer_closest_preceding_async(peer, 9, on_node, &r[4], 5000), NET_ERR_OK, "closest_preceding");
+    CHORD_TEST_ASSERT_EQ(net_peer_ping_async(peer, on_ping, &r[5], 5000), NET_ERR_OK, "ping");
+    CHORD_TEST_ASSERT_EQ(r[0].done, 0, "Nothing completed before delivery");
+    
+    CHORD_TEST_ASSERT_EQ(fake_peer_deliver(peer, 1), 6, "Six responses delivered");
+    for (int i = 0; i < 6; i++) {
+        CHORD_TEST_ASSERT_EQ(r[i].done, 1, "Completed exactly once");
+        CHORD_TEST_ASSERT_EQ(r[i].error, NET_ERR_OK, "No error");
+    }
+    CHORD_TEST_ASSERT_EQ(r[0].key, 77, "find_successor result");
+    CHORD_TEST_ASSERT_EQ(r[1].has_node, 0, "No predecessor");
+    CHORD_TEST_ASSERT_EQ(r[2].key, 77, "get_successor result");
+    CHORD_TEST_ASSERT_EQ(r[4].key, 77, "closest_preceding result");
+    CHORD_TEST_ASSERT_EQ(r[5].alive, 1, "ping result");
+    
+    const net_message_t *req = fake_peer_get_request(peer, 3);
+    CHORD_TEST_ASSERT_STR_EQ(req->payload.notify_req.node.url, "tcp://self:5555", "notify carried node");
+    
+    net_peer_destroy(peer);
+    net_loop_destroy(loop);
+}
+
+typedef struct {
+    int done;
+    int error;
+    int msg_type;
+    uint32_t count;
+    int succ_key;
+} raw_result_t;
+
+static void on_raw(void *context, const net_frame_view_t *response, int error) {
+    raw_result_t *r = (raw_result_t*)context;
+    r->done++;
+    r->error = error;
+    if (response) {
+        r->msg_type = response->header.msg_type;
+        r->count = response->count;
+        r->succ_key = response->count > 0 ? response->successors[0].key : -1;
+    }
+}
+
+static void test_async_stabilize_request(void) {
+    CHORD_TEST("send_request_async carries the node for STABILIZE");
+    
+    net_loop_t *loop = net_loop_create();
+    net_peer_t *peer = fake_peer_create();
+    net_message_t msg;
+    raw_result_t r;
+    
+    memset(&r, 0, sizeof(r));
+    fake_peer_set_canned_node(peer, "succ", 77, "tcp://succ:5555");
+    fake_peer_attach_loop(peer, loop);
+    
+    net_protocol_init_message(&msg, NET_MSG_STABILIZE, 0);
+    net_protocol_copy_node_addr(&msg.payload.notify_req.node, "self", 3, "tcp://self:5555");
+    CHORD_TEST_ASSERT_EQ(net_peer_send_request_async(peer, &msg, on_raw, &r, 5000), NET_ERR_OK,
+                         "Request sent");
+    CHORD_TEST_ASSERT_EQ(fake_peer_deliver(peer, 0), 1, "Response delivered");
+    
+    CHORD_TEST_ASSERT_EQ(r.done, 1, "Completed once");
+    CHORD_TEST_ASSERT_EQ(r.error, NET_ERR_OK, "No error");
+    CHORD_TEST_ASSERT_EQ(r.msg_type, NET_MSG_STABILIZE_RESPONSE, "Stabilize response");
+    CHORD_TEST_ASSERT_EQ(r.count, 1, "One successor");
+    CHORD_TEST_ASSERT_EQ(r.succ_key, 77, "Successor list");
+    
+    const net_message_t *req = fake_peer_get_request(peer, 0);
+    CHORD_TEST_ASSERT_EQ(req->header.msg_type, NET_MSG_STABILIZE, "Stabilize request");
+    CHORD_TEST_ASSERT_EQ(req->payload.notify_req.node.key, 3, "Stabilize carried node key");
+    CHORD_TEST_ASSERT_STR_EQ(req->payload.notify_req.node.url, "tcp://self:5555", "Stabilize carried node");
+    
+    net_peer_destroy(peer);
+    net_loop_destroy(loop);
+}
+
+static void test_async_timeout_and_error(void) {
+    CHORD_TEST("async helpers report timeouts and remote errors");
+    
+    net_loop_t *loop = net_loop_create();
+    net_peer_t *peer = fake_peer_create();
+    async_result_t lost, failed;
+    
+    memset(&lost, 0, sizeof(lost));
+    memset(&failed, 0, sizeof(failed));
+    fake_peer_attach_loop(peer, loop);
+    
+    fake_peer_inject_timeout(peer, 1);
+    net_peer_find_successor_async(peer, 5, on_node, &lost, 20);
+    fake_peer_inject_timeout(peer, 0);
+    fake_peer_inject_error(peer, NET_ERR_NODE_NOT_FOUND);
+    net_peer_ping_async(peer, on_ping, &failed, 5000);
+    
+    CHORD_TEST_ASSERT_EQ(fake_peer_deliver(peer, 0), 1, "Only the error is delivered");
+    CHORD_TEST_ASSERT_EQ(failed.error, NET_ERR_NODE_NOT_FOUND, "Remote error code");
+    
+    uint64_t deadline = net_loop_now_ms(loop) + 1000;
+    while (!lost.done && net_loop_now_ms(loop) < deadline) {
+        net_loop_run_once(loop, 10);
+    }
+    CHORD_TEST_ASSERT_EQ(lost.done, 1, "Lost call completed");
+    CHORD_TEST_ASSERT_EQ(lost.error, NET_ERR_TIMEOUT, "Timed out");
+    CHORD_TEST_ASSERT_EQ(lost.has_node, 0, "No result");
+    
+    net_peer_destroy(peer);
+    net_loop_destroy(loop);
+}
+
+#define ID_THREADS 4
+#define IDS_PER_THREAD 20000
+
+typedef struct {
+    net_peer_t *peer;
+    uint32_t ids[IDS_PER_THREAD];
+} id_worker_t;
+
+static void* id_worker(void *arg) {
+    id_worker_t *w = (id_worker_t*)arg;
+    for (int i = 0; i < IDS_PER_THREAD; i++) {
+        w->ids[i] = net_peer_next_request_id(w->peer);
+    }
+    return NULL;
+}
+
+static void test_request_ids(void) {
+    CHORD_TEST("request IDs are monotonic and unique across threads");
+    
+    static id_worker_t workers[ID_THREADS];
+    pthread_t threads[ID_THREADS];
+    net_peer_t *peer = fake_peer_create();
+    unsigned char *seen = (unsigned char*)calloc(ID_THREADS * IDS_PER_THREAD + 1, 1);
+    
+    CHORD_TEST_ASSERT_EQ(net_peer_next_request_id(peer), 1, "First ID is 1");
+    CHORD_TEST_ASSERT_EQ(net_peer_next_request_id(peer), 2, "Then 2");
+    
+    net_node_addr_t result;
+    net_peer_find_successor(peer, 1, &result, 5000);
+    CHORD_TEST_ASSERT_EQ(fake_peer_get_request(peer, 0)->header.request_id, 3, "Helpers draw from the same sequence");
+    
+    for (int t = 0; t < ID_THREADS; t++) {
+        workers[t].peer = peer;
+        pthread_create(&threads[t], NULL, id_worker, &workers[t]);
+    }
+    for (int t = 0; t < ID_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    
+    int unique = 1, increasing = 1;
+    for (int t = 0; t < ID_THREADS; t++) {
+        for (int i = 0; i < IDS_PER_THREAD; i++) {
+            uint32_t id = workers[t].ids[i] - 3;
+            if (id == 0 || id > ID_THREADS * IDS_PER_THREAD || seen[id]) {
+                unique = 0;
+            }
+            else {
+                seen[id] = 1;
+            }
+            if (i > 0 && workers[t].ids[i] <= workers[t].ids[i - 1]) {
+                increasing = 0;
+            }
+        }
+    }
+    free(seen);
+    CHORD_TEST_ASSERT_TRUE(unique, "No ID issued twice");
+    CHORD_TEST_ASSERT_TRUE(increasing, "IDs increase within each thread");
+    
+    net_peer_destroy(peer);
+}
+
 int main(void) {
     CHORD_TEST_INIT();
     
@@ -202,6 +467,12 @@ int main(void) {
     CHORD_RUN_TEST(test_fake_peer_ping);
     CHORD_RUN_TEST(test_fake_peer_error_injection);
     CHORD_RUN_TEST(test_fake_peer_timeout_injection);
+    CHORD_RUN_TEST(test_net_buf_pool_reuse);
+    CHORD_RUN_TEST(test_rpc_helpers_no_heap_after_warmup);
+    CHORD_RUN_TEST(test_async_helpers);
+    CHORD_RUN_TEST(test_async_stabilize_request);
+    CHORD_RUN_TEST(test_async_timeout_and_error);
+    CHORD_RUN_TEST(test_request_ids);
     
     CHORD_TEST_FINI();
 }
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <string.h>
+#include "../chord_test.h"
+#include "../fakes/fake_peer.h"
+#include "../../src/net/net_pool.h"
+
+/*
+ * Unit tests for net_pool.c - peer connection pool
+ *
+ * Tests cover:
+ * - One shared handle per URL
+ * - Idle expiry
+ * - LRU eviction at the cap (leased handles are never evicted)
+ * - Health eviction after consecutive failures
+ * - Warm reconnect of a dropped handle and prewarming
+ * - Failed dials are not pooled
+ */
+
+static uint64_t fake_now = 1000;
+
+static uint64_t fake_clock(void) {
+    return fake_now;
+}
+
+static int factory_calls = 0;
+
+/* Builds fake peers; URLs containing "dead" cannot be reached */
+static net_peer_t* fake_factory(void *context, const char *url) {
+    (void)context;
+    factory_calls++;
+    return strstr(url, "dead") ? NULL : fake_peer_create();
+}
+
+static net_pool_t* make_pool(size_t max_peers) {
+    net_pool_config_t config;
+    net_pool_config_default(&config);
+    config.max_peers = max_peers;
+    config.idle_timeout_ms = 1000;
+    config.max_failures = 3;
+    config.clock = fake_clock;
+    factory_calls = 0;
+    return net_pool_create(&config, fake_factory, NULL);
+}
+
+static void test_pool_reuse(void) {
+    CHORD_TEST("one shared handle per URL");
+
+    net_pool_t *pool = make_pool(8);
+    net_pool_stats_t stats;
+
+    net_peer_t *a = net_pool_acquire(pool, "tcp://a:5555");
+    net_peer_t *b = net_pool_acquire(pool, "tcp://a:5555");
+    net_peer_t *c = net_pool_acquire(pool, "tcp://c:5555");
+    CHORD_TEST_ASSERT_TRUE(a != NULL && a == b, "Same handle for same URL");
+    CHORD_TEST_ASSERT_TRUE(c != NULL && c != a, "Different URL, different handle");
+    CHORD_TEST_ASSERT_TRUE(a->connected, "Handle is connected");
+    CHORD_TEST_ASSERT_STR_EQ(a->remote_url, "tcp://a:5555", "Connected to URL");
+
+    net_pool_release(pool, a);
+    net_pool_release(pool, b);
+    net_pool_release(pool, c);
+    CHORD_TEST_ASSERT_TRUE(net_pool_acquire(pool, "tcp://a:5555") == a, "Reused after release");
+    net_pool_release(pool, a);
+
+    net_pool_get_stats(pool, &stats);
+    CHORD_TEST_ASSERT_EQ(stats.connects, 2, "Two dials");
+    CHORD_TEST_ASSERT_EQ(stats.hits, 2, "Two hits");
+    CHORD_TEST_ASSERT_EQ(net_pool_size(pool), 2, "Two pooled");
+
+    net_pool_destroy(pool);
+}
+
+static void test_pool_idle_expiry(void) {
+    CHORD_TEST("idle handles expire");
+
+    net_pool_t *pool = make_pool(8);
+    net_pool_stats_t stats;
+
+    net_peer_t *a = net_pool_acquire(pool, "tcp://a:5555");
+    net_peer_t *held = net_pool_acquire(pool, "tcp://held:5555");
+    net_pool_release(pool, a);
+
+    fake_now += 999;
+    net_pool_expire(pool);
+    CHORD_TEST_ASSERT_EQ(net_pool_size(pool), 2, "Not yet expired");
+
+    fake_now += 1;
+    net_pool_expire(pool);
+    CHORD_TEST_ASSERT_EQ(net_pool_size(pool), 1, "Idle handle closed, leased one kept");
+
+    net_pool_get_stats(pool, &stats);
+    CHORD_TEST_ASSERT_EQ(stats.idle_evictions, 1, "One idle eviction");
+
+    net_pool_release(pool, held);
+    net_pool_destroy(pool);
+}
+
+static void test_pool_lru_cap(void) {
+    CHORD_TEST("LRU eviction at the cap");
+
+    net_pool_t *pool = make_pool(2);
+    net_pool_stats_t stats;
+
+    net_pool_release(pool, net_pool_acquire(pool, "tcp://a:5555"));
+    fake_now++;
+    net_pool_release(pool, net_pool_acquire(pool, "tcp://b:5555"));
+    fake_now++;
+    net_pool_release(pool, net_pool_acquire(pool, "tcp://a:5555"));  /* a is now newest */
+
+    net_peer_t *c = net_pool_acquire(pool, "tcp://c:5555");
+    CHORD_TEST_ASSERT_EQ(net_pool_size(pool), 2, "Cap respected");
+
+    factory_calls = 0;
+    net_pool_release(pool, net_pool_acquire(pool, "tcp://a:5555"));
+    CHORD_TEST_ASSERT_EQ(factory_calls, 0, "Recently used a survived");
+
+    /* b was evicted; with a idle and c leased, dialling b evicts a */
+    net_pool_release(pool, net_pool_acquire(pool, "tcp://b:5555"));
+    CHORD_TEST_ASSERT_EQ(factory_calls, 1, "b had to be dialled again");
+
+    net_pool_get_stats(pool, &stats);
+    CHORD_TEST_ASSERT_EQ(stats.lru_evictions, 2, "Two LRU evictions");
+    CHORD_TEST_ASSERT_TRUE(c->connected, "Leased handle untouched");
+
+    net_pool_release(pool, c);
+    net_pool_destroy(pool);
+}
+
+static void test_pool_health_eviction(void) {
+    CHORD_TEST("failing handles are evicted");
+
+    net_pool_t *pool = make_pool(8);
+    net_pool_stats_t stats;
+
+    net_peer_t *a = net_pool_acquire(pool, "tcp://a:5555");
+    net_pool_report(pool, a, NET_ERR_TIMEOUT);
+    net_pool_report(pool, a, NET_ERR_OK);              /* success resets */
+    net_pool_report(pool, a, NET_ERR_TIMEOUT);
+    net_pool_report(pool, a, NET_ERR_NODE_NOT_FOUND);  /* remote answered: link is fine */
+    net_pool_report(pool, a, NET_ERR_TIMEOUT);
+    net_pool_report(pool, a, NET_ERR_TIMEOUT);
+    CHORD_TEST_ASSERT_EQ(net_pool_size(pool), 1, "Still pooled");
+
+    net_pool_report(pool, a, NET_ERR_CONNECTION_CLOSED);
+    CHORD_TEST_ASSERT_EQ(net_pool_size(pool), 0, "Evicted after three in a row");
+    CHORD_TEST_ASSERT_TRUE(a->connected, "Lease holder keeps a valid handle");
+
+    net_peer_t *fresh = net_pool_acquire(pool, "tcp://a:5555");
+    CHORD_TEST_ASSERT_TRUE(fresh != NULL && fresh != a, "Next acquire dials afresh");
+
+    net_pool_release(pool, a);  /* frees the retired handle */
+    net_pool_release(pool, fresh);
+
+    net_pool_get_stats(pool, &stats);
+    CHORD_TEST_ASSERT_EQ(stats.health_evictions, 1, "One health eviction");
+
+    net_pool_destroy(pool);
+}
+
+static void test_pool_warm_reconnect(void) {
+    CHORD_TEST("dropped handles reconnect in place; prewarm");
+
+    net_pool_t *pool = make_pool(8);
+    net_pool_stats_t stats;
+
+    CHORD_TEST_ASSERT_EQ(net_pool_prewarm(pool, "tcp://a:5555"), NET_ERR_OK, "Prewarmed");
+    net_peer_t *a = net_pool_acquire(pool, "tcp://a:5555");
+    uint32_t id = net_peer_next_request_id(a);
+
+    net_peer_close(a);  /* connection dropped */
+    net_pool_release(pool, a);
+
+    net_peer_t *again = net_pool_acquire(pool, "tcp://a:5555");
+    CHORD_TEST_ASSERT_TRUE(again == a, "Same handle");
+    CHORD_TEST_ASSERT_TRUE(again->connected, "Reconnected");
+    CHORD_TEST_ASSERT_EQ(net_peer_next_request_id(again), id + 1, "Request IDs continue");
+    net_pool_release(pool, again);
+
+    net_pool_get_stats(pool, &stats);
+    CHORD_TEST_ASSERT_EQ(stats.connects, 1, "One dial");
+    CHORD_TEST_ASSERT_EQ(stats.reconnects, 1, "One warm reconnect");
+    CHORD_TEST_ASSERT_EQ(stats.hits, 1, "Prewarmed acquire was a hit");
+
+    net_pool_destroy(pool);
+}
+
+static void test_pool_failed_dial(void) {
+    CHORD_TEST("failed dials are not pooled");
+
+    net_pool_t *pool = make_pool(8);
+
+    CHORD_TEST_ASSERT_TRUE(net_pool_acquire(pool, "tcp://dead:5555") == NULL, "Acquire fails");
+    CHORD_TEST_ASSERT_EQ(net_pool_size(pool), 0, "Nothing pooled");
+    CHORD_TEST_ASSERT_TRUE(net_pool_prewarm(pool, "tcp://dead:5555") != NET_ERR_OK, "Prewarm fails");
+    CHORD_TEST_ASSERT_EQ(factory_calls, 2, "Each attempt dials");
+
+    net_pool_destroy(pool);
+}
+
+int main(void) {
+    CHORD_TEST_INIT();
+
+    CHORD_RUN_TEST(test_pool_reuse);
+    CHORD_RUN_TEST(test_pool_idle_expiry);
+    CHORD_RUN_TEST(test_pool_lru_cap);
+    CHORD_RUN_TEST(test_pool_health_eviction);
+    CHORD_RUN_TEST(test_pool_warm_reconnect);
+    CHORD_RUN_TEST(test_pool_failed_dial);
+
+    CHORD_TEST_FINI();
+}
@@ -0,0 +1,522 @@
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include "../chord_test.h"
+#include "../../src/net/net_protocol.h"
+
+/*
+ * Unit tests for net_protocol.c - wire format encode/decode
+ *
+ * Tests cover:
+ * - Binary round trip for every message type
+ * - JSON round trip and format auto-detection
+ * - Compact frame sizes
+ * - Truncated, oversized and malformed frames are rejected
+ * - Version mismatch detection
+ * - Message validation
+ * - Direct request encoding and zero-copy view decoding
+ * - Batches: records, limits, encode_batch and malformed batches
+ * - STABILIZE_RESPONSE successor lists in messages and views
+ */
+
+static void make_node(net_node_addr_t *node, const char *id, int key, const char *url) {
+    net_protocol_copy_node_addr(node, id, key, url);
+}
+
+/* Encode msg in format, decode into out; returns decode result */
+static int roundtrip(const net_message_t *msg, net_protocol_format_t format, net_message_t *out) {
+    uint8_t buffer[NET_PROTOCOL_MAX_FRAME];
+    int len = net_protocol_serialize_as(msg, format, buffer, sizeof(buffer));
+    if (len < 0) {
+        return -1;
+    }
+    return net_protocol_deserialize(out, buffer, (size_t)len);
+}
+
+static void check_all_types(net_protocol_format_t format) {
+    net_message_t msg, out, inner;
+    int len;
+
+    net_protocol_init_message(&msg, NET_MSG_FIND_SUCCESSOR, 7);
+    msg.payload.find_successor_req.key = 200;
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "FIND_SUCCESSOR decodes");
+    CHORD_TEST_ASSERT_EQ(out.header.msg_type, NET_MSG_FIND_SUCCESSOR, "FIND_SUCCESSOR type");
+    CHORD_TEST_ASSERT_EQ(out.header.request_id, 7, "FIND_SUCCESSOR request_id");
+    CHORD_TEST_ASSERT_EQ(out.payload.find_successor_req.key, 200, "FIND_SUCCESSOR key");
+
+    net_protocol_init_message(&msg, NET_MSG_FIND_SUCCESSOR_RESPONSE, 8);
+    make_node(&msg.payload.find_successor_resp.node, "node1", 42, "tcp://127.0.0.1:5555");
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "FIND_SUCCESSOR_RESPONSE decodes");
+    CHORD_TEST_ASSERT_STR_EQ(out.payload.find_successor_resp.node.id, "node1", "Node id");
+    CHORD_TEST_ASSERT_EQ(out.payload.find_successor_resp.node.key, 42, "Node key");
+    CHORD_TEST_ASSERT_STR_EQ(out.payload.find_successor_resp.node.url, "tcp://127.0.0.1:5555", "Node url");
+
+    net_protocol_init_message(&msg, NET_MSG_GET_PREDECESSOR, 9);
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "GET_PREDECESSOR decodes");
+    CHORD_TEST_ASSERT_EQ(out.header.msg_type, NET_MSG_GET_PREDECESSOR, "GET_PREDECESSOR type");
+
+    net_protocol_init_message(&msg, NET_MSG_GET_PREDECESSOR_RESPONSE, 10);
+    msg.payload.get_node_resp.has_node = 0;
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "Empty predecessor decodes");
+    CHORD_TEST_ASSERT_EQ(out.payload.get_node_resp.has_node, 0, "No predecessor");
+
+    net_protocol_init_message(&msg, NET_MSG_GET_SUCCESSOR_RESPONSE, 11);
+    msg.payload.get_node_resp.has_node = 1;
+    make_node(&msg.payload.get_node_resp.node, "succ", 250, "ipc:///tmp/succ");
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "GET_SUCCESSOR_RESPONSE decodes");
+    CHORD_TEST_ASSERT_EQ(out.payload.get_node_resp.has_node, 1, "Has successor");
+    CHORD_TEST_ASSERT_EQ(out.payload.get_node_resp.node.key, 250, "Successor key");
+
+    net_protocol_init_message(&msg, NET_MSG_NOTIFY, 12);
+    make_node(&msg.payload.notify_req.node, "new \"quoted\" node", 3, "tcp://new:1");
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "NOTIFY decodes");
+    CHORD_TEST_ASSERT_STR_EQ(out.payload.notify_req.node.id, "new \"quoted\" node", "Escaped id survives");
+
+    net_protocol_init_message(&msg, NET_MSG_NOTIFY_RESPONSE, 13);
+    msg.payload.notify_resp.success = 1;
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "NOTIFY_RESPONSE decodes");
+    CHORD_TEST_ASSERT_EQ(out.payload.notify_resp.success, 1, "Notify success");
+
+    net_protocol_init_message(&msg, NET_MSG_CLOSEST_PRECEDING, 14);
+    msg.payload.closest_preceding_req.key = 0;
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "CLOSEST_PRECEDING decodes");
+    CHORD_TEST_ASSERT_EQ(out.payload.closest_preceding_req.key, 0, "Closest preceding key");
+
+    net_protocol_init_message(&msg, NET_MSG_PING_RESPONSE, 15);
+    msg.payload.ping_resp.alive = 1;
+    msg.payload.ping_resp.state = 2;
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "PING_RESPONSE decodes");
+    CHORD_TEST_ASSERT_EQ(out.payload.ping_resp.state, 2, "Ping state");
+
+    net_protocol_init_message(&msg, NET_MSG_NEXT_HOP_RESPONSE, 17);
+    msg.payload.next_hop_resp.done = 1;
+    make_node(&msg.payload.next_hop_resp.node, "owner", 77, "tcp://owner:7");
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "NEXT_HOP_RESPONSE decodes");
+    CHORD_TEST_ASSERT_EQ(out.payload.next_hop_resp.done, 1, "Next hop done");
+    CHORD_TEST_ASSERT_EQ(out.payload.next_hop_resp.node.key, 77, "Next hop key");
+
+    net_protocol_init_message(&msg, NET_MSG_FORWARD_LOOKUP, 18);
+    msg.payload.lookup.key = 130;
+    msg.payload.lookup.hops = 3;
+    make_node(&msg.payload.lookup.node, "origin", 5, "tcp://origin:5");
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "FORWARD_LOOKUP decodes");
+    CHORD_TEST_ASSERT_EQ(out.payload.lookup.key, 130, "Lookup key");
+    CHORD_TEST_ASSERT_EQ(out.payload.lookup.hops, 3, "Lookup hops");
+    CHORD_TEST_ASSERT_STR_EQ(out.payload.lookup.node.url, "tcp://origin:5", "Lookup origin");
+
+    net_protocol_init_message(&inner, NET_MSG_FIND_SUCCESSOR, 19);
+    inner.payload.find_successor_req.key = 99;
+    len = net_protocol_serialize_as(&inner, format, msg.payload.addressed.frame,
+                                    sizeof(msg.payload.addressed.frame));
+    net_protocol_init_message(&msg, NET_MSG_ADDRESSED, 19);
+    snprintf(msg.payload.addressed.node_id, sizeof(msg.payload.addressed.node_id), "17-node");
+    msg.payload.addressed.frame_len = (uint32_t)len;
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "ADDRESSED decodes");
+    CHORD_TEST_ASSERT_STR_EQ(out.payload.addressed.node_id, "17-node", "Addressed node");
+    CHORD_TEST_ASSERT_EQ((int)out.payload.addressed.frame_len, len, "Addressed frame length");
+    CHORD_TEST_ASSERT_EQ(net_protocol_deserialize(&inner, out.payload.addressed.frame,
+                                                  out.payload.addressed.frame_len), NET_ERR_OK,
+                         "Inner frame decodes");
+    CHORD_TEST_ASSERT_EQ(inner.payload.find_successor_req.key, 99, "Inner key");
+
+    net_protocol_init_message(&msg, NET_MSG_BATCH, 20);
+    net_protocol_batch_init(&msg.payload.batch);
+    for (int i = 0; i < 3; i++) {
+        uint8_t record[128];
+
+        net_protocol_init_message(&inner, NET_MSG_FIND_SUCCESSOR, (uint32_t)(20 + i));
+        inner.payload.find_successor_req.key = 100 + i;
+        len = net_protocol_serialize_as(&inner, format, record, sizeof(record));
+        net_protocol_batch_add(&msg.payload.batch, record, (size_t)len);
+    }
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "BATCH decodes");
+    CHORD_TEST_ASSERT_EQ((int)out.payload.batch.count, 3, "Batch records");
+    {
+        const uint8_t *record;
+        size_t record_len;
+        size_t offset = 0;
+        int keys = 0;
+
+        while (net_protocol_batch_next(out.payload.batch.data, out.payload.batch.len, &offset,
+                                       &record, &record_len)) {
+            if (net_protocol_deserialize(&inner, record, record_len) == NET_ERR_OK &&
+                inner.payload.find_successor_req.key == 100 + keys) {
+                keys++;
+            }
+        }
+        CHORD_TEST_ASSERT_EQ(keys, 3, "Records decode in order");
+    }
+
+    net_protocol_init_message(&msg, NET_MSG_STABILIZE, 23);
+    make_node(&msg.payload.notify_req.node, "asker", 9, "tcp://asker:9");
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "STABILIZE decodes");
+    CHORD_TEST_ASSERT_EQ(out.payload.notify_req.node.key, 9, "Stabilize sender");
+
+    net_protocol_init_message(&msg, NET_MSG_STABILIZE_RESPONSE, 24);
+    msg.payload.stabilize_resp.has_node = 1;
+    make_node(&msg.payload.stabilize_resp.node, "pred", 8, "tcp://pred:8");
+    msg.payload.stabilize_resp.count = 3;
+    make_node(&msg.payload.stabilize_resp.successors[0], "s1", 20, "tcp://s1:1");
+    make_node(&msg.payload.stabilize_resp.successors[1], "s2", 30, "tcp://s2:2");
+    make_node(&msg.payload.stabilize_resp.successors[2], "s3", 40, "tcp://s3:3");
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "STABILIZE_RESPONSE decodes");
+    CHORD_TEST_ASSERT_EQ(out.payload.stabilize_resp.has_node, 1, "Has predecessor");
+    CHORD_TEST_ASSERT_EQ(out.payload.stabilize_resp.node.key, 8, "Predecessor key");
+    CHORD_TEST_ASSERT_EQ((int)out.payload.stabilize_resp.count, 3, "Successor count");
+    CHORD_TEST_ASSERT_STR_EQ(out.payload.stabilize_resp.successors[2].url, "tcp://s3:3",
+                             "Last successor url");
+
+    msg.payload.stabilize_resp.has_node = 0;
+    msg.payload.stabilize_resp.count = 0;
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "Empty STABILIZE_RESPONSE decodes");
+    CHORD_TEST_ASSERT_EQ(out.payload.stabilize_resp.has_node, 0, "No predecessor");
+    CHORD_TEST_ASSERT_EQ((int)out.payload.stabilize_resp.count, 0, "No successors");
+
+    net_protocol_create_error(&msg, 16, NET_ERR_NODE_NOT_FOUND, "no such node");
+    CHORD_TEST_ASSERT_EQ(roundtrip(&msg, format, &out), NET_ERR_OK, "ERROR decodes");
+    CHORD_TEST_ASSERT_EQ(out.payload.error.error_code, NET_ERR_NODE_NOT_FOUND, "Error code");
+    CHORD_TEST_ASSERT_STR_EQ(out.payload.error.error_msg, "no such node", "Error text");
+}
+
+static void test_binary_roundtrip(void) {
+    CHORD_TEST("binary round trip for all message types");
+    check_all_types(NET_PROTOCOL_FORMAT_BINARY);
+}
+
+static void test_json_roundtrip(void) {
+    CHORD_TEST("JSON round trip for all message types");
+    check_all_types(NET_PROTOCOL_FORMAT_JSON);
+}
+
+static void test_binary_frame_size(void) {
+    CHORD_TEST("binary frames are compact");
+
+    net_message_t msg;
+    uint8_t buffer[NET_PROTOCOL_MAX_FRAME];
+
+    net_protocol_init_message(&msg, NET_MSG_FIND_SUCCESSOR, 123456);
+    msg.payload.find_successor_req.key = 200;
+    int len = net_protocol_serialize(&msg, buffer, sizeof(buffer));
+    CHORD_TEST_ASSERT_TRUE(len > 0 && len <= 10, "FIND_SUCCESSOR fits in 10 bytes");
+    CHORD_TEST_ASSERT_EQ(buffer[0], NET_PROTOCOL_VERSION, "Version is first byte");
+    CHORD_TEST_ASSERT_EQ(buffer[1], NET_MSG_FIND_SUCCESSOR, "Type is second byte");
+
+    net_protocol_init_message(&msg, NET_MSG_FIND_SUCCESSOR_RESPONSE, 123456);
+    make_node(&msg.payload.find_successor_resp.node, "node1", 42, "tcp://127.0.0.1:5555");
+    len = net_protocol_serialize(&msg, buffer, sizeof(buffer));
+    CHORD_TEST_ASSERT_TRUE(len > 0 && len <= 40, "FIND_SUCCESSOR_RESPONSE fits in 40 bytes");
+}
+
+static void test_format_selection(void) {
+    CHORD_TEST("net_protocol_set_format selects JSON");
+
+    net_message_t msg, out;
+    char buffer[NET_PROTOCOL_MAX_FRAME];
+
+    net_protocol_set_format(NET_PROTOCOL_FORMAT_JSON);
+    net_protocol_init_message(&msg, NET_MSG_FIND_SUCCESSOR, 7);
+    msg.payload.find_successor_req.key = 42;
+    int len = net_protocol_serialize(&msg, buffer, sizeof(buffer) - 1);
+    net_protocol_set_format(NET_PROTOCOL_FORMAT_BINARY);
+
+    CHORD_TEST_ASSERT_TRUE(len > 0, "JSON serialize succeeds");
+    buffer[len] = '\0';
+    CHORD_TEST_ASSERT_STR_EQ(buffer, "{\"v\":1,\"type\":\"FIND_SUCCESSOR\",\"id\":7,\"payload\":{\"key\":42}}",
+                             "JSON frame text");
+    CHORD_TEST_ASSERT_EQ(net_protocol_deserialize(&out, buffer, (size_t)len), NET_ERR_OK,
+                         "JSON frame auto-detected");
+
+    const char *reordered = "{ \"payload\": {\"key\": 9}, \"id\": 3, \"type\": \"CLOSEST_PRECEDING\", \"v\": 1 }";
+    CHORD_TEST_ASSERT_EQ(net_protocol_deserialize(&out, reordered, strlen(reordered)), NET_ERR_OK,
+                         "Members in any order");
+    CHORD_TEST_ASSERT_EQ(out.payload.closest_preceding_req.key, 9, "Reordered key");
+}
+
+static void test_malformed_frames(void) {
+    CHORD_TEST("malformed frames are rejected");
+
+    net_message_t msg, out;
+    uint8_t buffer[NET_PROTOCOL_MAX_FRAME];
+
+    net_protocol_init_message(&msg, NET_MSG_NOTIFY, 1);
+    make_node(&msg.payload.notify_req.node, "node1", 42, "tcp://127.0.0.1:5555");
+    int len = net_protocol_serialize(&msg, buffer, sizeof(buffer));
+    CHORD_TEST_ASSERT_TRUE(len > 0, "Serialize succeeds");
+
+    for (int cut = 1; cut < len; cut++) {
+        CHORD_TEST_ASSERT_NE(net_protocol_deserialize(&out, buffer, (size_t)cut), NET_ERR_OK,
+                             "Truncated frame rejected");
+    }
+
+    CHORD_TEST_ASSERT_EQ(net_protocol_serialize(&msg, buffer, (size_t)len - 1), -1,
+                         "Short output buffer rejected");
+
+    buffer[0] = NET_PROTOCOL_VERSION + 1;
+    CHORD_TEST_ASSERT_EQ(net_protocol_deserialize(&out, buffer, (size_t)len), NET_ERR_VERSION_MISMATCH,
+                         "Version mismatch detected");
+
+    const char *bad_json = "{\"v\":1,\"type\":\"NO_SUCH_TYPE\",\"id\":1,\"payload\":{}}";
+    CHORD_TEST_ASSERT_EQ(net_protocol_deserialize(&out, bad_json, strlen(bad_json)), NET_ERR_INVALID_MESSAGE,
+                         "Unknown JSON type rejected");
+
+    const char *missing = "{\"v\":1,\"type\":\"FIND_SUCCESSOR\",\"id\":1,\"payload\":{}}";
+    CHORD_TEST_ASSERT_EQ(net_protocol_deserialize(&out, missing, strlen(missing)), NET_ERR_INVALID_MESSAGE,
+                         "Missing JSON field rejected");
+
+    uint8_t long_string[] = { NET_PROTOCOL_VERSION, NET_MSG_NOTIFY, 1, 3, 0x80, 0x01, 'x' };
+    CHORD_TEST_ASSERT_EQ(net_protocol_deserialize(&out, long_string, sizeof(long_string)), NET_ERR_INVALID_MESSAGE,
+                         "String longer than frame rejected");
+}
+
+static void test_validate(void) {
+    CHORD_TEST("net_protocol_validate");
+
+    net_message_t msg;
+
+    net_protocol_init_message(&msg, NET_MSG_FIND_SUCCESSOR, 1);
+    msg.payload.find_successor_req.key = 5;
+    CHORD_TEST_ASSERT_EQ(net_protocol_validate(&msg), NET_ERR_OK, "Valid request");
+
+    msg.payload.find_successor_req.key = -1;
+    CHORD_TEST_ASSERT_EQ(net_protocol_validate(&msg), NET_ERR_INVALID_MESSAGE, "Negative key rejected");
+
+    msg.header.version = 0;
+    CHORD_TEST_ASSERT_EQ(net_protocol_validate(&msg), NET_ERR_VERSION_MISMATCH, "Bad version rejected");
+
+    net_protocol_init_message(&msg, NET_MSG_NOTIFY, 1);
+    memset(msg.payload.notify_req.node.id, 'x', sizeof(msg.payload.notify_req.node.id));
+    msg.payload.notify_req.node.url[0] = '\0';
+    CHORD_TEST_ASSERT_EQ(net_protocol_validate(&msg), NET_ERR_INVALID_MESSAGE, "Unterminated id rejected");
+
+    CHORD_TEST_ASSERT_STR_EQ(net_protocol_msg_type_name(NET_MSG_PING), "PING", "Type name");
+    CHORD_TEST_ASSERT_STR_EQ(net_protocol_msg_type_name(99), "UNKNOWN", "Unknown type name");
+}
+
+static void test_encode_request_and_view(void) {
+    CHORD_TEST("encode_request matches serialize; views point into frame");
+
+    net_message_t msg;
+    net_node_addr_t node, copy;
+    net_frame_view_t view;
+    uint8_t direct[NET_PROTOCOL_MAX_FRAME], full[NET_PROTOCOL_MAX_FRAME];
+    uint8_t inner[64];
+    int inner_len;
+
+    make_node(&node, "node1", 42, "tcp://127.0.0.1:5555");
+    int len = net_protocol_encode_request(direct, sizeof(direct), NET_MSG_NOTIFY, 99, 0, &node);
+    net_protocol_init_message(&msg, NET_MSG_NOTIFY, 99);
+    msg.payload.notify_req.node = node;
+    CHORD_TEST_ASSERT_EQ(len, net_protocol_serialize(&msg, full, sizeof(full)), "Same length");
+    CHORD_TEST_ASSERT_TRUE(memcmp(direct, full, (size_t)len) == 0, "Same bytes");
+    CHORD_TEST_ASSERT_EQ(net_protocol_encode_request(direct, sizeof(direct), NET_MSG_PING_RESPONSE, 1, 0, NULL),
+                         -1, "Responses are not requests");
+
+    net_protocol_init_message(&msg, NET_MSG_GET_SUCCESSOR_RESPONSE, 5);
+    msg.payload.get_node_resp.has_node = 1;
+    msg.payload.get_node_resp.node = node;
+    len = net_protocol_serialize(&msg, full, sizeof(full));
+    CHORD_TEST_ASSERT_EQ(net_protocol_decode_view(&view, full, (size_t)len), NET_ERR_OK, "View decodes");
+    CHORD_TEST_ASSERT_EQ(view.header.request_id, 5, "Request ID");
+    CHORD_TEST_ASSERT_EQ(view.has_node, 1, "Has node");
+    CHORD_TEST_ASSERT_TRUE((const uint8_t*)view.node.url > full &&
+                           (const uint8_t*)view.node.url < full + len, "URL points into frame");
+    net_protocol_copy_node_view(&copy, &view.node);
+    CHORD_TEST_ASSERT_STR_EQ(copy.id, "node1", "Copied ID");
+    CHORD_TEST_ASSERT_STR_EQ(copy.url, "tcp://127.0.0.1:5555", "Copied URL");
+    CHORD_TEST_ASSERT_EQ(copy.key, 42, "Copied key");
+    CHORD_TEST_ASSERT_EQ(net_protocol_decode_view(&view, full, (size_t)len - 1), NET_ERR_INVALID_MESSAGE,
+                         "Truncated view rejected");
+
+    len = net_protocol_serialize_as(&msg, NET_PROTOCOL_FORMAT_JSON, full, sizeof(full));
+    CHORD_TEST_ASSERT_EQ(net_protocol_decode_view(&view, full, (size_t)len), NET_ERR_OK, "JSON view decodes");
+    net_protocol_copy_node_view(&copy, &view.node);
+    CHORD_TEST_ASSERT_STR_EQ(copy.url, "tcp://127.0.0.1:5555", "JSON view URL");
+
+    len = net_protocol_encode_lookup(direct, sizeof(direct), NET_MSG_LOOKUP_RESULT, 21, 130, 4, &node);
+    net_protocol_init_message(&msg, NET_MSG_LOOKUP_RESULT, 21);
+    msg.payload.lookup.key = 130;
+    msg.payload.lookup.hops = 4;
+    msg.payload.lookup.node = node;
+    CHORD_TEST_ASSERT_EQ(len, net_protocol_serialize(&msg, full, sizeof(full)), "Lookup same length");
+    CHORD_TEST_ASSERT_TRUE(memcmp(direct, full, (size_t)len) == 0, "Lookup same bytes");
+    CHORD_TEST_ASSERT_EQ(net_protocol_decode_view(&view, direct, (size_t)len), NET_ERR_OK, "Lookup view decodes");
+    CHORD_TEST_ASSERT_EQ(view.key, 130, "Lookup view key");
+    CHORD_TEST_ASSERT_EQ(view.hops, 4, "Lookup view hops");
+    CHORD_TEST_ASSERT_EQ(view.node.key, 42, "Lookup view node");
+    CHORD_TEST_ASSERT_EQ(net_protocol_encode_lookup(direct, sizeof(direct), NET_MSG_NEXT_HOP, 1, 0, 0, &node),
+                         -1, "Only lookup types");
+
+    inner_len = net_protocol_encode_request(inner, sizeof(inner), NET_MSG_PING, 22, 0, NULL);
+    len = net_protocol_encode_addressed(direct, sizeof(direct), 22, "17-node", inner, (size_t)inner_len);
+    net_protocol_init_message(&msg, NET_MSG_ADDRESSED, 22);
+    snprintf(msg.payload.addressed.node_id, sizeof(msg.payload.addressed.node_id), "17-node");
+    memcpy(msg.payload.addressed.frame, inner, (size_t)inner_len);
+    msg.payload.addressed.frame_len = (uint32_t)inner_len;
+    CHORD_TEST_ASSERT_EQ(len, net_protocol_serialize(&msg, full, sizeof(full)), "Addressed same length");
+    CHORD_TEST_ASSERT_TRUE(memcmp(direct, full, (size_t)len) == 0, "Addressed same bytes");
+    CHORD_TEST_ASSERT_EQ(net_protocol_decode_view(&view, direct, (size_t)len), NET_ERR_OK,
+                         "Addressed view decodes");
+    CHORD_TEST_ASSERT_TRUE(view.to_len == 7 && memcmp(view.to, "17-node", 7) == 0, "Addressed view node");
+    CHORD_TEST_ASSERT_TRUE(view.frame > direct && view.frame_len == (uint32_t)inner_len &&
+                           memcmp(view.frame, inner, (size_t)inner_len) == 0, "Frame points into envelope");
+}
+
+static void test_batches(void) {
+    CHORD_TEST("batch records, limits and encode_batch");
+
+    net_message_t msg, out;
+    net_batch_t batch;
+    net_frame_view_t view;
+    uint8_t record[NET_PROTOCOL_MAX_FRAME], direct[NET_PROTOCOL_MAX_FRAME], full[NET_PROTOCOL_MAX_FRAME];
+    const uint8_t *next;
+    size_t next_len;
+    size_t offset = 0;
+    int record_len;
+    int len;
+
+    net_protocol_batch_init(&batch);
+    CHORD_TEST_ASSERT_EQ(net_protocol_encode_batch(direct, sizeof(direct), NET_MSG_BATCH, 1, &batch), -1,
+                         "Empty batch refused");
+    for (uint32_t i = 0; i < NET_PROTOCOL_MAX_BATCH; i++) {
+        record_len = net_protocol_encode_request(record, sizeof(record), NET_MSG_PING, 40 + i, 0, NULL);
+        CHORD_TEST_ASSERT_EQ(net_protocol_batch_add(&batch, record, (size_t)record_len), 0, "Record added");
+    }
+    CHORD_TEST_ASSERT_EQ(net_protocol_batch_add(&batch, record, (size_t)record_len), -1,
+                         "No more than NET_PROTOCOL_MAX_BATCH records");
+    CHORD_TEST_ASSERT_EQ(net_protocol_encode_batch(direct, sizeof(direct), NET_MSG_PING, 40, &batch), -1,
+                         "Only batch types");
+
+    len = net_protocol_encode_batch(direct, sizeof(direct), NET_MSG_BATCH, 40, &batch);
+    net_protocol_init_message(&msg, NET_MSG_BATCH, 40);
+    msg.payload.batch = batch;
+    CHORD_TEST_ASSERT_EQ(len, net_protocol_serialize(&msg, full, sizeof(full)), "Batch same length");
+    CHORD_TEST_ASSERT_TRUE(memcmp(direct, full, (size_t)len) == 0, "Batch same bytes");
+    CHORD_TEST_ASSERT_EQ(net_protocol_decode_view(&view, direct, (size_t)len), NET_ERR_OK, "Batch view decodes");
+    CHORD_TEST_ASSERT_EQ((int)view.count, NET_PROTOCOL_MAX_BATCH, "View record count");
+    CHORD_TEST_ASSERT_TRUE(view.frame > direct && view.frame + view.frame_len == direct + len,
+                           "Records point into frame");
+    CHORD_TEST_ASSERT_EQ(net_protocol_batch_next(view.frame, view.frame_len, &offset, &next, &next_len), 1,
+                         "First record");
+    CHORD_TEST_ASSERT_TRUE(next_len == (size_t)record_len, "First record length");
+
+    /* The record count is checked against the records */
+    direct[3]++;  /* version, type, request_id, count */
+    CHORD_TEST_ASSERT_EQ(net_protocol_decode_view(&view, direct, (size_t)len), NET_ERR_INVALID_MESSAGE,
+                         "Count mismatch rejected");
+    CHORD_TEST_ASSERT_EQ(net_protocol_deserialize(&out, direct, (size_t)len - 1), NET_ERR_INVALID_MESSAGE,
+                         "Truncated record rejected");
+
+    net_protocol_batch_init(&batch);
+    memset(record, 0, sizeof(record));
+    CHORD_TEST_ASSERT_EQ(net_protocol_batch_add(&batch, record, NET_PROTOCOL_BATCH_CAPACITY), -1,
+                         "Record larger than the capacity refused");
+    CHORD_TEST_ASSERT_EQ(net_protocol_batch_add(&batch, record, NET_PROTOCOL_BATCH_CAPACITY - 2), 0,
+                         "Record filling the capacity taken");
+    CHORD_TEST_ASSERT_EQ(net_protocol_batch_add(&batch, record, 1), -1, "Full batch refused");
+
+    net_protocol_set_format(NET_PROTOCOL_FORMAT_JSON);
+    net_protocol_batch_init(&batch);
+    for (uint32_t i = 0; i < 2; i++) {
+        record_len = net_protocol_encode_request(record, sizeof(record), NET_MSG_FIND_SUCCESSOR, 50 + i,
+                                                 (int)i, NULL);
+        net_protocol_batch_add(&batch, record, (size_t)record_len);
+    }
+    net_protocol_set_format(NET_PROTOCOL_FORMAT_BINARY);
+    len = net_protocol_encode_batch(direct, sizeof(direct), NET_MSG_BATCH, 50, &batch);
+    CHORD_TEST_ASSERT_TRUE(len > 0 && direct[0] == '{', "JSON records, JSON batch");
+    CHORD_TEST_ASSERT_EQ(net_protocol_decode_view(&view, direct, (size_t)len), NET_ERR_OK,
+                         "JSON batch view decodes");
+    CHORD_TEST_ASSERT_EQ((int)view.count, 2, "JSON record count");
+    offset = 0;
+    net_protocol_batch_next(view.frame, view.frame_len, &offset, &next, &next_len);
+    net_protocol_batch_next(view.frame, view.frame_len, &offset, &next, &next_len);
+    CHORD_TEST_ASSERT_EQ(net_protocol_decode_view(&view, next, next_len), NET_ERR_OK, "JSON record decodes");
+    CHORD_TEST_ASSERT_EQ(view.key, 1, "JSON record key");
+
+    const char *nested = "{\"v\":1,\"type\":\"BATCH\",\"id\":1,\"payload\":{\"frames\":[\"PING\"]}}";
+    CHORD_TEST_ASSERT_EQ(net_protocol_deserialize(&out, nested, strlen(nested)), NET_ERR_INVALID_MESSAGE,
+                         "Non-object JSON record rejected");
+}
+
+static void test_stabilize(void) {
+    CHORD_TEST("STABILIZE requests and successor list views");
+
+    net_message_t msg, out;
+    net_frame_view_t view;
+    net_node_addr_t node;
+    uint8_t direct[NET_PROTOCOL_MAX_FRAME], full[NET_PROTOCOL_MAX_FRAME];
+    int len;
+
+    make_node(&node, "asker", 9, "tcp://asker:9");
+    len = net_protocol_encode_request(direct, sizeof(direct), NET_MSG_STABILIZE, 60, 0, &node);
+    net_protocol_init_message(&msg, NET_MSG_STABILIZE, 60);
+    msg.payload.notify_req.node = node;
+    CHORD_TEST_ASSERT_EQ(len, net_protocol_serialize(&msg, full, sizeof(full)), "Request same length");
+    CHORD_TEST_ASSERT_TRUE(memcmp(direct, full, (size_t)len) == 0, "Request same bytes");
+    CHORD_TEST_ASSERT_EQ(net_protocol_encode_request(direct, sizeof(direct), NET_MSG_STABILIZE, 60, 0, NULL),
+                         -1, "Request needs its node");
+
+    net_protocol_init_message(&msg, NET_MSG_STABILIZE_RESPONSE, 61);
+    msg.payload.stabilize_resp.has_node = 1;
+    make_node(&msg.payload.stabilize_resp.node, "pred", 8, "tcp://pred:8");
+    msg.payload.stabilize_resp.count = NET_PROTOCOL_MAX_SUCCESSORS;
+    for (int i = 0; i < NET_PROTOCOL_MAX_SUCCESSORS; i++) {
+        make_node(&msg.payload.stabilize_resp.successors[i], "succ", 20 + i, "tcp://succ:2");
+    }
+    for (int json = 0; json < 2; json++) {
+        len = net_protocol_serialize_as(&msg, json ? NET_PROTOCOL_FORMAT_JSON : NET_PROTOCOL_FORMAT_BINARY,
+                                        full, sizeof(full));
+        CHORD_TEST_ASSERT_EQ(net_protocol_decode_view(&view, full, (size_t)len), NET_ERR_OK,
+                             "Response view decodes");
+        CHORD_TEST_ASSERT_TRUE(view.has_node && view.node.key == 8, "View predecessor");
+        CHORD_TEST_ASSERT_EQ((int)view.count, NET_PROTOCOL_MAX_SUCCESSORS, "View successor count");
+        CHORD_TEST_ASSERT_EQ(view.successors[NET_PROTOCOL_MAX_SUCCESSORS - 1].key,
+                             20 + NET_PROTOCOL_MAX_SUCCESSORS - 1, "Last successor in view");
+    }
+
+    /* the longest list with the longest ids and URLs still fits a frame
+       inside an ADDRESSED envelope */
+    msg.payload.stabilize_resp.node.key = INT_MIN;
+    memset(msg.payload.stabilize_resp.node.id, 'p', NET_PROTOCOL_MAX_NODE_ID - 1);
+    memset(msg.payload.stabilize_resp.node.url, 'u', NET_PROTOCOL_MAX_URL - 1);
+    msg.payload.stabilize_resp.node.id[NET_PROTOCOL_MAX_NODE_ID - 1] = '\0';
+    msg.payload.stabilize_resp.node.url[NET_PROTOCOL_MAX_URL - 1] = '\0';
+    for (int i = 0; i < NET_PROTOCOL_MAX_SUCCESSORS; i++) {
+        msg.payload.stabilize_resp.successors[i] = msg.payload.stabilize_resp.node;
+    }
+    msg.header.request_id = UINT32_MAX;
+    for (int json = 0; json < 2; json++) {
+        uint8_t envelope[NET_PROTOCOL_MAX_FRAME];
+
+        len = net_protocol_serialize_as(&msg, json ? NET_PROTOCOL_FORMAT_JSON : NET_PROTOCOL_FORMAT_BINARY,
+                                        full, sizeof(full));
+        CHORD_TEST_ASSERT_TRUE(len > 0, "Longest response fits a frame");
+        len = net_protocol_encode_addressed(envelope, sizeof(envelope), UINT32_MAX,
+                                            msg.payload.stabilize_resp.node.id, full, (size_t)len);
+        CHORD_TEST_ASSERT_TRUE(len > 0, "Longest response fits an ADDRESSED envelope");
+    }
+
+    msg.payload.stabilize_resp.count = NET_PROTOCOL_MAX_SUCCESSORS + 1;
+    CHORD_TEST_ASSERT_EQ(net_protocol_validate(&msg), NET_ERR_INVALID_MESSAGE, "Overlong list invalid");
+    CHORD_TEST_ASSERT_EQ(net_protocol_serialize(&msg, full, sizeof(full)), -1, "Overlong list refused");
+
+    const char *missing = "{\"v\":1,\"type\":\"STABILIZE_RESPONSE\",\"id\":1,\"payload\":{\"has_node\":0}}";
+    CHORD_TEST_ASSERT_EQ(net_protocol_deserialize(&out, missing, strlen(missing)), NET_ERR_INVALID_MESSAGE,
+                         "JSON response needs its list");
+}
+
+int main(void) {
+    CHORD_TEST_INIT();
+
+    CHORD_RUN_TEST(test_binary_roundtrip);
+    CHORD_RUN_TEST(test_json_roundtrip);
+    CHORD_RUN_TEST(test_binary_frame_size);
+    CHORD_RUN_TEST(test_format_selection);
+    CHORD_RUN_TEST(test_malformed_frames);
+    CHORD_RUN_TEST(test_validate);
+    CHORD_RUN_TEST(test_encode_request_and_view);
+    CHORD_RUN_TEST(test_batches);
+    CHORD_RUN_TEST(test_stabilize);
+
+    CHORD_TEST_FINI();
+}
@@ -0,0 +1,526 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include "../chord_test.h"
+#include "../../src/net/net_rpc.h"
+
+/*
+ * Unit tests for net_loop.c and net_rpc.c - event loop and async RPC engine
+ *
+ * Tests cover:
+ * - Timer wheel ordering, cancellation and re-arming
+ * - File descriptor watches
+ * - Hooks run before every wait, removable from their own callback
+ * - Responses matched to calls by request_id, in any order
+ * - Timeouts, late responses, ERROR frames and wrong response types
+ * - Pending calls failed on destroy
+ * - Retransmission with backoff until answered or timed out
+ * - Hundreds of calls multiplexed on one link, answered in shuffled order
+ * - Batching: one BATCH per window or when full, BATCH_RESPONSE
+ *   completing every call, send failures
+ */
+
+static uint32_t next_id = 1;
+
+/* Link that records sent frames so tests can answer them */
+#define LINK_MAX_FRAMES 64
+
+typedef struct {
+    net_frame_view_t sent[LINK_MAX_FRAMES];
+    uint8_t raw[LINK_MAX_FRAMES][NET_PROTOCOL_MAX_FRAME];    /* What sent[] points into */
+    int count;
+    int fail;
+} test_link_t;
+
+static int test_link_send(void *link, const net_buf_t *frame) {
+    test_link_t *tl = (test_link_t*)link;
+    if (tl->fail) {
+        return NET_ERR_INTERNAL;
+    }
+    if (tl->count < LINK_MAX_FRAMES) {
+        memcpy(tl->raw[tl->count], frame->data, frame->len);
+        net_protocol_decode_view(&tl->sent[tl->count], tl->raw[tl->count], frame->len);
+        tl->count++;
+    }
+    return NET_ERR_OK;
+}
+
+/* Encode the response to a recorded request */
+static int answer(const net_frame_view_t *request, net_msg_type_t type, int node_key,
+                  uint8_t *buffer, size_t size) {
+    net_message_t msg;
+    net_protocol_init_message(&msg, type, request->header.request_id);
+    if (type == NET_MSG_FIND_SUCCESSOR_RESPONSE) {
+        net_protocol_copy_node_addr(&msg.payload.find_successor_resp.node, "n", node_key, "tcp://n:1");
+    }
+    else if (type == NET_MSG_ERROR) {
+        net_protocol_create_error(&msg, request->header.request_id, NET_ERR_NODE_NOT_FOUND, "gone");
+    }
+    return net_protocol_serialize(&msg, buffer, size);
+}
+
+typedef struct {
+    int calls;
+    int error;
+    int key;
+} result_t;
+
+static void on_result(void *context, const net_frame_view_t *response, int error) {
+    result_t *r = (result_t*)context;
+    r->error = error;
+    r->key = response ? response->node.key : -1;
+    r->calls++;
+}
+
+static void run_until(net_loop_t *loop, const int *flag, int limit_ms) {
+    uint64_t deadline = net_loop_now_ms(loop) + (uint64_t)limit_ms;
+    while (!*flag && net_loop_now_ms(loop) < deadline) {
+        net_loop_run_once(loop, 10);
+    }
+}
+
+/* Timers */
+
+typedef struct {
+    int fired[4];
+    int count;
+} timer_log_t;
+
+typedef struct {
+    net_timer_t timer;
+    int id;
+    timer_log_t *log;
+} test_timer_t;
+
+static void on_timer(net_timer_t *timer, void *context) {
+    test_timer_t *t = (test_timer_t*)context;
+    (void)timer;
+    t->log->fired[t->log->count++] = t->id;
+}
+
+static void test_timer_wheel(void) {
+    CHORD_TEST("timer wheel fires in deadline order; stop cancels");
+
+    net_loop_t *loop = net_loop_create();
+    timer_log_t log = { {0}, 0 };
+    test_timer_t t[4];
+
+    for (int i = 0; i < 4; i++) {
+        t[i].id = i;
+        t[i].log = &log;
+        net_timer_init(&t[i].timer, on_timer, &t[i]);
+    }
+
+    net_loop_timer_start(loop, &t[0].timer, 60);
+    net_loop_timer_start(loop, &t[1].timer, 10);
+    net_loop_timer_start(loop, &t[2].timer, 30);
+    net_loop_timer_start(loop, &t[3].timer, 20);
+    net_loop_timer_stop(loop, &t[3].timer);
+    net_loop_timer_start(loop, &t[2].timer, 5000);  /* re-arm later */
+    CHORD_TEST_ASSERT_EQ(net_loop_timer_count(loop), 3, "Three armed");
+
+    uint64_t deadline = net_loop_now_ms(loop) + 1000;
+    while (log.count < 2 && net_loop_now_ms(loop) < deadline) {
+        net_loop_run_once(loop, -1);
+    }
+
+    CHORD_TEST_ASSERT_EQ(log.count, 2, "Two timers fired");
+    CHORD_TEST_ASSERT_EQ(log.fired[0], 1, "Earliest first");
+    CHORD_TEST_ASSERT_EQ(log.fired[1], 0, "Then the 60 ms timer");
+    CHORD_TEST_ASSERT_EQ(net_loop_timer_count(loop), 1, "Re-armed timer still pending");
+
+    net_loop_destroy(loop);
+}
+
+static void on_readable(void *context, uint32_t events) {
+    int *flag = (int*)context;
+    if (events & EPOLLIN) {
+        *flag = 1;
+    }
+}
+
+static void test_watch(void) {
+    CHORD_TEST("fd watch reports readiness");
+
+    net_loop_t *loop = net_loop_create();
+    net_watch_t watch;
+    int fds[2];
+    int readable = 0;
+
+    memset(&watch, 0, sizeof(watch));
+    CHORD_TEST_ASSERT_EQ(pipe(fds), 0, "Pipe created");
+    CHORD_TEST_ASSERT_EQ(net_loop_watch(loop, &watch, fds[0], EPOLLIN, on_readable, &readable), 0,
+                         "Watch registered");
+
+    net_loop_run_once(loop, 0);
+    CHORD_TEST_ASSERT_EQ(readable, 0, "Nothing to read yet");
+
+    CHORD_TEST_ASSERT_EQ(write(fds[1], "x", 1), 1, "Byte written");
+    net_loop_run_once(loop, 100);
+    CHORD_TEST_ASSERT_EQ(readable, 1, "Readable reported");
+
+    net_loop_unwatch(loop, &watch);
+    close(fds[0]);
+    close(fds[1]);
+    net_loop_destroy(loop);
+}
+
+static void on_hook(void *context) {
+    (*(int*)context)++;
+}
+
+static void test_hooks(void) {
+    CHORD_TEST("hooks run before every wait");
+
+    net_loop_t *loop = net_loop_create();
+    net_hook_t hook;
+    int runs = 0;
+
+    memset(&hook, 0, sizeof(hook));
+    net_loop_add_hook(loop, &hook, on_hook, &runs);
+    net_loop_add_hook(loop, &hook, on_hook, &runs);
+    net_loop_run_once(loop, 0);
+    net_loop_run_once(loop, 0);
+    CHORD_TEST_ASSERT_EQ(runs, 2, "Once per iteration, added once");
+
+    net_loop_remove_hook(loop, &hook);
+    net_loop_remove_hook(loop, &hook);
+    net_loop_run_once(loop, 0);
+    CHORD_TEST_ASSERT_EQ(runs, 2, "Removed");
+
+    net_loop_destroy(loop);
+}
+
+/* RPC engine */
+
+static void test_rpc_out_of_order(void) {
+    CHORD_TEST("responses complete the matching call in any order");
+
+    net_loop_t *loop = net_loop_create();
+    test_link_t link = { .count = 0, .fail = 0 };
+    net_rpc_t *rpc = net_rpc_create(loop, test_link_send, &link);
+    result_t r[3];
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+
+    memset(r, 0, sizeof(r));
+    for (int i = 0; i < 3; i++) {
+        CHORD_TEST_ASSERT_EQ(net_rpc_call(rpc, next_id++, NET_MSG_FIND_SUCCESSOR, 10 + i, NULL, on_result, &r[i], 5000),
+                             NET_ERR_OK, "Call started");
+    }
+    CHORD_TEST_ASSERT_EQ(net_rpc_pending(rpc), 3, "Three in flight");
+    CHORD_TEST_ASSERT_EQ(link.sent[1].key, 11, "Request encoded");
+
+    for (int i = 2; i >= 0; i--) {
+        int len = answer(&link.sent[i], NET_MSG_FIND_SUCCESSOR_RESPONSE, 100 + i, frame, sizeof(frame));
+        CHORD_TEST_ASSERT_EQ(net_rpc_receive(rpc, frame, (size_t)len), NET_ERR_OK, "Response matched");
+    }
+
+    for (int i = 0; i < 3; i++) {
+        CHORD_TEST_ASSERT_EQ(r[i].calls, 1, "Completed once");
+        CHORD_TEST_ASSERT_EQ(r[i].error, NET_ERR_OK, "No error");
+        CHORD_TEST_ASSERT_EQ(r[i].key, 100 + i, "Own response");
+    }
+    CHORD_TEST_ASSERT_EQ(net_rpc_pending(rpc), 0, "Nothing pending");
+
+    int len = answer(&link.sent[0], NET_MSG_FIND_SUCCESSOR_RESPONSE, 1, frame, sizeof(frame));
+    CHORD_TEST_ASSERT_EQ(net_rpc_receive(rpc, frame, (size_t)len), NET_ERR_NODE_NOT_FOUND,
+                         "Duplicate dropped");
+    CHORD_TEST_ASSERT_EQ(r[0].calls, 1, "Not completed twice");
+
+    net_rpc_destroy(rpc);
+    net_loop_destroy(loop);
+}
+
+static void test_rpc_timeout(void) {
+    CHORD_TEST("unanswered call times out; late response dropped");
+
+    net_loop_t *loop = net_loop_create();
+    test_link_t link = { .count = 0, .fail = 0 };
+    net_rpc_t *rpc = net_rpc_create(loop, test_link_send, &link);
+    result_t r;
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+
+    memset(&r, 0, sizeof(r));
+    net_rpc_call(rpc, next_id++, NET_MSG_FIND_SUCCESSOR, 1, NULL, on_result, &r, 20);
+    run_until(loop, &r.calls, 1000);
+
+    CHORD_TEST_ASSERT_EQ(r.calls, 1, "Completed");
+    CHORD_TEST_ASSERT_EQ(r.error, NET_ERR_TIMEOUT, "Timed out");
+    CHORD_TEST_ASSERT_EQ(net_loop_timer_count(loop), 0, "Timer released");
+
+    int len = answer(&link.sent[0], NET_MSG_FIND_SUCCESSOR_RESPONSE, 1, frame, sizeof(frame));
+    CHORD_TEST_ASSERT_EQ(net_rpc_receive(rpc, frame, (size_t)len), NET_ERR_NODE_NOT_FOUND,
+                         "Late response dropped");
+    CHORD_TEST_ASSERT_EQ(r.calls, 1, "Not completed twice");
+
+    net_rpc_destroy(rpc);
+    net_loop_destroy(loop);
+}
+
+static void test_rpc_retransmit(void) {
+    CHORD_TEST("retransmission resends with backoff until answered");
+
+    net_loop_t *loop = net_loop_create();
+    test_link_t link = { .count = 0, .fail = 0 };
+    net_rpc_t *rpc = net_rpc_create(loop, test_link_send, &link);
+    result_t r;
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+
+    net_rpc_set_retransmit(rpc, 10);
+    memset(&r, 0, sizeof(r));
+    net_rpc_call(rpc, next_id++, NET_MSG_PING, 0, NULL, on_result, &r, 5000);
+    uint64_t deadline = net_loop_now_ms(loop) + 1000;
+    while (link.count < 3 && net_loop_now_ms(loop) < deadline) {
+        net_loop_run_once(loop, 10);
+    }
+    CHORD_TEST_ASSERT_TRUE(link.count >= 3, "Resent while unanswered");
+    CHORD_TEST_ASSERT_EQ(link.sent[2].header.request_id, link.sent[0].header.request_id, "Same request");
+    CHORD_TEST_ASSERT_EQ(net_rpc_retransmits(rpc), (size_t)link.count - 1, "Counted");
+
+    int len = answer(&link.sent[0], NET_MSG_PING_RESPONSE, 0, frame, sizeof(frame));
+    net_rpc_receive(rpc, frame, (size_t)len);
+    net_rpc_receive(rpc, frame, (size_t)len);
+    CHORD_TEST_ASSERT_EQ(r.calls, 1, "Answered once despite duplicate responses");
+    CHORD_TEST_ASSERT_EQ(r.error, NET_ERR_OK, "No error");
+    CHORD_TEST_ASSERT_EQ(net_loop_timer_count(loop), 0, "Timer released");
+
+    /* 10 + 20 + 40 ms of backoff fit in 100 ms: three resends, then timeout */
+    link.count = 0;
+    memset(&r, 0, sizeof(r));
+    net_rpc_call(rpc, next_id++, NET_MSG_PING, 0, NULL, on_result, &r, 100);
+    run_until(loop, &r.calls, 1000);
+    CHORD_TEST_ASSERT_EQ(r.error, NET_ERR_TIMEOUT, "Timed out");
+    CHORD_TEST_ASSERT_EQ(link.count, 4, "Original plus three resends");
+
+    net_rpc_destroy(rpc);
+    net_loop_destroy(loop);
+}
+
+static void test_rpc_errors(void) {
+    CHORD_TEST("ERROR frames, wrong types and send failures");
+
+    net_loop_t *loop = net_loop_create();
+    test_link_t link = { .count = 0, .fail = 0 };
+    net_rpc_t *rpc = net_rpc_create(loop, test_link_send, &link);
+    result_t r[2];
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+
+    memset(r, 0, sizeof(r));
+    net_rpc_call(rpc, next_id++, NET_MSG_FIND_SUCCESSOR, 1, NULL, on_result, &r[0], 5000);
+    net_rpc_call(rpc, next_id++, NET_MSG_FIND_SUCCESSOR, 2, NULL, on_result, &r[1], 5000);
+
+    int len = answer(&link.sent[0], NET_MSG_ERROR, 0, frame, sizeof(frame));
+    net_rpc_receive(rpc, frame, (size_t)len);
+    CHORD_TEST_ASSERT_EQ(r[0].error, NET_ERR_NODE_NOT_FOUND, "Remote error code");
+
+    len = answer(&link.sent[1], NET_MSG_PING_RESPONSE, 0, frame, sizeof(frame));
+    net_rpc_receive(rpc, frame, (size_t)len);
+    CHORD_TEST_ASSERT_EQ(r[1].error, NET_ERR_INVALID_MESSAGE, "Wrong response type");
+
+    link.fail = 1;
+    memset(r, 0, sizeof(r));
+    CHORD_TEST_ASSERT_EQ(net_rpc_call(rpc, next_id++, NET_MSG_PING, 0, NULL, on_result, &r[0], 5000),
+                         NET_ERR_INTERNAL, "Send failure returned");
+    CHORD_TEST_ASSERT_EQ(net_rpc_pending(rpc), 0, "Nothing left pending");
+    CHORD_TEST_ASSERT_EQ(net_loop_timer_count(loop), 0, "No timer left armed");
+    CHORD_TEST_ASSERT_EQ(r[0].calls, 0, "Callback not invoked");
+
+    net_rpc_destroy(rpc);
+    net_loop_destroy(loop);
+}
+
+static void test_rpc_destroy_fails_pending(void) {
+    CHORD_TEST("destroy completes pending calls");
+
+    net_loop_t *loop = net_loop_create();
+    test_link_t link = { .count = 0, .fail = 0 };
+    net_rpc_t *rpc = net_rpc_create(loop, test_link_send, &link);
+    result_t r;
+
+    memset(&r, 0, sizeof(r));
+    net_rpc_call(rpc, next_id++, NET_MSG_PING, 0, NULL, on_result, &r, 5000);
+    net_rpc_destroy(rpc);
+
+    CHORD_TEST_ASSERT_EQ(r.calls, 1, "Completed");
+    CHORD_TEST_ASSERT_EQ(r.error, NET_ERR_CONNECTION_CLOSED, "Connection closed");
+    CHORD_TEST_ASSERT_EQ(net_loop_timer_count(loop), 0, "Timer released");
+
+    net_loop_destroy(loop);
+}
+
+/* Link that only records request IDs, for many calls in flight */
+#define MANY_CALLS 500
+
+typedef struct {
+    uint32_t ids[MANY_CALLS];
+    int count;
+} id_link_t;
+
+static int id_link_send(void *link, const net_buf_t *frame) {
+    id_link_t *il = (id_link_t*)link;
+    net_frame_view_t view;
+    net_protocol_decode_view(&view, frame->data, frame->len);
+    il->ids[il->count++] = view.header.request_id;
+    return NET_ERR_OK;
+}
+
+static void test_rpc_many_in_flight(void) {
+    CHORD_TEST("hundreds of calls multiplexed on one link");
+
+    static id_link_t link;
+    static result_t r[MANY_CALLS];
+    static int order[MANY_CALLS];
+    net_loop_t *loop = net_loop_create();
+    net_rpc_t *rpc = net_rpc_create(loop, id_link_send, &link);
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+    uint32_t first = next_id;
+
+    memset(r, 0, sizeof(r));
+    link.count = 0;
+    for (int i = 0; i < MANY_CALLS; i++) {
+        CHORD_TEST_ASSERT_EQ(net_rpc_call(rpc, next_id++, NET_MSG_FIND_SUCCESSOR, i, NULL, on_result, &r[i], 5000),
+                             NET_ERR_OK, "Call started");
+        order[i] = i;
+    }
+    CHORD_TEST_ASSERT_EQ(net_rpc_pending(rpc), MANY_CALLS, "All in flight");
+    CHORD_TEST_ASSERT_EQ(net_rpc_call(rpc, first, NET_MSG_PING, 0, NULL, on_result, &r[0], 5000),
+                         NET_ERR_INTERNAL, "ID already in flight refused");
+
+    /* Fisher-Yates with a fixed LCG so the order is reproducible */
+    uint32_t seed = 12345;
+    for (int i = MANY_CALLS - 1; i > 0; i--) {
+        seed = seed * 1103515245u + 12345u;
+        int j = (int)(seed % (uint32_t)(i + 1));
+        int tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+
+    for (int i = 0; i < MANY_CALLS; i++) {
+        net_frame_view_t request;
+        int n = order[i];
+        request.header.request_id = link.ids[n];
+        int len = answer(&request, NET_MSG_FIND_SUCCESSOR_RESPONSE, 1000 + n, frame, sizeof(frame));
+        CHORD_TEST_ASSERT_EQ(net_rpc_receive(rpc, frame, (size_t)len), NET_ERR_OK, "Response matched");
+    }
+
+    for (int i = 0; i < MANY_CALLS; i++) {
+        CHORD_TEST_ASSERT_EQ(link.ids[i], first + (uint32_t)i, "IDs sent in order");
+        CHORD_TEST_ASSERT_EQ(r[i].calls, 1, "Completed once");
+        CHORD_TEST_ASSERT_EQ(r[i].key, 1000 + i, "Own response");
+    }
+    CHORD_TEST_ASSERT_EQ(net_rpc_pending(rpc), 0, "Nothing pending");
+
+    net_rpc_destroy(rpc);
+    net_loop_destroy(loop);
+}
+
+static void test_rpc_batching(void) {
+    CHORD_TEST("batched calls go out as one BATCH and complete from one BATCH_RESPONSE");
+
+    net_loop_t *loop = net_loop_create();
+    test_link_t link = { .count = 0, .fail = 0 };
+    net_rpc_t *rpc = net_rpc_create(loop, test_link_send, &link);
+    result_t r[5];
+    net_batch_t responses;
+    net_frame_view_t request;
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+    const uint8_t *record;
+    size_t record_len;
+    size_t offset = 0;
+    uint32_t first = next_id;
+
+    memset(r, 0, sizeof(r));
+    net_rpc_set_batching(rpc, 8, 0);
+    for (int i = 0; i < 3; i++) {
+        CHORD_TEST_ASSERT_EQ(net_rpc_call(rpc, next_id++, NET_MSG_FIND_SUCCESSOR, 10 + i, NULL, on_result, &r[i], 5000),
+                             NET_ERR_OK, "Call staged");
+    }
+    CHORD_TEST_ASSERT_EQ(link.count, 0, "Nothing sent during the turn");
+    CHORD_TEST_ASSERT_EQ(net_rpc_pending(rpc), 3, "Three in flight");
+    net_loop_run_once(loop, 0);
+    CHORD_TEST_ASSERT_EQ(link.count, 1, "One frame at the next turn");
+    CHORD_TEST_ASSERT_EQ(link.sent[0].header.msg_type, NET_MSG_BATCH, "A BATCH");
+    CHORD_TEST_ASSERT_EQ(link.sent[0].header.request_id, first, "Carrying the first record's ID");
+    CHORD_TEST_ASSERT_EQ((int)link.sent[0].count, 3, "Of every call");
+    CHORD_TEST_ASSERT_EQ(net_rpc_batches(rpc), 1, "Counted");
+
+    /* Answer in reverse, all in one frame */
+    net_protocol_batch_init(&responses);
+    for (int i = 2; i >= 0; i--) {
+        offset = 0;
+        for (int skip = 0; skip <= i; skip++) {
+            net_protocol_batch_next(link.sent[0].frame, link.sent[0].frame_len, &offset, &record, &record_len);
+        }
+        net_protocol_decode_view(&request, record, record_len);
+        int len = answer(&request, NET_MSG_FIND_SUCCESSOR_RESPONSE, 100 + request.key, frame, sizeof(frame));
+        net_protocol_batch_add(&responses, frame, (size_t)len);
+    }
+    int len = net_protocol_encode_batch(frame, sizeof(frame), NET_MSG_BATCH_RESPONSE, first, &responses);
+    CHORD_TEST_ASSERT_EQ(net_rpc_receive(rpc, frame, (size_t)len), NET_ERR_OK, "Batch response matched");
+    for (int i = 0; i < 3; i++) {
+        CHORD_TEST_ASSERT_EQ(r[i].calls, 1, "Completed once");
+        CHORD_TEST_ASSERT_EQ(r[i].key, 110 + i, "Own response");
+    }
+    CHORD_TEST_ASSERT_EQ(net_rpc_receive(rpc, frame, (size_t)len), NET_ERR_NODE_NOT_FOUND,
+                         "Duplicate batch response dropped");
+
+    /* Full batches leave at once, the rest with the window or a flush */
+    memset(r, 0, sizeof(r));
+    link.count = 0;
+    net_rpc_set_batching(rpc, 4, 1000);
+    for (int i = 0; i < 5; i++) {
+        net_rpc_call(rpc, next_id++, NET_MSG_PING, 0, NULL, on_result, &r[i], 5000);
+    }
+    CHORD_TEST_ASSERT_EQ(link.count, 1, "Full batch sent");
+    CHORD_TEST_ASSERT_EQ((int)link.sent[0].count, 4, "Of four");
+    CHORD_TEST_ASSERT_EQ(net_rpc_flush(rpc), NET_ERR_OK, "Flushed");
+    CHORD_TEST_ASSERT_EQ(link.count, 2, "Remainder sent");
+    CHORD_TEST_ASSERT_EQ(link.sent[1].header.msg_type, NET_MSG_PING, "A lone request goes out bare");
+    len = answer(&link.sent[1], NET_MSG_PING_RESPONSE, 0, frame, sizeof(frame));
+    CHORD_TEST_ASSERT_EQ(net_rpc_receive(rpc, frame, (size_t)len), NET_ERR_OK, "Bare response matched");
+    CHORD_TEST_ASSERT_EQ(r[4].calls, 1, "Completed");
+
+    net_rpc_call(rpc, next_id++, NET_MSG_PING, 0, NULL, on_result, &r[4], 5000);
+    net_rpc_call(rpc, next_id++, NET_MSG_PING, 0, NULL, on_result, &r[4], 5000);
+    uint64_t deadline = net_loop_now_ms(loop) + 3000;
+    while (link.count < 3 && net_loop_now_ms(loop) < deadline) {
+        net_loop_run_once(loop, 10);
+    }
+    CHORD_TEST_ASSERT_EQ(link.count, 3, "Sent when the window closed");
+    CHORD_TEST_ASSERT_EQ((int)link.sent[2].count, 2, "Both calls");
+
+    /* A failed batch send completes its calls */
+    memset(r, 0, sizeof(r));
+    link.fail = 1;
+    CHORD_TEST_ASSERT_EQ(net_rpc_call(rpc, next_id++, NET_MSG_PING, 0, NULL, on_result, &r[0], 5000),
+                         NET_ERR_OK, "Staged despite the broken link");
+    CHORD_TEST_ASSERT_EQ(net_rpc_flush(rpc), NET_ERR_INTERNAL, "Flush reports the send failure");
+    CHORD_TEST_ASSERT_EQ(r[0].calls, 1, "Call completed");
+    CHORD_TEST_ASSERT_EQ(r[0].error, NET_ERR_INTERNAL, "With the link's error");
+    link.fail = 0;
+
+    net_rpc_destroy(rpc);
+    CHORD_TEST_ASSERT_EQ(net_loop_timer_count(loop), 0, "No timer left armed");
+    net_loop_destroy(loop);
+}
+
+int main(void) {
+    CHORD_TEST_INIT();
+
+    CHORD_RUN_TEST(test_timer_wheel);
+    CHORD_RUN_TEST(test_watch);
+    CHORD_RUN_TEST(test_hooks);
+    CHORD_RUN_TEST(test_rpc_out_of_order);
+    CHORD_RUN_TEST(test_rpc_timeout);
+    CHORD_RUN_TEST(test_rpc_retransmit);
+    CHORD_RUN_TEST(test_rpc_errors);
+    CHORD_RUN_TEST(test_rpc_destroy_fails_pending);
+    CHORD_RUN_TEST(test_rpc_many_in_flight);
+    CHORD_RUN_TEST(test_rpc_batching);
+
+    CHORD_TEST_FINI();
+}
@@ -0,0 +1,757 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../chord_test.h"
+#include "../../src/net/net_server.h"
+#include "../../src/net/net_node_service.h"
+#include "../../src/net/net_transport.h"
+
+/*
+ * Unit tests for net_server.c - RPC server with a worker pool
+ *
+ * Tests cover:
+ * - Readers running on several workers at once
+ * - Writers running alone, never beside a reader or another writer
+ * - Idle workers stealing requests queued behind a slow one
+ * - Unregistered types and undecodable frames answered with ERROR
+ * - Connections spread over several I/O threads
+ * - BATCH frames answered record by record in BATCH_RESPONSE frames
+ * - Node service: lookups, GET_*, PING and NOTIFY against core nodes
+ * - Iterative and recursive lookups across one server per node, also
+ *   from several threads at once over the same links
+ * - Networked stabilization converging with one STABILIZE per period
+ */
+
+#define TEST_TIMEOUT_MS 2000
+
+static void sleep_ms(int ms) {
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+static net_server_t* start_server(int io_threads, int workers,
+                                  void (*setup)(net_server_t *server, void *context), void *context) {
+    net_server_config_t config;
+    net_server_t *server;
+
+    net_server_config_default(&config);
+    config.io_threads = io_threads;
+    config.workers = workers;
+    server = net_server_create(&config);
+    if (!server) {
+        return NULL;
+    }
+    setup(server, context);
+    if (net_server_listen(server, "tcp://127.0.0.1:0") != 0 || net_server_start(server) != 0) {
+        net_server_destroy(server);
+        return NULL;
+    }
+    return server;
+}
+
+static net_transport_t* connect_client(net_server_t *server) {
+    net_transport_t *client = net_transport_create(NET_TRANSPORT_TCP);
+
+    if (net_transport_connect(client, net_server_url(server), TEST_TIMEOUT_MS) != 0) {
+        net_transport_destroy(client);
+        return NULL;
+    }
+    return client;
+}
+
+static int send_request(net_transport_t *client, net_msg_type_t type, uint32_t id, int key,
+                        const net_node_addr_t *node) {
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+    int len = net_protocol_encode_request(frame, sizeof(frame), type, id, key, node);
+
+    return len > 0 ? net_transport_send(client, frame, (size_t)len, TEST_TIMEOUT_MS) : -1;
+}
+
+/* Receive one response into view (strings point into buf) */
+static int recv_response(net_transport_t *client, uint8_t *buf, net_frame_view_t *view) {
+    int n = net_transport_recv(client, buf, NET_PROTOCOL_MAX_FRAME, TEST_TIMEOUT_MS);
+
+    return n > 0 ? net_protocol_decode_view(view, buf, (size_t)n) : -1;
+}
+
+/*
+ * Concurrency probes: handlers that sleep while counting who else runs
+ */
+
+typedef struct {
+    _Atomic int readers;
+    _Atomic int writers;
+    _Atomic int max_readers;
+    _Atomic int violations;
+    int read_ms;
+    int write_ms;
+} probe_t;
+
+static int probe_read(void *context, const net_frame_view_t *request, net_message_t *response) {
+    probe_t *probe = (probe_t*)context;
+    int active = atomic_fetch_add(&probe->readers, 1) + 1;
+    int max = atomic_load(&probe->max_readers);
+
+    while (active > max && !atomic_compare_exchange_weak(&probe->max_readers, &max, active)) {
+    }
+    if (atomic_load(&probe->writers) != 0) {
+        atomic_fetch_add(&probe->violations, 1);
+    }
+    sleep_ms(request->key == 1 ? 100 : probe->read_ms);
+    atomic_fetch_sub(&probe->readers, 1);
+    response->payload.find_successor_resp.node.key = request->key;
+    return NET_ERR_OK;
+}
+
+static int probe_write(void *context, const net_frame_view_t *request, net_message_t *response) {
+    probe_t *probe = (probe_t*)context;
+
+    (void)request;
+    if (atomic_fetch_add(&probe->writers, 1) != 0 || atomic_load(&probe->readers) != 0) {
+        atomic_fetch_add(&probe->violations, 1);
+    }
+    sleep_ms(probe->write_ms);
+    if (atomic_load(&probe->readers) != 0) {
+        atomic_fetch_add(&probe->violations, 1);
+    }
+    atomic_fetch_sub(&probe->writers, 1);
+    response->payload.notify_resp.success = 1;
+    return NET_ERR_OK;
+}
+
+static void probe_setup(net_server_t *server, void *context) {
+    net_server_handle(server, NET_MSG_FIND_SUCCESSOR, NET_SERVER_READ, probe_read, context);
+    net_server_handle(server, NET_MSG_NOTIFY, NET_SERVER_WRITE, probe_write, context);
+}
+
+static void test_server_parallel_readers(void) {
+    CHORD_TEST("readers run on several workers at once");
+
+    probe_t probe = { .read_ms = 20 };
+    net_server_t *server = start_server(1, 4, probe_setup, &probe);
+    net_transport_t *client;
+    uint8_t buf[NET_PROTOCOL_MAX_FRAME];
+    net_frame_view_t view;
+    uint32_t seen = 0;
+
+    CHORD_TEST_ASSERT_NOT_NULL(server, "Server started");
+    client = connect_client(server);
+    CHORD_TEST_ASSERT_NOT_NULL(client, "Client connected");
+
+    for (uint32_t id = 1; id <= 8; id++) {
+        send_request(client, NET_MSG_FIND_SUCCESSOR, id, 100 + (int)id, NULL);
+    }
+    for (int i = 0; i < 8; i++) {
+        CHORD_TEST_ASSERT_EQ(recv_response(client, buf, &view), NET_ERR_OK, "Response");
+        CHORD_TEST_ASSERT_EQ(view.header.msg_type, NET_MSG_FIND_SUCCESSOR_RESPONSE, "Response type");
+        CHORD_TEST_ASSERT_EQ(view.node.key, 100 + (int)view.header.request_id, "Matches its request");
+        seen |= 1u << view.header.request_id;
+    }
+    CHORD_TEST_ASSERT_EQ(seen, 0x1FEu, "Every request answered once");
+    CHORD_TEST_ASSERT_TRUE(atomic_load(&probe.max_readers) > 1, "Readers overlapped");
+
+    net_transport_destroy(client);
+    net_server_destroy(server);
+}
+
+static void test_server_exclusive_writers(void) {
+    CHORD_TEST("writers run alone");
+
+    probe_t probe = { .read_ms = 2, .write_ms = 2 };
+    net_server_t *server = start_server(2, 4, probe_setup, &probe);
+    net_transport_t *clients[2];
+    uint8_t buf[NET_PROTOCOL_MAX_FRAME];
+    net_frame_view_t view;
+    net_node_addr_t node;
+    net_server_stats_t stats;
+    int answered = 0;
+
+    CHORD_TEST_ASSERT_NOT_NULL(server, "Server started");
+    clients[0] = connect_client(server);
+    clients[1] = connect_client(server);
+    net_protocol_copy_node_addr(&node, "n", 7, "tcp://127.0.0.1:1");
+
+    for (uint32_t id = 1; id <= 40; id++) {
+        net_transport_t *client = clients[id % 2];
+        if (id % 3 == 0) {
+            send_request(client, NET_MSG_NOTIFY, id, 0, &node);
+        } else {
+            send_request(client, NET_MSG_FIND_SUCCESSOR, id, 50, NULL);
+        }
+    }
+    for (int i = 0; i < 40; i++) {
+        answered += recv_response(clients[i % 2], buf, &view) == NET_ERR_OK &&
+                    view.header.msg_type != NET_MSG_ERROR;
+    }
+    CHORD_TEST_ASSERT_EQ(answered, 40, "All answered");
+    CHORD_TEST_ASSERT_EQ(atomic_load(&probe.violations), 0, "No writer overlapped anything");
+
+    net_server_get_stats(server, &stats);
+    CHORD_TEST_ASSERT_EQ(stats.connections, 2, "Two connections");
+    CHORD_TEST_ASSERT_EQ(stats.requests, 40, "Forty requests");
+
+    net_transport_destroy(clients[0]);
+    net_transport_destroy(clients[1]);
+    net_server_destroy(server);
+}
+
+static void test_server_steals(void) {
+    CHORD_TEST("idle workers steal from a busy one");
+
+    probe_t probe = { .read_ms = 1 };
+    net_server_t *server = start_server(1, 2, probe_setup, &probe);
+    net_transport_t *client = connect_client(server);
+    uint8_t buf[NET_PROTOCOL_MAX_FRAME];
+    net_frame_view_t view;
+    net_server_stats_t stats;
+    int answered = 0;
+
+    CHORD_TEST_ASSERT_NOT_NULL(client, "Client connected");
+
+    /* Key 1 sleeps 100 ms on the first worker; the rest of its share
+     * should be taken by the second */
+    for (uint32_t id = 1; id <= 8; id++) {
+        send_request(client, NET_MSG_FIND_SUCCESSOR, id, (int)id, NULL);
+    }
+    for (int i = 0; i < 8; i++) {
+        answered += recv_response(client, buf, &view) == NET_ERR_OK;
+        if (i == 0) {
+            CHORD_TEST_ASSERT_TRUE(view.header.request_id != 1, "Slow request did not block the rest");
+        }
+    }
+    CHORD_TEST_ASSERT_EQ(answered, 8, "All answered");
+    net_server_get_stats(server, &stats);
+    CHORD_TEST_ASSERT_TRUE(stats.steals > 0, "Work was stolen");
+
+    net_transport_destroy(client);
+    net_server_destroy(server);
+}
+
+static void test_server_errors(void) {
+    CHORD_TEST("unknown types and bad frames get ERROR");
+
+    probe_t probe = { .read_ms = 0 };
+    net_server_t *server = start_server(1, 1, probe_setup, &probe);
+    net_transport_t *client = connect_client(server);
+    uint8_t buf[NET_PROTOCOL_MAX_FRAME];
+    net_frame_view_t view;
+    net_server_stats_t stats;
+
+    CHORD_TEST_ASSERT_NOT_NULL(client, "Client connected");
+    CHORD_TEST_ASSERT_EQ(net_server_handle(server, NET_MSG_PING_RESPONSE, NET_SERVER_READ, probe_read, &probe),
+                         NET_ERR_INVALID_MESSAGE, "Responses cannot be served");
+
+    send_request(client, NET_MSG_PING, 9, 0, NULL);
+    CHORD_TEST_ASSERT_EQ(recv_response(client, buf, &view), NET_ERR_OK, "Answered");
+    CHORD_TEST_ASSERT_TRUE(view.header.msg_type == NET_MSG_ERROR && view.header.request_id == 9 &&
+                           view.error_code == NET_ERR_INVALID_MESSAGE, "Unregistered type refused");
+
+    net_transport_send(client, "garbage", 7, TEST_TIMEOUT_MS);
+    CHORD_TEST_ASSERT_EQ(recv_response(client, buf, &view), NET_ERR_OK, "Answered");
+    CHORD_TEST_ASSERT_EQ(view.header.msg_type, NET_MSG_ERROR, "Bad frame refused");
+
+    send_request(client, NET_MSG_FIND_SUCCESSOR, 10, 5, NULL);
+    CHORD_TEST_ASSERT_EQ(recv_response(client, buf, &view), NET_ERR_OK, "Still serving");
+    CHORD_TEST_ASSERT_EQ(view.node.key, 5, "Served");
+
+    net_server_get_stats(server, &stats);
+    CHORD_TEST_ASSERT_EQ(stats.errors, 2, "Errors counted");
+
+    net_transport_destroy(client);
+    net_server_destroy(server);
+}
+
+static void test_server_io_threads(void) {
+    CHORD_TEST("connections spread over I/O threads");
+
+    probe_t probe = { .read_ms = 0 };
+    net_server_t *server = start_server(3, 2, probe_setup, &probe);
+    net_transport_t *clients[6];
+    uint8_t buf[NET_PROTOCOL_MAX_FRAME];
+    net_frame_view_t view;
+    int answered = 0;
+
+    CHORD_TEST_ASSERT_NOT_NULL(server, "Server started");
+    for (int i = 0; i < 6; i++) {
+        clients[i] = connect_client(server);
+        send_request(clients[i], NET_MSG_FIND_SUCCESSOR, 1, i, NULL);
+    }
+    for (int i = 0; i < 6; i++) {
+        answered += recv_response(clients[i], buf, &view) == NET_ERR_OK && view.node.key == i;
+    }
+    CHORD_TEST_ASSERT_EQ(answered, 6, "Every connection served");
+
+    /* Hanging up with a request in flight must not upset the server */
+    send_request(clients[0], NET_MSG_FIND_SUCCESSOR, 2, 1, NULL);
+    for (int i = 0; i < 6; i++) {
+        net_transport_destroy(clients[i]);
+    }
+    net_server_destroy(server);
+}
+
+static int fat_successor(void *context, const net_frame_view_t *request, net_message_t *response) {
+    char url[NET_PROTOCOL_MAX_URL];
+
+    (void)context;
+    memset(url, 'u', sizeof(url) - 1);
+    url[sizeof(url) - 1] = '\0';
+    response->payload.get_node_resp.has_node = 1;
+    net_protocol_copy_node_addr(&response->payload.get_node_resp.node, "fat", (int)request->header.request_id, url);
+    return NET_ERR_OK;
+}
+
+static void batch_setup(net_server_t *server, void *context) {
+    probe_setup(server, context);
+    net_server_handle(server, NET_MSG_GET_SUCCESSOR, NET_SERVER_READ, fat_successor, NULL);
+}
+
+static void test_server_batch(void) {
+    CHORD_TEST("BATCH records answered together in BATCH_RESPONSE frames");
+
+    probe_t probe = { .read_ms = 0 };
+    net_server_t *server = start_server(1, 2, batch_setup, &probe);
+    net_transport_t *client = connect_client(server);
+    uint8_t buf[NET_PROTOCOL_MAX_FRAME];
+    uint8_t record[NET_PROTOCOL_MAX_FRAME];
+    net_frame_view_t view;
+    net_frame_view_t answer;
+    net_node_addr_t node;
+    net_server_stats_t stats;
+    net_batch_t batch;
+    const uint8_t *next;
+    size_t next_len;
+    size_t offset = 0;
+    int record_len;
+    int len;
+    int keys = 0;
+    int answered = 0;
+
+    CHORD_TEST_ASSERT_NOT_NULL(client, "Client connected");
+    net_protocol_copy_node_addr(&node, "n", 3, "tcp://n:1");
+    net_protocol_batch_init(&batch);
+    for (uint32_t i = 0; i < 4; i++) {
+        record_len = net_protocol_encode_request(record, sizeof(record), NET_MSG_FIND_SUCCESSOR, 100 + i,
+                                                 (int)i + 2, NULL);
+        net_protocol_batch_add(&batch, record, (size_t)record_len);
+    }
+    record_len = net_protocol_encode_request(record, sizeof(record), NET_MSG_NOTIFY, 104, 0, &node);
+    net_protocol_batch_add(&batch, record, (size_t)record_len);
+    record_len = net_protocol_encode_request(record, sizeof(record), NET_MSG_PING, 105, 0, NULL);
+    net_protocol_batch_add(&batch, record, (size_t)record_len);
+    len = net_protocol_encode_batch(buf, sizeof(buf), NET_MSG_BATCH, 100, &batch);
+    net_transport_send(client, buf, (size_t)len, TEST_TIMEOUT_MS);
+
+    CHORD_TEST_ASSERT_EQ(recv_response(client, buf, &view), NET_ERR_OK, "Answered");
+    CHORD_TEST_ASSERT_EQ(view.header.msg_type, NET_MSG_BATCH_RESPONSE, "One BATCH_RESPONSE");
+    CHORD_TEST_ASSERT_EQ(view.header.request_id, 100, "Echoing the batch's ID");
+    CHORD_TEST_ASSERT_EQ((int)view.count, 6, "A record per request");
+    while (net_protocol_batch_next(view.frame, view.frame_len, &offset, &next, &next_len)) {
+        net_protocol_decode_view(&answer, next, next_len);
+        if (answer.header.msg_type == NET_MSG_FIND_SUCCESSOR_RESPONSE &&
+            answer.header.request_id == (uint32_t)(100 + keys) && answer.node.key == keys + 2) {
+            keys++;
+        }
+        else if (answer.header.msg_type == NET_MSG_NOTIFY_RESPONSE) {
+            CHORD_TEST_ASSERT_EQ(answer.success, 1, "Writer ran");
+        }
+        else {
+            CHORD_TEST_ASSERT_TRUE(answer.header.msg_type == NET_MSG_ERROR && answer.header.request_id == 105,
+                                   "Unregistered record refused on its own");
+        }
+    }
+    CHORD_TEST_ASSERT_EQ(keys, 4, "Readers answered in order");
+
+    /* Responses too large for one frame continue in further ones */
+    net_protocol_batch_init(&batch);
+    for (uint32_t i = 0; i < NET_PROTOCOL_MAX_BATCH; i++) {
+        record_len = net_protocol_encode_request(record, sizeof(record), NET_MSG_GET_SUCCESSOR, 200 + i, 0, NULL);
+        net_protocol_batch_add(&batch, record, (size_t)record_len);
+    }
+    len = net_protocol_encode_batch(buf, sizeof(buf), NET_MSG_BATCH, 200, &batch);
+    net_transport_send(client, buf, (size_t)len, TEST_TIMEOUT_MS);
+    for (int frames = 0; answered < NET_PROTOCOL_MAX_BATCH && frames < NET_PROTOCOL_MAX_BATCH; frames++) {
+        CHORD_TEST_ASSERT_EQ(recv_response(client, buf, &view), NET_ERR_OK, "Answered");
+        CHORD_TEST_ASSERT_EQ(view.header.request_id, 200, "Every frame echoes the batch's ID");
+        offset = 0;
+        while (net_protocol_batch_next(view.frame, view.frame_len, &offset, &next, &next_len)) {
+            net_protocol_decode_view(&answer, next, next_len);
+            answered += answer.has_node && answer.node.key == 200 + answered;
+        }
+    }
+    CHORD_TEST_ASSERT_EQ(answered, NET_PROTOCOL_MAX_BATCH, "Every record answered, in order");
+
+    net_server_get_stats(server, &stats);
+    CHORD_TEST_ASSERT_EQ(stats.batches, 2, "Batches counted");
+    CHORD_TEST_ASSERT_EQ(stats.requests, 6 + NET_PROTOCOL_MAX_BATCH, "Records counted as requests");
+    CHORD_TEST_ASSERT_EQ(stats.errors, 1, "Refused record counted");
+
+    net_transport_destroy(client);
+    net_server_destroy(server);
+}
+
+/*
+ * Node service
+ */
+
+static void test_node_service(void) {
+    CHORD_TEST("node service answers from core nodes");
+
+    Node *a = node_init("alpha");
+    Node *b = node_init("bravo");
+    net_server_config_t config;
+    net_server_t *server;
+    net_node_service_t *service;
+    net_transport_t *client;
+    uint8_t buf[NET_PROTOCOL_MAX_FRAME];
+    net_frame_view_t view;
+    net_node_addr_t addr;
+
+    node_create(a);
+    node_join(a, b);
+    for (int i = 0; i < 3; i++) {
+        node_stabilise(a);
+        node_stabilise(b);
+        node_fix_fingers(a);
+        node_fix_fingers(b);
+    }
+
+    net_server_config_default(&config);
+    server = net_server_create(&config);
+    net_server_listen(server, "tcp://127.0.0.1:0");
+    service = net_node_service_create(server, a);
+    CHORD_TEST_ASSERT_NOT_NULL(service, "Service bound");
+    CHORD_TEST_ASSERT_EQ(net_server_start(server), 0, "Started");
+    client = connect_client(server);
+
+    send_request(client, NET_MSG_FIND_SUCCESSOR, 1, b->key, NULL);
+    CHORD_TEST_ASSERT_EQ(recv_response(client, buf, &view), NET_ERR_OK, "Lookup answered");
+    CHORD_TEST_ASSERT_EQ(view.node.key, node_find_successor(a, b->key)->key, "Same as the local lookup");
+    CHORD_TEST_ASSERT_TRUE(view.node.url_len == strlen(net_server_url(server)), "Named by the server URL");
+
+    send_request(client, NET_MSG_CLOSEST_PRECEDING, 2, b->key, NULL);
+    CHORD_TEST_ASSERT_EQ(recv_response(client, buf, &view), NET_ERR_OK, "Closest preceding answered");
+    CHORD_TEST_ASSERT_EQ(view.node.key, node_closest_preceding_node(a, b->key)->key, "Same as local");
+
+    send_request(client, NET_MSG_GET_SUCCESSOR, 3, 0, NULL);
+    CHORD_TEST_ASSERT_EQ(recv_response(client, buf, &view), NET_ERR_OK, "Successor answered");
+    CHORD_TEST_ASSERT_TRUE(view.has_node && view.node.key == a->successor->key, "Successor");
+
+    send_request(client, NET_MSG_PING, 4, 0, NULL);
+    CHORD_TEST_ASSERT_EQ(recv_response(client, buf, &view), NET_ERR_OK, "Ping answered");
+    CHORD_TEST_ASSERT_TRUE(view.alive == 1 && view.state == NODE_STATE_RUNNING, "Alive");
+
+    a->predecessor = NULL;
+    net_protocol_copy_node_addr(&addr, b->id, b->key, "tcp://127.0.0.1:1");
+    send_request(client, NET_MSG_NOTIFY, 5, 0, &addr);
+    CHORD_TEST_ASSERT_EQ(recv_response(client, buf, &view), NET_ERR_OK, "Notify answered");
+    CHORD_TEST_ASSERT_TRUE(view.success == 1, "Notify accepted");
+
+    send_request(client, NET_MSG_GET_PREDECESSOR, 6, 0, NULL);
+    CHORD_TEST_ASSERT_EQ(recv_response(client, buf, &view), NET_ERR_OK, "Predecessor answered");
+    CHORD_TEST_ASSERT_TRUE(view.has_node && view.node.key == b->key, "Notify took effect");
+
+    addr.key = 0;
+    while (addr.key == a->key || addr.key == b->key) {
+        addr.key++;
+    }
+    send_request(client, NET_MSG_NOTIFY, 7, 0, &addr);
+    CHORD_TEST_ASSERT_EQ(recv_response(client, buf, &view), NET_ERR_OK, "Answered");
+    CHORD_TEST_ASSERT_TRUE(view.header.msg_type == NET_MSG_ERROR &&
+                           view.error_code == NET_ERR_NODE_NOT_FOUND, "Unknown node refused");
+
+    net_transport_destroy(client);
+    net_server_destroy(server);
+    net_node_service_destroy(service);
+}
+
+/* A ring with every node behind its own server */
+#define LOOKUP_NODES 16
+
+typedef struct {
+    Node *nodes[LOOKUP_NODES];
+    net_server_t *servers[LOOKUP_NODES];
+    net_node_service_t *services[LOOKUP_NODES];
+} lookup_ring_t;
+
+static const char* lookup_resolve(void *context, const Node *node) {
+    lookup_ring_t *ring = (lookup_ring_t*)context;
+
+    for (int i = 0; i < LOOKUP_NODES; i++) {
+        if (ring->nodes[i] == node) {
+            return net_server_url(ring->servers[i]);
+        }
+    }
+    return NULL;
+}
+
+#define LOOKUP_THREADS 4
+
+typedef struct {
+    lookup_ring_t *ring;
+    int first;
+    int mismatches;
+} lookup_worker_t;
+
+/* Every fourth key from first, both modes, all from the first node */
+static void* lookup_worker(void *arg) {
+    lookup_worker_t *worker = (lookup_worker_t*)arg;
+    lookup_ring_t *ring = worker->ring;
+    net_node_addr_t result;
+
+    for (int key = worker->first; key < 256; key += LOOKUP_THREADS) {
+        Node *expected = node_find_successor(ring->nodes[0], key);
+
+        for (int mode = 0; mode < 2; mode++) {
+            if (net_node_service_lookup(ring->services[0], key,
+                                        mode ? NET_LOOKUP_RECURSIVE : NET_LOOKUP_ITERATIVE,
+                                        TEST_TIMEOUT_MS, &result, NULL) != NET_ERR_OK ||
+                result.key != expected->key) {
+                worker->mismatches++;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void test_node_lookup_modes(void) {
+    CHORD_TEST("iterative and recursive lookups match node_find_successor");
+
+    static char names[LOOKUP_NODES][16];
+    lookup_ring_t ring;
+    net_server_config_t config;
+    net_server_stats_t stats;
+    net_node_addr_t result;
+    int mismatches = 0;
+    int longer = 0;
+    int max_hops = 0;
+
+    for (int i = 0; i < LOOKUP_NODES; i++) {
+        snprintf(names[i], sizeof(names[i]), "%d-lookup", i);
+        ring.nodes[i] = node_init(names[i]);
+        if (i == 0) {
+            node_create(ring.nodes[0]);
+        } else {
+            node_join(ring.nodes[0], ring.nodes[i]);
+            node_stabilise(ring.nodes[i]);
+            node_fix_fingers(ring.nodes[i]);
+        }
+    }
+    for (int round = 0; round < 2 * LOOKUP_NODES; round++) {
+        for (int i = 0; i < LOOKUP_NODES; i++) {
+            node_stabilise(ring.nodes[i]);
+            node_fix_fingers(ring.nodes[i]);
+        }
+    }
+
+    net_server_config_default(&config);
+    config.workers = 2;
+    for (int i = 0; i < LOOKUP_NODES; i++) {
+        ring.servers[i] = net_server_create(&config);
+        net_server_listen(ring.servers[i], "tcp://127.0.0.1:0");
+        ring.services[i] = net_node_service_create(ring.servers[i], ring.nodes[i]);
+        net_node_service_set_resolver(ring.services[i], lookup_resolve, &ring);
+    }
+    for (int i = 0; i < LOOKUP_NODES; i++) {
+        CHORD_TEST_ASSERT_EQ(net_server_start(ring.servers[i]), 0, "Started");
+    }
+
+    for (int key = 0; key < 256; key += 5) {
+        Node *origin = ring.nodes[key % LOOKUP_NODES];
+        Node *expected = node_find_successor(origin, key);
+        int iterative_hops = -1;
+        int recursive_hops = -1;
+
+        if (net_node_service_lookup(ring.services[key % LOOKUP_NODES], key, NET_LOOKUP_ITERATIVE,
+                                    TEST_TIMEOUT_MS, &result, &iterative_hops) != NET_ERR_OK ||
+            result.key != expected->key ||
+            strcmp(result.url, lookup_resolve(&ring, expected)) != 0) {
+            mismatches++;
+        }
+        if (net_node_service_lookup(ring.services[key % LOOKUP_NODES], key, NET_LOOKUP_RECURSIVE,
+                                    TEST_TIMEOUT_MS, &result, &recursive_hops) != NET_ERR_OK ||
+            result.key != expected->key ||
+            strcmp(result.url, lookup_resolve(&ring, expected)) != 0) {
+            mismatches++;
+        }
+        if (recursive_hops != iterative_hops) {
+            longer++;
+        }
+        if (recursive_hops > max_hops) {
+            max_hops = recursive_hops;
+        }
+    }
+    CHORD_TEST_ASSERT_EQ(mismatches, 0, "Both modes find the local answer");
+    CHORD_TEST_ASSERT_EQ(longer, 0, "Both modes take the same route");
+    CHORD_TEST_ASSERT_TRUE(max_hops > 1, "Some lookups cross several nodes");
+
+    /* Lookups from several threads share the origin's links */
+    pthread_t threads[LOOKUP_THREADS];
+    lookup_worker_t workers[LOOKUP_THREADS];
+
+    mismatches = 0;
+    for (int t = 0; t < LOOKUP_THREADS; t++) {
+        workers[t] = (lookup_worker_t){ &ring, t, 0 };
+        pthread_create(&threads[t], NULL, lookup_worker, &workers[t]);
+    }
+    for (int t = 0; t < LOOKUP_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        mismatches += workers[t].mismatches;
+    }
+    CHORD_TEST_ASSERT_EQ(mismatches, 0, "Concurrent lookups all answered");
+
+    for (int i = 0; i < LOOKUP_NODES; i++) {
+        net_server_get_stats(ring.servers[i], &stats);
+        CHORD_TEST_ASSERT_EQ(stats.errors, 0, "One-way messages are not answered");
+    }
+    for (int i = 0; i < LOOKUP_NODES; i++) {
+        net_server_destroy(ring.servers[i]);
+        net_node_service_destroy(ring.services[i]);
+    }
+}
+
+/* Fresh nodes joined through the first one, no stabilization yet;
+ * keys are kept apart from every node already in the ring */
+static void stabilise_ring_start(lookup_ring_t *ring, char names[][16], const char *tag) {
+    net_server_config_t config;
+    Ring *all = ring_get();
+
+    for (int i = 0, n = 0; i < LOOKUP_NODES; n++) {
+        int key;
+        int taken = 0;
+
+        snprintf(names[i], 16, "%d-%s", n, tag);
+        key = chord_hash(names[i]);
+        for (unsigned j = 0; j < all->size; j++) {
+            taken |= all->nodes[j]->key == key;
+        }
+        if (taken) {
+            continue;
+        }
+        ring->nodes[i] = node_init(names[i]);
+        if (i == 0) {
+            node_create(ring->nodes[0]);
+        } else {
+            node_join(ring->nodes[0], ring->nodes[i]);
+        }
+        i++;
+    }
+
+    net_server_config_default(&config);
+    config.workers = 2;
+    for (int i = 0; i < LOOKUP_NODES; i++) {
+        ring->servers[i] = net_server_create(&config);
+        net_server_listen(ring->servers[i], "tcp://127.0.0.1:0");
+        ring->services[i] = net_node_service_create(ring->servers[i], ring->nodes[i]);
+        net_node_service_set_resolver(ring->services[i], lookup_resolve, ring);
+        net_server_start(ring->servers[i]);
+    }
+}
+
+/* 1 once every successor list names the next nodes by key */
+static int stabilise_converged(const lookup_ring_t *ring) {
+    for (int i = 0; i < LOOKUP_NODES; i++) {
+        const Node *node = ring->nodes[i];
+        const Node *expected = node;
+
+        for (int s = 0; s < SUCCESSOR_LIST_SIZE; s++) {
+            const Node *next = NULL;
+
+            for (int j = 0; j < LOOKUP_NODES; j++) {
+                const Node *other = ring->nodes[j];
+
+                if (other != expected && (!next
+                    || (other->key - expected->key + 256) % 256 < (next->key - expected->key + 256) % 256)) {
+                    next = other;
+                }
+            }
+            expected = next;
+            if (node->successors[s] != expected || (s == 0 && node->successor != expected)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* Stabilization periods (every node once) until converged; sets the
+ * round trips they took, and the most one node took in one period */
+static int stabilise_periods(lookup_ring_t *ring, net_stabilise_mode_t mode, int *trips, int *most) {
+    int periods = 0;
+
+    *trips = 0;
+    *most = 0;
+    while (!stabilise_converged(ring) && periods < 4 * LOOKUP_NODES) {
+        /* The first node last, so it is not alone when it stabilises
+         * (it would become its own predecessor, as in the core) */
+        for (int i = LOOKUP_NODES - 1; i >= 0; i--) {
+            int used = 0;
+
+            if (net_node_service_stabilise(ring->services[i], mode, TEST_TIMEOUT_MS, &used) != NET_ERR_OK) {
+                return -1;
+            }
+            *trips += used;
+            *most = used > *most ? used : *most;
+        }
+        periods++;
+    }
+    return periods;
+}
+
+static void test_node_stabilise_modes(void) {
+    CHORD_TEST("STABILIZE converges a ring in one round trip per node and period");
+
+    static char names[2][LOOKUP_NODES][16];
+    lookup_ring_t rings[2];
+    int periods[2];
+    int trips[2];
+    int most[2];
+
+    for (int mode = 0; mode < 2; mode++) {
+        stabilise_ring_start(&rings[mode], names[mode], mode ? "sep" : "comb");
+        periods[mode] = stabilise_periods(&rings[mode],
+                                          mode ? NET_STABILISE_SEPARATE : NET_STABILISE_COMBINED,
+                                          &trips[mode], &most[mode]);
+        if (mode == 0) {
+            int settled = 0;
+
+            for (int i = 0; i < LOOKUP_NODES; i++) {
+                int used = 0;
+
+                net_node_service_stabilise(rings[0].services[i], NET_STABILISE_COMBINED, TEST_TIMEOUT_MS, &used);
+                settled += used;
+            }
+            CHORD_TEST_ASSERT_EQ(settled, LOOKUP_NODES, "Settled ring: one round trip per node");
+        }
+        for (int i = 0; i < LOOKUP_NODES; i++) {
+            net_server_destroy(rings[mode].servers[i]);
+            net_node_service_destroy(rings[mode].services[i]);
+        }
+    }
+    CHORD_TEST_ASSERT_TRUE(periods[0] > 0 && stabilise_converged(&rings[0]), "Combined mode converges");
+    CHORD_TEST_ASSERT_TRUE(periods[1] > 0 && stabilise_converged(&rings[1]), "Separate mode converges");
+    CHORD_TEST_ASSERT_EQ(most[0], 2, "At most two round trips, while converging");
+    CHORD_TEST_ASSERT_EQ(most[1], SUCCESSOR_LIST_SIZE + 1, "Separate: list size + 1 round trips");
+    CHORD_TEST_ASSERT_TRUE(trips[0] * 2 < trips[1], "Combined converges on far fewer messages");
+    printf("    combined: %d periods, %d trips; separate: %d periods, %d trips\n",
+           periods[0], trips[0], periods[1], trips[1]);
+}
+
+int main(void) {
+    CHORD_TEST_INIT();
+
+    CHORD_RUN_TEST(test_server_parallel_readers);
+    CHORD_RUN_TEST(test_server_exclusive_writers);
+    CHORD_RUN_TEST(test_server_steals);
+    CHORD_RUN_TEST(test_server_errors);
+    CHORD_RUN_TEST(test_server_io_threads);
+    CHORD_RUN_TEST(test_server_batch);
+    CHORD_RUN_TEST(test_node_service);
+    CHORD_RUN_TEST(test_node_lookup_modes);
+    CHORD_RUN_TEST(test_node_stabilise_modes);
+
+    CHORD_TEST_FINI();
+}
@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../chord_test.h"
+#include "../../src/net/net_shards.h"
+
+/*
+ * Unit tests for net_shards.c - sharded node runtime
+ *
+ * Tests cover:
+ * - Nodes placed on the shard owning their key range
+ * - Lookups crossing shards agree with node_find_successor
+ * - Lookups submitted from a shard's own callbacks
+ * - Stop and restart with lookups in between
+ */
+
+#define SHARD_COUNT 4
+#define SHARD_NODES 64
+#define WAIT_MS 5000
+
+typedef struct {
+    _Atomic int done;
+    _Atomic int errors;
+    _Atomic int crossings;
+} tally_t;
+
+typedef struct {
+    net_shard_lookup_t lookup;
+    tally_t *tally;
+    int expected;
+    int matched;
+} probe_t;
+
+static void sleep_ms(int ms) {
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+static int wait_done(tally_t *tally, int count) {
+    for (int waited = 0; waited < WAIT_MS && atomic_load(&tally->done) < count; waited++) {
+        sleep_ms(1);
+    }
+    return atomic_load(&tally->done);
+}
+
+static void on_lookup(net_shard_lookup_t *lookup, int error) {
+    probe_t *probe = (probe_t*)lookup->context;
+
+    probe->matched = error == NET_ERR_OK && lookup->result->key == probe->expected;
+    if (error != NET_ERR_OK) {
+        atomic_fetch_add(&probe->tally->errors, 1);
+    }
+    atomic_fetch_add(&probe->tally->crossings, lookup->crossings);
+    atomic_fetch_add(&probe->tally->done, 1);
+}
+
+static net_shards_t* make_ring(Node **nodes, const char *suffix) {
+    net_shards_t *shards = net_shards_create(SHARD_COUNT, "tcp://10.0.0.7:6000");
+    char id[32];
+
+    for (int i = 0; i < SHARD_NODES; i++) {
+        snprintf(id, sizeof(id), "%d-%s", i, suffix);
+        nodes[i] = net_shards_spawn(shards, id);
+        if (i == 0) {
+            node_create(nodes[0]);
+        } else {
+            node_join(nodes[0], nodes[i]);
+            node_stabilise(nodes[i]);
+            node_fix_fingers(nodes[i]);
+        }
+    }
+    for (int round = 0; round < 2 * SHARD_NODES; round++) {
+        for (int i = 0; i < SHARD_NODES; i++) {
+            node_stabilise(nodes[i]);
+            node_fix_fingers(nodes[i]);
+        }
+    }
+    return shards;
+}
+
+static void test_shards_placement(void) {
+    CHORD_TEST("nodes live on the shard owning their key");
+
+    Node *nodes[SHARD_NODES];
+    net_shards_t *shards = make_ring(nodes, "place");
+    int placed = 0;
+    int used[SHARD_COUNT] = { 0 };
+
+    CHORD_TEST_ASSERT_NOT_NULL(shards, "Shards created");
+    for (int i = 0; i < SHARD_NODES; i++) {
+        unsigned owner = net_shards_owner(shards, nodes[i]->key);
+        net_host_t *host = net_shards_host(shards, owner);
+
+        if (net_host_node_url(host, nodes[i]) != NULL) {
+            placed++;
+        }
+        used[owner] = 1;
+    }
+    CHORD_TEST_ASSERT_EQ(placed, SHARD_NODES, "Every node on its key's shard");
+    CHORD_TEST_ASSERT_EQ(used[0] + used[1] + used[2] + used[3], SHARD_COUNT, "Every shard has nodes");
+    CHORD_TEST_ASSERT_EQ(net_shards_owner(shards, 0), 0, "Lowest key, first shard");
+    CHORD_TEST_ASSERT_EQ(net_shards_owner(shards, ring_key_max() - 1), SHARD_COUNT - 1,
+                         "Highest key, last shard");
+
+    net_shards_destroy(shards);
+}
+
+static void test_shards_lookups(void) {
+    CHORD_TEST("lookups across shards match node_find_successor");
+
+    static probe_t probes[SHARD_NODES * 16];
+    Node *nodes[SHARD_NODES];
+    net_shards_t *shards = make_ring(nodes, "route");
+    net_shard_stats_t stats;
+    tally_t tally = { 0 };
+    int count = (int)(sizeof(probes) / sizeof(probes[0]));
+    int matched = 0;
+    uint64_t completed = 0;
+    uint64_t received = 0;
+
+    for (int i = 0; i < count; i++) {
+        Node *origin = nodes[i % SHARD_NODES];
+        int key = (i * 37 + 5) % ring_key_max();
+
+        probes[i].tally = &tally;
+        probes[i].expected = node_find_successor(origin, key)->key;
+    }
+    CHORD_TEST_ASSERT_EQ(net_shards_lookup(shards, nodes[0], 1, &probes[0].lookup, on_lookup, &probes[0]),
+                         NET_ERR_CONNECTION_CLOSED, "Refused before start");
+    CHORD_TEST_ASSERT_EQ(net_shards_start(shards), 0, "Started");
+    CHORD_TEST_ASSERT_TRUE(net_shards_spawn(shards, "late") == NULL, "No spawning while running");
+
+    for (int i = 0; i < count; i++) {
+        net_shards_lookup(shards, nodes[i % SHARD_NODES], (i * 37 + 5) % ring_key_max(),
+                          &probes[i].lookup, on_lookup, &probes[i]);
+    }
+    CHORD_TEST_ASSERT_EQ(wait_done(&tally, count), count, "Every lookup completed");
+    net_shards_stop(shards);
+
+    for (int i = 0; i < count; i++) {
+        matched += probes[i].matched;
+    }
+    for (unsigned s = 0; s < SHARD_COUNT; s++) {
+        net_shards_get_stats(shards, s, &stats);
+        completed += stats.completed;
+        received += stats.received;
+    }
+    CHORD_TEST_ASSERT_EQ(matched, count, "Same successor as node_find_successor");
+    CHORD_TEST_ASSERT_EQ(atomic_load(&tally.errors), 0, "No errors");
+    CHORD_TEST_ASSERT_TRUE(atomic_load(&tally.crossings) > 0, "Lookups crossed shards");
+    CHORD_TEST_ASSERT_EQ((int)completed, count, "Completions counted");
+    CHORD_TEST_ASSERT_EQ((int)received, count + atomic_load(&tally.crossings),
+                         "One inbox message per submit and crossing");
+
+    net_shards_destroy(shards);
+}
+
+typedef struct {
+    net_shard_lookup_t lookup;
+    net_shards_t *shards;
+    Node *origin;
+    _Atomic int left;
+    _Atomic int links;
+    _Atomic int done;
+} chain_t;
+
+static void on_chain(net_shard_lookup_t *lookup, int error) {
+    chain_t *chain = (chain_t*)lookup->context;
+
+    atomic_fetch_add(&chain->links, 1);
+    if (error == NET_ERR_OK && atomic_fetch_sub(&chain->left, 1) > 1) {
+        /* Reuse the finished lookup from the shard's own thread */
+        net_shards_lookup(chain->shards, chain->origin, (lookup->key + 29) % ring_key_max(),
+                          lookup, on_chain, chain);
+        return;
+    }
+    atomic_store(&chain->done, 1);
+}
+
+static void test_shards_chained(void) {
+    CHORD_TEST("lookups started from callbacks, and a restart");
+
+    Node *nodes[SHARD_NODES];
+    net_shards_t *shards = make_ring(nodes, "chain");
+    chain_t chain;
+
+    memset(&chain, 0, sizeof(chain));
+    chain.shards = shards;
+    chain.origin = nodes[5];
+
+    for (int run = 0; run < 2; run++) {
+        CHORD_TEST_ASSERT_EQ(net_shards_start(shards), 0, "Started");
+        atomic_store(&chain.left, 100);
+        atomic_store(&chain.done, 0);
+        net_shards_lookup(shards, chain.origin, 3, &chain.lookup, on_chain, &chain);
+        for (int waited = 0; waited < WAIT_MS && !atomic_load(&chain.done); waited++) {
+            sleep_ms(1);
+        }
+        CHORD_TEST_ASSERT_EQ(atomic_load(&chain.done), 1, "Chain finished");
+        net_shards_stop(shards);
+    }
+    CHORD_TEST_ASSERT_EQ(atomic_load(&chain.links), 200, "Every link ran, both runs");
+
+    net_shards_destroy(shards);
+}
+
+int main(void) {
+    CHORD_TEST_INIT();
+
+    CHORD_RUN_TEST(test_shards_placement);
+    CHORD_RUN_TEST(test_shards_lookups);
+    CHORD_RUN_TEST(test_shards_chained);
+
+    CHORD_TEST_FINI();
+}
@@ -0,0 +1,463 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "../chord_test.h"
+#include "../../src/net/net_transport.h"
+
+/*
+ * Unit tests for net_transport.c - TCP and Unix socket transport
+ *
+ * Tests cover:
+ * - Round trips over TCP loopback and Unix domain sockets
+ * - Shared-memory rings between two processes
+ * - Framing: back-to-back, empty, oversized and 512 KB frames
+ * - Timeouts, refused connections, hang-ups and bad URLs
+ * - Loop-driven listener accepting 1000 connections
+ * - io_uring backend: coalesced bursts, timeouts, big frames, hang-ups
+ */
+
+#define TEST_TIMEOUT_MS 2000
+
+static void ipc_url(char *url, size_t size, const char *name) {
+    snprintf(url, size, "ipc:///tmp/chord_test_%s_%d.sock", name, (int)getpid());
+}
+
+/* Connect a client to listener and accept its server side */
+static int make_pair(net_transport_listener_t *listener,
+                     net_transport_t **client, net_transport_t **server) {
+    *client = net_transport_create(listener->type);
+    if (net_transport_connect(*client, net_transport_listener_url(listener), TEST_TIMEOUT_MS) != 0) {
+        return -1;
+    }
+    *server = net_transport_listener_accept(listener, TEST_TIMEOUT_MS);
+    return *server ? 0 : -1;
+}
+
+static int round_trip(net_transport_type_t type, const char *url) {
+    net_transport_listener_t *listener = net_transport_listener_create(type);
+    net_transport_t *client = NULL;
+    net_transport_t *server = NULL;
+    char buf[64];
+    int ok;
+
+    ok = net_transport_listener_listen(listener, url) == 0 &&
+         make_pair(listener, &client, &server) == 0 &&
+         net_transport_send(client, "ping", 4, TEST_TIMEOUT_MS) == 0 &&
+         net_transport_recv(server, buf, sizeof(buf), TEST_TIMEOUT_MS) == 4 &&
+         memcmp(buf, "ping", 4) == 0 &&
+         net_transport_send(server, "pong!", 5, TEST_TIMEOUT_MS) == 0 &&
+         net_transport_recv(client, buf, sizeof(buf), TEST_TIMEOUT_MS) == 5 &&
+         memcmp(buf, "pong!", 5) == 0;
+
+    net_transport_destroy(client);
+    net_transport_destroy(server);
+    net_transport_listener_destroy(listener);
+    return ok;
+}
+
+static void test_transport_round_trip(void) {
+    CHORD_TEST("round trips over TCP and Unix sockets");
+
+    net_transport_listener_t *listener = net_transport_listener_create(NET_TRANSPORT_TCP);
+    char url[NET_TRANSPORT_MAX_URL];
+
+    CHORD_TEST_ASSERT_EQ(net_transport_listener_listen(listener, "tcp://127.0.0.1:0"), 0, "Listen");
+    CHORD_TEST_ASSERT_TRUE(strncmp(net_transport_listener_url(listener), "tcp://127.0.0.1:", 16) == 0,
+                           "Bound URL keeps host");
+    CHORD_TEST_ASSERT_TRUE(strcmp(net_transport_listener_url(listener), "tcp://127.0.0.1:0") != 0,
+                           "Bound URL has the chosen port");
+    net_transport_listener_destroy(listener);
+
+    CHORD_TEST_ASSERT_TRUE(round_trip(NET_TRANSPORT_TCP, "tcp://127.0.0.1:0"), "TCP round trip");
+
+    ipc_url(url, sizeof(url), "rt");
+    CHORD_TEST_ASSERT_TRUE(round_trip(NET_TRANSPORT_IPC, url), "IPC round trip");
+    CHORD_TEST_ASSERT_TRUE(access(url + 6, F_OK) != 0, "Socket file removed on stop");
+}
+
+typedef struct {
+    net_transport_t *transport;
+    size_t len;
+    int result;
+} big_send_t;
+
+static void* big_sender(void *arg) {
+    big_send_t *job = (big_send_t*)arg;
+    uint8_t *data = (uint8_t*)malloc(job->len);
+
+    for (size_t i = 0; i < job->len; i++) {
+        data[i] = (uint8_t)(i * 31u);
+    }
+    job->result = net_transport_send(job->transport, data, job->len, TEST_TIMEOUT_MS);
+    free(data);
+    return NULL;
+}
+
+static void test_transport_framing(void) {
+    CHORD_TEST("frames survive stream splitting and merging");
+
+    net_transport_listener_t *listener = net_transport_listener_create(NET_TRANSPORT_IPC);
+    net_transport_t *client;
+    net_transport_t *server;
+    static uint8_t big[512 * 1024];
+    char url[NET_TRANSPORT_MAX_URL];
+    char buf[64];
+    char tiny[2];
+    pthread_t thread;
+    big_send_t job;
+
+    ipc_url(url, sizeof(url), "frame");
+    net_transport_listener_listen(listener, url);
+    CHORD_TEST_ASSERT_EQ(make_pair(listener, &client, &server), 0, "Connected");
+
+    /* Several frames in one burst arrive one per recv */
+    for (int i = 0; i < 10; i++) {
+        snprintf(buf, sizeof(buf), "frame-%d", i);
+        CHORD_TEST_ASSERT_EQ(net_transport_send(client, buf, strlen(buf), 0), 0, "Burst send");
+    }
+    for (int i = 0; i < 10; i++) {
+        char expect[16];
+        int n = net_transport_recv(server, buf, sizeof(buf), TEST_TIMEOUT_MS);
+        snprintf(expect, sizeof(expect), "frame-%d", i);
+        CHORD_TEST_ASSERT_EQ(n, (int)strlen(expect), "Frame length");
+        CHORD_TEST_ASSERT_TRUE(memcmp(buf, expect, (size_t)n) == 0, "Frame content");
+    }
+
+    /* Empty frame */
+    CHORD_TEST_ASSERT_EQ(net_transport_send(client, NULL, 0, 0), 0, "Empty send");
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(server, buf, sizeof(buf), TEST_TIMEOUT_MS), 0, "Empty recv");
+
+    /* Too large for the caller's buffer: dropped, stream stays in sync */
+    net_transport_send(client, "toolong", 7, 0);
+    net_transport_send(client, "ok", 2, 0);
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(server, tiny, sizeof(tiny), TEST_TIMEOUT_MS), -1, "Oversized");
+    CHORD_TEST_ASSERT_EQ(errno, EMSGSIZE, "EMSGSIZE");
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(server, tiny, sizeof(tiny), TEST_TIMEOUT_MS), 2, "Next frame");
+
+    /* Larger than the socket buffers: needs partial writes and reads */
+    job.transport = client;
+    job.len = sizeof(big);
+    pthread_create(&thread, NULL, big_sender, &job);
+    int n = net_transport_recv(server, big, sizeof(big), TEST_TIMEOUT_MS);
+    pthread_join(thread, NULL);
+    CHORD_TEST_ASSERT_EQ(job.result, 0, "Big send");
+    CHORD_TEST_ASSERT_EQ(n, (int)sizeof(big), "Big recv");
+    for (size_t i = 0; i < sizeof(big); i++) {
+        CHORD_TEST_ASSERT_EQ(big[i], (uint8_t)(i * 31u), "Big content");
+    }
+
+    CHORD_TEST_ASSERT_EQ(net_transport_send(client, big, NET_TRANSPORT_MAX_FRAME + 1, 0), -1, "Over limit");
+    CHORD_TEST_ASSERT_EQ(errno, EMSGSIZE, "Send EMSGSIZE");
+
+    net_transport_destroy(client);
+    net_transport_destroy(server);
+    net_transport_listener_destroy(listener);
+}
+
+static void test_transport_errors(void) {
+    CHORD_TEST("timeouts, refusals and hang-ups");
+
+    net_transport_listener_t *listener = net_transport_listener_create(NET_TRANSPORT_TCP);
+    net_transport_t *client;
+    net_transport_t *server;
+    char url[NET_TRANSPORT_MAX_URL];
+    char buf[16];
+
+    net_transport_listener_listen(listener, "tcp://127.0.0.1:0");
+    CHORD_TEST_ASSERT_EQ(make_pair(listener, &client, &server), 0, "Connected");
+
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(server, buf, sizeof(buf), 0), -1, "Nothing yet");
+    CHORD_TEST_ASSERT_EQ(errno, EAGAIN, "Timeout 0 does not wait");
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(server, buf, sizeof(buf), 20), -1, "Times out");
+    CHORD_TEST_ASSERT_EQ(errno, ETIMEDOUT, "ETIMEDOUT");
+    CHORD_TEST_ASSERT_TRUE(net_transport_listener_accept(listener, 20) == NULL, "Accept times out");
+
+    net_transport_close(client);
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(server, buf, sizeof(buf), TEST_TIMEOUT_MS), -1, "Hang-up");
+    CHORD_TEST_ASSERT_EQ(errno, ECONNRESET, "ECONNRESET");
+    CHORD_TEST_ASSERT_TRUE(!server->connected && net_transport_fd(server) == -1, "Closed");
+    CHORD_TEST_ASSERT_EQ(net_transport_send(server, "x", 1, 0), -1, "Send when closed");
+    CHORD_TEST_ASSERT_EQ(errno, ENOTCONN, "ENOTCONN");
+
+    /* Nobody listening any more */
+    snprintf(url, sizeof(url), "%s", net_transport_listener_url(listener));
+    net_transport_listener_stop(listener);
+    CHORD_TEST_ASSERT_EQ(net_transport_connect(client, url, TEST_TIMEOUT_MS), -1, "Refused");
+    CHORD_TEST_ASSERT_EQ(errno, ECONNREFUSED, "ECONNREFUSED");
+
+    CHORD_TEST_ASSERT_EQ(net_transport_connect(client, "ipc:///tmp/x", 0), -1, "Scheme mismatch");
+    CHORD_TEST_ASSERT_EQ(net_transport_connect(client, "tcp://127.0.0.1", 0), -1, "No port");
+    CHORD_TEST_ASSERT_EQ(errno, EINVAL, "EINVAL");
+
+    net_transport_destroy(client);
+    net_transport_destroy(server);
+    net_transport_listener_destroy(listener);
+}
+
+/* Child process: echo frames back until the parent hangs up */
+static int shm_echo_child(const char *url) {
+    static uint8_t buf[NET_TRANSPORT_MAX_FRAME];
+    net_transport_t *transport = net_transport_create(NET_TRANSPORT_SHM);
+    int n;
+
+    if (net_transport_connect(transport, url, TEST_TIMEOUT_MS) != 0) {
+        net_transport_destroy(transport);
+        return 1;
+    }
+    while ((n = net_transport_recv(transport, buf, sizeof(buf), TEST_TIMEOUT_MS)) >= 0) {
+        net_transport_send(transport, buf, (size_t)n, TEST_TIMEOUT_MS);
+    }
+    n = errno == ECONNRESET ? 0 : 2;
+    net_transport_destroy(transport);
+    return n;
+}
+
+static void test_transport_shm(void) {
+    CHORD_TEST("shared-memory rings between processes");
+
+    static uint8_t big[200 * 1024];  /* Larger than a ring: streamed */
+    static uint8_t back[200 * 1024];
+    net_transport_listener_t *listener = net_transport_listener_create(NET_TRANSPORT_SHM);
+    net_transport_t *server;
+    net_loop_t *loop = net_loop_create();
+    char url[NET_TRANSPORT_MAX_URL];
+    char name[NET_TRANSPORT_MAX_URL];
+    char buf[64];
+    int status = -1;
+    pid_t child;
+
+    snprintf(url, sizeof(url), "shm://chord_test_%d", (int)getpid());
+    snprintf(name, sizeof(name), "/chord-chord_test_%d", (int)getpid());
+    CHORD_TEST_ASSERT_EQ(net_transport_listener_listen(listener, url), 0, "Listen");
+    CHORD_TEST_ASSERT_STR_EQ(net_transport_listener_url(listener), url, "URL");
+    CHORD_TEST_ASSERT_EQ(net_transport_listener_attach(listener, loop, NULL, NULL), -1, "No loop support");
+
+    fflush(stdout);
+    child = fork();
+    if (child == 0) {
+        _exit(shm_echo_child(url));
+    }
+
+    server = net_transport_listener_accept(listener, TEST_TIMEOUT_MS);
+    CHORD_TEST_ASSERT_TRUE(server != NULL, "Accepted");
+    CHORD_TEST_ASSERT_EQ(net_transport_fd(server), -1, "No descriptor");
+
+    for (int i = 0; i < 1000; i++) {
+        int n = snprintf(buf, sizeof(buf), "ping-%d", i);
+        CHORD_TEST_ASSERT_EQ(net_transport_send(server, buf, (size_t)n, TEST_TIMEOUT_MS), 0, "Send");
+        CHORD_TEST_ASSERT_EQ(net_transport_recv(server, buf, sizeof(buf), TEST_TIMEOUT_MS), n, "Echo");
+    }
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(server, buf, sizeof(buf), 0), -1, "Nothing pending");
+    CHORD_TEST_ASSERT_EQ(errno, EAGAIN, "EAGAIN");
+
+    for (size_t i = 0; i < sizeof(big); i++) {
+        big[i] = (uint8_t)(i * 7u);
+    }
+    CHORD_TEST_ASSERT_EQ(net_transport_send(server, big, sizeof(big), TEST_TIMEOUT_MS), 0, "Big send");
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(server, back, sizeof(back), TEST_TIMEOUT_MS),
+                         (int)sizeof(back), "Big echo");
+    CHORD_TEST_ASSERT_TRUE(memcmp(big, back, sizeof(big)) == 0, "Big content");
+
+    net_transport_destroy(server);  /* child sees the hang-up and exits */
+    waitpid(child, &status, 0);
+    CHORD_TEST_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "Child saw a clean close");
+
+    net_transport_listener_stop(listener);
+    CHORD_TEST_ASSERT_TRUE(shm_open(name, O_RDONLY, 0) < 0, "Segment removed on stop");
+    server = net_transport_create(NET_TRANSPORT_SHM);
+    CHORD_TEST_ASSERT_EQ(net_transport_connect(server, url, 100), -1, "Refused");
+    CHORD_TEST_ASSERT_EQ(errno, ECONNREFUSED, "ECONNREFUSED");
+
+    net_transport_destroy(server);
+    net_transport_listener_destroy(listener);
+    net_loop_destroy(loop);
+}
+
+#define ACCEPT_CLIENTS 1000
+
+typedef struct {
+    net_transport_t *accepted[ACCEPT_CLIENTS];
+    int count;
+} accept_state_t;
+
+static void on_accept(net_transport_t *client, void *context) {
+    accept_state_t *state = (accept_state_t*)context;
+    if (state->count < ACCEPT_CLIENTS) {
+        state->accepted[state->count++] = client;
+    }
+    else {
+        net_transport_destroy(client);
+    }
+}
+
+static void test_transport_many_connections(void) {
+    CHORD_TEST("loop-driven listener accepts 1000 connections");
+
+    static net_transport_t *clients[ACCEPT_CLIENTS];
+    static accept_state_t state;
+    net_transport_listener_t *listener = net_transport_listener_create(NET_TRANSPORT_TCP);
+    net_loop_t *loop = net_loop_create();
+    char buf[16];
+
+    net_transport_listener_listen(listener, "tcp://127.0.0.1:0");
+    CHORD_TEST_ASSERT_EQ(net_transport_listener_attach(listener, loop, on_accept, &state), 0, "Attach");
+
+    for (int i = 0; i < ACCEPT_CLIENTS; i++) {
+        clients[i] = net_transport_create(NET_TRANSPORT_TCP);
+        CHORD_TEST_ASSERT_EQ(net_transport_connect(clients[i], net_transport_listener_url(listener),
+                                                   TEST_TIMEOUT_MS), 0, "Connect");
+        if (i % 100 == 99) {
+            net_loop_run_once(loop, 0);
+        }
+    }
+    for (int spins = 0; state.count < ACCEPT_CLIENTS && spins < 100; spins++) {
+        net_loop_run_once(loop, 10);
+    }
+    CHORD_TEST_ASSERT_EQ(state.count, ACCEPT_CLIENTS, "All accepted");
+
+    /* Spot-check that the accepted sockets are live */
+    for (int i = 0; i < ACCEPT_CLIENTS; i += 97) {
+        CHORD_TEST_ASSERT_EQ(net_transport_send(state.accepted[i], "hi", 2, TEST_TIMEOUT_MS), 0, "Send");
+    }
+    int received = 0;
+    for (int i = 0; i < ACCEPT_CLIENTS; i++) {
+        received += net_transport_recv(clients[i], buf, sizeof(buf), 0) == 2;
+    }
+    CHORD_TEST_ASSERT_EQ(received, (ACCEPT_CLIENTS + 96) / 97, "Each spot-checked client heard back");
+
+    for (int i = 0; i < ACCEPT_CLIENTS; i++) {
+        net_transport_destroy(clients[i]);
+        net_transport_destroy(state.accepted[i]);
+    }
+    net_transport_listener_destroy(listener);
+    net_loop_destroy(loop);
+}
+
+/* Owns the client from its first use: uring connections bind to a thread */
+static void* uring_big_sender(void *arg) {
+    big_sender(arg);
+    net_transport_destroy(((big_send_t*)arg)->transport);
+    return NULL;
+}
+
+static void test_transport_uring(void) {
+    CHORD_TEST("io_uring backend");
+
+    net_transport_listener_t *listener = net_transport_listener_create(NET_TRANSPORT_TCP);
+    net_transport_t *client = NULL;
+    net_transport_t *server = NULL;
+    net_transport_t *big_client = NULL;
+    net_transport_t *big_server = NULL;
+    static uint8_t big[512 * 1024];
+    char url[NET_TRANSPORT_MAX_URL];
+    char buf[64];
+    char tiny[2];
+    pthread_t thread;
+    big_send_t job;
+    int ok;
+
+    CHORD_TEST_ASSERT_EQ(net_transport_set_backend((net_transport_backend_t)7), -1, "Unknown backend");
+    CHORD_TEST_ASSERT_EQ(errno, EINVAL, "EINVAL");
+    if (net_transport_set_backend(NET_TRANSPORT_BACKEND_URING) != 0) {
+        CHORD_TEST_ASSERT_EQ(errno, ENOSYS, "Unsupported kernel reports ENOSYS");
+        CHORD_TEST_ASSERT_EQ(net_transport_get_backend(), NET_TRANSPORT_BACKEND_EPOLL, "Epoll kept");
+        printf("  (io_uring unavailable, skipped)\n");
+        net_transport_listener_destroy(listener);
+        return;
+    }
+
+    /* Only connections made while the backend is selected use it */
+    ipc_url(url, sizeof(url), "uring");
+    ok = round_trip(NET_TRANSPORT_TCP, "tcp://127.0.0.1:0") &&
+         round_trip(NET_TRANSPORT_IPC, url) &&
+         net_transport_listener_listen(listener, "tcp://127.0.0.1:0") == 0 &&
+         make_pair(listener, &client, &server) == 0 &&
+         make_pair(listener, &big_client, &big_server) == 0;
+    net_transport_set_backend(NET_TRANSPORT_BACKEND_EPOLL);
+    CHORD_TEST_ASSERT_TRUE(ok, "Round trips and connections");
+    CHORD_TEST_ASSERT_EQ(net_transport_fd(client), -1, "No descriptor for a loop");
+
+    /* A burst is queued, coalesced and submitted on the next wait */
+    for (int i = 0; i < 100; i++) {
+        snprintf(buf, sizeof(buf), "frame-%d", i);
+        CHORD_TEST_ASSERT_EQ(net_transport_send(client, buf, strlen(buf), 0), 0, "Burst send");
+    }
+    CHORD_TEST_ASSERT_EQ(net_transport_flush(client), 0, "Flush");
+    for (int i = 0; i < 100; i++) {
+        char expect[16];
+        int n = net_transport_recv(server, buf, sizeof(buf), TEST_TIMEOUT_MS);
+        snprintf(expect, sizeof(expect), "frame-%d", i);
+        CHORD_TEST_ASSERT_EQ(n, (int)strlen(expect), "Frame length");
+        CHORD_TEST_ASSERT_TRUE(memcmp(buf, expect, (size_t)n) == 0, "Frame content");
+    }
+
+    /* Writes big enough to go out zero-copy from the registered buffers */
+    for (int i = 0; i < 8; i++) {
+        memset(big, 'a' + i, 6000);
+        CHORD_TEST_ASSERT_EQ(net_transport_send(client, big, 6000, TEST_TIMEOUT_MS), 0, "6 KB send");
+    }
+    net_transport_flush(client);
+    for (int i = 0; i < 8; i++) {
+        CHORD_TEST_ASSERT_EQ(net_transport_recv(server, big, sizeof(big), TEST_TIMEOUT_MS), 6000, "6 KB recv");
+        CHORD_TEST_ASSERT_TRUE(big[0] == 'a' + i && big[5999] == 'a' + i, "6 KB content");
+    }
+
+    CHORD_TEST_ASSERT_EQ(net_transport_send(client, NULL, 0, 0), 0, "Empty send");
+    net_transport_send(client, "toolong", 7, 0);
+    net_transport_send(client, "ok", 2, 0);
+    net_transport_flush(client);
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(server, buf, sizeof(buf), TEST_TIMEOUT_MS), 0, "Empty recv");
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(server, tiny, sizeof(tiny), TEST_TIMEOUT_MS), -1, "Oversized");
+    CHORD_TEST_ASSERT_EQ(errno, EMSGSIZE, "EMSGSIZE");
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(server, tiny, sizeof(tiny), TEST_TIMEOUT_MS), 2, "Next frame");
+
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(server, buf, sizeof(buf), 0), -1, "Nothing yet");
+    CHORD_TEST_ASSERT_EQ(errno, EAGAIN, "Timeout 0 does not wait");
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(server, buf, sizeof(buf), 20), -1, "Times out");
+    CHORD_TEST_ASSERT_EQ(errno, ETIMEDOUT, "ETIMEDOUT");
+
+    /* Larger than a registered buffer and the socket buffers */
+    job.transport = big_client;
+    job.len = sizeof(big);
+    pthread_create(&thread, NULL, uring_big_sender, &job);
+    int n = net_transport_recv(big_server, big, sizeof(big), TEST_TIMEOUT_MS);
+    pthread_join(thread, NULL);
+    CHORD_TEST_ASSERT_EQ(job.result, 0, "Big send");
+    CHORD_TEST_ASSERT_EQ(n, (int)sizeof(big), "Big recv");
+    for (size_t i = 0; i < sizeof(big); i++) {
+        CHORD_TEST_ASSERT_EQ(big[i], (uint8_t)(i * 31u), "Big content");
+    }
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(big_server, buf, sizeof(buf), TEST_TIMEOUT_MS), -1,
+                         "Sender thread hung up");
+    CHORD_TEST_ASSERT_EQ(errno, ECONNRESET, "ECONNRESET");
+
+    net_transport_close(client);
+    CHORD_TEST_ASSERT_EQ(net_transport_recv(server, buf, sizeof(buf), TEST_TIMEOUT_MS), -1, "Hang-up");
+    CHORD_TEST_ASSERT_EQ(errno, ECONNRESET, "ECONNRESET");
+    CHORD_TEST_ASSERT_TRUE(!server->connected, "Closed");
+
+    net_transport_destroy(client);
+    net_transport_destroy(server);
+    net_transport_destroy(big_server);
+    net_transport_listener_destroy(listener);
+}
+
+int main(void) {
+    CHORD_TEST_INIT();
+
+    CHORD_RUN_TEST(test_transport_round_trip);
+    CHORD_RUN_TEST(test_transport_framing);
+    CHORD_RUN_TEST(test_transport_errors);
+    CHORD_RUN_TEST(test_transport_shm);
+    CHORD_RUN_TEST(test_transport_many_connections);
+    CHORD_RUN_TEST(test_transport_uring);
+
+    CHORD_TEST_FINI();
+}
@@ -0,0 +1,364 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "../chord_test.h"
+#include "../../src/net/net_udp.h"
+
+/*
+ * Unit tests for net_udp.c - UDP control plane
+ *
+ * Tests cover:
+ * - PING, NOTIFY, GET_SUCCESSOR and STABILIZE round trips through a handler
+ * - Unsupported types and blocking helpers refused
+ * - Hundreds of calls batched into a few sendmmsg/recvmmsg calls
+ * - Calls to one peer coalesced into BATCH datagrams, answered in kind
+ * - Lost requests retransmitted; retransmitted requests deduplicated
+ * - Calls to a silent address time out
+ */
+
+#define TEST_TIMEOUT_MS 2000
+
+typedef struct {
+    int requests;
+    net_node_addr_t notified;
+} server_t;
+
+static int serve(void *context, const net_frame_view_t *request, net_message_t *response) {
+    server_t *server = (server_t*)context;
+
+    server->requests++;
+    switch (request->header.msg_type) {
+    case NET_MSG_PING:
+        response->payload.ping_resp.alive = 1;
+        response->payload.ping_resp.state = 7;
+        return NET_ERR_OK;
+    case NET_MSG_NOTIFY:
+        net_protocol_copy_node_view(&server->notified, &request->node);
+        response->payload.notify_resp.success = 1;
+        return NET_ERR_OK;
+    case NET_MSG_GET_SUCCESSOR:
+        response->payload.get_node_resp.has_node = 1;
+        net_protocol_copy_node_addr(&response->payload.get_node_resp.node, "succ", 42, "udp://s:1");
+        return NET_ERR_OK;
+    case NET_MSG_STABILIZE:
+        net_protocol_copy_node_view(&server->notified, &request->node);
+        response->payload.stabilize_resp.has_node = 0;
+        response->payload.stabilize_resp.count = 2;
+        net_protocol_copy_node_addr(&response->payload.stabilize_resp.successors[0], "s1", 42, "udp://s:1");
+        net_protocol_copy_node_addr(&response->payload.stabilize_resp.successors[1], "s2", 43, "udp://s:2");
+        return NET_ERR_OK;
+    default:
+        return NET_ERR_NODE_NOT_FOUND;
+    }
+}
+
+typedef struct {
+    int done;
+    int error;
+    int alive;
+    int state;
+    int key;
+} result_t;
+
+static void on_ping(void *context, int error, int alive, int state) {
+    result_t *r = (result_t*)context;
+    r->done++;
+    r->error = error;
+    r->alive = alive;
+    r->state = state;
+}
+
+static void on_status(void *context, int error) {
+    result_t *r = (result_t*)context;
+    r->done++;
+    r->error = error;
+}
+
+static void on_node(void *context, int error, const net_node_addr_t *node) {
+    result_t *r = (result_t*)context;
+    r->done++;
+    r->error = error;
+    r->key = node ? node->key : -1;
+}
+
+static void on_stabilize(void *context, int error, const net_stabilize_resp_t *result) {
+    result_t *r = (result_t*)context;
+    r->done++;
+    r->error = error;
+    r->key = result ? result->successors[result->count - 1].key : -1;
+}
+
+static void run_until(net_loop_t *loop, const int *count, int target) {
+    for (int i = 0; i < TEST_TIMEOUT_MS / 10 && *count < target; i++) {
+        net_loop_run_once(loop, 10);
+    }
+}
+
+static void test_udp_round_trip(void) {
+    CHORD_TEST("control RPCs round trip through the handler");
+
+    net_loop_t *loop = net_loop_create();
+    net_udp_t *server_udp = net_udp_create(loop, "udp://127.0.0.1:0");
+    net_udp_t *client_udp = net_udp_create(loop, "udp://127.0.0.1:0");
+    server_t server;
+    result_t r[4];
+    net_node_addr_t self;
+    net_peer_t *peer;
+    int done = 0;
+
+    CHORD_TEST_ASSERT_NOT_NULL(server_udp, "Server bound");
+    CHORD_TEST_ASSERT_NOT_NULL(client_udp, "Client bound");
+    CHORD_TEST_ASSERT_TRUE(strcmp(net_udp_url(server_udp), "udp://127.0.0.1:0") != 0, "Port chosen");
+    memset(&server, 0, sizeof(server));
+    memset(r, 0, sizeof(r));
+    net_udp_set_handler(server_udp, serve, &server);
+
+    peer = net_udp_peer_create(client_udp);
+    CHORD_TEST_ASSERT_EQ(net_peer_connect(peer, net_udp_url(server_udp)), NET_ERR_OK, "Connected");
+    net_protocol_copy_node_addr(&self, "me", 5, "udp://127.0.0.1:9");
+
+    CHORD_TEST_ASSERT_EQ(net_peer_ping_async(peer, on_ping, &r[0], TEST_TIMEOUT_MS), NET_ERR_OK, "Ping");
+    CHORD_TEST_ASSERT_EQ(net_peer_notify_async(peer, &self, on_status, &r[1], TEST_TIMEOUT_MS), NET_ERR_OK,
+                         "Notify");
+    CHORD_TEST_ASSERT_EQ(net_peer_get_successor_async(peer, on_node, &r[2], TEST_TIMEOUT_MS), NET_ERR_OK,
+                         "Get successor");
+    CHORD_TEST_ASSERT_EQ(net_peer_stabilize_async(peer, &self, on_stabilize, &r[3], TEST_TIMEOUT_MS),
+                         NET_ERR_OK, "Stabilize");
+    while (done < 4 && net_loop_run_once(loop, 100) >= 0) {
+        done = r[0].done + r[1].done + r[2].done + r[3].done;
+    }
+
+    CHORD_TEST_ASSERT_TRUE(r[0].error == NET_ERR_OK && r[0].alive == 1 && r[0].state == 7, "Ping answered");
+    CHORD_TEST_ASSERT_EQ(r[1].error, NET_ERR_OK, "Notify answered");
+    CHORD_TEST_ASSERT_STR_EQ(server.notified.url, "udp://127.0.0.1:9", "Notify delivered the node");
+    CHORD_TEST_ASSERT_TRUE(r[2].error == NET_ERR_OK && r[2].key == 42, "Successor returned");
+    CHORD_TEST_ASSERT_TRUE(r[3].error == NET_ERR_OK && r[3].key == 43, "Successor list returned");
+
+    CHORD_TEST_ASSERT_EQ(net_peer_find_successor_async(peer, 1, on_node, &r[0], 100),
+                         NET_ERR_INVALID_MESSAGE, "Lookups stay on streams");
+    CHORD_TEST_ASSERT_EQ(net_peer_ping(peer, &r[0].alive, &r[0].state, 100), NET_ERR_INTERNAL,
+                         "No blocking calls");
+
+    net_peer_destroy(peer);
+    net_udp_destroy(client_udp);
+    net_udp_destroy(server_udp);
+    net_loop_destroy(loop);
+}
+
+#define BATCH_CALLS 256
+
+static void test_udp_batching(void) {
+    CHORD_TEST("bursts go out in a few sendmmsg/recvmmsg calls");
+
+    net_loop_t *loop = net_loop_create();
+    net_udp_t *server_udp = net_udp_create(loop, "udp://127.0.0.1:0");
+    net_udp_t *client_udp = net_udp_create(loop, "udp://127.0.0.1:0");
+    net_peer_t *peer = net_udp_peer_create(client_udp);
+    net_udp_stats_t client_stats;
+    net_udp_stats_t server_stats;
+    server_t server;
+    result_t r;
+
+    memset(&server, 0, sizeof(server));
+    memset(&r, 0, sizeof(r));
+    net_udp_set_handler(server_udp, serve, &server);
+    net_peer_connect(peer, net_udp_url(server_udp));
+
+    for (int i = 0; i < BATCH_CALLS; i++) {
+        CHORD_TEST_ASSERT_EQ(net_peer_ping_async(peer, on_ping, &r, TEST_TIMEOUT_MS), NET_ERR_OK, "Queued");
+    }
+    run_until(loop, &r.done, BATCH_CALLS);
+    CHORD_TEST_ASSERT_EQ(r.done, BATCH_CALLS, "All answered");
+
+    net_udp_get_stats(client_udp, &client_stats);
+    net_udp_get_stats(server_udp, &server_stats);
+    CHORD_TEST_ASSERT_EQ(client_stats.datagrams_sent, BATCH_CALLS, "One datagram per call");
+    CHORD_TEST_ASSERT_EQ(client_stats.send_calls, BATCH_CALLS / NET_UDP_BATCH, "Full batches");
+    CHORD_TEST_ASSERT_TRUE(server_stats.recv_calls <= BATCH_CALLS / NET_UDP_BATCH + 2, "Batched receives");
+    CHORD_TEST_ASSERT_TRUE(server_stats.send_calls <= BATCH_CALLS / NET_UDP_BATCH + 2, "Batched replies");
+
+    net_peer_destroy(peer);
+    net_udp_destroy(client_udp);
+    net_udp_destroy(server_udp);
+    net_loop_destroy(loop);
+}
+
+static void test_udp_coalescing(void) {
+    CHORD_TEST("calls to one peer share BATCH datagrams");
+
+    net_loop_t *loop = net_loop_create();
+    net_udp_t *server_udp = net_udp_create(loop, "udp://127.0.0.1:0");
+    net_udp_t *client_udp = net_udp_create(loop, "udp://127.0.0.1:0");
+    net_udp_stats_t client_stats;
+    net_udp_stats_t server_stats;
+    net_node_addr_t self;
+    net_peer_t *peer;
+    server_t server;
+    result_t pings;
+    result_t notifies;
+    int done = 0;
+
+    memset(&server, 0, sizeof(server));
+    memset(&pings, 0, sizeof(pings));
+    memset(&notifies, 0, sizeof(notifies));
+    net_udp_set_handler(server_udp, serve, &server);
+    net_udp_set_batching(client_udp, NET_PROTOCOL_MAX_BATCH, 0);
+    peer = net_udp_peer_create(client_udp);
+    net_peer_connect(peer, net_udp_url(server_udp));
+    net_protocol_copy_node_addr(&self, "me", 5, "udp://127.0.0.1:9");
+
+    for (int i = 0; i < BATCH_CALLS / 2; i++) {
+        net_peer_ping_async(peer, on_ping, &pings, TEST_TIMEOUT_MS);
+        net_peer_notify_async(peer, &self, on_status, &notifies, TEST_TIMEOUT_MS);
+    }
+    for (int i = 0; i < TEST_TIMEOUT_MS / 10 && done < BATCH_CALLS; i++) {
+        net_loop_run_once(loop, 10);
+        done = pings.done + notifies.done;
+    }
+    CHORD_TEST_ASSERT_EQ(done, BATCH_CALLS, "All answered");
+    CHORD_TEST_ASSERT_TRUE(pings.error == NET_ERR_OK && pings.state == 7, "Pings answered");
+    CHORD_TEST_ASSERT_EQ(notifies.error, NET_ERR_OK, "Notifies answered");
+    CHORD_TEST_ASSERT_EQ(server.requests, BATCH_CALLS, "Every record handled once");
+
+    net_udp_get_stats(client_udp, &client_stats);
+    net_udp_get_stats(server_udp, &server_stats);
+    CHORD_TEST_ASSERT_EQ(client_stats.datagrams_sent, BATCH_CALLS / NET_PROTOCOL_MAX_BATCH,
+                         "One datagram per full batch");
+    CHORD_TEST_ASSERT_EQ(server_stats.batches, BATCH_CALLS / NET_PROTOCOL_MAX_BATCH, "Served as batches");
+    CHORD_TEST_ASSERT_EQ(server_stats.datagrams_sent, BATCH_CALLS / NET_PROTOCOL_MAX_BATCH,
+                         "One response datagram per batch");
+    CHORD_TEST_ASSERT_EQ(net_rpc_batches(net_udp_peer_rpc(peer)), BATCH_CALLS / NET_PROTOCOL_MAX_BATCH,
+                         "Counted by the engine");
+
+    net_peer_destroy(peer);
+    net_udp_destroy(client_udp);
+    net_udp_destroy(server_udp);
+    net_loop_destroy(loop);
+}
+
+static int raw_socket(struct sockaddr_in *addr) {
+    socklen_t len = sizeof(*addr);
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct timeval tv = { 0, 200000 };
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (struct sockaddr*)addr, sizeof(*addr));
+    getsockname(fd, (struct sockaddr*)addr, &len);
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+static void test_udp_loss(void) {
+    CHORD_TEST("lost requests are resent; resent requests are deduplicated");
+
+    net_loop_t *loop = net_loop_create();
+    net_udp_t *udp = net_udp_create(loop, "udp://127.0.0.1:0");
+    net_peer_t *peer = net_udp_peer_create(udp);
+    struct sockaddr_in raw_addr;
+    struct sockaddr_in from;
+    socklen_t from_len = sizeof(from);
+    int raw = raw_socket(&raw_addr);
+    uint8_t frame[NET_PROTOCOL_MAX_FRAME];
+    uint8_t reply[NET_PROTOCOL_MAX_FRAME];
+    net_frame_view_t view;
+    net_message_t msg;
+    server_t server;
+    char url[64];
+    result_t r;
+    ssize_t n;
+    int len;
+
+    /* Client side: the raw socket ignores the first request */
+    memset(&r, 0, sizeof(r));
+    snprintf(url, sizeof(url), "udp://127.0.0.1:%u", ntohs(raw_addr.sin_port));
+    net_peer_connect(peer, url);
+    net_peer_ping_async(peer, on_ping, &r, TEST_TIMEOUT_MS);
+    net_loop_run_once(loop, 0);
+    n = recvfrom(raw, frame, sizeof(frame), 0, (struct sockaddr*)&from, &from_len);
+    CHORD_TEST_ASSERT_TRUE(n > 0, "First request arrived");
+    for (int i = 0; i < 50; i++) {
+        net_loop_run_once(loop, 10);
+    }
+    n = recvfrom(raw, frame, sizeof(frame), 0, (struct sockaddr*)&from, &from_len);
+    CHORD_TEST_ASSERT_TRUE(n > 0, "Request resent");
+    CHORD_TEST_ASSERT_EQ(net_protocol_decode_view(&view, frame, (size_t)n), NET_ERR_OK, "Decodes");
+    net_protocol_init_message(&msg, NET_MSG_PING_RESPONSE, view.header.request_id);
+    msg.payload.ping_resp.alive = 1;
+    msg.payload.ping_resp.state = 3;
+    len = net_protocol_serialize(&msg, reply, sizeof(reply));
+    sendto(raw, reply, (size_t)len, 0, (struct sockaddr*)&from, from_len);
+    sendto(raw, reply, (size_t)len, 0, (struct sockaddr*)&from, from_len);
+    run_until(loop, &r.done, 1);
+    CHORD_TEST_ASSERT_TRUE(r.done == 1 && r.error == NET_ERR_OK && r.state == 3, "Answered once");
+    CHORD_TEST_ASSERT_TRUE(net_rpc_retransmits(net_udp_peer_rpc(peer)) >= 1, "Retransmit counted");
+
+    /* Server side: the same request twice runs the handler once */
+    memset(&server, 0, sizeof(server));
+    net_udp_set_handler(udp, serve, &server);
+    len = net_protocol_encode_request(frame, sizeof(frame), NET_MSG_PING, 77, 0, NULL);
+    from_len = sizeof(from);
+    inet_pton(AF_INET, "127.0.0.1", &from.sin_addr);
+    from.sin_family = AF_INET;
+    from.sin_port = htons((uint16_t)atoi(strrchr(net_udp_url(udp), ':') + 1));
+    for (int i = 0; i < 2; i++) {
+        sendto(raw, frame, (size_t)len, 0, (struct sockaddr*)&from, sizeof(from));
+        net_loop_run_once(loop, 100);
+        net_loop_run_once(loop, 0);
+        n = recv(raw, reply, sizeof(reply), 0);
+        CHORD_TEST_ASSERT_TRUE(n > 0 && net_protocol_decode_view(&view, reply, (size_t)n) == NET_ERR_OK &&
+                               view.header.request_id == 77 && view.state == 7, "Answered");
+    }
+    CHORD_TEST_ASSERT_EQ(server.requests, 1, "Handler ran once");
+
+    close(raw);
+    net_peer_destroy(peer);
+    net_udp_destroy(udp);
+    net_loop_destroy(loop);
+}
+
+static void test_udp_timeout(void) {
+    CHORD_TEST("calls to a silent address time out");
+
+    net_loop_t *loop = net_loop_create();
+    net_udp_t *udp = net_udp_create(loop, "udp://127.0.0.1:0");
+    net_peer_t *peer = net_udp_peer_create(udp);
+    struct sockaddr_in raw_addr;
+    int raw = raw_socket(&raw_addr);
+    char url[64];
+    result_t r;
+
+    memset(&r, 0, sizeof(r));
+    snprintf(url, sizeof(url), "udp://127.0.0.1:%u", ntohs(raw_addr.sin_port));
+    CHORD_TEST_ASSERT_EQ(net_peer_connect(peer, "tcp://127.0.0.1:1"), NET_ERR_NODE_NOT_FOUND, "Bad scheme");
+    net_peer_connect(peer, url);
+    net_peer_ping_async(peer, on_ping, &r, 300);
+    run_until(loop, &r.done, 1);
+    CHORD_TEST_ASSERT_EQ(r.error, NET_ERR_TIMEOUT, "Timed out");
+    CHORD_TEST_ASSERT_EQ(net_rpc_retransmits(net_udp_peer_rpc(peer)), 1, "Resent once before the deadline");
+
+    close(raw);
+    net_peer_destroy(peer);
+    net_udp_destroy(udp);
+    net_loop_destroy(loop);
+}
+
+int main(void) {
+    CHORD_TEST_INIT();
+
+    CHORD_RUN_TEST(test_udp_round_trip);
+    CHORD_RUN_TEST(test_udp_batching);
+    CHORD_RUN_TEST(test_udp_coalescing);
+    CHORD_RUN_TEST(test_udp_loss);
+    CHORD_RUN_TEST(test_udp_timeout);
+
+    CHORD_TEST_FINI();
+}
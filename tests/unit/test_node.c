@@ -0,0 +1,691 @@
+#include <stdio.h>
+#include <string.h>
+#include "../chord_test.h"
+#include "../../src/core/ring.h"
+#include "../../src/core/node.h"
+
+/*
+ * Unit tests for node.c - routing and ring maintenance
+ *
+ * Tests cover:
+ * - node_lookup() agrees with node_find_successor() and counts hops
+ * - Every finger policy converges to the true successors
+ * - FINGER_FIX_NEXT refreshes one finger per call, round robin
+ * - SHARED and CHANGED cost fewer messages than ALL on a settled ring
+ * - node_join_copy() seeds fingers from the successor's table
+ * - node_join_batch() splices a join storm in with one stabilise
+ * - node_maintain() backs off on a quiet ring and recovers from a failure
+ * - The unified routing view uses the successor list and skips dead nodes
+ * - Finger tables of base 4 and 16: size, starts, routing
+ * - One-hop lookups, and membership changes spread by stabilise
+ * - Documents handed over on join and leave
+ * - node_balance() moves light nodes into a hot range
+ */
+
+#define RING_NODES 24
+
+static const FingerPolicy policies[] = {
+    FINGER_FIX_ALL, FINGER_FIX_NEXT, FINGER_FIX_SHARED, FINGER_FIX_CHANGED
+};
+
+/* First of nodes at or after key, going round the ring */
+static Node* true_successor(Node **nodes, int count, int key) {
+    Node *best = NULL;
+    int best_distance = 0;
+
+    for (int i = 0; i < count; i++) {
+        int distance = ((nodes[i]->key - key) % ring_key_max() + ring_key_max()) % ring_key_max();
+
+        if (!best || distance < best_distance) {
+            best = nodes[i];
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+/* count nodes on distinct keys, joined one by one and settled */
+static void make_ring(Node **nodes, int count, const char *suffix, FingerPolicy policy) {
+    static char names[24][RING_NODES * 4][24];
+    static int rings = 0;
+    int made = 0;
+    char *name;
+
+    for (int n = 0; made < count; n++) {
+        int taken = 0;
+
+        name = names[rings][made];
+        snprintf(name, sizeof(names[0][0]), "%d-%s", n, suffix);
+        for (int i = 0; i < made; i++) {
+            taken |= nodes[i]->key == chord_hash(name);
+        }
+        if (taken) {
+            continue;
+        }
+        nodes[made] = node_init(name);
+        if (made == 0) {
+            node_create(nodes[0]);
+        } else {
+            node_join(nodes[0], nodes[made]);
+        }
+        made++;
+    }
+    rings++;
+
+    for (int round = 0; round < 2 * count * KEY_BITS; round++) {
+        /* backwards: a node stabilising alone would take itself as predecessor */
+        for (int i = count - 1; i >= 0; i--) {
+            node_stabilise(nodes[i]);
+            node_fix_fingers_policy(nodes[i], policy);
+        }
+    }
+}
+
+static int fingers_correct(Node **nodes, int count) {
+    int correct = 0;
+
+    for (int i = 0; i < count; i++) {
+        for (int f = 0; f < nodes[i]->finger_table->length; f++) {
+            Finger *finger = nodes[i]->finger_table->fingers[f];
+
+            correct += finger->node == true_successor(nodes, count, finger->start);
+        }
+    }
+    return correct;
+}
+
+/* A node on a key no node of nodes holds */
+static Node* fresh_node(Node **nodes, int count, const char *suffix) {
+    static char names[64][24];
+    static int made = 0;
+    char *name;
+
+    for (int n = 0; ; n++) {
+        int taken = 0;
+
+        name = names[made];
+        snprintf(name, sizeof(names[0]), "%d-%s", n, suffix);
+        for (int i = 0; i < count; i++) {
+            taken |= nodes[i]->key == chord_hash(name);
+        }
+        if (!taken) {
+            made++;
+            return node_init(name);
+        }
+    }
+}
+
+static void test_node_lookup(void) {
+    CHORD_TEST("node_lookup matches node_find_successor");
+
+    Node *nodes[RING_NODES];
+    int hops = 0;
+    int matched = 0;
+    int max_hops = 0;
+
+    make_ring(nodes, RING_NODES, "lookup", FINGER_FIX_ALL);
+    for (int key = 0; key < ring_key_max(); key++) {
+        Node *origin = nodes[key % RING_NODES];
+        int before = hops;
+
+        matched += node_lookup(origin, key, &hops) == node_find_successor(origin, key);
+        max_hops = hops - before > max_hops ? hops - before : max_hops;
+    }
+    CHORD_TEST_ASSERT_EQ(matched, ring_key_max(), "Same successor for every key");
+    CHORD_TEST_ASSERT_TRUE(hops > 0, "Remote hops counted");
+    CHORD_TEST_ASSERT_TRUE(max_hops <= KEY_BITS, "Hops bounded by the finger count");
+
+    hops = 0;
+    node_lookup(nodes[0], (nodes[0]->successor->key + ring_key_max() - 1) % ring_key_max(), &hops);
+    CHORD_TEST_ASSERT_EQ(hops, 0, "Key before the successor resolves locally");
+}
+
+static void test_fix_fingers_policies_converge(void) {
+    CHORD_TEST("every finger policy converges to the true successors");
+
+    static const char *suffixes[] = { "all", "next", "shared", "changed" };
+    Node *nodes[RING_NODES];
+
+    for (int p = 0; p < 4; p++) {
+        make_ring(nodes, RING_NODES, suffixes[p], policies[p]);
+        CHORD_TEST_ASSERT_EQ(fingers_correct(nodes, RING_NODES), RING_NODES * KEY_BITS,
+                             "All fingers on their start's successor");
+    }
+}
+
+static void test_fix_fingers_next(void) {
+    CHORD_TEST("FINGER_FIX_NEXT refreshes one finger per call");
+
+    Node *nodes[RING_NODES];
+    Node *node;
+    FingerTable *table;
+
+    make_ring(nodes, RING_NODES, "round", FINGER_FIX_ALL);
+    node = nodes[3];
+    table = node->finger_table;
+    for (int f = 0; f < KEY_BITS; f++) {
+        table->fingers[f]->node = node;
+    }
+    table->next = KEY_BITS - 2;
+
+    node_fix_fingers_policy(node, FINGER_FIX_NEXT);
+    CHORD_TEST_ASSERT_EQ(table->next, KEY_BITS - 1, "Pointer advanced");
+    CHORD_TEST_ASSERT_TRUE(table->fingers[KEY_BITS - 2]->node != node, "That finger refreshed");
+    CHORD_TEST_ASSERT_TRUE(table->fingers[0]->node == node, "Others untouched");
+
+    node_fix_fingers_policy(node, FINGER_FIX_NEXT);
+    CHORD_TEST_ASSERT_EQ(table->next, 0, "Pointer wraps");
+    for (int f = 0; f < KEY_BITS - 2; f++) {
+        node_fix_fingers_policy(node, FINGER_FIX_NEXT);
+    }
+    for (int f = 0; f < KEY_BITS; f++) {
+        CHORD_TEST_ASSERT_TRUE(table->fingers[f]->node ==
+                               true_successor(nodes, RING_NODES, table->fingers[f]->start),
+                               "Full round restores the table");
+    }
+}
+
+static void test_fix_fingers_messages(void) {
+    CHORD_TEST("SHARED and CHANGED cost less than ALL when settled");
+
+    Node *nodes[RING_NODES];
+    int messages[4] = { 0 };
+
+    make_ring(nodes, RING_NODES, "cost", FINGER_FIX_ALL);
+    for (int p = 0; p < 4; p++) {
+        for (int i = 0; i < RING_NODES; i++) {
+            messages[p] += node_fix_fingers_policy(nodes[i], policies[p]);
+        }
+        CHORD_TEST_ASSERT_EQ(fingers_correct(nodes, RING_NODES), RING_NODES * KEY_BITS,
+                             "Table still correct");
+    }
+    CHORD_TEST_ASSERT_TRUE(messages[0] > 0, "ALL sends lookups");
+    CHORD_TEST_ASSERT_TRUE(messages[1] < messages[0], "NEXT sends less per call");
+    CHORD_TEST_ASSERT_TRUE(messages[2] < messages[0], "SHARED skips shared fingers");
+    CHORD_TEST_ASSERT_TRUE(messages[3] < messages[0], "CHANGED only probes");
+    CHORD_TEST_ASSERT_TRUE(messages[3] <= RING_NODES * KEY_BITS, "At most one probe per finger");
+
+    /* a node joins in front of some fingers: CHANGED walks back to it */
+    Node *joined = fresh_node(nodes, RING_NODES, "late");
+    node_join(nodes[0], joined);
+    for (int round = 0; round < 4; round++) {
+        node_stabilise(joined);
+        for (int i = RING_NODES - 1; i >= 0; i--) {
+            node_stabilise(nodes[i]);
+        }
+    }
+    for (int i = 0; i < RING_NODES; i++) {
+        node_fix_fingers_policy(nodes[i], FINGER_FIX_CHANGED);
+    }
+    node_fix_fingers_policy(joined, FINGER_FIX_ALL);
+
+    Node *all[RING_NODES + 1];
+    memcpy(all, nodes, sizeof(nodes));
+    all[RING_NODES] = joined;
+    CHORD_TEST_ASSERT_EQ(fingers_correct(all, RING_NODES + 1), (RING_NODES + 1) * KEY_BITS,
+                         "CHANGED picked up the new node");
+}
+
+static void test_join_copy(void) {
+    CHORD_TEST("node_join_copy seeds fingers from the successor");
+
+    Node *nodes[RING_NODES + 2];
+    Node *copied;
+    Node *looked_up;
+    int copy_messages;
+    int plain_messages = 1;
+    int copy_right;
+
+    make_ring(nodes, RING_NODES, "seed", FINGER_FIX_ALL);
+    copied = fresh_node(nodes, RING_NODES, "copy");
+    nodes[RING_NODES] = copied;
+    looked_up = fresh_node(nodes, RING_NODES + 1, "plain");
+    nodes[RING_NODES + 1] = looked_up;
+
+    copy_messages = node_join_copy(nodes[5], copied);
+    CHORD_TEST_ASSERT_TRUE(copied->successor == true_successor(nodes, RING_NODES, copied->key),
+                           "Successor found");
+    for (int f = 0; f < KEY_BITS; f++) {
+        Finger *finger = copied->finger_table->fingers[f];
+
+        if (key_in_range(finger->start, copied->key, copied->successor->key, TRUE)) {
+            CHORD_TEST_ASSERT_TRUE(finger->node == copied->successor, "Start before successor fixed");
+        }
+    }
+    copy_right = 0;
+    for (int f = 0; f < KEY_BITS; f++) {
+        Finger *finger = copied->finger_table->fingers[f];
+
+        copy_right += finger->node == true_successor(nodes, RING_NODES, finger->start);
+    }
+    CHORD_TEST_ASSERT_TRUE(copy_right >= KEY_BITS / 2, "Most copied fingers already right");
+
+    node_join(nodes[5], looked_up);
+    node_lookup(nodes[5], looked_up->key, &plain_messages);
+    plain_messages += node_fix_fingers_policy(looked_up, FINGER_FIX_ALL);
+    CHORD_TEST_ASSERT_TRUE(copy_messages < plain_messages, "Fewer messages than lookups");
+    CHORD_TEST_ASSERT_TRUE(copy_messages <= KEY_BITS, "Lookup plus one transfer");
+
+    for (int round = 0; round < 8; round++) {
+        for (int i = RING_NODES + 1; i >= 0; i--) {
+            node_stabilise(nodes[i]);
+            node_fix_fingers_policy(nodes[i], FINGER_FIX_CHANGED);
+        }
+    }
+    CHORD_TEST_ASSERT_EQ(fingers_correct(nodes, RING_NODES + 2), (RING_NODES + 2) * KEY_BITS,
+                         "Converges under FINGER_FIX_CHANGED");
+}
+
+/* Every node's successor and predecessor its true neighbour */
+static int ring_linked(Node **nodes, int count) {
+    int linked = 0;
+
+    for (int i = 0; i < count; i++) {
+        Node *node = nodes[i];
+
+        linked += node->successor == true_successor(nodes, count, (node->key + 1) % ring_key_max())
+                  && node->predecessor != NULL && node->predecessor->successor == node;
+    }
+    return linked;
+}
+
+static void test_join_batch(void) {
+    CHORD_TEST("node_join_batch splices joiners in together");
+
+    enum { SEED = 8, JOINERS = 40 };
+    Node *nodes[SEED + JOINERS];
+    int messages;
+
+    make_ring(nodes, SEED, "storm", FINGER_FIX_ALL);
+    for (int i = SEED; i < SEED + JOINERS; i++) {
+        nodes[i] = fresh_node(nodes, i, "joiner");
+    }
+    messages = node_join_batch(nodes[2], &nodes[SEED], JOINERS);
+    CHORD_TEST_ASSERT_TRUE(messages >= 3 * JOINERS, "Lookup, transfer and stabilise per joiner");
+    CHORD_TEST_ASSERT_EQ(ring_linked(nodes, SEED + JOINERS), SEED + JOINERS,
+                         "Linked in place without further rounds");
+
+    for (int round = 0; round < 4; round++) {
+        for (int i = SEED + JOINERS - 1; i >= 0; i--) {
+            node_stabilise(nodes[i]);
+            node_fix_fingers_policy(nodes[i], FINGER_FIX_CHANGED);
+        }
+    }
+    CHORD_TEST_ASSERT_EQ(fingers_correct(nodes, SEED + JOINERS), (SEED + JOINERS) * KEY_BITS,
+                         "Fingers converge");
+
+    /* into a ring of one */
+    Node *alone[4];
+    alone[0] = fresh_node(nodes, 0, "solo");
+    node_create(alone[0]);
+    for (int i = 1; i < 4; i++) {
+        alone[i] = fresh_node(alone, i, "solo");
+    }
+    node_join_batch(alone[0], &alone[1], 3);
+    CHORD_TEST_ASSERT_EQ(ring_linked(alone, 4), 4, "Single node ring grows to four");
+}
+
+static void test_maintain_adaptive(void) {
+    CHORD_TEST("node_maintain backs off when quiet, recovers from a failure");
+
+    Node *nodes[RING_NODES];
+    Node *live[RING_NODES - 1];
+    Node *dead;
+    Node *before_dead = NULL;
+    int fixed = 0;
+    int adaptive = 0;
+    int woke = 0;
+    int tick;
+    int settled = -1;
+
+    make_ring(nodes, RING_NODES, "tick", FINGER_FIX_ALL);
+    for (tick = 0; tick < 32; tick++) {
+        for (int i = RING_NODES - 1; i >= 0; i--) {
+            fixed += node_maintain(nodes[i], tick, FINGER_FIX_CHANGED);
+        }
+    }
+    for (int i = 0; i < RING_NODES; i++) {
+        node_schedule(nodes[i], 1, 16);
+    }
+    for (; tick < 64; tick++) {
+        for (int i = RING_NODES - 1; i >= 0; i--) {
+            adaptive += node_maintain(nodes[i], tick, FINGER_FIX_CHANGED);
+        }
+    }
+    CHORD_TEST_ASSERT_EQ(nodes[0]->schedule.period[MAINTAIN_STABILISE], 16, "Quiet stabilise backed off");
+    CHORD_TEST_ASSERT_EQ(nodes[0]->schedule.period[MAINTAIN_FIX_FINGERS], 16, "Quiet fix_fingers backed off");
+    CHORD_TEST_ASSERT_TRUE(adaptive * 4 < fixed, "Far less traffic than every tick");
+
+    dead = nodes[7];
+    dead->state = NODE_STATE_DEAD;
+    for (int i = 0, j = 0; i < RING_NODES; i++) {
+        if (nodes[i] != dead) {
+            live[j++] = nodes[i];
+        }
+        if (nodes[i]->successor == dead) {
+            before_dead = nodes[i];
+        }
+    }
+    CHORD_TEST_ASSERT_NOT_NULL(before_dead, "Dead node had a predecessor");
+
+    for (int end = tick + 64; tick < end && settled < 0; tick++) {
+        for (int i = RING_NODES - 2; i >= 0; i--) {
+            node_maintain(live[i], tick, FINGER_FIX_CHANGED);
+        }
+        woke |= before_dead->schedule.period[MAINTAIN_STABILISE] == 1;
+        if (ring_linked(live, RING_NODES - 1) == RING_NODES - 1
+            && fingers_correct(live, RING_NODES - 1) == (RING_NODES - 1) * KEY_BITS) {
+            settled = tick;
+        }
+    }
+    CHORD_TEST_ASSERT_TRUE(settled >= 0, "Live ring repaired");
+    CHORD_TEST_ASSERT_TRUE(woke, "Failure dropped the period to the minimum");
+    CHORD_TEST_ASSERT_TRUE(before_dead->successor != dead, "Failed over past the dead successor");
+}
+
+static void test_routing_view(void) {
+    CHORD_TEST("unified routing view covers for stale and dead fingers");
+
+    Node *nodes[RING_NODES];
+    Node *node;
+    Node *saved[KEY_BITS];
+    Ring *ring = ring_get();
+    int key;
+
+    make_ring(nodes, RING_NODES, "view", FINGER_FIX_ALL);
+    node = nodes[4];
+    key = node->predecessor->key;
+    CHORD_TEST_ASSERT_EQ(ring->routing, ROUTE_UNIFIED, "Unified by default");
+    CHORD_TEST_ASSERT_TRUE(node_closest_preceding_node(node, key) != node, "Fresh fingers route");
+
+    for (int f = 0; f < KEY_BITS; f++) {
+        saved[f] = node->finger_table->fingers[f]->node;
+        node->finger_table->fingers[f]->node = node;
+    }
+    ring->routing = ROUTE_FINGERS;
+    CHORD_TEST_ASSERT_TRUE(node_closest_preceding_node(node, key) == node, "Fingers alone: stuck");
+    ring->routing = ROUTE_UNIFIED;
+    CHORD_TEST_ASSERT_TRUE(node_closest_preceding_node(node, key) == node->successors[SUCCESSOR_LIST_SIZE - 1],
+                           "Unified: furthest successor-list entry");
+
+    node->successors[SUCCESSOR_LIST_SIZE - 1]->state = NODE_STATE_DEAD;
+    CHORD_TEST_ASSERT_TRUE(node_closest_preceding_node(node, key) == node->successors[SUCCESSOR_LIST_SIZE - 2],
+                           "Dead entry skipped");
+    node->successors[SUCCESSOR_LIST_SIZE - 1]->state = NODE_STATE_RUNNING;
+
+    for (int f = 0; f < KEY_BITS; f++) {
+        node->finger_table->fingers[f]->node = saved[f];
+    }
+    for (int k = 0; k < ring_key_max(); k++) {
+        CHORD_TEST_ASSERT_TRUE(node_find_successor(nodes[k % RING_NODES], k) == true_successor(nodes, RING_NODES, k),
+                               "Lookups still correct");
+    }
+}
+
+static void test_finger_base(void) {
+    CHORD_TEST("finger base b gives (b-1)·log_b fingers and fewer hops");
+
+    Node *nodes[RING_NODES];
+    Ring *ring = ring_get();
+    static const int bases[] = { 2, 4, 16 };
+    static const int lengths[] = { KEY_BITS, 12, 30 };
+    static const char *suffixes[] = { "b2", "b4", "b16" };
+    int hops[3] = { 0 };
+
+    for (int b = 0; b < 3; b++) {
+        FingerTable *table;
+
+        ring->finger_base = bases[b];
+        make_ring(nodes, RING_NODES, suffixes[b], FINGER_FIX_ALL);
+        table = nodes[0]->finger_table;
+        CHORD_TEST_ASSERT_EQ(table->length, lengths[b], "Table size");
+        CHORD_TEST_ASSERT_EQ(key_distance(nodes[0]->key, table->fingers[bases[b] - 1]->start), bases[b],
+                             "First finger of the second power at distance b");
+        CHORD_TEST_ASSERT_EQ(fingers_correct(nodes, RING_NODES), RING_NODES * table->length,
+                             "Every finger converged");
+        for (int key = 0; key < ring_key_max(); key++) {
+            CHORD_TEST_ASSERT_TRUE(node_lookup(nodes[key % RING_NODES], key, &hops[b])
+                                   == true_successor(nodes, RING_NODES, key), "Lookups correct");
+        }
+    }
+    ring->finger_base = 2;
+    CHORD_TEST_ASSERT_TRUE(hops[1] < hops[0], "Base 4 takes fewer hops than base 2");
+    CHORD_TEST_ASSERT_TRUE(hops[2] < hops[1], "Base 16 fewer still");
+}
+
+/* one stabilise round over nodes, then every table's size */
+static int members_settle(Node **nodes, int count, int rounds) {
+    int sizes = 0;
+
+    for (int round = 0; round < rounds; round++) {
+        for (int i = count - 1; i >= 0; i--) {
+            if (nodes[i]->state != NODE_STATE_DEAD) {
+                node_stabilise(nodes[i]);
+                node_check_predecessor(nodes[i]);
+            }
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        sizes += nodes[i]->state != NODE_STATE_DEAD ? nodes[i]->members->count : 0;
+    }
+    return sizes;
+}
+
+static void test_one_hop(void) {
+    CHORD_TEST("node_lookup_one_hop answers in one hop and tracks churn");
+
+    Node *nodes[RING_NODES + 1];
+    Node *dead;
+    int hops = 0;
+    int correct = 0;
+    int most = 0;
+
+    make_ring(nodes, RING_NODES, "onehop", FINGER_FIX_ALL);
+    for (int i = 0; i < RING_NODES; i++) {
+        node_members_enable(nodes[i]);
+    }
+    CHORD_TEST_ASSERT_EQ(members_settle(nodes, RING_NODES, 0), RING_NODES * RING_NODES,
+                         "Every table lists every node");
+    for (int key = 0; key < ring_key_max(); key++) {
+        int before = hops;
+
+        correct += node_lookup_one_hop(nodes[key % RING_NODES], key, &hops)
+            == true_successor(nodes, RING_NODES, key);
+        most = hops - before > most ? hops - before : most;
+    }
+    CHORD_TEST_ASSERT_EQ(correct, ring_key_max(), "Every lookup correct");
+    CHORD_TEST_ASSERT_EQ(most, 1, "At most one hop");
+
+    nodes[RING_NODES] = fresh_node(nodes, RING_NODES, "onehop");
+    node_join(nodes[0], nodes[RING_NODES]);
+    CHORD_TEST_ASSERT_EQ(node_members_enable(nodes[RING_NODES]), 1, "Joiner copies its successor's table");
+    CHORD_TEST_ASSERT_EQ(members_settle(nodes, RING_NODES + 1, RING_NODES),
+                         (RING_NODES + 1) * (RING_NODES + 1), "Join spread to every table");
+
+    dead = nodes[RING_NODES / 2];
+    dead->state = NODE_STATE_DEAD;
+    hops = 0;
+    CHORD_TEST_ASSERT_TRUE(node_lookup_one_hop(nodes[0], dead->key, &hops)
+                           == dead->successor, "Stale entry falls back to the live successor");
+    CHORD_TEST_ASSERT_EQ(members_settle(nodes, RING_NODES + 1, RING_NODES), RING_NODES * RING_NODES,
+                         "Failure spread to every table");
+    dead->state = NODE_STATE_RUNNING;
+}
+
+/* every document of nodes held by its key's successor */
+static int documents_placed(Node **nodes, int count) {
+    int placed = 0;
+
+    for (int i = 0; i < count; i++) {
+        for (int d = 0; d < nodes[i]->num_documents; d++) {
+            placed += true_successor(nodes, count, nodes[i]->documents[d]->key) == nodes[i];
+        }
+    }
+    return placed;
+}
+
+/* A node on a free key whose successor among nodes is target */
+static Node* gap_node(Node **nodes, int count, Node *target) {
+    static char names[256][24];
+    static int made = 0;
+    char *name;
+
+    for (int n = 0; ; n++) {
+        int taken = 0;
+
+        name = names[made];
+        snprintf(name, sizeof(names[0]), "%d-gap", n);
+        for (int i = 0; i < count; i++) {
+            taken |= nodes[i]->key == chord_hash(name);
+        }
+        if (!taken && true_successor(nodes, count, chord_hash(name)) == target) {
+            made++;
+            return node_init(name);
+        }
+    }
+}
+
+static void test_handoff(void) {
+    CHORD_TEST("documents handed over on join and leave");
+
+    static Document docs[256];
+    Node *nodes[RING_NODES + 5];
+    Node *leaving;
+    Node *successor;
+    Node *wide;
+    int total = 0;
+
+    make_ring(nodes, RING_NODES, "handoff", FINGER_FIX_ALL);
+    for (int d = 0; d < ring_key_max(); d++) {
+        docs[d].key = d;
+        node_document_keep(true_successor(nodes, RING_NODES, docs[d].key), &docs[d]);
+    }
+
+    nodes[RING_NODES] = fresh_node(nodes, RING_NODES, "handoff");
+    successor = true_successor(nodes, RING_NODES, nodes[RING_NODES]->key);
+    total = successor->num_documents;
+    node_join(nodes[0], nodes[RING_NODES]);
+    CHORD_TEST_ASSERT_EQ(documents_placed(nodes, RING_NODES + 1), 256, "Joiner took its documents");
+    CHORD_TEST_ASSERT_EQ(nodes[RING_NODES]->num_documents + successor->num_documents, total,
+                         "Only from its successor");
+    for (int round = 0; round < 4; round++) {
+        for (int i = RING_NODES; i >= 0; i--) {
+            node_stabilise(nodes[i]);
+        }
+    }
+
+    leaving = nodes[3];
+    successor = leaving->successor;
+    total = leaving->num_documents + successor->num_documents;
+    node_leave(leaving);
+    CHORD_TEST_ASSERT_EQ(leaving->num_documents, 0, "Leaver holds nothing");
+    CHORD_TEST_ASSERT_EQ(successor->num_documents, total, "Successor took it all");
+    CHORD_TEST_ASSERT_TRUE(successor->predecessor->successor == successor, "Neighbours linked");
+    nodes[3] = nodes[RING_NODES];
+    CHORD_TEST_ASSERT_EQ(documents_placed(nodes, RING_NODES), 256, "Every document placed");
+    CHORD_TEST_ASSERT_TRUE(node_find_successor(nodes[0], leaving->key) == successor,
+                           "Lookups skip the leaver");
+
+    nodes[RING_NODES] = fresh_node(nodes, RING_NODES, "handoff");
+    node_join_copy(nodes[0], nodes[RING_NODES]);
+    CHORD_TEST_ASSERT_TRUE(nodes[RING_NODES]->num_documents > 0, "node_join_copy joiner took documents");
+    CHORD_TEST_ASSERT_EQ(documents_placed(nodes, RING_NODES + 1), 256, "Every document placed");
+    for (int round = 0; round < 4; round++) {
+        for (int i = RING_NODES; i >= 0; i--) {
+            node_stabilise(nodes[i]);
+        }
+    }
+
+    /* three joiners sharing the widest gap, one elsewhere */
+    wide = nodes[0];
+    for (int i = 1; i <= RING_NODES; i++) {
+        if (key_distance(nodes[i]->predecessor->key, nodes[i]->key)
+            > key_distance(wide->predecessor->key, wide->key)) {
+            wide = nodes[i];
+        }
+    }
+    for (int j = 0; j < 3; j++) {
+        nodes[RING_NODES + 1 + j] = gap_node(nodes, RING_NODES + 1 + j, wide);
+    }
+    nodes[RING_NODES + 4] = gap_node(nodes, RING_NODES + 4, wide->successor);
+    node_join_batch(nodes[0], &nodes[RING_NODES + 1], 4);
+    for (int j = 1; j <= 4; j++) {
+        CHORD_TEST_ASSERT_TRUE(nodes[RING_NODES + j]->num_documents > 0,
+                               "node_join_batch joiner took documents");
+    }
+    CHORD_TEST_ASSERT_EQ(documents_placed(nodes, RING_NODES + 5), 256, "Every document placed");
+}
+
+static void test_balance(void) {
+    CHORD_TEST("node_balance moves light nodes into a hot range");
+
+    static Document docs[96];
+    Node *nodes[RING_NODES];
+    Node *hot;
+    Node *loose;
+    int moved = 0;
+    int most_before = 0;
+    int most = 0;
+
+    make_ring(nodes, RING_NODES, "balance", FINGER_FIX_ALL);
+    hot = nodes[0];
+    for (int i = 1; i < RING_NODES; i++) {
+        if (key_distance(nodes[i]->predecessor->key, nodes[i]->key)
+            > key_distance(hot->predecessor->key, hot->key)) {
+            hot = nodes[i];
+        }
+    }
+    for (int d = 0; d < 96; d++) {
+        /* every key from the hot node's predecessor's to its own */
+        docs[d].key = (hot->predecessor->key + 1
+                       + d % key_distance(hot->predecessor->key, hot->key)) % ring_key_max();
+        node_document_keep(hot, &docs[d]);
+    }
+    most_before = hot->num_documents;
+
+    for (int round = 0; round < 16; round++) {
+        for (int i = 0; i < RING_NODES; i++) {
+            moved += node_balance(nodes[i], nodes[(i * 7 + round * 5) % RING_NODES]);
+        }
+        for (int pass = 0; pass < 2; pass++) {
+            for (int i = RING_NODES - 1; i >= 0; i--) {
+                node_stabilise(nodes[i]);
+                node_fix_fingers(nodes[i]);
+            }
+        }
+    }
+    for (int i = 0; i < RING_NODES; i++) {
+        most = nodes[i]->num_documents > most ? nodes[i]->num_documents : most;
+    }
+
+    CHORD_TEST_ASSERT_TRUE(moved > 0, "Light nodes moved");
+    CHORD_TEST_ASSERT_TRUE(most * 4 <= most_before, "Hottest node holds a quarter or less");
+    CHORD_TEST_ASSERT_EQ(documents_placed(nodes, RING_NODES), 96, "Every document at its successor");
+    CHORD_TEST_ASSERT_FALSE(node_balance(nodes[0], nodes[0]), "No probe of itself");
+    loose = fresh_node(nodes, RING_NODES, "loose");
+    CHORD_TEST_ASSERT_FALSE(node_balance(loose, hot), "Unjoined node does not move");
+    CHORD_TEST_ASSERT_FALSE(node_balance(hot, loose), "Unjoined node is not sampled");
+    for (int key = 0; key < ring_key_max(); key++) {
+        CHORD_TEST_ASSERT_TRUE(node_find_successor(nodes[key % RING_NODES], key)
+                               == true_successor(nodes, RING_NODES, key), "Ring intact");
+    }
+}
+
+int main(void) {
+    CHORD_TEST_INIT();
+
+    CHORD_RUN_TEST(test_node_lookup);
+    CHORD_RUN_TEST(test_fix_fingers_policies_converge);
+    CHORD_RUN_TEST(test_fix_fingers_next);
+    CHORD_RUN_TEST(test_fix_fingers_messages);
+    CHORD_RUN_TEST(test_join_copy);
+    CHORD_RUN_TEST(test_join_batch);
+    CHORD_RUN_TEST(test_maintain_adaptive);
+    CHORD_RUN_TEST(test_routing_view);
+    CHORD_RUN_TEST(test_finger_base);
+    CHORD_RUN_TEST(test_one_hop);
+    CHORD_RUN_TEST(test_handoff);
+    CHORD_RUN_TEST(test_balance);
+
+    CHORD_TEST_FINI();
+}
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "../chord_test.h"
+#include "../../src/util/trace.h"
+
+/*
+ * Unit tests for trace.c - lookup tracing ring buffers
+ *
+ * Built with CHORD_TRACE=1 so the TRACE* macros are live.
+ *
+ * Tests cover:
+ * - Scopes allocate a lookup ID and nested scopes join it
+ * - Dump/load round trip preserves records in time order
+ * - Buffers wrap and keep the most recent records
+ * - Each thread writes its own buffer
+ */
+
+#define TEST_TRACE_FILE "build/tests/unit/test_trace.bin"
+
+static void test_trace_scope_ids(void) {
+    CHORD_TEST("trace scopes share lookup IDs");
+
+    trace_reset();
+
+    uint32_t outer = TRACE_SCOPE_BEGIN(TRACE_EV_CLI_BEGIN, 10, 200);
+    uint32_t cli_id = trace_tls_lookup_id;
+    CHORD_TEST_ASSERT_EQ(outer, 0, "No enclosing lookup");
+    CHORD_TEST_ASSERT_NE(cli_id, 0, "CLI scope allocated a lookup ID");
+
+    uint32_t inner = TRACE_SCOPE_BEGIN(TRACE_EV_LOOKUP_BEGIN, 10, 200);
+    CHORD_TEST_ASSERT_EQ(inner, cli_id, "Nested lookup sees the CLI ID as outer");
+    CHORD_TEST_ASSERT_EQ(trace_tls_lookup_id, cli_id, "Nested lookup joins the CLI ID");
+    TRACE(TRACE_EV_LOOKUP_HOP, 42, 1);
+    TRACE_SCOPE_END(inner, TRACE_EV_LOOKUP_END, 210, 200);
+
+    CHORD_TEST_ASSERT_EQ(trace_tls_lookup_id, cli_id, "Inner end restores CLI ID");
+    TRACE_SCOPE_END(outer, TRACE_EV_CLI_END, 10, 200);
+    CHORD_TEST_ASSERT_EQ(trace_tls_lookup_id, 0, "Outer end clears lookup ID");
+
+    uint32_t next = TRACE_SCOPE_BEGIN(TRACE_EV_LOOKUP_BEGIN, 10, 5);
+    CHORD_TEST_ASSERT_TRUE(trace_tls_lookup_id != cli_id, "New lookup gets a new ID");
+    TRACE_SCOPE_END(next, TRACE_EV_LOOKUP_END, 10, 5);
+}
+
+static void test_trace_dump_roundtrip(void) {
+    CHORD_TEST("trace dump and load round trip");
+
+    trace_reset();
+
+    uint32_t outer = TRACE_SCOPE_BEGIN(TRACE_EV_LOOKUP_BEGIN, 1, 77);
+    TRACE(TRACE_EV_LOOKUP_HOP, 1, 1);
+    TRACE(TRACE_EV_LOOKUP_HOP, 50, 2);
+    TRACE_SCOPE_END(outer, TRACE_EV_LOOKUP_END, 80, 77);
+
+    CHORD_TEST_ASSERT_EQ(trace_dump(TEST_TRACE_FILE), 0, "Dump succeeds");
+
+    trace_dump_t dump;
+    CHORD_TEST_ASSERT_EQ(trace_dump_load(TEST_TRACE_FILE, &dump), 0, "Load succeeds");
+    CHORD_TEST_ASSERT_EQ((int)dump.count, 4, "Four records loaded");
+    CHORD_TEST_ASSERT_TRUE(dump.ns_per_tick > 0.0, "Clock calibration is positive");
+
+    CHORD_TEST_ASSERT_EQ(dump.records[0].event, TRACE_EV_LOOKUP_BEGIN, "First is BEGIN");
+    CHORD_TEST_ASSERT_EQ(dump.records[0].arg, 77, "BEGIN carries key");
+    CHORD_TEST_ASSERT_EQ(dump.records[2].node_key, 50, "Second hop node key");
+    CHORD_TEST_ASSERT_EQ(dump.records[3].event, TRACE_EV_LOOKUP_END, "Last is END");
+    CHORD_TEST_ASSERT_EQ(dump.records[3].lookup_id, dump.records[0].lookup_id,
+                         "All records share the lookup ID");
+    for (size_t i = 1; i < dump.count; i++) {
+        CHORD_TEST_ASSERT_TRUE(dump.records[i].timestamp >= dump.records[i - 1].timestamp,
+                               "Records sorted by time");
+    }
+
+    trace_dump_free(&dump);
+    remove(TEST_TRACE_FILE);
+}
+
+static void test_trace_wraparound(void) {
+    CHORD_TEST("trace buffer keeps most recent records");
+
+    trace_reset();
+
+    for (int i = 0; i < TRACE_BUFFER_RECORDS + 10; i++) {
+        TRACE(TRACE_EV_LOOKUP_HOP, i, 0);
+    }
+
+    CHORD_TEST_ASSERT_EQ(trace_dump(TEST_TRACE_FILE), 0, "Dump succeeds");
+
+    trace_dump_t dump;
+    CHORD_TEST_ASSERT_EQ(trace_dump_load(TEST_TRACE_FILE, &dump), 0, "Load succeeds");
+    CHORD_TEST_ASSERT_EQ((int)dump.count, TRACE_BUFFER_RECORDS, "Buffer capped at capacity");
+    CHORD_TEST_ASSERT_EQ(dump.records[0].node_key, 10, "Oldest records overwritten");
+    CHORD_TEST_ASSERT_EQ(dump.records[dump.count - 1].node_key, TRACE_BUFFER_RECORDS + 9,
+                         "Newest record kept");
+
+    trace_dump_free(&dump);
+    remove(TEST_TRACE_FILE);
+}
+
+static void* trace_thread_main(void *arg) {
+    (void)arg;
+    TRACE(TRACE_EV_LOOKUP_HOP, 999, 0);
+    return NULL;
+}
+
+static void test_trace_per_thread(void) {
+    CHORD_TEST("trace threads write separate buffers");
+
+    trace_reset();
+
+    TRACE(TRACE_EV_LOOKUP_HOP, 1, 0);
+
+    pthread_t thread;
+    CHORD_TEST_ASSERT_EQ(pthread_create(&thread, NULL, trace_thread_main, NULL), 0,
+                         "Thread created");
+    pthread_join(thread, NULL);
+
+    CHORD_TEST_ASSERT_EQ(trace_dump(TEST_TRACE_FILE), 0, "Dump succeeds");
+
+    trace_dump_t dump;
+    CHORD_TEST_ASSERT_EQ(trace_dump_load(TEST_TRACE_FILE, &dump), 0, "Load succeeds");
+    CHORD_TEST_ASSERT_EQ((int)dump.count, 2, "Both threads' records loaded");
+    CHORD_TEST_ASSERT_TRUE(dump.records[0].thread != dump.records[1].thread,
+                           "Records come from distinct thread buffers");
+
+    trace_dump_free(&dump);
+    remove(TEST_TRACE_FILE);
+}
+
+int main(void) {
+    CHORD_TEST_INIT();
+
+    CHORD_RUN_TEST(test_trace_scope_ids);
+    CHORD_RUN_TEST(test_trace_dump_roundtrip);
+    CHORD_RUN_TEST(test_trace_wraparound);
+    CHORD_RUN_TEST(test_trace_per_thread);
+
+    CHORD_TEST_FINI();
+}